@@ -0,0 +1,629 @@
+// Microbenchmarks of the input path, the passes and the full frame.
+//
+// Runs on any Vulkan device; a software device such as lavapipe keeps the
+// numbers comparable between CI machines:
+//
+//   export VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json
+//   ./build/vulkanio_bench --out bench.json --baseline baseline.json
+//
+// Every benchmark is reported as the median and the median absolute
+// deviation (MAD) of its samples, which a few outliers (page faults, a
+// preempted thread) don't move. A benchmark regresses when its median is more
+// than --threshold percent and more than three MADs above the baseline's.
+//
+// The modes that produce a denoised frame (the GPU frame and the CPU backend
+// with each of its kernel tables) also report its quality: PSNR, SSIM and
+// FLIP-lite of the second frame's TNR2 output against the CPU reference
+// chain's. A mode regresses in quality when its PSNR drops more than
+// --quality-threshold dB below the baseline's.
+//
+// Last, the sequence is denoised again with one and with two frames in
+// flight. The TNR2 outputs must be identical, or the run fails.
+#include "CpuDenoiser.hpp"
+#include "ImageMetrics.hpp"
+#include "PixelConvert.hpp"
+#include "VulkanRenderer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct BenchOptions {
+  uint32_t width = 1920;
+  uint32_t height = 864;
+  int warmup = 5;
+  int iterations = 50;
+  std::string output;   // JSON results; empty: don't write
+  std::string baseline; // JSON results of an earlier run to compare with
+  double threshold = 10.0; // Percent
+  bool quality = true;
+  double qualityThreshold = 1.0; // PSNR drop in dB
+  // The CPU backend takes seconds per frame at full size.
+  int cpuWarmup = 1;
+  int cpuIterations = 5;
+};
+
+// Frames of the synthetic sequence; quality is scored on the last one.
+const int SEQUENCE_FRAMES = 2;
+
+struct BenchResult {
+  std::string name;
+  std::vector<double> samples; // Milliseconds
+  bool hasQuality = false;
+  QualityScores quality;
+};
+
+struct BenchSummary {
+  std::string name;
+  size_t count = 0;
+  double median = 0.0;
+  double mad = 0.0;
+  double min = 0.0;
+  double max = 0.0;
+  double mean = 0.0;
+  bool hasQuality = false;
+  QualityScores quality;
+};
+
+static double median(std::vector<double> values) {
+  if (values.empty()) {
+    return 0.0;
+  }
+  std::sort(values.begin(), values.end());
+  size_t middle = values.size() / 2;
+  return values.size() % 2 ? values[middle]
+                           : (values[middle - 1] + values[middle]) / 2.0;
+}
+
+static BenchSummary summarize(const BenchResult &result) {
+  BenchSummary summary;
+  summary.name = result.name;
+  summary.count = result.samples.size();
+  summary.hasQuality = result.hasQuality;
+  summary.quality = result.quality;
+  if (result.samples.empty()) {
+    return summary;
+  }
+  summary.median = median(result.samples);
+  std::vector<double> deviations;
+  double sum = 0.0;
+  for (double sample : result.samples) {
+    deviations.push_back(std::abs(sample - summary.median));
+    sum += sample;
+  }
+  summary.mad = median(deviations);
+  summary.min = *std::min_element(result.samples.begin(), result.samples.end());
+  summary.max = *std::max_element(result.samples.begin(), result.samples.end());
+  summary.mean = sum / result.samples.size();
+  return summary;
+}
+
+// Wall time of fn, after warmup untimed calls.
+template <typename Fn>
+static BenchResult timeCpu(const std::string &name, const BenchOptions &options,
+                           Fn fn) {
+  using Clock = std::chrono::steady_clock;
+  BenchResult result;
+  result.name = name;
+  for (int i = 0; i < options.warmup; i++) {
+    fn();
+  }
+  for (int i = 0; i < options.iterations; i++) {
+    Clock::time_point start = Clock::now();
+    fn();
+    result.samples.push_back(
+        std::chrono::duration<double, std::milli>(Clock::now() - start)
+            .count());
+  }
+  return result;
+}
+
+// One result per line, so readBaseline() doesn't need a JSON parser.
+static void writeJson(const std::string &path, const std::string &device,
+                      const BenchOptions &options,
+                      const std::vector<BenchSummary> &summaries) {
+  std::ofstream out(path);
+  if (!out) {
+    throw std::runtime_error("failed to open " + path + "!");
+  }
+  out << "{\n  \"device\": \"" << device << "\",\n  \"width\": "
+      << options.width << ",\n  \"height\": " << options.height
+      << ",\n  \"unit\": \"ms\",\n  \"benchmarks\": [\n";
+  out << std::setprecision(6);
+  for (size_t i = 0; i < summaries.size(); i++) {
+    const BenchSummary &s = summaries[i];
+    out << "    {\"name\": \"" << s.name << "\", \"samples\": " << s.count
+        << ", \"median\": " << s.median << ", \"mad\": " << s.mad
+        << ", \"min\": " << s.min << ", \"max\": " << s.max
+        << ", \"mean\": " << s.mean;
+    if (s.hasQuality) {
+      out << ", \"psnr\": " << s.quality.psnr << ", \"ssim\": "
+          << s.quality.ssim << ", \"flip\": " << s.quality.flip;
+    }
+    out << "}"
+        << (i + 1 < summaries.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+}
+
+static double jsonNumber(const std::string &line, const std::string &key) {
+  size_t at = line.find("\"" + key + "\": ");
+  if (at == std::string::npos) {
+    return 0.0;
+  }
+  return std::stod(line.substr(at + key.size() + 4));
+}
+
+// Reads a file written by writeJson(): name -> summary.
+static std::map<std::string, BenchSummary>
+readBaseline(const std::string &path) {
+  std::ifstream in(path);
+  if (!in) {
+    throw std::runtime_error("failed to open baseline " + path + "!");
+  }
+  std::map<std::string, BenchSummary> baseline;
+  std::string line;
+  const std::string NAME_KEY = "{\"name\": \"";
+  while (std::getline(in, line)) {
+    size_t at = line.find(NAME_KEY);
+    if (at == std::string::npos) {
+      continue;
+    }
+    size_t begin = at + NAME_KEY.size();
+    BenchSummary summary;
+    summary.name = line.substr(begin, line.find('"', begin) - begin);
+    summary.median = jsonNumber(line, "median");
+    summary.mad = jsonNumber(line, "mad");
+    summary.hasQuality = line.find("\"psnr\": ") != std::string::npos;
+    summary.quality.psnr = jsonNumber(line, "psnr");
+    summary.quality.ssim = jsonNumber(line, "ssim");
+    summary.quality.flip = jsonNumber(line, "flip");
+    baseline[summary.name] = summary;
+  }
+  return baseline;
+}
+
+// The synthetic sequence's directory, removed however the run ends (no
+// Vulkan device is the common failure).
+class TemporaryDirectory {
+public:
+  TemporaryDirectory()
+      : path(fs::temp_directory_path() /
+             ("vulkanio_bench_" + std::to_string(std::random_device()()))) {}
+  ~TemporaryDirectory() {
+    std::error_code error;
+    fs::remove_all(path, error);
+  }
+  TemporaryDirectory(const TemporaryDirectory &) = delete;
+  TemporaryDirectory &operator=(const TemporaryDirectory &) = delete;
+
+  const fs::path path;
+};
+
+// Sends std::cerr to another buffer until the end of the scope.
+class CerrRedirect {
+public:
+  explicit CerrRedirect(std::streambuf *buffer)
+      : saved(std::cerr.rdbuf(buffer)) {}
+  ~CerrRedirect() { std::cerr.rdbuf(saved); }
+  CerrRedirect(const CerrRedirect &) = delete;
+  CerrRedirect &operator=(const CerrRedirect &) = delete;
+
+private:
+  std::streambuf *saved;
+};
+
+// Writes a small synthetic sequence: two frames of every input channel, with
+// content that changes per pixel, channel and frame.
+static void writeSequence(const fs::path &directory, uint32_t width,
+                          uint32_t height) {
+  static const std::string *prefixes[] = {
+      &COLOR_FILE_PREFIX, &DEPTH_FILE_PREFIX, &NORMAL_FILE_PREFIX,
+      &ALBEDO_FILE_PREFIX, &MV_FILE_PREFIX};
+  fs::create_directories(directory);
+  std::ofstream(directory / "sequence.txt")
+      << "width=" << width << "\nheight=" << height
+      << "\nframes=" << SEQUENCE_FRAMES << "\n";
+
+  SequenceInfo sequence;
+  sequence.directory = directory.string();
+  std::vector<uint8_t> pixels((size_t)width * height * 4);
+  for (int frame = 0; frame < SEQUENCE_FRAMES; frame++) {
+    for (int c = 0; c < 5; c++) {
+      for (size_t i = 0; i < pixels.size(); i++) {
+        size_t x = (i / 4) % width, y = (i / 4) / width;
+        pixels[i] = static_cast<uint8_t>((x ^ y) + 37 * c + 11 * frame + i);
+      }
+      std::ofstream(sequence.framePath(*prefixes[c], frame), std::ios::binary)
+          .write(reinterpret_cast<const char *>(pixels.data()), pixels.size());
+    }
+  }
+}
+
+// The five channels of every frame of the sequence, rows top to bottom as
+// the renderer uploads them.
+using SequenceFrames = std::vector<std::vector<std::vector<uint8_t>>>;
+
+static SequenceFrames loadFrames(const fs::path &directory) {
+  static const std::string *prefixes[] = {
+      &COLOR_FILE_PREFIX, &DEPTH_FILE_PREFIX, &NORMAL_FILE_PREFIX,
+      &ALBEDO_FILE_PREFIX, &MV_FILE_PREFIX};
+  SequenceInfo sequence = SequenceInfo::load(directory.string());
+  SequenceFrames frames(SEQUENCE_FRAMES);
+  for (int frame = 0; frame < SEQUENCE_FRAMES; frame++) {
+    for (int c = 0; c < 5; c++) {
+      std::vector<uint8_t> pixels(sequence.frameBytes());
+      std::ifstream(sequence.framePath(*prefixes[c], frame), std::ios::binary)
+          .read(reinterpret_cast<char *>(pixels.data()), pixels.size());
+      flipRows(pixels.data(), (size_t)sequence.width * 4, sequence.height);
+      frames[frame].push_back(std::move(pixels));
+    }
+  }
+  return frames;
+}
+
+// Scores the TNR2 output of a mode's last sequence frame, rendered from a
+// fresh history, against the CPU reference chain's (the golden image).
+class QualityJudge {
+public:
+  QualityJudge(const SequenceFrames &frames, uint32_t width, uint32_t height) {
+    RefHistory history;
+    for (const std::vector<std::vector<uint8_t>> &channels : frames) {
+      RefImage inputs[5];
+      for (int c = 0; c < 5; c++) {
+        inputs[c] = RefImage::fromUnorm8(channels[c].data(), width, height);
+      }
+      golden = referenceFrame(inputs, history);
+    }
+  }
+
+  QualityScores score(const RefImage &output) {
+    return metrics.compare(golden, output);
+  }
+
+private:
+  RefImage golden;
+  ImageMetrics metrics;
+};
+
+// The CPU backend with one kernel table, denoising the sequence's frames in
+// turn. judge (optional) scores the first pass over the sequence.
+static BenchResult benchCpuDenoiser(const CpuKernelTable &kernels,
+                                    const BenchOptions &options,
+                                    const SequenceFrames &frames,
+                                    QualityJudge *judge) {
+  const uint8_t *inputs[SEQUENCE_FRAMES][5];
+  for (int f = 0; f < SEQUENCE_FRAMES; f++) {
+    for (int c = 0; c < 5; c++) {
+      inputs[f][c] = frames[f][c].data();
+    }
+  }
+  CpuDenoiser denoiser(options.width, options.height, 0, &kernels);
+  QualityScores quality;
+  if (judge) {
+    for (int f = 0; f < SEQUENCE_FRAMES; f++) {
+      denoiser.process(inputs[f]);
+    }
+    std::vector<uint16_t> output((size_t)options.width * options.height * 4);
+    denoiser.readOutput(OutputPixels::RGBA16F, output.data());
+    quality = judge->score(
+        RefImage::fromHalf(output.data(), options.width, options.height));
+  }
+
+  BenchOptions cpuOptions = options;
+  cpuOptions.warmup = options.cpuWarmup;
+  cpuOptions.iterations = options.cpuIterations;
+  int frame = 0;
+  BenchResult result =
+      timeCpu("cpu/frame/" + std::string(kernels.name), cpuOptions, [&] {
+        denoiser.process(inputs[frame++ % SEQUENCE_FRAMES]);
+      });
+  result.hasQuality = judge != nullptr;
+  result.quality = quality;
+  return result;
+}
+
+// Drives a headless renderer through the benchmarks with its step-by-step
+// interface.
+class RendererBench {
+public:
+  RendererBench(const BenchOptions &options, const fs::path &directory,
+                QualityJudge *judge)
+      : options(options), directory(directory), judge(judge) {
+    RendererConfig config;
+    config.sequenceDirectories = {directory.string()};
+    config.headless = true;
+    config.framesInFlight = 1; // Nothing overlaps the frame being timed
+    config.gpuProfile = true;
+    config.gpuProfileInterval = 0.0;
+    renderer = std::make_unique<VulkanRenderer>(config);
+    renderer->initHeadless();
+  }
+
+  ~RendererBench() { renderer->shutdown(); }
+
+  std::string deviceName() const { return renderer->getDeviceName(); }
+
+  std::vector<BenchResult> run() {
+    std::vector<BenchResult> results;
+    VulkanRenderer &r = *renderer;
+    void *staging = r.getInputStaging();
+    SequenceInfo sequence = SequenceInfo::load(directory.string());
+
+    // The quality run goes first, while the history images hold no earlier
+    // frames.
+    QualityScores quality;
+    if (judge) {
+      for (int f = 0; f < SEQUENCE_FRAMES; f++) {
+        r.renderFrame();
+      }
+      quality = judge->score(r.readbackTnr2());
+    }
+
+    // The failure paths log every call; keep them out of the output.
+    {
+      std::ostringstream discarded;
+      CerrRedirect redirect(discarded.rdbuf());
+      results.push_back(timeCpu("loadRawImage/hit", options, [&] {
+        r.loadInput(sequence.framePath(COLOR_FILE_PREFIX, 0));
+      }));
+      // A missing frame that wraps around to frame 0
+      results.push_back(timeCpu("loadRawImage/fallback", options, [&] {
+        r.loadInput(sequence.framePath(COLOR_FILE_PREFIX, 999),
+                    sequence.pathPrefix(COLOR_FILE_PREFIX));
+      }));
+      results.push_back(timeCpu("loadRawImage/missing", options, [&] {
+        r.loadInput(sequence.framePath(COLOR_FILE_PREFIX, 999));
+      }));
+      fs::path truncated = directory / "truncated.raw";
+      std::ofstream(truncated, std::ios::binary) << "short";
+      results.push_back(timeCpu("loadRawImage/wrong_size", options, [&] {
+        r.loadInput(truncated.string());
+      }));
+    }
+
+    results.push_back(timeCpu("flipRows", options, [&] {
+      flipRows(staging, (size_t)options.width * 4, options.height);
+    }));
+    // Five channels, each a synchronous staging-to-image copy. Frames
+    // record their uploads instead; this is the cost they no longer pay.
+    results.push_back(
+        timeCpu("upload", options, [&] { r.uploadInput(); }));
+    // Load, record (with the uploads), submit and wait for the GPU
+    results.push_back(timeCpu("frame", options, [&] { r.renderFrame(); }));
+    results.back().hasQuality = judge != nullptr;
+    results.back().quality = quality;
+
+    // Pass times from the timestamps of the frames above. One stream and
+    // one frame in flight, so no other work overlaps a pass.
+    r.renderFrame(); // Collects the last frame's timestamps
+    const GpuProfiler &profiler = r.getGpuProfiler();
+    std::vector<GpuProfiler::PassStats> passes = profiler.getStats();
+    for (size_t p = 0; p < passes.size(); p++) {
+      BenchResult result;
+      result.name = "pass/" + passes[p].name;
+      result.samples = profiler.getSamples(p);
+      // Keep the timed frames only (the warmup ones come first).
+      if (result.samples.size() > (size_t)options.iterations) {
+        result.samples.erase(result.samples.begin(),
+                             result.samples.end() - options.iterations);
+      }
+      results.push_back(result);
+    }
+    return results;
+  }
+
+private:
+  BenchOptions options;
+  fs::path directory;
+  QualityJudge *judge;
+  std::unique_ptr<VulkanRenderer> renderer;
+};
+
+// TNR2 of the sequence's last frame, denoised from a fresh history with the
+// given number of frames in flight.
+static RefImage renderSequence(const fs::path &directory, int framesInFlight) {
+  RendererConfig config;
+  config.sequenceDirectories = {directory.string()};
+  config.headless = true;
+  config.framesInFlight = framesInFlight;
+  VulkanRenderer renderer(config);
+  renderer.initHeadless();
+  for (int f = 0; f < SEQUENCE_FRAMES; f++) {
+    renderer.renderFrame();
+  }
+  RefImage tnr2 = renderer.readbackTnr2();
+  renderer.shutdown();
+  return tnr2;
+}
+
+// Frames in flight decide how far the CPU runs ahead, never what the GPU
+// computes; the descriptor sets follow the TNR history, not the frame
+// context. Returns 1 if one and two frames in flight give different TNR2.
+static int checkFramesInFlight(const fs::path &directory) {
+  RefImage single = renderSequence(directory, 1);
+  RefImage dual = renderSequence(directory, 2);
+  size_t differing = 0;
+  for (size_t i = 0; i + 4 <= single.texels.size(); i += 4) {
+    differing += !std::equal(&single.texels[i], &single.texels[i] + 4,
+                             &dual.texels[i]);
+  }
+  if (differing > 0) {
+    std::cout << "frames in flight: TNR2 with 1 and 2 differs in "
+              << differing << " pixels" << std::endl;
+    return 1;
+  }
+  std::cout << "frames in flight: TNR2 with 1 and 2 is identical"
+            << std::endl;
+  return 0;
+}
+
+// Prints the results next to the baseline; returns the number of
+// regressions in speed or quality.
+static int compare(const std::vector<BenchSummary> &summaries,
+                   const std::map<std::string, BenchSummary> &baseline,
+                   const BenchOptions &options) {
+  int regressions = 0;
+  std::cout << std::fixed << std::setprecision(3);
+  std::cout << std::left << std::setw(26) << "benchmark" << std::right
+            << std::setw(11) << "median ms" << std::setw(10) << "MAD"
+            << std::setw(8) << "PSNR" << std::setw(8) << "SSIM"
+            << std::setw(8) << "FLIP" << std::setw(12) << "baseline"
+            << std::setw(10) << "change" << std::endl;
+  for (const BenchSummary &s : summaries) {
+    std::cout << std::left << std::setw(26) << s.name << std::right
+              << std::setw(11) << s.median << std::setw(10) << s.mad;
+    if (s.hasQuality) {
+      std::cout << std::setprecision(2) << std::setw(8) << s.quality.psnr
+                << std::setprecision(4) << std::setw(8) << s.quality.ssim
+                << std::setw(8) << s.quality.flip << std::setprecision(3);
+    } else {
+      std::cout << std::setw(24) << "";
+    }
+    auto base = baseline.find(s.name);
+    if (base != baseline.end() && base->second.median > 0.0) {
+      double change = 100.0 * (s.median / base->second.median - 1.0);
+      double noise = 3.0 * std::max(s.mad, base->second.mad);
+      bool regressed = change > options.threshold &&
+                       s.median - base->second.median > noise;
+      bool qualityRegressed =
+          s.hasQuality && base->second.hasQuality &&
+          s.quality.psnr < base->second.quality.psnr - options.qualityThreshold;
+      regressions += regressed + qualityRegressed;
+      std::cout << std::setw(12) << base->second.median << std::setw(9)
+                << std::setprecision(1) << std::showpos << change
+                << std::noshowpos << "%" << std::setprecision(3)
+                << (regressed ? "  REGRESSION" : "")
+                << (qualityRegressed ? "  QUALITY REGRESSION" : "");
+    }
+    std::cout << std::endl;
+  }
+  std::cout << std::defaultfloat;
+  return regressions;
+}
+
+static void printUsage(const char *program) {
+  std::cout
+      << "Usage: " << program << " [options]\n"
+      << "  --size <w>x<h>     frame size (default: 1920x864)\n"
+      << "  --iterations <n>   timed runs per benchmark (default: 50)\n"
+      << "  --warmup <n>       untimed runs first (default: 5)\n"
+      << "  --out <file>       write the results as JSON\n"
+      << "  --baseline <file>  compare with the JSON of an earlier run\n"
+      << "  --threshold <pct>  slowdown that counts as a regression "
+         "(default: 10)\n"
+      << "  --quality-threshold <dB>  PSNR drop that counts as a regression "
+         "(default: 1)\n"
+      << "  --cpu-iterations <n>  timed runs of the CPU backend (default: 5)\n"
+      << "  --no-quality       skip the quality scores (and the CPU "
+         "reference chain\n"
+      << "                     they need, seconds per frame)\n"
+      << "Exits with 2 when a benchmark regressed." << std::endl;
+}
+
+int main(int argc, char **argv) {
+  try {
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      if (arg == "--size" && i + 1 < argc) {
+        std::string size = argv[++i];
+        size_t x = size.find('x');
+        if (x == std::string::npos) {
+          throw std::runtime_error("--size needs <width>x<height>!");
+        }
+        options.width = std::stoul(size.substr(0, x));
+        options.height = std::stoul(size.substr(x + 1));
+      } else if (arg == "--iterations" && i + 1 < argc) {
+        options.iterations = std::max(1, std::stoi(argv[++i]));
+      } else if (arg == "--warmup" && i + 1 < argc) {
+        options.warmup = std::max(0, std::stoi(argv[++i]));
+      } else if (arg == "--out" && i + 1 < argc) {
+        options.output = argv[++i];
+      } else if (arg == "--baseline" && i + 1 < argc) {
+        options.baseline = argv[++i];
+      } else if (arg == "--threshold" && i + 1 < argc) {
+        options.threshold = std::stod(argv[++i]);
+      } else if (arg == "--quality-threshold" && i + 1 < argc) {
+        options.qualityThreshold = std::stod(argv[++i]);
+      } else if (arg == "--cpu-iterations" && i + 1 < argc) {
+        options.cpuIterations = std::max(1, std::stoi(argv[++i]));
+      } else if (arg == "--no-quality") {
+        options.quality = false;
+      } else if (arg == "--help" || arg == "-h") {
+        printUsage(argv[0]);
+        return EXIT_SUCCESS;
+      } else {
+        std::cerr << "Unknown argument: " << arg << std::endl;
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+      }
+    }
+
+    TemporaryDirectory directory;
+    writeSequence(directory.path, options.width, options.height);
+    SequenceFrames frames = loadFrames(directory.path);
+    std::unique_ptr<QualityJudge> judge;
+    if (options.quality) {
+      judge = std::make_unique<QualityJudge>(frames, options.width,
+                                             options.height);
+    }
+
+    std::vector<BenchSummary> summaries;
+    std::string device;
+    {
+      RendererBench bench(options, directory.path, judge.get());
+      device = bench.deviceName();
+      for (const BenchResult &result : bench.run()) {
+        summaries.push_back(summarize(result));
+      }
+    }
+
+    std::vector<const CpuKernelTable *> cpuKernels = {&baselineCpuKernels()};
+    if (avx2CpuKernels()) {
+      cpuKernels.push_back(avx2CpuKernels());
+    }
+    for (const CpuKernelTable *kernels : cpuKernels) {
+      summaries.push_back(summarize(
+          benchCpuDenoiser(*kernels, options, frames, judge.get())));
+    }
+
+    std::map<std::string, BenchSummary> baseline;
+    if (!options.baseline.empty()) {
+      baseline = readBaseline(options.baseline);
+    }
+    std::cout << "=== vulkanio_bench (" << device << ", " << options.width
+              << "x" << options.height << ") ===" << std::endl;
+    int regressions = compare(summaries, baseline, options);
+    regressions += checkFramesInFlight(directory.path);
+    if (!options.output.empty()) {
+      writeJson(options.output, device, options, summaries);
+      std::cout << "Results written to " << options.output << std::endl;
+    }
+    if (regressions > 0) {
+      std::cout << regressions << " regression(s): slower by more than "
+                << options.threshold << "% or PSNR lower by more than "
+                << options.qualityThreshold
+                << " dB, or TNR2 depending on the frames in flight"
+                << std::endl;
+      return 2;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,23 @@
+#!/bin/bash
+# Measures how aggregate throughput scales with the number of streams processed
+# side by side on one GPU. Runs batch mode without writing outputs, so only
+# loading, uploads, rendering and readback are timed.
+#
+#   ./bench_streams.sh [sequence dir] [frames] [stream counts...]
+SEQUENCE=${1:-nvt_2026_01_23_11_43_31_45}
+FRAMES=${2:-100}
+COUNTS=${*:3}
+COUNTS=${COUNTS:-1 2 4 8}
+PLAYER=./build/VulkanImagePlayer
+
+printf "%-8s %12s %12s\n" streams "frames/s" "aggregate"
+for N in $COUNTS; do
+    LINE=$($PLAYER --sequence "$SEQUENCE" --streams "$N" --batch --frames "$FRAMES" | grep "^Batch:")
+    if [ -z "$LINE" ]; then
+        echo "run with $N streams failed" >&2
+        exit 1
+    fi
+    FPS=$(echo "$LINE" | sed -E 's/.*\(([0-9.]+) fps.*/\1/')
+    AGGREGATE=$(echo "$LINE" | sed -E 's/.*, ([0-9.]+) stream frames.*/\1/')
+    printf "%-8s %12s %12s\n" "$N" "$FPS" "$AGGREGATE"
+done
@@ -8,6 +8,10 @@ num_frames = 150
 def generate_frames():
     output_dir = "nvt_2026_01_23_11_43_31_45"
     os.makedirs(output_dir, exist_ok=True)
+
+    # Sequence metadata read by the player (resolution and length)
+    with open(os.path.join(output_dir, "sequence.txt"), "w") as f:
+        f.write(f"width={width}\nheight={height}\nframes={num_frames}\n")
     
     for i in range(num_frames):
         t = i / num_frames
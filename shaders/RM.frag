@@ -59,10 +59,16 @@ float getSceneLinearDepth(vec2 uv) {
     return depthNorm * FAR;
 }
 
+// Aspect ratio of the input sequence (any resolution).
+float ScreenAspect() {
+    vec2 size = vec2(textureSize(texSampler, 0));
+    return size.x / size.y;
+}
+
 vec2 PostoUV(vec3 pos, vec3 ro) {
     vec3 p_rel = pos - ro;
     vec2 v_uv;
-    v_uv.x = (p_rel.x / p_rel.z) / (1920.0 / 864.0);
+    v_uv.x = (p_rel.x / p_rel.z) / ScreenAspect();
     v_uv.y = -(p_rel.y / p_rel.z);
     return (v_uv + 1.0) * 0.5;
 }
@@ -123,7 +129,7 @@ float Hash(vec2 p) {
 void main() {
     vec2 correctedUV = fragTexCoord;
     vec2 ndc = correctedUV * 2.0 - 1.0;
-    float aspect = 1920.0 / 864.0;
+    float aspect = ScreenAspect();
     vec3 ro = vec3(0, 1, 0); 
     vec3 rd = normalize(vec3(ndc.x * aspect, -ndc.y, 1.0)); 
     
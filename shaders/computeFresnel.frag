@@ -7,14 +7,17 @@ layout(location = 0) in vec2 fragTexCoord;
 layout(location = 0) out vec4 fresnel_out0;
 
 // Constants approximating UI variables from CompleteRT
-const vec2 SizeScreen = vec2(1920.0, 864.0);
 const float UI_SpecularIntensity = 1.0;
 const float SkyDepth = 0.9999;
 const float nearplan = 0.25;
 const float farplan = 1000.0;
-const float CFX_aspectRatio = SizeScreen.x/SizeScreen.y;
 const float FOV = 45.0;
-const vec2 pix = 1.0 / SizeScreen;
+
+// Screen size is taken from the depth input in main(), so the shader works
+// at any sequence resolution.
+vec2 SizeScreen;
+float CFX_aspectRatio;
+vec2 pix;
 
 vec3 UVtoPos(vec2 uv, float depth) {
     // Approximate view position reconstruction
@@ -75,6 +78,10 @@ vec3 ComputeNormal(vec2 uv) {
 }
 
 void main() {
+    SizeScreen = vec2(textureSize(depthSampler, 0));
+    CFX_aspectRatio = SizeScreen.x/SizeScreen.y;
+    pix = 1.0 / SizeScreen;
+
     float depth = read_depth(fragTexCoord);
     
     //vec3 normal = texture(normalSampler, fragTexCoord).rgb;
@@ -0,0 +1,129 @@
+#include "BottleneckClassifier.hpp"
+#include <iomanip>
+
+namespace {
+
+const char *PHASE_NAMES[BottleneckClassifier::PHASE_COUNT] = {
+    "load", "upload", "record", "GPU wait", "present",
+    "input wait", "output wait", "loader busy"};
+
+// What each render-thread phase means when it dominates
+const char *DIAGNOSES[BottleneckClassifier::PHASE_COUNT] = {
+    "I/O-bound: reading input files (try batch mode, whose loader runs ahead, "
+    "or faster storage)",
+    "upload-bound: synchronous input uploads (batch mode records them into "
+    "the frame's command buffer)",
+    "CPU-record-bound: recording and submitting command buffers",
+    "GPU-bound: the GPU is the limit (see --gpu-profile for the passes)",
+    "present-bound: waiting on the swapchain (vsync or the compositor)",
+    "I/O-bound: the render thread waits for the loader",
+    "output-bound: the encoders can't keep up (--encoder-threads, or a "
+    "cheaper --output-format)",
+    ""};
+
+} // namespace
+
+void BottleneckClassifier::start(double reportInterval) {
+  this->reportInterval = reportInterval;
+  begin = snapshot();
+  lastReport = begin;
+}
+
+void BottleneckClassifier::add(Phase phase, Clock::duration duration) {
+  nanos[phase].fetch_add(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(),
+      std::memory_order_relaxed);
+}
+
+void BottleneckClassifier::sampleInputQueue(size_t depth, size_t capacity) {
+  queueCapacity = capacity;
+  queueSamples.fetch_add(1, std::memory_order_relaxed);
+  queueDepthSum.fetch_add(depth, std::memory_order_relaxed);
+}
+
+BottleneckClassifier::Totals BottleneckClassifier::snapshot() const {
+  Totals totals;
+  for (int p = 0; p < PHASE_COUNT; p++) {
+    totals.nanos[p] = nanos[p].load(std::memory_order_relaxed);
+  }
+  totals.frames = frames.load(std::memory_order_relaxed);
+  totals.queueSamples = queueSamples.load(std::memory_order_relaxed);
+  totals.queueDepthSum = queueDepthSum.load(std::memory_order_relaxed);
+  totals.time = Clock::now();
+  return totals;
+}
+
+void BottleneckClassifier::printReport(std::ostream &out,
+                                       double gpuMsPerFrame) const {
+  printDiagnosis(out, begin, snapshot(), gpuMsPerFrame, "run");
+}
+
+void BottleneckClassifier::maybePrintPeriodic(std::ostream &out,
+                                              double gpuMsPerFrame) {
+  if (reportInterval <= 0.0) {
+    return;
+  }
+  Totals now = snapshot();
+  if (std::chrono::duration<double>(now.time - lastReport.time).count() <
+      reportInterval) {
+    return;
+  }
+  printDiagnosis(out, lastReport, now, gpuMsPerFrame, "last interval");
+  lastReport = now;
+}
+
+void BottleneckClassifier::printDiagnosis(std::ostream &out,
+                                          const Totals &from, const Totals &to,
+                                          double gpuMsPerFrame,
+                                          const char *title) const {
+  double wall = std::chrono::duration<double>(to.time - from.time).count();
+  uint64_t frameCount = to.frames - from.frames;
+  if (wall <= 0.0 || frameCount == 0) {
+    return;
+  }
+  auto seconds = [&](int phase) {
+    return (to.nanos[phase] - from.nanos[phase]) * 1e-9;
+  };
+
+  // The largest share of render thread time names the bottleneck.
+  int dominant = Load;
+  for (int p = 0; p < LoaderBusy; p++) {
+    if (seconds(p) > seconds(dominant)) {
+      dominant = p;
+    }
+  }
+
+  double frameMs = 1000.0 * wall / frameCount;
+  out << "=== Bottleneck (" << title << ", " << frameCount
+      << " frames) ===" << std::endl;
+  out << std::fixed << std::setprecision(1);
+  out << "  " << DIAGNOSES[dominant] << std::endl;
+  out << "  frame time " << std::setprecision(2) << frameMs << " ms:";
+  const char *separator = " ";
+  for (int p = 0; p < LoaderBusy; p++) {
+    if (seconds(p) > 0.0) {
+      out << separator << PHASE_NAMES[p] << " " << std::setprecision(1)
+          << 100.0 * seconds(p) / wall << "%";
+      separator = ", ";
+    }
+  }
+  out << std::endl;
+  if (seconds(LoaderBusy) > 0.0 || to.queueSamples > from.queueSamples) {
+    out << std::setprecision(1) << "  loader busy "
+        << 100.0 * seconds(LoaderBusy) / wall << "%";
+    uint64_t samples = to.queueSamples - from.queueSamples;
+    if (samples > 0) {
+      out << ", input queue " << std::setprecision(2)
+          << (double)(to.queueDepthSum - from.queueDepthSum) / samples
+          << " of " << queueCapacity << " on average";
+    }
+    out << std::endl;
+  }
+  if (gpuMsPerFrame > 0.0) {
+    out << "  GPU passes " << std::setprecision(2) << gpuMsPerFrame
+        << " ms/frame (" << std::setprecision(1)
+        << 100.0 * gpuMsPerFrame / frameMs << "% of the frame time)"
+        << std::endl;
+  }
+  out << std::defaultfloat;
+}
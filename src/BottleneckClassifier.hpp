@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// Names what limited a run from where the render thread spent its time.
+//
+// The render thread either works (loading, uploading, recording) or blocks
+// (on the GPU, the swapchain, the loader or the encoders); whichever phase
+// takes the largest share of its time is the bottleneck. The loader thread's
+// busy time and the input queue depth are reported alongside: a busy loader
+// with an empty queue confirms an I/O-bound run.
+//
+// add() may be called from any thread; reports come from the render thread.
+class BottleneckClassifier {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum Phase {
+        Load,       // Reading input files on the render thread
+        Upload,     // Synchronous staging-to-image uploads
+        Record,     // Recording and submitting command buffers
+        GpuWait,    // Waiting on frame context fences
+        Present,    // Acquiring and presenting swapchain images
+        InputWait,  // Waiting for the loader thread (batch)
+        OutputWait, // Waiting for the encoders to free a readback slot (batch)
+        LoaderBusy, // Loader thread reading files (batch, not render thread time)
+        PHASE_COUNT
+    };
+
+    class Scope {
+    public:
+        Scope(BottleneckClassifier& classifier, Phase phase)
+            : classifier(classifier), phase(phase), start(Clock::now()) {}
+        ~Scope() { classifier.add(phase, Clock::now() - start); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        BottleneckClassifier& classifier;
+        Phase phase;
+        Clock::time_point start;
+    };
+
+    void start(double reportInterval); // Seconds; 0: no periodic reports
+    void add(Phase phase, Clock::duration duration);
+    void frameDone() { frames.fetch_add(1, std::memory_order_relaxed); }
+    // Depth of the loaded-input queue, sampled before each pop (batch).
+    void sampleInputQueue(size_t depth, size_t capacity);
+
+    // gpuMsPerFrame: summed GPU pass times per frame when profiling, else 0.
+    void printReport(std::ostream& out, double gpuMsPerFrame) const;
+    // Prints the diagnosis of the last interval once it has elapsed.
+    void maybePrintPeriodic(std::ostream& out, double gpuMsPerFrame);
+
+private:
+    struct Totals {
+        uint64_t nanos[PHASE_COUNT] = {};
+        uint64_t frames = 0;
+        uint64_t queueSamples = 0;
+        uint64_t queueDepthSum = 0;
+        Clock::time_point time;
+    };
+
+    Totals snapshot() const;
+    void printDiagnosis(std::ostream& out, const Totals& from, const Totals& to, double gpuMsPerFrame,
+                        const char* title) const;
+
+    std::atomic<uint64_t> nanos[PHASE_COUNT] = {};
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> queueSamples{0};
+    std::atomic<uint64_t> queueDepthSum{0};
+    size_t queueCapacity = 0;
+
+    Totals begin;      // At start()
+    Totals lastReport; // At the last periodic report
+    double reportInterval = 0.0;
+};
@@ -0,0 +1,209 @@
+#include "CpuBatch.hpp"
+#include "BoundedQueue.hpp"
+#include "CpuDenoiser.hpp"
+#include "CpuTracer.hpp"
+#include "PixelConvert.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <thread>
+
+namespace {
+
+using CpuBatchClock = std::chrono::steady_clock;
+
+double secondsSince(CpuBatchClock::time_point start) {
+  return std::chrono::duration<double>(CpuBatchClock::now() - start).count();
+}
+
+// Frames to time per thread count in the scaling report, after one warm-up.
+const int SCALING_FRAMES = 8;
+
+// The five inputs of one frame, rows top to bottom like the GPU uploads.
+struct CpuInputFrame {
+  std::vector<uint8_t> channels[5];
+  const uint8_t *pixels[5] = {};
+};
+
+void loadChannel(const std::string &path, const SequenceInfo &sequence,
+                 std::vector<uint8_t> &pixels) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    // Running from the build directory
+    file.open("../" + path, std::ios::binary);
+  }
+  pixels.resize(sequence.frameBytes());
+  if (!file.read(reinterpret_cast<char *>(pixels.data()), pixels.size())) {
+    throw std::runtime_error("failed to read " + path + "!");
+  }
+  flipRows(pixels.data(), (size_t)sequence.width * 4, sequence.height);
+}
+
+void loadFrame(const SequenceInfo &sequence, int frameIndex,
+               CpuInputFrame &frame) {
+  const std::string *prefixes[5] = {&COLOR_FILE_PREFIX, &DEPTH_FILE_PREFIX,
+                                    &NORMAL_FILE_PREFIX, &ALBEDO_FILE_PREFIX,
+                                    &MV_FILE_PREFIX};
+  for (int c = 0; c < 5; c++) {
+    loadChannel(sequence.framePath(*prefixes[c], frameIndex), sequence,
+                frame.channels[c]);
+    frame.pixels[c] = frame.channels[c].data();
+  }
+}
+
+SequenceInfo loadSequence(const RendererConfig &config) {
+  if (config.sequenceDirectories.size() != 1) {
+    throw std::runtime_error("the CPU backend processes a single stream!");
+  }
+  SequenceInfo sequence = SequenceInfo::load(config.sequenceDirectories[0]);
+  if (config.firstFrame < 0 || config.firstFrame >= sequence.frameCount) {
+    throw std::runtime_error("first frame is outside the sequence!");
+  }
+  return sequence;
+}
+
+} // namespace
+
+void runCpuBatch(const RendererConfig &config) {
+  SequenceInfo sequence = loadSequence(config);
+  if (!config.traceOutput.empty()) {
+    CpuTracer::enable();
+    CpuTracer::setThreadName("main");
+  }
+  int firstFrame = config.firstFrame;
+  int frameCount = config.frameCount > 0 ? config.frameCount
+                                         : sequence.frameCount - firstFrame;
+  int lastFrame = std::min(firstFrame + frameCount, sequence.frameCount);
+
+  CpuDenoiser denoiser(sequence.width, sequence.height, config.cpuThreads);
+  OutputPixels pixels = config.outputSource == OutputSource::TNR2
+                            ? OutputPixels::RGBA16F
+                            : OutputPixels::BGRA8;
+  size_t outputBytes = (size_t)sequence.width * sequence.height *
+                       (pixels == OutputPixels::RGBA16F ? 8 : 4);
+
+  // The encoder's workers share the cores with the denoiser, which keeps
+  // all of them busy; one is enough unless asked for more.
+  std::unique_ptr<OutputEncoder> encoder;
+  if (!config.outputDirectory.empty()) {
+    std::filesystem::create_directories(config.outputDirectory);
+    encoder = std::make_unique<OutputEncoder>(
+        config.outputDirectory,
+        config.outputSource == OutputSource::TNR2 ? "tnr2_" : "final_",
+        config.outputFormat, pixels, sequence.width, sequence.height,
+        std::max(1u, config.encoderThreads));
+  }
+  // Output buffers cycle between the denoiser and the encoder.
+  const size_t outputSlots = encoder ? encoder->getWorkerCount() + 2 : 1;
+  std::vector<std::vector<uint8_t>> outputs(outputSlots,
+                                            std::vector<uint8_t>(outputBytes));
+  BoundedQueue<size_t> freeOutputs(outputSlots);
+  for (size_t slot = 0; slot < outputSlots; slot++) {
+    freeOutputs.push(slot);
+  }
+
+  std::cout << "CPU batch: " << sequence.directory << ", " << sequence.width
+            << "x" << sequence.height << ", " << denoiser.getKernelName()
+            << " kernels on " << denoiser.getThreadCount() << " thread(s)"
+            << std::endl;
+
+  CpuInputFrame input;
+  double loadBusy = 0.0;
+  double denoiseBusy = 0.0;
+  CpuBatchClock::time_point batchStart = CpuBatchClock::now();
+  for (int frame = firstFrame; frame < lastFrame; frame++) {
+    CpuBatchClock::time_point start = CpuBatchClock::now();
+    loadFrame(sequence, frame, input);
+    loadBusy += secondsSince(start);
+
+    start = CpuBatchClock::now();
+    denoiser.process(input.pixels);
+    size_t slot = *freeOutputs.pop();
+    denoiser.readOutput(pixels, outputs[slot].data());
+    denoiseBusy += secondsSince(start);
+
+    if (encoder) {
+      encoder->submit(frame, outputs[slot].data(),
+                      [&freeOutputs, slot]() { freeOutputs.push(slot); });
+    } else {
+      freeOutputs.push(slot);
+    }
+  }
+  if (encoder) {
+    encoder->finish();
+  }
+
+  double wallTime = secondsSince(batchStart);
+  int frames = denoiser.getFrameCount();
+  auto percent = [&](double seconds) {
+    return wallTime > 0.0 ? 100.0 * seconds / wallTime : 0.0;
+  };
+  std::cout << std::fixed << std::setprecision(1) << "CPU batch: " << frames
+            << " frames in " << wallTime << " s ("
+            << (wallTime > 0.0 ? frames / wallTime : 0.0) << " fps)"
+            << std::endl
+            << "  load busy " << percent(loadBusy) << "%, denoise busy "
+            << percent(denoiseBusy) << "%" << std::defaultfloat << std::endl;
+  denoiser.printStageTimes(std::cout);
+  if (encoder) {
+    encoder->printStats();
+  }
+  if (CpuTracer::isEnabled()) {
+    size_t events = CpuTracer::writeChromeTrace(config.traceOutput);
+    std::cout << "CPU trace (" << events << " events) written to "
+              << config.traceOutput << std::endl;
+  }
+}
+
+void runCpuScaling(const RendererConfig &config) {
+  SequenceInfo sequence = loadSequence(config);
+  int frameCount = std::min(SCALING_FRAMES + 1,
+                            sequence.frameCount - config.firstFrame);
+  if (frameCount < 2) {
+    throw std::runtime_error("the scaling report needs at least 2 frames!");
+  }
+  std::vector<CpuInputFrame> inputs(frameCount);
+  for (int f = 0; f < frameCount; f++) {
+    loadFrame(sequence, config.firstFrame + f, inputs[f]);
+  }
+
+  unsigned maxThreads = config.cpuThreads;
+  if (maxThreads == 0) {
+    maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  std::vector<unsigned> threadCounts;
+  for (unsigned threads = 1; threads < maxThreads; threads *= 2) {
+    threadCounts.push_back(threads);
+  }
+  threadCounts.push_back(maxThreads);
+
+  std::cout << "CPU scaling: " << sequence.width << "x" << sequence.height
+            << ", " << frameCount - 1 << " timed frame(s) per run, "
+            << std::thread::hardware_concurrency() << " core(s)" << std::endl
+            << "  threads      fps  speedup  efficiency  steals" << std::endl;
+  double baseFps = 0.0;
+  for (unsigned threads : threadCounts) {
+    CpuDenoiser denoiser(sequence.width, sequence.height, threads);
+    // The first frame warms the caches and the page tables of the planes.
+    denoiser.process(inputs[0].pixels);
+    CpuBatchClock::time_point start = CpuBatchClock::now();
+    for (int f = 1; f < frameCount; f++) {
+      denoiser.process(inputs[f].pixels);
+    }
+    double seconds = secondsSince(start);
+    double fps = seconds > 0.0 ? (frameCount - 1) / seconds : 0.0;
+    if (baseFps == 0.0) {
+      baseFps = fps;
+    }
+    double speedup = baseFps > 0.0 ? fps / baseFps : 0.0;
+    std::cout << std::fixed << std::setprecision(2) << "  " << std::setw(7)
+              << threads << std::setw(9) << fps << std::setw(9) << speedup
+              << std::setw(11) << std::setprecision(0)
+              << 100.0 * speedup / threads << "%" << std::setw(8)
+              << denoiser.getStealCount() << std::defaultfloat << std::endl;
+  }
+}
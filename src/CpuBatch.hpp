@@ -0,0 +1,14 @@
+#pragma once
+
+#include "VulkanRenderer.hpp"
+
+// Batch mode on the CPU backend (CpuDenoiser) instead of the GPU: the first
+// sequence's frames [firstFrame, firstFrame + frameCount), written like the
+// GPU batch output when config.outputDirectory is set. Creates no Vulkan
+// objects.
+void runCpuBatch(const RendererConfig& config);
+
+// Times the CPU backend on the first frames of the sequence with 1, 2, 4, ...
+// up to config.cpuThreads (default: every core) threads and prints the
+// frame rate, speedup and parallel efficiency of each.
+void runCpuScaling(const RendererConfig& config);
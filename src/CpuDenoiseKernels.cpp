@@ -0,0 +1,18 @@
+// Baseline build of the CPU denoise kernels and the ISA dispatch.
+#include "CpuDenoiseKernels.inl"
+
+#if defined(CPU_DENOISE_AVX2)
+// CpuDenoiseKernelsAvx2.cpp
+const CpuKernelTable &avx2CpuKernelTable();
+#endif
+
+const CpuKernelTable &baselineCpuKernels() { return KERNELS; }
+
+const CpuKernelTable *avx2CpuKernels() {
+#if defined(CPU_DENOISE_AVX2)
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return &avx2CpuKernelTable();
+  }
+#endif
+  return nullptr;
+}
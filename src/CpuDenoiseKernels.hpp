@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Data layout and kernel entry points of the CPU denoise backend
+// (CpuDenoiser.hpp). Images are structure-of-arrays: one float plane per
+// channel, all with the same size and stride, and CPU_PLANE_BORDER pixels of
+// border around each that repeat the edge pixels. Neighbour reads and
+// bilinear taps therefore never clamp, which is what the renderer's
+// clamp-to-edge samplers would return. Kernels run on one tile of the
+// image; the caller spreads the tiles over threads and refills the borders
+// of every plane a kernel wrote before the next kernel reads it.
+
+// Widest kernel footprint: SNR2's and Fresnel's +-2 pixels.
+const int CPU_PLANE_BORDER = 2;
+
+struct CpuPlane {
+    float* origin = nullptr; // Pixel (0, 0)
+    ptrdiff_t stride = 0;    // Floats per row, the same for every plane
+};
+
+// Everything the kernels read and write for one frame. History pairs are
+// indexed with `read` (the previous frame's results) and `written`.
+struct CpuFrame {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    const uint8_t* inputs[5] = {}; // DenoiseChannel order, RGBA8, top row first
+
+    // Unpacked inputs
+    CpuPlane depthDS;      // depthDS.frag's normalized linear depth
+    CpuPlane packedDepth;  // The packed depth's low byte; TNR2 samples it raw
+    CpuPlane fresnelDepth; // computeFresnel.frag's read_depth()
+    CpuPlane motion[2];    // Decoded motion vector in uv units
+    CpuPlane color[3];     // RM's scene color; its borders wrap around (texSampler repeats)
+
+    CpuPlane rm[3];
+    CpuPlane tnrColor[3];
+    CpuPlane tnrInfo[2][3]; // History length, luminance second moment, depth
+    CpuPlane snr[2][3];
+    CpuPlane blur[3]; // SNR2's horizontal pass
+    CpuPlane snr2[3];
+    CpuPlane fresnel;
+    CpuPlane tnr2[2][3]; // Its alpha is the fresnel plane
+    int read = 0;
+    int written = 1;
+};
+
+// Pixels [x0, x1) x [y0, y1). x0 is a multiple of 8, so SIMD loops only run
+// past x1 at the right edge of the image, into the border and padding.
+struct CpuTile {
+    uint32_t x0, y0, x1, y1;
+};
+
+using CpuKernel = void (*)(const CpuFrame& frame, const CpuTile& tile);
+
+struct CpuKernelTable {
+    const char* name; // "avx2", "neon" or "scalar"
+    int lanes;
+    CpuKernel unpack;         // Inputs -> color, depthDS, packedDepth, fresnelDepth, motion
+    CpuKernel rm;             // -> rm
+    CpuKernel tnr;            // -> tnrColor, tnrInfo[written]
+    CpuKernel snr;            // -> snr[written]
+    CpuKernel snr2Horizontal; // -> blur
+    CpuKernel snr2Vertical;   // -> snr2
+    CpuKernel fresnel;        // -> fresnel
+    CpuKernel tnr2;           // -> tnr2[written]
+};
+
+// Built for the baseline ISA of the target (NEON on AArch64).
+const CpuKernelTable& baselineCpuKernels();
+// Null when the build has no AVX2 kernels or the CPU lacks AVX2/FMA.
+const CpuKernelTable* avx2CpuKernels();
@@ -0,0 +1,487 @@
+// Kernel bodies of the CPU denoise backend, included by
+// CpuDenoiseKernels.cpp (baseline ISA) and CpuDenoiseKernelsAvx2.cpp. Each
+// kernel is the vectorized form of its fragment shader: SIMD_WIDTH
+// horizontally adjacent fragments per iteration, with branches turned into
+// lane selects. CpuReference.cpp has the scalar ports they are checked
+// against.
+
+#include "CpuDenoiseKernels.hpp"
+#include "CpuSimd.hpp"
+#include "PixelConvert.hpp"
+
+namespace {
+
+const float NEAR_PLANE = 0.25f;
+const float FAR_PLANE = 1000.0f;
+
+inline float* pixel(const CpuPlane& plane, ptrdiff_t offset) { return plane.origin + offset; }
+inline VFloat loadAt(const CpuPlane& plane, ptrdiff_t offset) { return load(plane.origin + offset); }
+inline VFloat3 loadAt(const CpuPlane* planes, ptrdiff_t offset) {
+    return {loadAt(planes[0], offset), loadAt(planes[1], offset), loadAt(planes[2], offset)};
+}
+inline void storeAt(const CpuPlane* planes, ptrdiff_t offset, const VFloat3& value) {
+    store(pixel(planes[0], offset), value.x);
+    store(pixel(planes[1], offset), value.y);
+    store(pixel(planes[2], offset), value.z);
+}
+inline VFloat3 mix(const VFloat3& a, const VFloat3& b, VFloat t) {
+    return {mix(a.x, b.x, t), mix(a.y, b.y, t), mix(a.z, b.z, t)};
+}
+
+// Texture coordinates of the fragments at x, x + 1, ... in one row.
+inline VFloat fragU(uint32_t x, uint32_t width) { return (lanes() + ((float)x + 0.5f)) / (float)width; }
+inline VFloat fragV(uint32_t y, uint32_t height) { return splat(((float)y + 0.5f) / (float)height); }
+
+// Bilinear taps at uv, as a linear sampler with clamp-to-edge filters: the
+// top-left texel's offset and the weights. Coordinates are clamped to the
+// first border pixel, whose copies of the edge make the taps clamp too.
+struct Bilinear {
+    VInt offset;
+    VFloat a;
+    VFloat b;
+    ptrdiff_t stride;
+};
+
+inline Bilinear bilinear(VFloat u, VFloat v, const CpuFrame& frame, ptrdiff_t stride) {
+    VFloat x = u * (float)frame.width - 0.5f;
+    VFloat y = v * (float)frame.height - 0.5f;
+    VFloat x0 = floor(x);
+    VFloat y0 = floor(y);
+    Bilinear taps;
+    taps.a = x - x0;
+    taps.b = y - y0;
+    VInt xi = toInt(clamp(x0, -1.0f, (float)frame.width - 1.0f));
+    VInt yi = toInt(clamp(y0, -1.0f, (float)frame.height - 1.0f));
+    taps.offset = yi * (int32_t)stride + xi;
+    taps.stride = stride;
+    return taps;
+}
+
+inline VFloat sample(const CpuPlane& plane, const Bilinear& taps) {
+    VFloat t00 = gather(plane.origin, taps.offset);
+    VFloat t10 = gather(plane.origin + 1, taps.offset);
+    VFloat t01 = gather(plane.origin + taps.stride, taps.offset);
+    VFloat t11 = gather(plane.origin + taps.stride + 1, taps.offset);
+    return mix(mix(t00, t10, taps.a), mix(t01, t11, taps.a), taps.b);
+}
+
+// TNR.frag's and TNR2.frag's decodeMotion(): RGB888 holding R10G10, each
+// component a signed square.
+inline float decodeMotionComponent(uint32_t bits) {
+    float norm = (float)bits / 1023.0f;
+    float m = (norm - 0.5f) * 2.0f;
+    return norm < 0.5f ? -m * m : m * m;
+}
+
+inline float linearizeDepth(uint32_t packed) {
+    float z = (float)packed / 16777215.0f;
+    float linearDepth = (NEAR_PLANE * FAR_PLANE) / (FAR_PLANE - z * (FAR_PLANE - NEAR_PLANE));
+    return linearDepth < FAR_PLANE ? linearDepth / FAR_PLANE : 1.0f;
+}
+
+void unpackKernel(const CpuFrame& frame, const CpuTile& tile) {
+    ptrdiff_t stride = frame.depthDS.stride;
+    for (uint32_t y = tile.y0; y < tile.y1; y++) {
+        for (uint32_t x = tile.x0; x < tile.x1; x++) {
+            size_t i = ((size_t)y * frame.width + x) * 4;
+            ptrdiff_t offset = (ptrdiff_t)y * stride + x;
+            const uint8_t* color = frame.inputs[0] + i;
+            const uint8_t* depth = frame.inputs[1] + i;
+            const uint8_t* mv = frame.inputs[4] + i;
+
+            // depthDS.frag takes the low byte unscaled (uint(packedDepth.r)
+            // is 1 only for 255) and scales the middle one by 256. Its
+            // output is RGBA16F.
+            uint32_t packed = (depth[0] == 255 ? 1u : 0u) +
+                              ((uint32_t)(depth[1] / 255.0f * 256.0f + 0.5f) << 8) +
+                              ((uint32_t)depth[2] << 16);
+            float depthDS = halfToFloat(floatToHalf(linearizeDepth(packed)));
+            *pixel(frame.depthDS, offset) = depthDS;
+            *pixel(frame.fresnelDepth, offset) =
+                linearizeDepth(depth[0] + ((uint32_t)depth[1] << 8) + ((uint32_t)depth[2] << 16));
+            *pixel(frame.packedDepth, offset) = depth[0] / 255.0f;
+
+            uint32_t bits = ((uint32_t)mv[0] << 16) | ((uint32_t)mv[1] << 8) | mv[2];
+            *pixel(frame.motion[0], offset) = decodeMotionComponent(bits & 0x3FFu);
+            *pixel(frame.motion[1], offset) = decodeMotionComponent((bits >> 10) & 0x3FFu);
+
+            for (int c = 0; c < 3; c++) {
+                *pixel(frame.color[c], offset) = color[c] / 255.0f;
+            }
+        }
+    }
+}
+
+void tnrKernel(const CpuFrame& frame, const CpuTile& tile) {
+    ptrdiff_t stride = frame.depthDS.stride;
+    const CpuPlane* historyColor = frame.snr[frame.read];
+    const CpuPlane* historyInfo = frame.tnrInfo[frame.read];
+    for (uint32_t y = tile.y0; y < tile.y1; y++) {
+        VFloat v = fragV(y, frame.height);
+        for (uint32_t x = tile.x0; x < tile.x1; x += SIMD_WIDTH) {
+            ptrdiff_t offset = (ptrdiff_t)y * stride + x;
+            VFloat u = fragU(x, frame.width);
+            VFloat3 current = loadAt(frame.rm, offset);
+            VFloat depth = loadAt(frame.depthDS, offset);
+
+            VFloat pastU = u + loadAt(frame.motion[0], offset);
+            VFloat pastV = v + loadAt(frame.motion[1], offset);
+            VMask inbound = (pastU >= 0.0f) & (pastU <= 1.0f) & (pastV >= 0.0f) & (pastV <= 1.0f);
+
+            Bilinear taps = bilinear(pastU, pastV, frame, stride);
+            VFloat3 history = {sample(historyColor[0], taps), sample(historyColor[1], taps),
+                               sample(historyColor[2], taps)};
+            VFloat historyLength = sample(historyInfo[0], taps);
+            VFloat tm2 = sample(historyInfo[1], taps);
+            VFloat pastDepth = sample(historyInfo[2], taps);
+
+            VMask keep = inbound & !(abs(depth - pastDepth) > 0.01f);
+            historyLength = select(keep, historyLength, splat(0.0f));
+            historyLength = min(historyLength, splat(32.0f)) + 1.0f;
+
+            VFloat lum = dot(current, {splat(0.299f), splat(0.587f), splat(0.114f)});
+            VFloat lum2 = lum * lum;
+            tm2 = select(historyLength > 4.0f, mix(tm2, lum2, 1.0f / historyLength), lum2);
+
+            VFloat3 result = mix(history, current, 1.0f / (historyLength + 1e-7f));
+            storeAt(frame.tnrColor, offset, result);
+            const CpuPlane* info = frame.tnrInfo[frame.written];
+            store(pixel(info[0], offset), historyLength);
+            store(pixel(info[1], offset), tm2);
+            store(pixel(info[2], offset), depth);
+        }
+    }
+}
+
+// SNR reads the TNR info written this frame, as SNR.frag does.
+void snrKernel(const CpuFrame& frame, const CpuTile& tile) {
+    ptrdiff_t stride = frame.depthDS.stride;
+    float spatial[3][3];
+    for (int j = -1; j <= 1; j++) {
+        for (int i = -1; i <= 1; i++) {
+            spatial[j + 1][i + 1] = expf(-(float)(i * i + j * j) / 2.0f);
+        }
+    }
+    for (uint32_t y = tile.y0; y < tile.y1; y++) {
+        for (uint32_t x = tile.x0; x < tile.x1; x += SIMD_WIDTH) {
+            ptrdiff_t offset = (ptrdiff_t)y * stride + x;
+            VFloat centerDepth = loadAt(frame.depthDS, offset);
+            VFloat historyLength = loadAt(frame.tnrInfo[frame.written][0], offset);
+
+            VFloat3 sum = {splat(0.0f), splat(0.0f), splat(0.0f)};
+            VFloat weightSum = splat(0.0f);
+            for (int j = -1; j <= 1; j++) {
+                for (int i = -1; i <= 1; i++) {
+                    ptrdiff_t neighbour = offset + j * stride + i;
+                    VFloat depthDiff = centerDepth - loadAt(frame.depthDS, neighbour);
+                    VFloat range = exp(splat(0.0f) - depthDiff * depthDiff / 0.01f);
+                    VFloat w = range * spatial[j + 1][i + 1];
+                    sum = sum + loadAt(frame.tnrColor, neighbour) * w;
+                    weightSum = weightSum + w;
+                }
+            }
+            // A stable history (more than 10 frames) keeps only the center,
+            // whose weight is 1.
+            VFloat3 result = select(historyLength > 10.0f, loadAt(frame.tnrColor, offset),
+                                    sum * (1.0f / weightSum));
+            storeAt(frame.snr[frame.written], offset, result);
+        }
+    }
+}
+
+// SNR2.frag's 5x5 Gaussian (sigma 2) is separable: exp(-(x^2 + y^2) / 8) is
+// exp(-x^2 / 8) * exp(-y^2 / 8), and clamping each tap to the edge clamps
+// the two axes independently.
+const int SNR2_RADIUS = 2;
+
+void snr2Weights(float weights[2 * SNR2_RADIUS + 1], float& norm) {
+    float sum = 0.0f;
+    for (int k = -SNR2_RADIUS; k <= SNR2_RADIUS; k++) {
+        weights[k + SNR2_RADIUS] = expf(-(float)(k * k) / (2.0f * 2.0f * 2.0f));
+        sum += weights[k + SNR2_RADIUS];
+    }
+    norm = 1.0f / (sum * sum);
+}
+
+void snr2HorizontalKernel(const CpuFrame& frame, const CpuTile& tile) {
+    ptrdiff_t stride = frame.depthDS.stride;
+    float weights[2 * SNR2_RADIUS + 1];
+    float norm;
+    snr2Weights(weights, norm);
+    const CpuPlane* source = frame.snr[frame.written];
+    for (uint32_t y = tile.y0; y < tile.y1; y++) {
+        for (uint32_t x = tile.x0; x < tile.x1; x += SIMD_WIDTH) {
+            ptrdiff_t offset = (ptrdiff_t)y * stride + x;
+            VFloat3 sum = {splat(0.0f), splat(0.0f), splat(0.0f)};
+            for (int k = -SNR2_RADIUS; k <= SNR2_RADIUS; k++) {
+                sum = sum + loadAt(source, offset + k) * splat(weights[k + SNR2_RADIUS]);
+            }
+            storeAt(frame.blur, offset, sum);
+        }
+    }
+}
+
+void snr2VerticalKernel(const CpuFrame& frame, const CpuTile& tile) {
+    ptrdiff_t stride = frame.depthDS.stride;
+    float weights[2 * SNR2_RADIUS + 1];
+    float norm;
+    snr2Weights(weights, norm);
+    for (uint32_t y = tile.y0; y < tile.y1; y++) {
+        for (uint32_t x = tile.x0; x < tile.x1; x += SIMD_WIDTH) {
+            ptrdiff_t offset = (ptrdiff_t)y * stride + x;
+            VFloat3 sum = {splat(0.0f), splat(0.0f), splat(0.0f)};
+            for (int k = -SNR2_RADIUS; k <= SNR2_RADIUS; k++) {
+                sum = sum + loadAt(frame.blur, offset + k * stride) * splat(weights[k + SNR2_RADIUS]);
+            }
+            storeAt(frame.snr2, offset, sum * splat(norm));
+        }
+    }
+}
+
+// RM.frag as a packet ray marcher. Every lane traces its own primary ray and
+// reflection with the shader's loop logic; a packet keeps stepping while any
+// lane is active, and lanes that are done are masked off. Their state is
+// never read again, so it may go stale or even NaN.
+const int RM_MAX_STEPS = 100;
+const float RM_MAX_DIST = 100.0f;
+const float RM_SURF_DIST = 0.001f;
+const VFloat3 RM_ORIGIN = {splat(0.0f), splat(1.0f), splat(0.0f)};
+
+// GetDist(): min of the sphere at (0, 1, 6) with radius 1 and the ground
+VFloat rmDistance(const VFloat3& p) {
+    VFloat3 rel = {p.x, p.y - 1.0f, p.z - 6.0f};
+    return min(sqrt(dot(rel, rel)) - 1.0f, p.y);
+}
+
+VFloat rmRayMarch(const VFloat3& rd) {
+    VFloat distance = splat(0.0f);
+    VMask active = splat(0.0f) >= 0.0f; // All lanes
+    for (int i = 0; i < RM_MAX_STEPS && anyTrue(active); i++) {
+        VFloat step = rmDistance(RM_ORIGIN + rd * distance);
+        distance = select(active, distance + step, distance);
+        active = active & !((distance > RM_MAX_DIST) | (step < RM_SURF_DIST));
+    }
+    return distance;
+}
+
+VFloat3 rmNormal(const VFloat3& p) {
+    VFloat d = rmDistance(p);
+    VFloat e = splat(0.01f);
+    VFloat zero = splat(0.0f);
+    VFloat3 n = {d - rmDistance(p - VFloat3{e, zero, zero}), d - rmDistance(p - VFloat3{zero, e, zero}),
+                 d - rmDistance(p - VFloat3{zero, zero, e})};
+    return normalize(n);
+}
+
+// Hash(), without fused multiply-adds: its fract()s amplify rounding.
+VFloat rmHash(VFloat u, VFloat v) {
+    VFloat px = u * 123.34f;
+    VFloat py = v * 456.21f;
+    px = px - floor(px);
+    py = py - floor(py);
+    VFloat d = px * (px + 45.32f) + py * (py + 45.32f);
+    VFloat h = (px + d) * (py + d);
+    return h - floor(h);
+}
+
+// DoRayMarchSpecular() for the lanes in mask; -1 where nothing is hit. The
+// shader restarts its step counter after every back step, so each lane
+// counts its own.
+VFloat3 rmRayMarchSpecular(const CpuFrame& frame, ptrdiff_t stride, VMask mask, const VFloat3& position,
+                           const VFloat3& raydir, VFloat noise) {
+    const float raySteps = 120.0f;
+    const float backSteps = 15.0f;
+    const float rayInc = 1.0f + 1.0f / sqrtf(raySteps);
+    const float rcpRaySteps = 1.0f / raySteps;
+    const float aspect = (float)frame.width / (float)frame.height;
+
+    VFloat bias = (splat(0.0f) - position.z) * (1.0f / FAR_PLANE) * 5.0f;
+    VFloat stepLength = splat(0.04f) * (noise * 0.5f + 1.0f);
+    VFloat hitStep = stepLength;
+    VFloat3 raypos = position;
+    VFloat backCount = splat(0.0f);
+    VFloat stepCount = splat(0.0f);
+    VFloat3 result = {splat(-1.0f), splat(-1.0f), splat(-1.0f)};
+
+    VMask active = mask;
+    while (anyTrue(active)) {
+        raypos = raypos + raydir * stepLength;
+        VFloat viewZ = raypos.z; // The origin is at z = 0
+        VFloat3 rel = raypos - RM_ORIGIN;
+        VFloat u = ((rel.x / rel.z) / aspect + 1.0f) * 0.5f;
+        VFloat v = ((splat(0.0f) - rel.y / rel.z) + 1.0f) * 0.5f;
+        VMask inside = (viewZ >= 0.0f) & (viewZ <= FAR_PLANE) & (u >= 0.0f) & (u <= 1.0f) & (v >= 0.0f) &
+                       (v <= 1.0f);
+        active = active & inside;
+
+        Bilinear taps = bilinear(u, v, frame, stride);
+        VFloat error = sample(frame.depthDS, taps) * FAR_PLANE - viewZ;
+        VMask candidate = active & (error < bias) & (error > max(hitStep, splat(1.0f)) * -2.0f);
+        VMask backStep = candidate & (backCount < backSteps);
+        VMask hit = candidate & !backStep;
+        if (anyTrue(hit)) {
+            // texSampler repeats; the color planes' borders wrap around.
+            VFloat3 color = {sample(frame.color[0], taps), sample(frame.color[1], taps),
+                             sample(frame.color[2], taps)};
+            result = select(hit, color, result);
+            active = active & !hit;
+        }
+
+        raypos = select(backStep, raypos - raydir * stepLength, raypos);
+        stepLength = select(backStep, stepLength * rcpRaySteps, stepLength * rayInc);
+        backCount = select(backStep, backCount + 1.0f, backCount);
+        stepCount = select(backStep, splat(1.0f), stepCount + 1.0f);
+        hitStep = stepLength;
+        active = active & (stepCount < raySteps);
+    }
+    return result;
+}
+
+void rmKernel(const CpuFrame& frame, const CpuTile& tile) {
+    ptrdiff_t stride = frame.depthDS.stride;
+    const float aspect = (float)frame.width / (float)frame.height;
+    const VFloat3 lightPos = {splat(2.0f), splat(5.0f), splat(-1.0f)};
+    const VFloat3 groundColor = {splat(0.5f), splat(0.5f), splat(0.5f)};
+    const VFloat3 sphereColor = {splat(0.4f), splat(0.4f), splat(0.6f)};
+    for (uint32_t y = tile.y0; y < tile.y1; y++) {
+        VFloat v = fragV(y, frame.height);
+        for (uint32_t x = tile.x0; x < tile.x1; x += SIMD_WIDTH) {
+            ptrdiff_t offset = (ptrdiff_t)y * stride + x;
+            VFloat u = fragU(x, frame.width);
+            VFloat3 rd = normalize(VFloat3{(u * 2.0f - 1.0f) * aspect, 1.0f - v * 2.0f, splat(1.0f)});
+
+            VFloat3 sceneColor = loadAt(frame.color, offset);
+            VFloat sceneZ = loadAt(frame.depthDS, offset) * FAR_PLANE;
+            VFloat d = rmRayMarch(rd);
+            VMask hit = (d < RM_MAX_DIST) & (d < sceneZ);
+            if (!anyTrue(hit)) {
+                storeAt(frame.rm, offset, sceneColor);
+                continue;
+            }
+
+            VFloat3 p = RM_ORIGIN + rd * d;
+            VFloat3 n = rmNormal(p);
+            VFloat dif = clamp(dot(n, normalize(lightPos - p)), 0.2f, 1.0f);
+            VFloat3 base = select(p.y < 0.01f, groundColor, sphereColor) * dif;
+            VFloat3 reflDir = rd - n * (2.0f * dot(n, rd));
+            VFloat3 reflection = rmRayMarchSpecular(frame, stride, hit, p, reflDir, rmHash(u, v));
+            VFloat3 shaded = select(reflection.x >= 0.0f, mix(base, reflection, splat(0.7f)), base);
+            storeAt(frame.rm, offset, select(hit, shaded, sceneColor));
+        }
+    }
+}
+
+void fresnelKernel(const CpuFrame& frame, const CpuTile& tile) {
+    ptrdiff_t stride = frame.depthDS.stride;
+    const float aspect = (float)frame.width / (float)frame.height;
+    const float tanHalfFov = tanf(45.0f * 0.5f * 3.14159265359f / 180.0f);
+    const float pixX = 1.0f / (float)frame.width;
+    const float pixY = 1.0f / (float)frame.height;
+
+    for (uint32_t y = tile.y0; y < tile.y1; y++) {
+        VFloat v = fragV(y, frame.height);
+        for (uint32_t x = tile.x0; x < tile.x1; x += SIMD_WIDTH) {
+            ptrdiff_t offset = (ptrdiff_t)y * stride + x;
+            VFloat u = fragU(x, frame.width);
+            auto depthAt = [&](int dx, int dy) { return loadAt(frame.fresnelDepth, offset + dy * stride + dx); };
+            // UVtoPos() of the neighbour dx, dy pixels away
+            auto position = [&](int dx, int dy) {
+                VFloat z = depthAt(dx, dy) * FAR_PLANE;
+                VFloat ndcX = (u + (float)dx * pixX) * 2.0f - 1.0f;
+                VFloat ndcY = (v + (float)dy * pixY) * 2.0f - 1.0f;
+                return VFloat3{ndcX * z * (aspect * tanHalfFov), ndcY * z * tanHalfFov, z};
+            };
+
+            // ComputeNormal(): of the two one-sided differences per axis,
+            // take the one whose extrapolated depth stays closer to the
+            // center. "Left" is +x and "up" -y, as in the shader.
+            VFloat3 c = position(0, 0);
+            VFloat3 up = position(0, -1);
+            VFloat3 down = position(0, 1);
+            VFloat3 left = position(1, 0);
+            VFloat3 right = position(-1, 0);
+            VFloat up2 = up.z * 2.0f - depthAt(0, -2) * FAR_PLANE;
+            VFloat down2 = down.z * 2.0f - depthAt(0, 2) * FAR_PLANE;
+            VFloat left2 = left.z * 2.0f - depthAt(2, 0) * FAR_PLANE;
+            VFloat right2 = right.z * 2.0f - depthAt(-2, 0) * FAR_PLANE;
+            VFloat3 vertical = select(abs(down2 - c.z) < abs(up2 - c.z), c - down, up - c);
+            VFloat3 horizontal = select(abs(left2 - c.z) < abs(right2 - c.z), c - left, right - c);
+            VFloat3 normal = normalize(cross(vertical, horizontal));
+
+            VFloat3 eyeDir = normalize(c);
+            VFloat3 lightDir = eyeDir - normal * (2.0f * dot(normal, eyeDir));
+            VFloat3 halfVec = normalize(lightDir + eyeDir);
+            VFloat dotLH = clamp(dot(lightDir, halfVec), 0.0f, 1.0f);
+
+            // pow(dotLH, 5 / (1 + 1e-6)) differs from the fifth power by
+            // less than 1e-5.
+            VFloat dotLH2 = dotLH * dotLH;
+            VFloat fresnel = fma(dotLH2 * dotLH2 * dotLH, splat(0.9f), splat(0.1f));
+            store(pixel(frame.fresnel, offset), clamp(fresnel, 0.0f, 1.0f));
+        }
+    }
+}
+
+void tnr2Kernel(const CpuFrame& frame, const CpuTile& tile) {
+    ptrdiff_t stride = frame.depthDS.stride;
+    const CpuPlane* history = frame.tnr2[frame.read];
+    const CpuPlane* historyInfo = frame.tnrInfo[frame.written];
+    for (uint32_t y = tile.y0; y < tile.y1; y++) {
+        VFloat v = fragV(y, frame.height);
+        for (uint32_t x = tile.x0; x < tile.x1; x += SIMD_WIDTH) {
+            ptrdiff_t offset = (ptrdiff_t)y * stride + x;
+            VFloat u = fragU(x, frame.width);
+            VFloat pastU = u + loadAt(frame.motion[0], offset);
+            VFloat pastV = v + loadAt(frame.motion[1], offset);
+            VMask inbound = (pastU >= 0.0f) & (pastU <= 1.0f) & (pastV >= 0.0f) & (pastV <= 1.0f);
+
+            VFloat3 current = loadAt(frame.snr2, offset);
+            VFloat depth = loadAt(frame.packedDepth, offset);
+
+            Bilinear taps = bilinear(pastU, pastV, frame, stride);
+            VFloat3 past = {sample(history[0], taps), sample(history[1], taps), sample(history[2], taps)};
+            VFloat historyLength = sample(historyInfo[0], taps);
+            VFloat pastDepth = sample(historyInfo[2], taps);
+
+            // Variance clipping against the 3x3 neighbourhood
+            VFloat3 m1 = current;
+            VFloat3 m2 = {current.x * current.x, current.y * current.y, current.z * current.z};
+            for (int j = -1; j <= 1; j++) {
+                for (int i = -1; i <= 1; i++) {
+                    if (i == 0 && j == 0) {
+                        continue;
+                    }
+                    VFloat3 neighbour = loadAt(frame.snr2, offset + j * stride + i);
+                    m1 = m1 + neighbour;
+                    m2 = m2 + VFloat3{neighbour.x * neighbour.x, neighbour.y * neighbour.y,
+                                      neighbour.z * neighbour.z};
+                }
+            }
+            m1 = m1 * splat(1.0f / 9.0f);
+            m2 = m2 * splat(1.0f / 9.0f);
+            VFloat3 sigma = {sqrt(abs(m2.x - m1.x * m1.x)), sqrt(abs(m2.y - m1.y * m1.y)),
+                             sqrt(abs(m2.z - m1.z * m1.z))};
+            VFloat3 boxMin = m1 - sigma * splat(1.5f);
+            VFloat3 boxMax = m1 + sigma * splat(1.5f);
+
+            // clipToAABB()
+            VFloat3 center = (boxMax + boxMin) * splat(0.5f);
+            VFloat3 extent = (boxMax - boxMin) * splat(0.5f);
+            VFloat3 offsetToHistory = past - center;
+            VFloat maxUnit = max(abs(offsetToHistory.x / extent.x),
+                                 max(abs(offsetToHistory.y / extent.y), abs(offsetToHistory.z / extent.z)));
+            VFloat3 clipped = select(maxUnit > 1.0f, center + offsetToHistory * (1.0f / maxUnit), past);
+
+            historyLength = select(abs(depth - pastDepth) > 0.1f, splat(0.0f), historyLength);
+            historyLength = min(historyLength + 1.0f, splat(32.0f));
+            VFloat3 result = mix(clipped, current, 1.0f / historyLength);
+
+            storeAt(frame.tnr2[frame.written], offset, select(inbound, result, current));
+        }
+    }
+}
+
+const CpuKernelTable KERNELS = {SIMD_NAME, SIMD_WIDTH,   unpackKernel,  rmKernel,  tnrKernel, snrKernel,
+                                 snr2HorizontalKernel, snr2VerticalKernel, fresnelKernel, tnr2Kernel};
+
+} // namespace
@@ -0,0 +1,10 @@
+// AVX2+FMA build of the CPU denoise kernels; CMake compiles this file with
+// -mavx2 -mfma on x86 and defines CPU_DENOISE_AVX2 for the dispatch in
+// CpuDenoiseKernels.cpp. Nothing here may run before that checked the CPU.
+#include "CpuDenoiseKernels.inl"
+
+#if !defined(CPU_SIMD_AVX2)
+#error "CpuDenoiseKernelsAvx2.cpp needs -mavx2 -mfma"
+#endif
+
+const CpuKernelTable &avx2CpuKernelTable() { return KERNELS; }
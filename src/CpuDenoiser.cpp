@@ -0,0 +1,232 @@
+#include "CpuDenoiser.hpp"
+#include "CpuTracer.hpp"
+#include "PixelConvert.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+using CpuClock = std::chrono::steady_clock;
+
+const uint32_t TILE_WIDTH = 64; // A multiple of every SIMD width
+const uint32_t TILE_HEIGHT = 16;
+
+// Left padding of every row: the border, rounded up so that x = 0 starts on
+// a 32-byte boundary.
+const ptrdiff_t ROW_PADDING = 8;
+// depthDS, packedDepth, fresnelDepth, motion (2), color, rm, tnrColor,
+// tnrInfo (2), snr (2), blur, snr2 (3 each), fresnel, tnr2 (2 x 3)
+const size_t PLANE_COUNT = 39;
+
+const char *STAGE_NAMES[] = {"unpack", "RM+Fresnel", "TNR", "SNR",
+                             "SNR2 h", "SNR2 v", "TNR2"};
+
+} // namespace
+
+CpuDenoiser::CpuDenoiser(uint32_t width, uint32_t height, unsigned threadCount,
+                         const CpuKernelTable *kernels)
+    : width(width), height(height), kernels(kernels), pool(threadCount) {
+  if (width == 0 || height == 0) {
+    throw std::runtime_error("CPU denoiser needs a non-empty frame!");
+  }
+  if (!kernels) {
+    this->kernels = avx2CpuKernels();
+  }
+  if (!this->kernels) {
+    this->kernels = &baselineCpuKernels();
+  }
+
+  // SIMD loops run up to 7 pixels past the right edge, and their +-2 pixel
+  // neighbourhoods 2 more.
+  stride = ROW_PADDING + (ptrdiff_t)(width + 7) / 8 * 8 + ROW_PADDING;
+  planeSize = (size_t)stride * (height + 2 * CPU_PLANE_BORDER);
+  storage.assign(planeSize * PLANE_COUNT, 0.0f);
+
+  frame.width = width;
+  frame.height = height;
+  frame.depthDS = allocatePlane();
+  frame.packedDepth = allocatePlane();
+  frame.fresnelDepth = allocatePlane();
+  frame.fresnel = allocatePlane();
+  for (CpuPlane &plane : frame.motion) {
+    plane = allocatePlane();
+  }
+  for (int c = 0; c < 3; c++) {
+    frame.color[c] = allocatePlane();
+    frame.rm[c] = allocatePlane();
+    frame.tnrColor[c] = allocatePlane();
+    frame.blur[c] = allocatePlane();
+    frame.snr2[c] = allocatePlane();
+    for (int h = 0; h < 2; h++) {
+      frame.tnrInfo[h][c] = allocatePlane();
+      frame.snr[h][c] = allocatePlane();
+      frame.tnr2[h][c] = allocatePlane();
+    }
+  }
+
+  for (uint32_t y = 0; y < height; y += TILE_HEIGHT) {
+    for (uint32_t x = 0; x < width; x += TILE_WIDTH) {
+      tiles.push_back({x, y, std::min(x + TILE_WIDTH, width),
+                       std::min(y + TILE_HEIGHT, height)});
+    }
+  }
+}
+
+CpuPlane CpuDenoiser::allocatePlane() {
+  if (planeCount == PLANE_COUNT) {
+    throw std::runtime_error("CPU denoiser ran out of planes!");
+  }
+  CpuPlane plane;
+  plane.origin = storage.data() + planeSize * planeCount++ +
+                 CPU_PLANE_BORDER * stride + ROW_PADDING;
+  plane.stride = stride;
+  return plane;
+}
+
+void CpuDenoiser::reset() {
+  std::fill(storage.begin(), storage.end(), 0.0f);
+  frame.read = 0;
+  frame.written = 1;
+}
+
+// Fills the border with what the next stage's samplers would return outside
+// the image: the edge pixels (clamp-to-edge), or with repeat the pixels of
+// the opposite edge.
+void CpuDenoiser::fillBorders(const CpuPlane &plane, bool repeat) {
+  for (uint32_t y = 0; y < height; y++) {
+    float *row = plane.origin + (ptrdiff_t)y * stride;
+    for (int b = 1; b <= CPU_PLANE_BORDER; b++) {
+      row[-b] = repeat ? row[width - b] : row[0];
+      row[width - 1 + b] = repeat ? row[b - 1] : row[width - 1];
+    }
+  }
+  size_t rowBytes = (width + 2 * CPU_PLANE_BORDER) * sizeof(float);
+  float *top = plane.origin - CPU_PLANE_BORDER;
+  float *bottom = top + (ptrdiff_t)(height - 1) * stride;
+  for (int b = 1; b <= CPU_PLANE_BORDER; b++) {
+    std::memcpy(top - b * stride, repeat ? bottom + (1 - b) * stride : top,
+                rowBytes);
+    std::memcpy(bottom + b * stride, repeat ? top + (b - 1) * stride : bottom,
+                rowBytes);
+  }
+}
+
+// Runs body on every tile, then refills the borders of the planes the stage
+// wrote.
+void CpuDenoiser::runStage(Stage stage, const std::vector<CpuPlane> &written,
+                           void (CpuDenoiser::*body)(const CpuTile &)) {
+  TRACE_SCOPE(STAGE_NAMES[stage]);
+  CpuClock::time_point start = CpuClock::now();
+  pool.parallelFor(tiles.size(),
+                   [&](size_t index) { (this->*body)(tiles[index]); });
+  for (const CpuPlane &plane : written) {
+    fillBorders(plane, false);
+  }
+  stageSeconds[stage] +=
+      std::chrono::duration<double>(CpuClock::now() - start).count();
+}
+
+void CpuDenoiser::kernelTile(const CpuTile &tile) {
+  currentKernel(frame, tile);
+}
+
+// RM and Fresnel only read unpacked inputs, so they share one pass over the
+// tiles and the ray marched tiles balance against cheap ones.
+void CpuDenoiser::rayMarchFresnelTile(const CpuTile &tile) {
+  kernels->rm(frame, tile);
+  kernels->fresnel(frame, tile);
+}
+
+void CpuDenoiser::process(const uint8_t *const inputs[5]) {
+  TRACE_SCOPE("CpuDenoiser::process");
+  std::swap(frame.read, frame.written);
+  for (int c = 0; c < 5; c++) {
+    frame.inputs[c] = inputs[c];
+  }
+  const CpuPlane *tnrInfo = frame.tnrInfo[frame.written];
+  const CpuPlane *snr = frame.snr[frame.written];
+  const CpuPlane *tnr2 = frame.tnr2[frame.written];
+
+  currentKernel = kernels->unpack;
+  runStage(Unpack, {frame.depthDS, frame.fresnelDepth},
+           &CpuDenoiser::kernelTile);
+  for (const CpuPlane &plane : frame.color) {
+    fillBorders(plane, true);
+  }
+  runStage(RayMarchFresnel, {}, &CpuDenoiser::rayMarchFresnelTile);
+  currentKernel = kernels->tnr;
+  runStage(TNR,
+           {frame.tnrColor[0], frame.tnrColor[1], frame.tnrColor[2],
+            tnrInfo[0], tnrInfo[1], tnrInfo[2]},
+           &CpuDenoiser::kernelTile);
+  currentKernel = kernels->snr;
+  runStage(SNR, {snr[0], snr[1], snr[2]}, &CpuDenoiser::kernelTile);
+  currentKernel = kernels->snr2Horizontal;
+  runStage(SNR2Horizontal, {frame.blur[0], frame.blur[1], frame.blur[2]},
+           &CpuDenoiser::kernelTile);
+  currentKernel = kernels->snr2Vertical;
+  runStage(SNR2Vertical, {frame.snr2[0], frame.snr2[1], frame.snr2[2]},
+           &CpuDenoiser::kernelTile);
+  currentKernel = kernels->tnr2;
+  runStage(TNR2, {tnr2[0], tnr2[1], tnr2[2]}, &CpuDenoiser::kernelTile);
+  frameCount++;
+}
+
+void CpuDenoiser::readOutput(OutputPixels pixels, void *destination) {
+  TRACE_SCOPE("CpuDenoiser::readOutput");
+  const CpuPlane *tnr2 = frame.tnr2[frame.written];
+  pool.parallelFor(height, [&](size_t y) {
+    ptrdiff_t row = (ptrdiff_t)y * stride;
+    if (pixels == OutputPixels::RGBA16F) {
+      std::vector<float> rgba((size_t)width * 4);
+      for (uint32_t x = 0; x < width; x++) {
+        rgba[x * 4 + 0] = tnr2[0].origin[row + x];
+        rgba[x * 4 + 1] = tnr2[1].origin[row + x];
+        rgba[x * 4 + 2] = tnr2[2].origin[row + x];
+        rgba[x * 4 + 3] = frame.fresnel.origin[row + x];
+      }
+      floatToHalf(rgba.data(),
+                  static_cast<uint16_t *>(destination) + y * width * 4,
+                  rgba.size());
+    } else {
+      // The final pass shows TNR2's alpha (the Fresnel term) as gray.
+      uint8_t *out = static_cast<uint8_t *>(destination) + y * width * 4;
+      for (uint32_t x = 0; x < width; x++) {
+        float a = frame.fresnel.origin[row + x];
+        uint8_t gray =
+            a > 0.0f ? (uint8_t)std::lround(std::min(a, 1.0f) * 255.0f) : 0;
+        out[x * 4 + 0] = gray;
+        out[x * 4 + 1] = gray;
+        out[x * 4 + 2] = gray;
+        out[x * 4 + 3] = 255;
+      }
+    }
+  });
+}
+
+size_t CpuDenoiser::getStealCount() const {
+  size_t steals = 0;
+  for (size_t count : pool.stealCounts()) {
+    steals += count;
+  }
+  return steals;
+}
+
+void CpuDenoiser::printStageTimes(std::ostream &out) const {
+  if (frameCount == 0) {
+    return;
+  }
+  out << "CPU stages (" << kernels->name << ", " << getThreadCount()
+      << " threads, ms/frame):";
+  for (int s = 0; s < STAGE_COUNT; s++) {
+    out << " " << STAGE_NAMES[s] << " " << std::fixed << std::setprecision(2)
+        << stageSeconds[s] * 1000.0 / frameCount;
+  }
+  out << std::defaultfloat << std::endl;
+}
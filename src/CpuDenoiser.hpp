@@ -0,0 +1,70 @@
+#pragma once
+
+#include "CpuDenoiseKernels.hpp"
+#include "OutputEncoder.hpp"
+#include "WorkStealingPool.hpp"
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// The denoise chain (depthDS, RM, TNR, SNR, SNR2, Fresnel, TNR2) on the CPU,
+// for machines without a usable GPU and as a second implementation to check
+// the shaders against. Frames are cut into tiles that a work-stealing pool
+// spreads over the cores; every pass is a SIMD kernel (CpuDenoiseKernels)
+// picked for the CPU at runtime; RM traces packets of one ray per lane.
+// Results match the GPU's within half-float rounding.
+class CpuDenoiser {
+public:
+    // threadCount 0: one per core. kernels null: the fastest table the CPU
+    // runs (avx2CpuKernels(), else baselineCpuKernels()).
+    CpuDenoiser(uint32_t width, uint32_t height, unsigned threadCount = 0, const CpuKernelTable* kernels = nullptr);
+
+    // Denoises the next frame of the sequence. inputs are the five RGBA8
+    // channels in DenoiseChannel order, rows top to bottom (as uploaded to
+    // the GPU).
+    void process(const uint8_t* const inputs[5]);
+
+    // Copies the last frame's TNR2 output (RGBA16F) or final image (BGRA8)
+    // to destination, rows top to bottom like a GPU readback.
+    void readOutput(OutputPixels pixels, void* destination);
+
+    // Forgets the history, as if the next frame were the first.
+    void reset();
+
+    const char* getKernelName() const { return kernels->name; }
+    unsigned getThreadCount() const { return pool.getThreadCount(); }
+    int getFrameCount() const { return frameCount; }
+    // Tiles the pool's threads stole from each other so far.
+    size_t getStealCount() const;
+
+    // Mean milliseconds per frame of every stage so far.
+    void printStageTimes(std::ostream& out) const;
+
+private:
+    enum Stage { Unpack, RayMarchFresnel, TNR, SNR, SNR2Horizontal, SNR2Vertical, TNR2, STAGE_COUNT };
+
+    void runStage(Stage stage, const std::vector<CpuPlane>& written, void (CpuDenoiser::*body)(const CpuTile&));
+    void rayMarchFresnelTile(const CpuTile& tile);
+    void fillBorders(const CpuPlane& plane, bool repeat);
+    void kernelTile(const CpuTile& tile);
+    CpuPlane allocatePlane();
+
+    uint32_t width;
+    uint32_t height;
+    const CpuKernelTable* kernels;
+    WorkStealingPool pool;
+
+    // Every plane lives in storage at planeSize floats apart.
+    ptrdiff_t stride = 0;
+    size_t planeSize = 0;
+    size_t planeCount = 0;
+    std::vector<float> storage;
+
+    CpuFrame frame;
+    std::vector<CpuTile> tiles;
+    CpuKernel currentKernel = nullptr;
+
+    int frameCount = 0;
+    double stageSeconds[STAGE_COUNT] = {};
+};
@@ -0,0 +1,697 @@
+#include "CpuReference.hpp"
+#include "PixelConvert.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+// Just enough GLSL to port the shaders line by line.
+struct vec2 {
+  float x, y;
+};
+struct vec3 {
+  float x, y, z;
+};
+struct vec4 {
+  float x, y, z, w;
+  vec3 rgb() const { return {x, y, z}; }
+};
+
+vec2 operator+(vec2 a, vec2 b) { return {a.x + b.x, a.y + b.y}; }
+vec2 operator-(vec2 a) { return {-a.x, -a.y}; }
+vec2 operator*(vec2 a, vec2 b) { return {a.x * b.x, a.y * b.y}; }
+vec2 operator*(vec2 a, float s) { return {a.x * s, a.y * s}; }
+vec2 operator+(vec2 a, float s) { return {a.x + s, a.y + s}; }
+
+vec3 operator+(vec3 a, vec3 b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+vec3 operator-(vec3 a, vec3 b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+vec3 operator*(vec3 a, vec3 b) { return {a.x * b.x, a.y * b.y, a.z * b.z}; }
+vec3 operator/(vec3 a, vec3 b) { return {a.x / b.x, a.y / b.y, a.z / b.z}; }
+vec3 operator*(vec3 a, float s) { return {a.x * s, a.y * s, a.z * s}; }
+vec3 operator*(float s, vec3 a) { return a * s; }
+vec3 operator/(vec3 a, float s) { return {a.x / s, a.y / s, a.z / s}; }
+
+vec4 operator+(vec4 a, vec4 b) {
+  return {a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w};
+}
+vec4 operator*(vec4 a, float s) { return {a.x * s, a.y * s, a.z * s, a.w * s}; }
+vec4 operator/(vec4 a, float s) { return {a.x / s, a.y / s, a.z / s, a.w / s}; }
+
+float fract(float x) { return x - std::floor(x); }
+float clamp(float x, float lo, float hi) {
+  return std::min(std::max(x, lo), hi);
+}
+float mix(float a, float b, float t) { return a * (1.0f - t) + b * t; }
+vec3 mix(vec3 a, vec3 b, float t) { return a * (1.0f - t) + b * t; }
+
+float dot(vec2 a, vec2 b) { return a.x * b.x + a.y * b.y; }
+float dot(vec3 a, vec3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+float length(vec3 v) { return std::sqrt(dot(v, v)); }
+vec3 normalize(vec3 v) { return v / length(v); }
+vec3 cross(vec3 a, vec3 b) {
+  return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+vec3 reflect(vec3 i, vec3 n) { return i - 2.0f * dot(n, i) * n; }
+vec3 min(vec3 a, vec3 b) {
+  return {std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z)};
+}
+vec3 max(vec3 a, vec3 b) {
+  return {std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z)};
+}
+vec3 abs(vec3 v) { return {std::fabs(v.x), std::fabs(v.y), std::fabs(v.z)}; }
+vec3 sqrt(vec3 v) { return {std::sqrt(v.x), std::sqrt(v.y), std::sqrt(v.z)}; }
+
+enum class Address { ClampToEdge, Repeat };
+
+int wrap(int i, int size, Address address) {
+  if (address == Address::Repeat) {
+    return ((i % size) + size) % size;
+  }
+  return std::min(std::max(i, 0), size - 1);
+}
+
+// Bilinear filtering as the Vulkan spec defines it: texel centers at half
+// integers, neighbours wrapped per the address mode. Hardware rounds the
+// weights to a few bits, so filtered samples differ slightly from these.
+vec4 texture(const RefImage &image, vec2 uv,
+             Address address = Address::ClampToEdge) {
+  float u = uv.x * image.width - 0.5f;
+  float v = uv.y * image.height - 0.5f;
+  if (!std::isfinite(u) || !std::isfinite(v)) {
+    u = v = 0.0f;
+  }
+  float u0 = std::floor(u);
+  float v0 = std::floor(v);
+  float a = u - u0;
+  float b = v - v0;
+  // Keep far out of range coordinates within int range; they clamp to the
+  // edge or wrap around to the same texels.
+  if (address == Address::Repeat) {
+    u0 -= image.width * std::floor(u0 / image.width);
+    v0 -= image.height * std::floor(v0 / image.height);
+  } else {
+    u0 = clamp(u0, -2.0f, (float)image.width + 1.0f);
+    v0 = clamp(v0, -2.0f, (float)image.height + 1.0f);
+  }
+  int x0 = wrap((int)u0, image.width, address);
+  int x1 = wrap((int)u0 + 1, image.width, address);
+  int y0 = wrap((int)v0, image.height, address);
+  int y1 = wrap((int)v0 + 1, image.height, address);
+
+  const float *t00 = image.at(x0, y0);
+  const float *t10 = image.at(x1, y0);
+  const float *t01 = image.at(x0, y1);
+  const float *t11 = image.at(x1, y1);
+  float c[4];
+  for (int i = 0; i < 4; i++) {
+    c[i] = (1 - a) * (1 - b) * t00[i] + a * (1 - b) * t10[i] +
+           (1 - a) * b * t01[i] + a * b * t11[i];
+  }
+  return {c[0], c[1], c[2], c[3]};
+}
+
+vec2 textureSize(const RefImage &image) {
+  return {(float)image.width, (float)image.height};
+}
+
+float roundHalf(float value) { return halfToFloat(floatToHalf(value)); }
+
+float roundUnorm8(float value) {
+  if (!(value > 0.0f)) {
+    return 0.0f;
+  }
+  return std::round(std::min(value, 1.0f) * 255.0f) / 255.0f;
+}
+
+enum class Target { Half, Unorm8 };
+
+// The fullscreen quad's texture coordinate at the center of fragment (x, y).
+vec2 fragUV(uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+  return {(x + 0.5f) / width, (y + 0.5f) / height};
+}
+
+// Stores a shader result the way the attachment format does.
+void store(float *texel, vec4 color, Target target) {
+  float channels[4] = {color.x, color.y, color.z, color.w};
+  for (int c = 0; c < 4; c++) {
+    texel[c] = target == Target::Half ? roundHalf(channels[c])
+                                      : roundUnorm8(channels[c]);
+  }
+}
+
+// Runs shader for every fragment of a width x height target.
+template <typename Shader>
+RefImage render(uint32_t width, uint32_t height, Target target,
+                Shader shader) {
+  RefImage out(width, height);
+  for (uint32_t y = 0; y < height; y++) {
+    for (uint32_t x = 0; x < width; x++) {
+      store(out.at(x, y), shader(fragUV(x, y, width, height)), target);
+    }
+  }
+  return out;
+}
+
+// TNR.frag / TNR2.frag: RGB888 rearranged into R10G10, quadratic decode.
+vec2 decodeMotion(const RefImage &mvImage, vec2 uv) {
+  vec4 mvRaw = texture(mvImage, uv);
+  uint32_t r = (uint32_t)(mvRaw.x * 255.0f + 0.5f);
+  uint32_t g = (uint32_t)(mvRaw.y * 255.0f + 0.5f);
+  uint32_t b = (uint32_t)(mvRaw.z * 255.0f + 0.5f);
+  uint32_t val = (r << 16) | (g << 8) | b;
+
+  float mvXNorm = (float)(val & 0x3FFu) / 1023.0f;
+  float mvYNorm = (float)((val >> 10) & 0x3FFu) / 1023.0f;
+
+  const float offset = 0.5f;
+  float mv0 = (mvXNorm - offset) * 2.0f;
+  float mv1 = (mvYNorm - offset) * 2.0f;
+  mv0 *= mv0;
+  mv1 *= mv1;
+
+  vec2 motion;
+  motion.x = (mvXNorm < offset) ? -mv0 : mv0;
+  motion.y = (mvYNorm < offset) ? -mv1 : mv1;
+  return motion;
+}
+
+const float NEAR = 0.25f;
+const float FAR = 1000.0f;
+
+// RM.frag
+const int MAX_STEPS = 100;
+const float MAX_DIST = 100.0f;
+const float SURF_DIST = 0.001f;
+
+float getDist(vec3 p) {
+  vec3 sphere = {0, 1, 6};
+  float sphereDist = length(p - sphere) - 1.0f;
+  float planeDist = p.y;
+  return std::min(sphereDist, planeDist);
+}
+
+float rayMarch(vec3 ro, vec3 rd) {
+  float dO = 0.0f;
+  for (int i = 0; i < MAX_STEPS; i++) {
+    vec3 p = ro + rd * dO;
+    float dS = getDist(p);
+    dO += dS;
+    if (dO > MAX_DIST || dS < SURF_DIST) {
+      break;
+    }
+  }
+  return dO;
+}
+
+vec3 getSDFNormal(vec3 p) {
+  float d = getDist(p);
+  const float e = 0.01f;
+  vec3 n = {d - getDist(p - vec3{e, 0, 0}), d - getDist(p - vec3{0, e, 0}),
+            d - getDist(p - vec3{0, 0, e})};
+  return normalize(n);
+}
+
+struct RayMarchScene {
+  const RefImage &color;
+  const RefImage &depthDS;
+  float aspect;
+
+  float sceneLinearDepth(vec2 uv) const {
+    return texture(depthDS, uv).x * FAR;
+  }
+
+  vec2 posToUV(vec3 pos, vec3 ro) const {
+    vec3 pRel = pos - ro;
+    vec2 uv;
+    uv.x = (pRel.x / pRel.z) / aspect;
+    uv.y = -(pRel.y / pRel.z);
+    return (uv + 1.0f) * 0.5f;
+  }
+
+  vec3 rayMarchSpecular(vec3 ro, vec3 position, vec3 raydir,
+                        float noiseZ) const {
+    const int raySteps = 120;
+    const int backSteps = 15;
+    const float rayInc = 1.0f + 1.0f / std::sqrt((float)raySteps);
+    const float rcpRaySteps = 1.0f / (float)raySteps;
+
+    float viewZStart = position.z - ro.z;
+    float bias = -viewZStart * (1.0f / FAR) * 5.0f;
+    float thicknessMul = -2.0f;
+
+    float steplength = 0.04f * (1.0f + noiseZ * 0.5f);
+    vec3 raypos = position;
+
+    float j = 0.0f;
+    float hitStep = steplength;
+    for (int i = 0; i < raySteps; i++) {
+      raypos = raypos + raydir * steplength;
+      float currentViewZ = raypos.z - ro.z;
+      if (currentViewZ < 0.0f || currentViewZ > FAR) {
+        break;
+      }
+
+      vec2 uvRaypos = posToUV(raypos, ro);
+      if (uvRaypos.x < 0.0f || uvRaypos.x > 1.0f || uvRaypos.y < 0.0f ||
+          uvRaypos.y > 1.0f) {
+        break;
+      }
+
+      float error = sceneLinearDepth(uvRaypos) - currentViewZ;
+      if (error < bias && error > thicknessMul * std::max(1.0f, hitStep)) {
+        if (j < (float)backSteps) {
+          raypos = raypos - raydir * steplength;
+          steplength *= rcpRaySteps;
+          j++;
+          i = 0; // As in the shader: the loop restarts from 1
+        } else {
+          return texture(color, uvRaypos, Address::Repeat).rgb();
+        }
+      } else {
+        steplength *= rayInc;
+      }
+      hitStep = steplength;
+    }
+    return {-1.0f, -1.0f, -1.0f};
+  }
+};
+
+float hash(vec2 p) {
+  p = p * vec2{123.34f, 456.21f};
+  p = {fract(p.x), fract(p.y)};
+  p = p + dot(p, p + 45.32f);
+  return fract(p.x * p.y);
+}
+
+// computeFresnel.frag
+const float FOV = 45.0f;
+const float PI = 3.14159265359f;
+
+struct FresnelScene {
+  const RefImage &depth;
+  float aspect;
+  vec2 pix;
+
+  vec3 uvToPos(vec2 uv, float d) const {
+    vec3 ndc = {uv.x * 2.0f - 1.0f, uv.y * 2.0f - 1.0f, d * FAR};
+    ndc.x *= ndc.z;
+    ndc.y *= ndc.z;
+    ndc.x *= aspect;
+    float t = std::tan(FOV * 0.5f * PI / 180.0f);
+    ndc.x *= t;
+    ndc.y *= t;
+    return ndc;
+  }
+
+  float readDepth(vec2 uv) const {
+    vec4 packed = texture(depth, uv);
+    float z = (float)((uint32_t)(packed.x * 255.0f + 0.5f) +
+                      ((uint32_t)(packed.y * 255.0f + 0.5f) << 8u) +
+                      ((uint32_t)(packed.z * 255.0f + 0.5f) << 16u)) /
+              16777215.0f;
+    float linearDepth = (NEAR * FAR) / (FAR - z * (FAR - NEAR));
+    return (linearDepth < FAR) ? (linearDepth / FAR) : 1.0f;
+  }
+
+  vec3 posAt(vec2 uv) const { return uvToPos(uv, readDepth(uv)); }
+
+  vec3 computeNormal(vec2 uv) const {
+    vec2 dU = {0, pix.y};
+    vec2 dD = -dU;
+    vec2 dL = {pix.x, 0};
+    vec2 dR = -dL;
+
+    vec3 u = posAt(uv + dD);
+    vec3 d = posAt(uv + dU);
+    vec3 l = posAt(uv + dL);
+    vec3 r = posAt(uv + dR);
+
+    vec3 u2 = posAt(uv + dD + dD);
+    vec3 d2 = posAt(uv + dU + dU);
+    vec3 l2 = posAt(uv + dL + dL);
+    vec3 r2 = posAt(uv + dR + dR);
+
+    u2 = u + (u - u2);
+    d2 = d + (d - d2);
+    l2 = l + (l - l2);
+    r2 = r + (r - r2);
+
+    vec3 c = posAt(uv);
+    vec3 v = u - c;
+    vec3 h = r - c;
+    if (std::fabs(d2.z - c.z) < std::fabs(u2.z - c.z)) {
+      v = c - d;
+    }
+    if (std::fabs(l2.z - c.z) < std::fabs(r2.z - c.z)) {
+      h = c - l;
+    }
+    return normalize(cross(v, h));
+  }
+};
+
+// TNR2.frag
+vec3 clipToAABB(vec3 history, vec3 boxMin, vec3 boxMax) {
+  vec3 pClip = 0.5f * (boxMax + boxMin);
+  vec3 eClip = 0.5f * (boxMax - boxMin);
+  vec3 vClip = history - pClip;
+  vec3 aUnit = abs(vClip / eClip);
+  float maUnit = std::max(aUnit.x, std::max(aUnit.y, aUnit.z));
+  if (maUnit > 1.0f) {
+    return pClip + vClip / maUnit;
+  }
+  return history;
+}
+
+} // namespace
+
+RefImage RefImage::fromUnorm8(const uint8_t *pixels, uint32_t width,
+                              uint32_t height) {
+  RefImage image(width, height);
+  for (size_t i = 0; i < image.texels.size(); i++) {
+    image.texels[i] = pixels[i] / 255.0f;
+  }
+  return image;
+}
+
+RefImage RefImage::fromHalf(const uint16_t *pixels, uint32_t width,
+                            uint32_t height) {
+  RefImage image(width, height);
+  halfToFloat(pixels, image.texels.data(), image.texels.size());
+  return image;
+}
+
+RefImage referenceDepthDS(const RefImage &depth, const RefImage &normal,
+                          const RefImage &albedo, uint32_t width,
+                          uint32_t height) {
+  return render(width, height, Target::Half, [&](vec2 uv) -> vec4 {
+    // The shader takes the low byte unscaled: uint(packedDepth.r) is 0
+    // except where the byte is 255.
+    vec4 packed = texture(depth, uv);
+    float z = (float)((uint32_t)packed.x +
+                      ((uint32_t)(packed.y * 256.0f + 0.5f) << 8u) +
+                      ((uint32_t)(packed.z * 255.0f + 0.5f) << 16u)) /
+              16777215.0f;
+    float linearDepth = (NEAR * FAR) / (FAR - z * (FAR - NEAR));
+    float depthNorm = (linearDepth < FAR) ? (linearDepth / FAR) : 1.0f;
+    return {depthNorm, texture(normal, uv).w, texture(albedo, uv).w, 1.0f};
+  });
+}
+
+RefImage referenceRM(const RefImage &color, const RefImage &depthDS,
+                     uint32_t width, uint32_t height) {
+  vec2 size = textureSize(color);
+  RayMarchScene scene{color, depthDS, size.x / size.y};
+  return render(width, height, Target::Half, [&](vec2 uv) -> vec4 {
+    vec2 ndc = {uv.x * 2.0f - 1.0f, uv.y * 2.0f - 1.0f};
+    vec3 ro = {0, 1, 0};
+    vec3 rd = normalize(vec3{ndc.x * scene.aspect, -ndc.y, 1.0f});
+
+    vec4 sceneColor = texture(color, uv, Address::Repeat);
+    float sceneZ = scene.sceneLinearDepth(uv);
+    float d = rayMarch(ro, rd);
+
+    vec3 result;
+    if (d < MAX_DIST && d < sceneZ) {
+      vec3 p = ro + rd * d;
+      vec3 n = getSDFNormal(p);
+      vec3 lightPos = {2.0f, 5.0f, -1.0f};
+      vec3 l = normalize(lightPos - p);
+      float dif = clamp(dot(n, l), 0.2f, 1.0f);
+      vec3 baseColor =
+          (p.y < 0.01f) ? vec3{0.5f, 0.5f, 0.5f} : vec3{0.4f, 0.4f, 0.6f};
+
+      vec3 reflection =
+          scene.rayMarchSpecular(ro, p, reflect(rd, n), hash(uv));
+      if (reflection.x >= 0.0f) {
+        result = mix(baseColor * dif, reflection, 0.7f);
+      } else {
+        result = baseColor * dif;
+      }
+    } else {
+      result = sceneColor.rgb();
+    }
+    return {result.x, result.y, result.z, 1.0f};
+  });
+}
+
+TnrOutputs referenceTNR(const RefImage &rm, const RefImage &depthDS,
+                        const RefImage &mv, const RefImage &historyColor,
+                        const RefImage &historyInfo, uint32_t width,
+                        uint32_t height) {
+  TnrOutputs out;
+  out.color = RefImage(width, height);
+  out.info = RefImage(width, height);
+  out.out2 = RefImage(width, height);
+  for (uint32_t y = 0; y < height; y++) {
+    for (uint32_t x = 0; x < width; x++) {
+      vec2 uv = fragUV(x, y, width, height);
+      vec2 motion = decodeMotion(mv, uv);
+      vec4 current = texture(rm, uv);
+      float depth = texture(depthDS, uv).x;
+
+      vec2 pastUV = uv + motion;
+      bool inbound = pastUV.x >= 0.0f && pastUV.x <= 1.0f && pastUV.y >= 0.0f &&
+                     pastUV.y <= 1.0f;
+
+      vec4 history = texture(historyColor, pastUV);
+      vec4 info = texture(historyInfo, pastUV);
+      float historyLength = info.x;
+      float tm2 = info.y;
+      float pastDepth = info.z;
+
+      float mask = 1.0f;
+      if (!inbound || std::fabs(depth - pastDepth) > 0.01f) {
+        mask = 0.0f;
+      }
+      historyLength *= mask;
+      historyLength = std::min(historyLength, 32.0f);
+      historyLength += 1.0f;
+
+      float currentLum = dot(current.rgb(), vec3{0.299f, 0.587f, 0.114f});
+      if (historyLength > 4.0f) {
+        tm2 = mix(tm2, currentLum * currentLum, 1.0f / historyLength);
+      } else {
+        tm2 = currentLum * currentLum;
+      }
+
+      vec3 result =
+          mix(history.rgb(), current.rgb(), 1.0f / (historyLength + 1e-7f));
+
+      store(out.color.at(x, y), {result.x, result.y, result.z, 1.0f},
+            Target::Half);
+      store(out.info.at(x, y), {historyLength, tm2, depth, 1.0f}, Target::Half);
+    }
+  }
+  return out;
+}
+
+RefImage referenceSNR(const RefImage &tnrColor, const RefImage &depthDS,
+                      const RefImage &tnrInfo, uint32_t width,
+                      uint32_t height) {
+  vec2 size = textureSize(tnrColor);
+  vec2 texelSize = {1.0f / size.x, 1.0f / size.y};
+  return render(width, height, Target::Half, [&](vec2 uv) -> vec4 {
+    float centerDepth = texture(depthDS, uv).x;
+    float historyLen = texture(tnrInfo, uv).x;
+    float radiusCheck = (historyLen > 10.0f) ? 0.0f : 1.0f;
+
+    vec4 sum = {0, 0, 0, 0};
+    float weightSum = 0.0f;
+    for (int i = -1; i <= 1; i++) {
+      for (int j = -1; j <= 1; j++) {
+        if (radiusCheck == 0.0f && (i != 0 || j != 0)) {
+          continue;
+        }
+        vec2 sampleUV = uv + vec2{(float)i, (float)j} * texelSize;
+        vec4 sampleColor = texture(tnrColor, sampleUV);
+        float sampleDepth = texture(depthDS, sampleUV).x;
+
+        float spatial = std::exp(-(float)(i * i + j * j) / 2.0f);
+        float depthDiff = std::fabs(centerDepth - sampleDepth);
+        float range = std::exp(-(depthDiff * depthDiff) / 0.01f);
+        float w = spatial * range;
+
+        sum = sum + sampleColor * w;
+        weightSum += w;
+      }
+    }
+    return sum / weightSum;
+  });
+}
+
+RefImage referenceSNR2(const RefImage &snr, uint32_t width, uint32_t height) {
+  vec2 size = textureSize(snr);
+  vec2 texelSize = {1.0f / size.x, 1.0f / size.y};
+  const float sigma = 2.0f;
+  const int radius = 2;
+  return render(width, height, Target::Half, [&](vec2 uv) -> vec4 {
+    vec4 colorSum = {0, 0, 0, 0};
+    float weightSum = 0.0f;
+    for (int x = -radius; x <= radius; x++) {
+      for (int y = -radius; y <= radius; y++) {
+        vec2 offset = vec2{(float)x, (float)y} * texelSize;
+        float weight =
+            std::exp(-(float)(x * x + y * y) / (2.0f * sigma * sigma));
+        colorSum = colorSum + texture(snr, uv + offset) * weight;
+        weightSum += weight;
+      }
+    }
+    return colorSum / weightSum;
+  });
+}
+
+RefImage referenceFresnel(const RefImage &depth, uint32_t width,
+                          uint32_t height) {
+  vec2 size = textureSize(depth);
+  FresnelScene scene{depth, size.x / size.y, {1.0f / size.x, 1.0f / size.y}};
+  const float specularIntensity = 1.0f;
+  return render(width, height, Target::Half, [&](vec2 uv) -> vec4 {
+    float d = scene.readDepth(uv);
+    vec3 normal = scene.computeNormal(uv);
+    vec3 eyeDir = normalize(scene.uvToPos(uv, d));
+
+    vec3 lightDir = reflect(eyeDir, normal);
+    vec3 halfVec = normalize(lightDir + eyeDir);
+    float dotLH = clamp(dot(lightDir, halfVec), 0.0f, 1.0f);
+
+    float f0 = clamp(specularIntensity * 0.1f, 0.0f, 1.0f);
+    float intensity = specularIntensity * specularIntensity + 1e-6f;
+    float fresnel = f0 + (1.0f - f0) * std::pow(dotLH, 5.0f / intensity);
+    fresnel = clamp(fresnel, 0.0f, 1.0f);
+    return {fresnel, fresnel, fresnel, fresnel};
+  });
+}
+
+RefImage referenceTNR2(const RefImage &snr2, const RefImage &history,
+                       const RefImage &depth, const RefImage &mv,
+                       const RefImage &fresnel, const RefImage &tnrInfo,
+                       uint32_t width, uint32_t height) {
+  vec2 size = textureSize(snr2);
+  vec2 texelSize = {1.0f / size.x, 1.0f / size.y};
+  const float maxFrames = 32.0f;
+  return render(width, height, Target::Half, [&](vec2 uv) -> vec4 {
+    vec2 pastUV = uv + decodeMotion(mv, uv);
+    vec4 current = texture(snr2, uv);
+    // The raw packed depth input: its low byte, not a linear depth.
+    float d = texture(depth, uv).x;
+    float f = texture(fresnel, uv).x;
+
+    if (pastUV.x < 0.0f || pastUV.x > 1.0f || pastUV.y < 0.0f ||
+        pastUV.y > 1.0f) {
+      return {current.x, current.y, current.z, f};
+    }
+
+    vec4 past = texture(history, pastUV);
+    vec4 historyInfo = texture(tnrInfo, pastUV);
+
+    vec3 cMin = current.rgb();
+    vec3 cMax = current.rgb();
+    vec3 m1 = current.rgb();
+    vec3 m2 = current.rgb() * current.rgb();
+    for (int x = -1; x <= 1; ++x) {
+      for (int y = -1; y <= 1; ++y) {
+        if (x == 0 && y == 0) {
+          continue;
+        }
+        vec3 neighbor =
+            texture(snr2, uv + vec2{(float)x, (float)y} * texelSize).rgb();
+        cMin = min(cMin, neighbor);
+        cMax = max(cMax, neighbor);
+        m1 = m1 + neighbor;
+        m2 = m2 + neighbor * neighbor;
+      }
+    }
+    m1 = m1 / 9.0f;
+    m2 = m2 / 9.0f;
+
+    vec3 sigma = sqrt(abs(m2 - m1 * m1));
+    vec3 boxMin = m1 - sigma * 1.5f;
+    vec3 boxMax = m1 + sigma * 1.5f;
+    vec3 clampedHistory = clipToAABB(past.rgb(), boxMin, boxMax);
+
+    float historyLen = historyInfo.x;
+    float pastDepth = historyInfo.z;
+    if (std::fabs(d - pastDepth) > 0.1f) {
+      historyLen = 0.0f;
+    }
+    historyLen = std::min(historyLen + 1.0f, maxFrames);
+    float alpha = 1.0f / historyLen;
+
+    vec3 result = mix(clampedHistory, current.rgb(), alpha);
+    return {result.x, result.y, result.z, f};
+  });
+}
+
+RefImage referenceFinal(const RefImage &tnr2, uint32_t width,
+                        uint32_t height) {
+  return render(width, height, Target::Unorm8, [&](vec2 uv) -> vec4 {
+    float a = texture(tnr2, uv).w;
+    return {a, a, a, 1.0f};
+  });
+}
+
+RefImage referenceFrame(const RefImage inputs[5], RefHistory &history) {
+  const uint32_t width = inputs[0].width, height = inputs[0].height;
+  if (history.tnr2.width != width || history.tnr2.height != height) {
+    history.snr = RefImage(width, height);
+    history.tnrInfo = RefImage(width, height);
+    history.tnr2 = RefImage(width, height);
+  }
+  RefImage depthDS =
+      referenceDepthDS(inputs[1], inputs[2], inputs[3], width, height);
+  RefImage rm = referenceRM(inputs[0], depthDS, width, height);
+  TnrOutputs tnr = referenceTNR(rm, depthDS, inputs[4], history.snr,
+                                history.tnrInfo, width, height);
+  RefImage snr = referenceSNR(tnr.color, depthDS, tnr.info, width, height);
+  RefImage snr2 = referenceSNR2(snr, width, height);
+  RefImage fresnel = referenceFresnel(inputs[1], width, height);
+  RefImage tnr2 = referenceTNR2(snr2, history.tnr2, inputs[1], inputs[4],
+                                fresnel, tnr.info, width, height);
+  history.snr = std::move(snr);
+  history.tnrInfo = std::move(tnr.info);
+  history.tnr2 = tnr2;
+  return tnr2;
+}
+
+RefError compareImages(const RefImage &reference, const RefImage &gpu) {
+  if (reference.width != gpu.width || reference.height != gpu.height) {
+    throw std::runtime_error("reference and GPU image sizes differ!");
+  }
+  RefError error;
+  double sum = 0.0;
+  size_t counted = 0;
+  for (size_t i = 0; i < reference.texels.size(); i++) {
+    float a = reference.texels[i];
+    float b = gpu.texels[i];
+    if (std::isnan(a) || std::isnan(b)) {
+      if (std::isnan(a) != std::isnan(b)) {
+        error.nanMismatches++;
+      }
+      continue;
+    }
+    double diff = a == b ? 0.0 : std::fabs((double)a - b);
+    sum += diff;
+    counted++;
+    if (diff > error.maxError) {
+      error.maxError = diff;
+      error.worstX = (uint32_t)(i / 4 % reference.width);
+      error.worstY = (uint32_t)(i / 4 / reference.width);
+    }
+  }
+  error.meanError = counted > 0 ? sum / counted : 0.0;
+  return error;
+}
+
+void printRefError(std::ostream &out, const std::string &name,
+                   const RefError &error) {
+  std::string worst = "(" + std::to_string(error.worstX) + ", " +
+                      std::to_string(error.worstY) + ")";
+  out << "  " << std::left << std::setw(12) << name << std::right
+      << std::scientific << std::setprecision(2) << std::setw(11)
+      << error.maxError << std::setw(11) << error.meanError << std::setw(14)
+      << worst << std::setw(6) << error.nanMismatches << std::endl;
+  out << std::defaultfloat;
+}
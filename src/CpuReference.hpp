@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Scalar CPU versions of every fragment shader, as ground truth that doesn't
+// depend on a driver. Each function is a line-by-line port of its shader and
+// runs it for every fragment of a width x height target, at the same texture
+// coordinates the fullscreen quad produces. Sampling follows the renderer's
+// samplers: bilinear filtering with clamp-to-edge, except the color input,
+// which repeats. RGBA16F targets round their results to half floats and the
+// final BGRA8 target to 8 bits, as the GPU stores them.
+//
+// The GLSL leaves a few things undefined that the reference has to pick:
+// pow() of a negative base (the motion vector decode) is evaluated as the
+// square it is meant to be, and NaNs compare like C++ floats. Differences
+// there show up as outliers in the comparison.
+
+// An RGBA float image, rows top to bottom (as the GPU sees the inputs after
+// the loader's flip).
+struct RefImage {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<float> texels; // 4 per pixel
+
+    RefImage() = default;
+    RefImage(uint32_t width, uint32_t height) : width(width), height(height), texels((size_t)width * height * 4, 0.0f) {}
+
+    static RefImage fromUnorm8(const uint8_t* pixels, uint32_t width, uint32_t height);
+    static RefImage fromHalf(const uint16_t* pixels, uint32_t width, uint32_t height);
+
+    float* at(uint32_t x, uint32_t y) { return &texels[((size_t)y * width + x) * 4]; }
+    const float* at(uint32_t x, uint32_t y) const { return &texels[((size_t)y * width + x) * 4]; }
+};
+
+// Inputs are the RGBA8 channels; intermediates are whatever the GPU (or an
+// earlier reference pass) produced.
+RefImage referenceDepthDS(const RefImage& depth, const RefImage& normal, const RefImage& albedo, uint32_t width,
+                          uint32_t height);
+RefImage referenceRM(const RefImage& color, const RefImage& depthDS, uint32_t width, uint32_t height);
+struct TnrOutputs {
+    RefImage color; // TNR_out0
+    RefImage info;  // TNR_out1: history length, second moment, depth
+    RefImage out2;  // TNR_out2 (unused, zero)
+};
+TnrOutputs referenceTNR(const RefImage& rm, const RefImage& depthDS, const RefImage& mv, const RefImage& historyColor,
+                        const RefImage& historyInfo, uint32_t width, uint32_t height);
+RefImage referenceSNR(const RefImage& tnrColor, const RefImage& depthDS, const RefImage& tnrInfo, uint32_t width,
+                      uint32_t height);
+RefImage referenceSNR2(const RefImage& snr, uint32_t width, uint32_t height);
+RefImage referenceFresnel(const RefImage& depth, uint32_t width, uint32_t height);
+RefImage referenceTNR2(const RefImage& snr2, const RefImage& history, const RefImage& depth, const RefImage& mv,
+                       const RefImage& fresnel, const RefImage& tnrInfo, uint32_t width, uint32_t height);
+RefImage referenceFinal(const RefImage& tnr2, uint32_t width, uint32_t height);
+
+// What one frame of the chain leaves for the next: TNR's history (the SNR
+// output and TNR's info) and TNR2's output. Empty before the first frame,
+// which then starts from zero history.
+struct RefHistory {
+    RefImage snr;
+    RefImage tnrInfo;
+    RefImage tnr2;
+};
+
+// The whole chain for one frame: inputs are the five channels in
+// DenoiseChannel order. Returns TNR2's output (the Fresnel term in alpha) and
+// updates history for the next frame.
+RefImage referenceFrame(const RefImage inputs[5], RefHistory& history);
+
+// Per-channel absolute error of a GPU image against its reference.
+struct RefError {
+    double maxError = 0.0;
+    double meanError = 0.0;
+    size_t nanMismatches = 0; // NaN on one side only; not in the error sums
+    uint32_t worstX = 0;
+    uint32_t worstY = 0;
+};
+RefError compareImages(const RefImage& reference, const RefImage& gpu);
+
+// One row of the comparison table.
+void printRefError(std::ostream& out, const std::string& name, const RefError& error);
@@ -0,0 +1,389 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define CPU_SIMD_AVX2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CPU_SIMD_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define CPU_SIMD_SSE2 1
+#endif
+
+// Portable SIMD vectors for the CPU denoise kernels and ImageMetrics:
+// SIMD_WIDTH float lanes with the arithmetic, compares, blends, gathers and
+// transcendentals they need. The implementation follows the compiler flags
+// of the including file: AVX2+FMA (8 lanes), NEON on AArch64 or SSE2 on
+// other x86 builds (4 lanes), or plain arrays of 4 that the compiler
+// vectorizes as far as it can.
+//
+// Everything lives in an anonymous namespace on purpose. The AVX2 kernels
+// are built with -mavx2 -mfma next to a baseline build of the same code, and
+// no inline function may be shared between the two: the linker could pick
+// the AVX2 copy for the baseline callers. For the same reason this header
+// uses the C math functions, which are not inline.
+namespace {
+
+#if defined(CPU_SIMD_AVX2)
+
+const int SIMD_WIDTH = 8;
+const char* const SIMD_NAME = "avx2";
+
+struct VFloat {
+    __m256 v;
+};
+struct VInt {
+    __m256i v;
+};
+struct VMask {
+    __m256 v;
+};
+
+inline VFloat splat(float x) { return {_mm256_set1_ps(x)}; }
+inline VFloat load(const float* p) { return {_mm256_loadu_ps(p)}; }
+inline void store(float* p, VFloat a) { _mm256_storeu_ps(p, a.v); }
+inline VFloat lanes() { return {_mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7)}; }
+
+inline VFloat operator+(VFloat a, VFloat b) { return {_mm256_add_ps(a.v, b.v)}; }
+inline VFloat operator-(VFloat a, VFloat b) { return {_mm256_sub_ps(a.v, b.v)}; }
+inline VFloat operator*(VFloat a, VFloat b) { return {_mm256_mul_ps(a.v, b.v)}; }
+inline VFloat operator/(VFloat a, VFloat b) { return {_mm256_div_ps(a.v, b.v)}; }
+inline VFloat fma(VFloat a, VFloat b, VFloat c) { return {_mm256_fmadd_ps(a.v, b.v, c.v)}; } // a * b + c
+inline VFloat min(VFloat a, VFloat b) { return {_mm256_min_ps(a.v, b.v)}; }
+inline VFloat max(VFloat a, VFloat b) { return {_mm256_max_ps(a.v, b.v)}; }
+inline VFloat abs(VFloat a) { return {_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)}; }
+inline VFloat sqrt(VFloat a) { return {_mm256_sqrt_ps(a.v)}; }
+inline VFloat floor(VFloat a) { return {_mm256_floor_ps(a.v)}; }
+
+// Ordered compares: false when either side is NaN, as in GLSL and C.
+inline VMask operator<(VFloat a, VFloat b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+inline VMask operator>(VFloat a, VFloat b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)}; }
+inline VMask operator<=(VFloat a, VFloat b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)}; }
+inline VMask operator>=(VFloat a, VFloat b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)}; }
+inline VMask operator&(VMask a, VMask b) { return {_mm256_and_ps(a.v, b.v)}; }
+inline VMask operator|(VMask a, VMask b) { return {_mm256_or_ps(a.v, b.v)}; }
+inline VMask operator!(VMask a) { return {_mm256_xor_ps(a.v, _mm256_castsi256_ps(_mm256_set1_epi32(-1)))}; }
+inline VFloat select(VMask m, VFloat a, VFloat b) { return {_mm256_blendv_ps(b.v, a.v, m.v)}; } // m ? a : b
+inline bool anyTrue(VMask m) { return _mm256_movemask_ps(m.v) != 0; }
+
+inline VInt toInt(VFloat a) { return {_mm256_cvttps_epi32(a.v)}; } // Truncates
+inline VInt operator+(VInt a, VInt b) { return {_mm256_add_epi32(a.v, b.v)}; }
+inline VInt operator*(VInt a, int32_t s) { return {_mm256_mullo_epi32(a.v, _mm256_set1_epi32(s))}; }
+inline VInt clamp(VInt a, int32_t lo, int32_t hi) {
+    return {_mm256_min_epi32(_mm256_max_epi32(a.v, _mm256_set1_epi32(lo)), _mm256_set1_epi32(hi))};
+}
+inline VFloat gather(const float* base, VInt index) { return {_mm256_i32gather_ps(base, index.v, 4)}; }
+// 2^n for n in the normal exponent range
+inline VFloat pow2i(VInt n) {
+    return {_mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(n.v, _mm256_set1_epi32(127)), 23))};
+}
+// Splits a positive normal float into mantissa (in [1, 2)) and exponent.
+inline VFloat mantissa(VFloat a) {
+    __m256i bits = _mm256_and_si256(_mm256_castps_si256(a.v), _mm256_set1_epi32(0x007fffff));
+    return {_mm256_castsi256_ps(_mm256_or_si256(bits, _mm256_set1_epi32(0x3f800000)))};
+}
+inline VFloat exponent(VFloat a) {
+    __m256i bits = _mm256_srli_epi32(_mm256_castps_si256(a.v), 23);
+    return {_mm256_cvtepi32_ps(_mm256_sub_epi32(bits, _mm256_set1_epi32(127)))};
+}
+
+#elif defined(CPU_SIMD_NEON)
+
+const int SIMD_WIDTH = 4;
+const char* const SIMD_NAME = "neon";
+
+struct VFloat {
+    float32x4_t v;
+};
+struct VInt {
+    int32x4_t v;
+};
+struct VMask {
+    uint32x4_t v;
+};
+
+inline VFloat splat(float x) { return {vdupq_n_f32(x)}; }
+inline VFloat load(const float* p) { return {vld1q_f32(p)}; }
+inline void store(float* p, VFloat a) { vst1q_f32(p, a.v); }
+inline VFloat lanes() {
+    static const float values[4] = {0, 1, 2, 3};
+    return {vld1q_f32(values)};
+}
+
+inline VFloat operator+(VFloat a, VFloat b) { return {vaddq_f32(a.v, b.v)}; }
+inline VFloat operator-(VFloat a, VFloat b) { return {vsubq_f32(a.v, b.v)}; }
+inline VFloat operator*(VFloat a, VFloat b) { return {vmulq_f32(a.v, b.v)}; }
+inline VFloat operator/(VFloat a, VFloat b) { return {vdivq_f32(a.v, b.v)}; }
+inline VFloat fma(VFloat a, VFloat b, VFloat c) { return {vfmaq_f32(c.v, a.v, b.v)}; } // a * b + c
+inline VFloat min(VFloat a, VFloat b) { return {vminq_f32(a.v, b.v)}; }
+inline VFloat max(VFloat a, VFloat b) { return {vmaxq_f32(a.v, b.v)}; }
+inline VFloat abs(VFloat a) { return {vabsq_f32(a.v)}; }
+inline VFloat sqrt(VFloat a) { return {vsqrtq_f32(a.v)}; }
+inline VFloat floor(VFloat a) { return {vrndmq_f32(a.v)}; }
+
+inline VMask operator<(VFloat a, VFloat b) { return {vcltq_f32(a.v, b.v)}; }
+inline VMask operator>(VFloat a, VFloat b) { return {vcgtq_f32(a.v, b.v)}; }
+inline VMask operator<=(VFloat a, VFloat b) { return {vcleq_f32(a.v, b.v)}; }
+inline VMask operator>=(VFloat a, VFloat b) { return {vcgeq_f32(a.v, b.v)}; }
+inline VMask operator&(VMask a, VMask b) { return {vandq_u32(a.v, b.v)}; }
+inline VMask operator|(VMask a, VMask b) { return {vorrq_u32(a.v, b.v)}; }
+inline VMask operator!(VMask a) { return {vmvnq_u32(a.v)}; }
+inline VFloat select(VMask m, VFloat a, VFloat b) { return {vbslq_f32(m.v, a.v, b.v)}; } // m ? a : b
+inline bool anyTrue(VMask m) { return vmaxvq_u32(m.v) != 0; }
+
+inline VInt toInt(VFloat a) { return {vcvtq_s32_f32(a.v)}; } // Truncates
+inline VInt operator+(VInt a, VInt b) { return {vaddq_s32(a.v, b.v)}; }
+inline VInt operator*(VInt a, int32_t s) { return {vmulq_n_s32(a.v, s)}; }
+inline VInt clamp(VInt a, int32_t lo, int32_t hi) {
+    return {vminq_s32(vmaxq_s32(a.v, vdupq_n_s32(lo)), vdupq_n_s32(hi))};
+}
+inline VFloat gather(const float* base, VInt index) {
+    int32_t offsets[4];
+    vst1q_s32(offsets, index.v);
+    float values[4] = {base[offsets[0]], base[offsets[1]], base[offsets[2]], base[offsets[3]]};
+    return {vld1q_f32(values)};
+}
+inline VFloat pow2i(VInt n) {
+    return {vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(n.v, vdupq_n_s32(127)), 23))};
+}
+// Splits a positive normal float into mantissa (in [1, 2)) and exponent.
+inline VFloat mantissa(VFloat a) {
+    uint32x4_t bits = vandq_u32(vreinterpretq_u32_f32(a.v), vdupq_n_u32(0x007fffff));
+    return {vreinterpretq_f32_u32(vorrq_u32(bits, vdupq_n_u32(0x3f800000)))};
+}
+inline VFloat exponent(VFloat a) {
+    int32x4_t bits = vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_f32(a.v), 23));
+    return {vcvtq_f32_s32(vsubq_s32(bits, vdupq_n_s32(127)))};
+}
+
+#elif defined(CPU_SIMD_SSE2)
+
+const int SIMD_WIDTH = 4;
+const char* const SIMD_NAME = "sse2";
+
+struct VFloat {
+    __m128 v;
+};
+struct VInt {
+    __m128i v;
+};
+struct VMask {
+    __m128 v;
+};
+
+inline VFloat splat(float x) { return {_mm_set1_ps(x)}; }
+inline VFloat load(const float* p) { return {_mm_loadu_ps(p)}; }
+inline void store(float* p, VFloat a) { _mm_storeu_ps(p, a.v); }
+inline VFloat lanes() { return {_mm_setr_ps(0, 1, 2, 3)}; }
+
+inline VFloat operator+(VFloat a, VFloat b) { return {_mm_add_ps(a.v, b.v)}; }
+inline VFloat operator-(VFloat a, VFloat b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline VFloat operator*(VFloat a, VFloat b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline VFloat operator/(VFloat a, VFloat b) { return {_mm_div_ps(a.v, b.v)}; }
+inline VFloat fma(VFloat a, VFloat b, VFloat c) { return {_mm_add_ps(_mm_mul_ps(a.v, b.v), c.v)}; } // a * b + c
+inline VFloat min(VFloat a, VFloat b) { return {_mm_min_ps(a.v, b.v)}; }
+inline VFloat max(VFloat a, VFloat b) { return {_mm_max_ps(a.v, b.v)}; }
+inline VFloat abs(VFloat a) { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)}; }
+inline VFloat sqrt(VFloat a) { return {_mm_sqrt_ps(a.v)}; }
+
+inline VMask operator<(VFloat a, VFloat b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+inline VMask operator>(VFloat a, VFloat b) { return {_mm_cmpgt_ps(a.v, b.v)}; }
+inline VMask operator<=(VFloat a, VFloat b) { return {_mm_cmple_ps(a.v, b.v)}; }
+inline VMask operator>=(VFloat a, VFloat b) { return {_mm_cmpge_ps(a.v, b.v)}; }
+inline VMask operator&(VMask a, VMask b) { return {_mm_and_ps(a.v, b.v)}; }
+inline VMask operator|(VMask a, VMask b) { return {_mm_or_ps(a.v, b.v)}; }
+inline VMask operator!(VMask a) { return {_mm_xor_ps(a.v, _mm_castsi128_ps(_mm_set1_epi32(-1)))}; }
+inline VFloat select(VMask m, VFloat a, VFloat b) { // m ? a : b
+    return {_mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v))};
+}
+inline bool anyTrue(VMask m) { return _mm_movemask_ps(m.v) != 0; }
+
+// SSE2 has no rounding instruction: truncate and step down where that
+// rounded up. Fine for |a| < 2^31, which covers every texel coordinate.
+inline VFloat floor(VFloat a) {
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+    return {_mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.0f)))};
+}
+
+inline VInt toInt(VFloat a) { return {_mm_cvttps_epi32(a.v)}; } // Truncates
+inline VInt operator+(VInt a, VInt b) { return {_mm_add_epi32(a.v, b.v)}; }
+inline VInt operator*(VInt a, int32_t s) { // No 32-bit multiply before SSE4.1
+    __m128i factor = _mm_set1_epi32(s);
+    __m128i even = _mm_mul_epu32(a.v, factor);
+    __m128i odd = _mm_mul_epu32(_mm_srli_si128(a.v, 4), factor);
+    return {_mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                               _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)))};
+}
+inline VInt clamp(VInt a, int32_t lo, int32_t hi) {
+    __m128i low = _mm_set1_epi32(lo);
+    __m128i high = _mm_set1_epi32(hi);
+    __m128i belowLow = _mm_cmplt_epi32(a.v, low);
+    __m128i r = _mm_or_si128(_mm_and_si128(belowLow, low), _mm_andnot_si128(belowLow, a.v));
+    __m128i aboveHigh = _mm_cmpgt_epi32(r, high);
+    return {_mm_or_si128(_mm_and_si128(aboveHigh, high), _mm_andnot_si128(aboveHigh, r))};
+}
+inline VFloat gather(const float* base, VInt index) {
+    alignas(16) int32_t offsets[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(offsets), index.v);
+    return {_mm_setr_ps(base[offsets[0]], base[offsets[1]], base[offsets[2]], base[offsets[3]])};
+}
+inline VFloat pow2i(VInt n) {
+    return {_mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n.v, _mm_set1_epi32(127)), 23))};
+}
+// Splits a positive normal float into mantissa (in [1, 2)) and exponent.
+inline VFloat mantissa(VFloat a) {
+    __m128i bits = _mm_and_si128(_mm_castps_si128(a.v), _mm_set1_epi32(0x007fffff));
+    return {_mm_castsi128_ps(_mm_or_si128(bits, _mm_set1_epi32(0x3f800000)))};
+}
+inline VFloat exponent(VFloat a) {
+    __m128i bits = _mm_srli_epi32(_mm_castps_si128(a.v), 23);
+    return {_mm_cvtepi32_ps(_mm_sub_epi32(bits, _mm_set1_epi32(127)))};
+}
+
+#else
+
+const int SIMD_WIDTH = 4;
+const char* const SIMD_NAME = "scalar";
+
+struct VFloat {
+    float v[4];
+};
+struct VInt {
+    int32_t v[4];
+};
+struct VMask {
+    bool v[4];
+};
+
+#define CPU_SIMD_LANES(expr)                                                                       \
+    for (int i = 0; i < 4; i++) {                                                                  \
+        r.v[i] = expr;                                                                             \
+    }
+
+inline VFloat splat(float x) { return {{x, x, x, x}}; }
+inline VFloat load(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+inline void store(float* p, VFloat a) { memcpy(p, a.v, sizeof(a.v)); }
+inline VFloat lanes() { return {{0, 1, 2, 3}}; }
+
+inline VFloat operator+(VFloat a, VFloat b) { VFloat r; CPU_SIMD_LANES(a.v[i] + b.v[i]) return r; }
+inline VFloat operator-(VFloat a, VFloat b) { VFloat r; CPU_SIMD_LANES(a.v[i] - b.v[i]) return r; }
+inline VFloat operator*(VFloat a, VFloat b) { VFloat r; CPU_SIMD_LANES(a.v[i] * b.v[i]) return r; }
+inline VFloat operator/(VFloat a, VFloat b) { VFloat r; CPU_SIMD_LANES(a.v[i] / b.v[i]) return r; }
+inline VFloat fma(VFloat a, VFloat b, VFloat c) { VFloat r; CPU_SIMD_LANES(a.v[i] * b.v[i] + c.v[i]) return r; }
+inline VFloat min(VFloat a, VFloat b) { VFloat r; CPU_SIMD_LANES(a.v[i] < b.v[i] ? a.v[i] : b.v[i]) return r; }
+inline VFloat max(VFloat a, VFloat b) { VFloat r; CPU_SIMD_LANES(a.v[i] > b.v[i] ? a.v[i] : b.v[i]) return r; }
+inline VFloat abs(VFloat a) { VFloat r; CPU_SIMD_LANES(fabsf(a.v[i])) return r; }
+inline VFloat sqrt(VFloat a) { VFloat r; CPU_SIMD_LANES(sqrtf(a.v[i])) return r; }
+inline VFloat floor(VFloat a) { VFloat r; CPU_SIMD_LANES(floorf(a.v[i])) return r; }
+
+inline VMask operator<(VFloat a, VFloat b) { VMask r; CPU_SIMD_LANES(a.v[i] < b.v[i]) return r; }
+inline VMask operator>(VFloat a, VFloat b) { VMask r; CPU_SIMD_LANES(a.v[i] > b.v[i]) return r; }
+inline VMask operator<=(VFloat a, VFloat b) { VMask r; CPU_SIMD_LANES(a.v[i] <= b.v[i]) return r; }
+inline VMask operator>=(VFloat a, VFloat b) { VMask r; CPU_SIMD_LANES(a.v[i] >= b.v[i]) return r; }
+inline VMask operator&(VMask a, VMask b) { VMask r; CPU_SIMD_LANES(a.v[i] && b.v[i]) return r; }
+inline VMask operator|(VMask a, VMask b) { VMask r; CPU_SIMD_LANES(a.v[i] || b.v[i]) return r; }
+inline VMask operator!(VMask a) { VMask r; CPU_SIMD_LANES(!a.v[i]) return r; }
+inline VFloat select(VMask m, VFloat a, VFloat b) { VFloat r; CPU_SIMD_LANES(m.v[i] ? a.v[i] : b.v[i]) return r; }
+inline bool anyTrue(VMask m) { return m.v[0] || m.v[1] || m.v[2] || m.v[3]; }
+
+inline VInt toInt(VFloat a) { VInt r; CPU_SIMD_LANES((int32_t)a.v[i]) return r; }
+inline VInt operator+(VInt a, VInt b) { VInt r; CPU_SIMD_LANES(a.v[i] + b.v[i]) return r; }
+inline VInt operator*(VInt a, int32_t s) { VInt r; CPU_SIMD_LANES(a.v[i] * s) return r; }
+inline VInt clamp(VInt a, int32_t lo, int32_t hi) {
+    VInt r;
+    CPU_SIMD_LANES(a.v[i] < lo ? lo : (a.v[i] > hi ? hi : a.v[i]))
+    return r;
+}
+inline VFloat gather(const float* base, VInt index) { VFloat r; CPU_SIMD_LANES(base[index.v[i]]) return r; }
+inline VFloat pow2i(VInt n) { VFloat r; CPU_SIMD_LANES(ldexpf(1.0f, n.v[i])) return r; }
+// Splits a positive normal float into mantissa (in [1, 2)) and exponent.
+inline VFloat mantissa(VFloat a) {
+    VFloat r;
+    int e;
+    CPU_SIMD_LANES(2.0f * frexpf(a.v[i], &e))
+    return r;
+}
+inline VFloat exponent(VFloat a) {
+    VFloat r;
+    int e;
+    CPU_SIMD_LANES((frexpf(a.v[i], &e), (float)(e - 1)))
+    return r;
+}
+
+#undef CPU_SIMD_LANES
+
+#endif
+
+inline VFloat operator+(VFloat a, float b) { return a + splat(b); }
+inline VFloat operator-(VFloat a, float b) { return a - splat(b); }
+inline VFloat operator*(VFloat a, float b) { return a * splat(b); }
+inline VFloat operator/(VFloat a, float b) { return a / splat(b); }
+inline VFloat operator-(float a, VFloat b) { return splat(a) - b; }
+inline VFloat operator*(float a, VFloat b) { return splat(a) * b; }
+inline VFloat operator/(float a, VFloat b) { return splat(a) / b; }
+inline VMask operator<(VFloat a, float b) { return a < splat(b); }
+inline VMask operator>(VFloat a, float b) { return a > splat(b); }
+inline VMask operator<=(VFloat a, float b) { return a <= splat(b); }
+inline VMask operator>=(VFloat a, float b) { return a >= splat(b); }
+inline VFloat clamp(VFloat a, float lo, float hi) { return min(max(a, splat(lo)), splat(hi)); }
+inline VFloat mix(VFloat a, VFloat b, VFloat t) { return a * (1.0f - t) + b * t; } // As GLSL defines it
+
+// e^x with the Cephes expf polynomial (about 2 ulp); inputs below -87.3
+// return e^-87.3, which the kernels only use as a negligible weight.
+inline VFloat exp(VFloat x) {
+    x = clamp(x, -87.3f, 88.3f);
+    VFloat n = floor(fma(x, splat(1.44269504088896341f), splat(0.5f)));
+    VFloat r = x - n * 0.693359375f - n * -2.12194440e-4f;
+    VFloat p = splat(1.9875691500e-4f);
+    p = fma(p, r, splat(1.3981999507e-3f));
+    p = fma(p, r, splat(8.3334519073e-3f));
+    p = fma(p, r, splat(4.1665795894e-2f));
+    p = fma(p, r, splat(1.6666665459e-1f));
+    p = fma(p, r, splat(5.0000001201e-1f));
+    VFloat y = fma(p, r * r, r + 1.0f);
+    return y * pow2i(toInt(n));
+}
+
+// Natural logarithm from the atanh series of the mantissa (about 1e-7
+// relative); inputs below FLT_MIN, including 0, return ln(FLT_MIN).
+inline VFloat log(VFloat x) {
+    x = max(x, splat(1.17549435e-38f));
+    VFloat m = mantissa(x), e = exponent(x);
+    VMask high = m > 1.41421356f; // Center m on 1: [sqrt(0.5), sqrt(2))
+    m = select(high, m * 0.5f, m);
+    e = select(high, e + 1.0f, e);
+    VFloat s = (m - 1.0f) / (m + 1.0f);
+    VFloat s2 = s * s;
+    VFloat p = fma(s2, splat(1.0f / 9.0f), splat(1.0f / 7.0f));
+    p = fma(p, s2, splat(1.0f / 5.0f));
+    p = fma(p, s2, splat(1.0f / 3.0f));
+    p = fma(p, s2, splat(1.0f));
+    return fma(e, splat(0.693147181f), 2.0f * s * p);
+}
+
+// a^b for a > 0.
+inline VFloat pow(VFloat a, VFloat b) { return exp(b * log(a)); }
+
+// Three planar vectors: SIMD_WIDTH xyz points or colors.
+struct VFloat3 {
+    VFloat x, y, z;
+};
+
+inline VFloat3 operator+(const VFloat3& a, const VFloat3& b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+inline VFloat3 operator-(const VFloat3& a, const VFloat3& b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+inline VFloat3 operator*(const VFloat3& a, VFloat s) { return {a.x * s, a.y * s, a.z * s}; }
+inline VFloat dot(const VFloat3& a, const VFloat3& b) { return fma(a.x, b.x, fma(a.y, b.y, a.z * b.z)); }
+inline VFloat3 cross(const VFloat3& a, const VFloat3& b) {
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+inline VFloat3 normalize(const VFloat3& a) { return a * (1.0f / sqrt(dot(a, a))); }
+inline VFloat3 select(VMask m, const VFloat3& a, const VFloat3& b) {
+    return {select(m, a.x, b.x), select(m, a.y, b.y), select(m, a.z, b.z)};
+}
+
+} // namespace
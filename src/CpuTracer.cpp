@@ -0,0 +1,134 @@
+#include "CpuTracer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+  const char *name;
+  int64_t startNs;
+  int64_t durationNs;
+};
+
+// Written only by its thread. `written` counts every event ever recorded;
+// the last events.size() of them are kept.
+struct ThreadBuffer {
+  uint32_t threadId;
+  std::string threadName;
+  std::vector<TraceEvent> events;
+  std::atomic<uint64_t> written{0};
+};
+
+// Buffers stay registered after their thread exits, so the encoder and loader
+// threads of a finished batch still show up in the trace.
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> registry;
+size_t bufferCapacity = 1 << 16;
+std::chrono::steady_clock::time_point epoch;
+
+thread_local ThreadBuffer *threadBuffer = nullptr;
+
+ThreadBuffer &getThreadBuffer() {
+  if (!threadBuffer) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    auto buffer = std::make_unique<ThreadBuffer>();
+    buffer->threadId = static_cast<uint32_t>(registry.size()) + 1;
+    buffer->threadName = "thread " + std::to_string(buffer->threadId);
+    buffer->events.resize(bufferCapacity);
+    threadBuffer = buffer.get();
+    registry.push_back(std::move(buffer));
+  }
+  return *threadBuffer;
+}
+
+void writeJsonString(std::ostream &out, const std::string &text) {
+  out << '"';
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      out << '\\';
+    }
+    out << c;
+  }
+  out << '"';
+}
+
+} // namespace
+
+std::atomic<bool> CpuTracer::enabled{false};
+
+void CpuTracer::enable(size_t eventsPerThread) {
+  {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    bufferCapacity = std::max<size_t>(1, eventsPerThread);
+    epoch = std::chrono::steady_clock::now();
+  }
+  enabled.store(true, std::memory_order_relaxed);
+}
+
+void CpuTracer::setThreadName(const std::string &name) {
+  if (!isEnabled()) {
+    return;
+  }
+  ThreadBuffer &buffer = getThreadBuffer();
+  std::lock_guard<std::mutex> lock(registryMutex);
+  buffer.threadName = name;
+}
+
+int64_t CpuTracer::now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - epoch)
+      .count();
+}
+
+void CpuTracer::record(const char *name, int64_t startNs, int64_t endNs) {
+  ThreadBuffer &buffer = getThreadBuffer();
+  uint64_t index = buffer.written.load(std::memory_order_relaxed);
+  buffer.events[index % buffer.events.size()] = {name, startNs,
+                                                 endNs - startNs};
+  buffer.written.store(index + 1, std::memory_order_release);
+}
+
+// Complete ("X") events with microsecond timestamps, plus a thread_name
+// metadata event per thread so each row is labelled.
+size_t CpuTracer::writeChromeTrace(const std::string &path) {
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open " + path + " for writing!");
+  }
+
+  std::lock_guard<std::mutex> lock(registryMutex);
+  size_t eventCount = 0;
+  bool first = true;
+  file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+  file << std::fixed << std::setprecision(3);
+  for (const auto &buffer : registry) {
+    file << (first ? "" : ",\n")
+         << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+            "\"tid\": "
+         << buffer->threadId << ", \"args\": {\"name\": ";
+    writeJsonString(file, buffer->threadName);
+    file << "}}";
+    first = false;
+
+    uint64_t written = buffer->written.load(std::memory_order_acquire);
+    uint64_t capacity = buffer->events.size();
+    uint64_t begin = written > capacity ? written - capacity : 0;
+    for (uint64_t i = begin; i < written; i++) {
+      const TraceEvent &event = buffer->events[i % capacity];
+      file << ",\n{\"name\": ";
+      writeJsonString(file, event.name);
+      file << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->threadId
+           << ", \"ts\": " << event.startNs / 1000.0
+           << ", \"dur\": " << event.durationNs / 1000.0 << "}";
+      eventCount++;
+    }
+  }
+  file << "\n]}\n";
+  return eventCount;
+}
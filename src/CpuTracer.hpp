@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Scoped CPU timers for every thread, exported as Chrome trace events
+// (chrome://tracing, ui.perfetto.dev).
+//
+// Each thread records into its own ring buffer of the most recent events, so
+// recording takes no lock and never allocates after the thread's first event.
+// A disabled tracer costs one relaxed load per scope. Names must be string
+// literals (or otherwise outlive the tracer); only the pointer is stored.
+//
+//   CpuTracer::enable();
+//   CpuTracer::setThreadName("loader");
+//   { TRACE_SCOPE("loadFrame"); ... }
+//   CpuTracer::writeChromeTrace("trace.json");
+class CpuTracer {
+public:
+    // Call before the traced threads start; the capacity applies to buffers
+    // created afterwards.
+    static void enable(size_t eventsPerThread = 1 << 16);
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    // Label of the calling thread in the trace.
+    static void setThreadName(const std::string& name);
+
+    static int64_t now(); // Nanoseconds since enable()
+    static void record(const char* name, int64_t startNs, int64_t endNs);
+
+    // Writes every thread's buffered events; returns how many. Threads should
+    // be idle: an event recorded during the write may overwrite one being read.
+    static size_t writeChromeTrace(const std::string& path);
+
+private:
+    static std::atomic<bool> enabled;
+};
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* name)
+        : name(CpuTracer::isEnabled() ? name : nullptr), start(this->name ? CpuTracer::now() : 0) {}
+    ~TraceScope() {
+        if (name) {
+            CpuTracer::record(name, start, CpuTracer::now());
+        }
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name;
+    int64_t start;
+};
+
+#define TRACE_SCOPE_CONCAT2(a, b) a##b
+#define TRACE_SCOPE_CONCAT(a, b) TRACE_SCOPE_CONCAT2(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_SCOPE_CONCAT(traceScope, __LINE__)(name)
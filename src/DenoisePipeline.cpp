@@ -0,0 +1,272 @@
+#include "DenoisePipeline.hpp"
+#include "VulkanRenderer.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <stdexcept>
+
+struct DenoisePipeline::State {
+  explicit State(size_t slotCount) : queues(slotCount), results(slotCount) {}
+
+  VulkanRenderer::FrameQueues queues;
+  // Finished readback slots waiting for the delivery thread: frame, slot
+  BoundedQueue<std::pair<int64_t, int>> results;
+  VulkanRenderer::FrameTimes times;
+
+  // Imported host memory, keyed by the base the caller registered
+  struct HostMemory {
+    const void *base;
+    ImportedHostBuffer imported;
+  };
+  std::vector<HostMemory> hostMemory;
+
+  // Progress of the delivery thread, for releaseHostMemory()
+  std::mutex progressMutex;
+  std::condition_variable progressChanged;
+  int64_t delivered = 0; // Frames [0, delivered) are done
+  bool renderDone = false; // The GPU is idle for good
+};
+
+DenoisePipeline::DenoisePipeline(const DenoiseOptions &options,
+                                 ResultCallback onResult)
+    : options(options), onResult(std::move(onResult)) {
+  if (options.width == 0 || options.height == 0 || options.streams == 0) {
+    throw std::runtime_error("denoise pipeline needs a size and a stream!");
+  }
+
+  // Batch mode minus the files: no window, upload and readback slots, and
+  // streams that take their metadata from the options.
+  SequenceInfo sequence;
+  sequence.directory.clear();
+  sequence.width = options.width;
+  sequence.height = options.height;
+
+  RendererConfig config;
+  config.batch = true;
+  config.memoryStreams.assign(options.streams, sequence);
+  config.outputSource = options.output;
+  config.framesInFlight = options.framesInFlight;
+  config.traceOutput = options.traceOutput;
+
+  renderer = std::make_unique<VulkanRenderer>(config);
+  renderer->loadSequence();
+  renderer->initVulkan();
+
+  state = std::make_unique<State>(renderer->uploadSlots.size());
+  renderThread = std::thread(&DenoisePipeline::renderLoop, this);
+  deliveryThread = std::thread(&DenoisePipeline::deliveryLoop, this);
+}
+
+DenoisePipeline::~DenoisePipeline() {
+  try {
+    finish();
+  } catch (...) {
+    // Errors are reported by finish(); a destructor can only drop them.
+  }
+  for (auto &memory : state->hostMemory) {
+    renderer->hostMemoryImporter.release(memory.imported);
+  }
+  renderer->cleanup();
+}
+
+bool DenoisePipeline::canImportHostMemory() const {
+  return renderer->hostMemoryImporter.isEnabled();
+}
+
+size_t DenoisePipeline::hostMemoryAlignment() const {
+  return static_cast<size_t>(renderer->hostMemoryImporter.getAlignment());
+}
+
+bool DenoisePipeline::importHostMemory(const void *base, size_t size) {
+  State::HostMemory memory{base, {}};
+  if (!renderer->hostMemoryImporter.import(base, size, memory.imported)) {
+    return false;
+  }
+  state->hostMemory.push_back(memory);
+  return true;
+}
+
+void DenoisePipeline::releaseHostMemory(const void *base) {
+  auto it = std::find_if(
+      state->hostMemory.begin(), state->hostMemory.end(),
+      [base](const State::HostMemory &memory) { return memory.base == base; });
+  if (it == state->hostMemory.end()) {
+    return;
+  }
+  {
+    std::unique_lock<std::mutex> lock(state->progressMutex);
+    state->progressChanged.wait(lock, [&] {
+      return state->delivered >= nextFrame || state->renderDone;
+    });
+  }
+  renderer->hostMemoryImporter.release(it->imported);
+  state->hostMemory.erase(it);
+}
+
+size_t DenoisePipeline::inputBytes() const {
+  return (size_t)options.width * options.height * 4;
+}
+
+size_t DenoisePipeline::outputBytes() const {
+  return static_cast<size_t>(renderer->outputFrameBytes());
+}
+
+DenoiseFrame DenoisePipeline::beginFrame() {
+  if (finished) {
+    throw std::runtime_error("denoise pipeline is finished!");
+  }
+  std::optional<int> slot = state->queues.freeUploads.pop();
+  if (!slot) {
+    throwStopped();
+  }
+
+  // Staging memory unless pushFrame() points an input elsewhere
+  VulkanRenderer::UploadSlot &upload = renderer->uploadSlots[*slot];
+  std::fill(upload.sources.begin(), upload.sources.end(), VK_NULL_HANDLE);
+
+  DenoiseFrame frame;
+  frame.slot = *slot;
+  for (auto &memory : upload.memories) {
+    frame.channels.push_back(memory.mapped);
+  }
+  return frame;
+}
+
+int64_t DenoisePipeline::submitFrame(const DenoiseFrame &frame) {
+  if (!state->queues.loadedUploads.push({nextFrame, frame.slot})) {
+    throwStopped();
+  }
+  return nextFrame++;
+}
+
+int64_t DenoisePipeline::pushFrame(const void *const *inputs) {
+  TRACE_SCOPE("pushFrame");
+  DenoiseFrame frame = beginFrame();
+  VulkanRenderer::UploadSlot &upload = renderer->uploadSlots[frame.slot];
+  for (size_t c = 0; c < frame.channels.size(); c++) {
+    // Inputs in imported memory are copied to the image by the GPU directly.
+    // Buffer-to-image copies need 4-byte aligned offsets.
+    // Compared as integers: the input and the imports are unrelated
+    // allocations, so subtracting their pointers is undefined.
+    const uint8_t *input = static_cast<const uint8_t *>(inputs[c]);
+    uintptr_t address = reinterpret_cast<uintptr_t>(input);
+    bool imported = false;
+    for (const auto &memory : state->hostMemory) {
+      uintptr_t base = reinterpret_cast<uintptr_t>(memory.imported.base);
+      if (address >= base && address - base <= memory.imported.size &&
+          inputBytes() <= memory.imported.size - (address - base) &&
+          (address - base) % 4 == 0) {
+        upload.sources[c] = memory.imported.buffer;
+        upload.sourceOffsets[c] = address - base;
+        imported = true;
+        break;
+      }
+    }
+    if (imported) {
+      importedCount++;
+    } else {
+      std::memcpy(frame.channels[c], input, inputBytes());
+      copiedCount++;
+    }
+  }
+  return submitFrame(frame);
+}
+
+int64_t DenoisePipeline::pushFrames(const FrameSource &source) {
+  int64_t count = 0;
+  while (true) {
+    DenoiseFrame frame = beginFrame();
+    if (!source(nextFrame, frame)) {
+      state->queues.freeUploads.push(frame.slot); // Unused, give it back
+      break;
+    }
+    submitFrame(frame);
+    count++;
+  }
+  return count;
+}
+
+void DenoisePipeline::finish() {
+  if (!finished) {
+    finished = true;
+    state->queues.loadedUploads.close();
+    renderThread.join();
+    state->results.close();
+    deliveryThread.join();
+    state->queues.close();
+  }
+  std::lock_guard<std::mutex> lock(errorMutex);
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+// Keeps the first error and stops every stage; beginFrame() and submitFrame()
+// then throw. Must be called from a catch block.
+void DenoisePipeline::fail() {
+  {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    if (!error) {
+      error = std::current_exception();
+    }
+  }
+  state->queues.close();
+  state->results.close();
+}
+
+void DenoisePipeline::throwStopped() {
+  std::lock_guard<std::mutex> lock(errorMutex);
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  throw std::runtime_error("denoise pipeline has stopped!");
+}
+
+void DenoisePipeline::renderLoop() {
+  CpuTracer::setThreadName("render");
+  try {
+    renderer->renderFrames(
+        state->queues,
+        [this](int64_t frame, int readbackSlot) {
+          if (!state->results.push({frame, readbackSlot})) {
+            state->queues.freeReadbacks.push(readbackSlot);
+          }
+        },
+        state->times);
+  } catch (...) {
+    fail();
+  }
+  // renderFrames() only returns once the GPU is idle.
+  std::lock_guard<std::mutex> lock(state->progressMutex);
+  state->renderDone = true;
+  state->progressChanged.notify_all();
+}
+
+// Hands every stream's part of a readback slot to the callback, then returns
+// the slot to the render thread.
+void DenoisePipeline::deliveryLoop() {
+  CpuTracer::setThreadName("delivery");
+  OutputPixels format = options.output == OutputSource::TNR2
+                            ? OutputPixels::RGBA16F
+                            : OutputPixels::BGRA8;
+  while (std::optional<std::pair<int64_t, int>> result =
+             state->results.pop()) {
+    const uint8_t *pixels = static_cast<const uint8_t *>(
+        renderer->readbackSlots[result->second].memory.mapped);
+    try {
+      TRACE_SCOPE("deliverResults");
+      for (unsigned s = 0; s < options.streams; s++) {
+        onResult({result->first, s, pixels + s * outputBytes(), outputBytes(),
+                  format, options.width, options.height});
+      }
+    } catch (...) {
+      fail();
+    }
+    state->queues.freeReadbacks.push(result->second);
+
+    std::lock_guard<std::mutex> lock(state->progressMutex);
+    state->delivered = result->first + 1;
+    state->progressChanged.notify_all();
+  }
+}
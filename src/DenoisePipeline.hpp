@@ -0,0 +1,142 @@
+#pragma once
+
+#include "OutputEncoder.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class VulkanRenderer;
+
+// Input channels of one stream, in the order the shaders sample them.
+enum class DenoiseChannel { Color, Depth, Normal, Albedo, MotionVectors };
+const int DENOISE_CHANNELS = 5;
+
+struct DenoiseOptions {
+    uint32_t width = 1920;
+    uint32_t height = 864;
+    unsigned streams = 1; // Independent sequences denoised side by side
+    OutputSource output = OutputSource::TNR2;
+    int framesInFlight = 2; // 1-4
+    std::string traceOutput; // Chrome trace of the pipeline's threads, written on destruction
+};
+
+// Input memory of one frame for every stream. The pointers go straight into
+// the persistently mapped staging memory the GPU copies from, so whatever is
+// written there is uploaded without another copy. Each channel holds
+// width * height RGBA8 pixels, rows top to bottom as the GPU samples them.
+// The raw sequence files are stored bottom-up; flipRows() (PixelConvert.hpp)
+// turns them around.
+struct DenoiseFrame {
+    int slot = -1;
+    std::vector<void*> channels; // [stream * DENOISE_CHANNELS + channel]
+
+    void* channel(unsigned stream, DenoiseChannel which) const {
+        return channels[stream * DENOISE_CHANNELS + static_cast<int>(which)];
+    }
+};
+
+// One stream's output of one frame: RGBA16F for TNR2, BGRA8 for the final
+// image, rows top to bottom like the inputs. The pixels live in readback memory and are only
+// valid during the callback.
+struct DenoiseResult {
+    int64_t frame; // Number returned by submitFrame()/pushFrame()
+    unsigned stream;
+    const void* pixels;
+    size_t size;
+    OutputPixels format;
+    uint32_t width;
+    uint32_t height;
+};
+
+// Embeddable denoiser. Frames are pushed from memory and the results are
+// delivered asynchronously on a delivery thread, in submission order. No
+// window, surface or swapchain is created.
+//
+// Frames can be fed three ways:
+//   beginFrame() + submitFrame() : the caller fills the staging memory itself
+//                                  (decoder output, network receive, ...)
+//   pushFrame()                  : copies from caller buffers into staging,
+//                                  or reads them in place when they lie in
+//                                  imported host memory
+//   pushFrames()                 : a callback fills the staging memory
+// Internally this is batch mode's pipeline with the caller as the loader and
+// the result callback as the encoder.
+//
+// Feed frames from one thread. The result callback must not call back into
+// the pipeline.
+class DenoisePipeline {
+public:
+    using ResultCallback = std::function<void(const DenoiseResult&)>;
+    // Fills `inputs` for frame number `frame`; returns false when there are
+    // no more frames.
+    using FrameSource = std::function<bool(int64_t frame, const DenoiseFrame& inputs)>;
+
+    DenoisePipeline(const DenoiseOptions& options, ResultCallback onResult);
+    ~DenoisePipeline();
+    DenoisePipeline(const DenoisePipeline&) = delete;
+    DenoisePipeline& operator=(const DenoisePipeline&) = delete;
+
+    // Blocks until an upload slot is free.
+    DenoiseFrame beginFrame();
+    // Queues a frame from beginFrame() for rendering; returns its number.
+    int64_t submitFrame(const DenoiseFrame& frame);
+    // inputs: one buffer per [stream * DENOISE_CHANNELS + channel]. Inputs
+    // inside imported host memory are not copied; they must stay unchanged
+    // until the frame's results have been delivered.
+    int64_t pushFrame(const void* const* inputs);
+    // Pulls frames from `source` until it returns false; returns the count.
+    int64_t pushFrames(const FrameSource& source);
+
+    // Waits until every submitted frame has been delivered. No frames can be
+    // pushed afterwards. Rethrows the first error of the render or delivery
+    // thread (including exceptions thrown by the result callback).
+    void finish();
+
+    // Zero-copy input (VK_EXT_external_memory_host). Imports caller memory,
+    // e.g. a pool of frame buffers or an mmap'd container file, so the GPU
+    // copies pushFrame() inputs that lie inside it straight to the input
+    // images. The range is rounded out to hostMemoryAlignment(), which must
+    // stay mapped. Returns false if the device can't import it; pushFrame()
+    // then copies as usual.
+    bool importHostMemory(const void* base, size_t size);
+    // Waits until every frame pushed so far has been delivered, then drops
+    // the import. Call it before freeing or unmapping the memory.
+    void releaseHostMemory(const void* base);
+    bool canImportHostMemory() const;
+    size_t hostMemoryAlignment() const;
+
+    size_t inputBytes() const;  // Per channel
+    size_t outputBytes() const; // Per stream
+    // Inputs of the frames pushed so far that were read in place / copied
+    uint64_t importedInputs() const { return importedCount; }
+    uint64_t copiedInputs() const { return copiedCount; }
+
+private:
+    struct State;
+
+    void renderLoop();
+    void deliveryLoop();
+    void fail();
+    [[noreturn]] void throwStopped();
+
+    DenoiseOptions options;
+    ResultCallback onResult;
+    std::unique_ptr<VulkanRenderer> renderer;
+    std::unique_ptr<State> state;
+    int64_t nextFrame = 0;
+    bool finished = false;
+    uint64_t importedCount = 0;
+    uint64_t copiedCount = 0;
+
+    std::thread renderThread;
+    std::thread deliveryThread;
+    std::mutex errorMutex;
+    std::exception_ptr error;
+};
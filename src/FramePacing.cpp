@@ -0,0 +1,137 @@
+#include "FramePacing.hpp"
+#include <algorithm>
+#include <iomanip>
+
+// Values below 2^SUB_BITS are exact; above, a value with its highest set bit
+// at position msb falls into one of HALF buckets of its power of two.
+static const int SUB_BITS = 6;
+static const uint64_t SUB_COUNT = 1ull << SUB_BITS; // 64
+static const uint64_t HALF = SUB_COUNT / 2;         // 32
+
+LatencyHistogram::LatencyHistogram()
+    : buckets(SUB_COUNT + (64 - SUB_BITS) * HALF, 0) {}
+
+size_t LatencyHistogram::bucketIndex(uint64_t micros) {
+  if (micros < SUB_COUNT) {
+    return static_cast<size_t>(micros);
+  }
+  int msb = 63;
+  while (!(micros >> msb)) {
+    msb--;
+  }
+  int shift = msb - (SUB_BITS - 1); // >= 1: keeps the top SUB_BITS bits
+  uint64_t top = micros >> shift;   // In [HALF, SUB_COUNT)
+  return static_cast<size_t>(SUB_COUNT + (shift - 1) * HALF + (top - HALF));
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index) {
+  if (index < SUB_COUNT) {
+    return index;
+  }
+  uint64_t shift = (index - SUB_COUNT) / HALF + 1;
+  uint64_t top = (index - SUB_COUNT) % HALF + HALF;
+  return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t micros) {
+  buckets[bucketIndex(micros)]++;
+  count++;
+  sum += micros;
+  max = std::max(max, micros);
+}
+
+uint64_t LatencyHistogram::percentile(double fraction) const {
+  if (count == 0) {
+    return 0;
+  }
+  uint64_t rank = static_cast<uint64_t>(fraction * count + 0.5);
+  rank = std::min(std::max<uint64_t>(rank, 1), count);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); i++) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      return std::min(bucketUpperBound(i), max);
+    }
+  }
+  return max;
+}
+
+static uint64_t microsBetween(FramePacing::Clock::time_point from,
+                              FramePacing::Clock::time_point to) {
+  auto micros =
+      std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+  return micros > 0 ? static_cast<uint64_t>(micros) : 0;
+}
+
+void FramePacing::init(size_t contextCount, double budgetMs) {
+  contexts.assign(contextCount, FrameTimes());
+  this->budgetMs = budgetMs;
+}
+
+void FramePacing::frameStarted(uint32_t context) {
+  FrameTimes &frame = contexts[context];
+  frame.start = Clock::now();
+  frame.acquired = frame.start;
+  frame.pending = false;
+}
+
+void FramePacing::frameAcquired(uint32_t context) {
+  contexts[context].acquired = Clock::now();
+}
+
+void FramePacing::frameSubmitted(uint32_t context) {
+  FrameTimes &frame = contexts[context];
+  frame.submitted = Clock::now();
+  frame.pending = true;
+}
+
+void FramePacing::frameFinished(uint32_t context) {
+  FrameTimes &frame = contexts[context];
+  if (!frame.pending) {
+    return;
+  }
+  frame.pending = false;
+  Clock::time_point now = Clock::now();
+
+  latency.record(microsBetween(frame.start, now));
+  acquireWait.record(microsBetween(frame.start, frame.acquired));
+  cpuWork.record(microsBetween(frame.acquired, frame.submitted));
+  queueTime.record(microsBetween(frame.submitted, now));
+  if (anyFinished) {
+    uint64_t micros = microsBetween(lastFinish, now);
+    interval.record(micros);
+    if (micros > budgetMs * 1000.0) {
+      stalls++;
+    }
+  }
+  lastFinish = now;
+  anyFinished = true;
+}
+
+void FramePacing::printReport(std::ostream &out,
+                              const std::string &finishedBy) const {
+  auto row = [&](const char *name, const LatencyHistogram &histogram) {
+    out << "  " << std::left << std::setw(14) << name << std::right
+        << std::setw(9) << histogram.getMean() / 1000.0 << std::setw(9)
+        << histogram.percentile(0.50) / 1000.0 << std::setw(9)
+        << histogram.percentile(0.90) / 1000.0 << std::setw(9)
+        << histogram.percentile(0.99) / 1000.0 << std::setw(9)
+        << histogram.getMax() / 1000.0 << std::endl;
+  };
+
+  out << "=== Frame Pacing (" << latency.getCount() << " frames, end = "
+      << finishedBy << ") ===" << std::endl;
+  out << std::fixed << std::setprecision(2);
+  out << "  " << std::left << std::setw(14) << "ms" << std::right
+      << std::setw(9) << "mean" << std::setw(9) << "p50" << std::setw(9)
+      << "p90" << std::setw(9) << "p99" << std::setw(9) << "max"
+      << std::endl;
+  row("interval", interval);
+  row("latency", latency);
+  row("  acquire", acquireWait);
+  row("  cpu", cpuWork);
+  row("  queue", queueTime);
+  out << "  stalls: " << stalls << " of " << interval.getCount()
+      << " intervals over the " << budgetMs << " ms budget" << std::endl;
+  out << std::defaultfloat;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Histogram of durations in microseconds with bounded relative error, in the
+// style of HdrHistogram: values below 64 us get a bucket each, larger values
+// keep their top 6 significant bits (at most ~3% error). Recording is O(1)
+// and the memory use is fixed.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void record(uint64_t micros);
+    uint64_t getCount() const { return count; }
+    uint64_t getMax() const { return max; }
+    double getMean() const { return count ? (double)sum / count : 0.0; }
+    // Upper bound of the bucket holding the given fraction of the samples.
+    uint64_t percentile(double fraction) const;
+
+private:
+    static size_t bucketIndex(uint64_t micros);
+    static uint64_t bucketUpperBound(size_t index);
+
+    std::vector<uint64_t> buckets;
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+};
+
+// Per-frame timestamps and pacing statistics.
+//
+// A frame starts when its frame context is free again and ends when it is
+// presented (windowed) or seen complete on the GPU (headless, batch). The
+// frame interval is the time between two consecutive frame ends, the latency
+// the time from a frame's start to its end. Intervals above the budget count
+// as stalls.
+//
+// GPU completion is observed when the context's fence wait returns, so for a
+// CPU-bound run it is an upper bound.
+class FramePacing {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void init(size_t contextCount, double budgetMs);
+
+    void frameStarted(uint32_t context);
+    void frameAcquired(uint32_t context);
+    void frameSubmitted(uint32_t context);
+    // End of the frame in `context`: presented or seen complete. Does nothing
+    // for a context without a submitted frame.
+    void frameFinished(uint32_t context);
+
+    uint64_t getStalls() const { return stalls; }
+    void printReport(std::ostream& out, const std::string& finishedBy) const;
+
+private:
+    struct FrameTimes {
+        Clock::time_point start;
+        Clock::time_point acquired; // = start when nothing is acquired
+        Clock::time_point submitted;
+        bool pending = false;       // Submitted, not finished yet
+    };
+
+    std::vector<FrameTimes> contexts;
+    double budgetMs = 0.0;
+
+    LatencyHistogram interval;
+    LatencyHistogram latency;
+    LatencyHistogram acquireWait; // start -> acquired
+    LatencyHistogram cpuWork;     // acquired -> submitted
+    LatencyHistogram queueTime;   // submitted -> finished
+    Clock::time_point lastFinish;
+    bool anyFinished = false;
+    uint64_t stalls = 0;
+};
@@ -0,0 +1,340 @@
+#include "GpuProfiler.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+void GpuProfiler::init(VkPhysicalDevice physicalDevice, VkDevice device,
+                       uint32_t queueFamilyIndex, uint32_t contextCount,
+                       uint32_t streamCount,
+                       const std::vector<std::string> &passNames,
+                       double printInterval, bool pipelineStatistics) {
+  this->device = device;
+  this->streamCount = streamCount;
+  this->passNames = passNames;
+  this->printInterval = printInterval;
+  pointCount = static_cast<uint32_t>(passNames.size()) + 1;
+  passes.assign(passNames.size(), PassSamples());
+  recorded.assign(contextCount, false);
+  lastPrint = std::chrono::steady_clock::now();
+
+  // Queues without timestamp support report 0 valid bits.
+  uint32_t familyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount,
+                                           nullptr);
+  std::vector<VkQueueFamilyProperties> families(familyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount,
+                                           families.data());
+  uint32_t validBits = families[queueFamilyIndex].timestampValidBits;
+  if (validBits == 0) {
+    std::cerr << "GPU profiling: the queue has no timestamps, disabled"
+              << std::endl;
+    return;
+  }
+  validMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  timestampPeriod = properties.limits.timestampPeriod;
+
+  VkQueryPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  poolInfo.queryCount = contextCount * streamCount * pointCount;
+  if (vkCreateQueryPool(device, &poolInfo, nullptr, &queryPool) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create timestamp query pool!");
+  }
+
+  // Compute invocations stay zero while every pass is a fullscreen draw; the
+  // counter is there for compute passes.
+  if (pipelineStatistics) {
+    VkQueryPoolCreateInfo statisticsInfo{};
+    statisticsInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    statisticsInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    statisticsInfo.queryCount =
+        contextCount * streamCount * static_cast<uint32_t>(passes.size());
+    statisticsInfo.pipelineStatistics =
+        VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+    if (vkCreateQueryPool(device, &statisticsInfo, nullptr,
+                          &statisticsPool) != VK_SUCCESS) {
+      throw std::runtime_error(
+          "failed to create pipeline statistics query pool!");
+    }
+  }
+}
+
+void GpuProfiler::destroy() {
+  if (queryPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(device, queryPool, nullptr);
+    queryPool = VK_NULL_HANDLE;
+  }
+  if (statisticsPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(device, statisticsPool, nullptr);
+    statisticsPool = VK_NULL_HANDLE;
+  }
+}
+
+const char *GpuProfiler::counterName(Counter counter) {
+  switch (counter) {
+  case VertexInvocations:
+    return "vertex_invocations";
+  case ClippingInvocations:
+    return "clipping_invocations";
+  case ClippingPrimitives:
+    return "clipping_primitives";
+  case FragmentInvocations:
+    return "fragment_invocations";
+  case ComputeInvocations:
+    return "compute_invocations";
+  default:
+    return "";
+  }
+}
+
+uint32_t GpuProfiler::queryIndex(uint32_t context, uint32_t stream,
+                                 uint32_t point) const {
+  return (context * streamCount + stream) * pointCount + point;
+}
+
+uint32_t GpuProfiler::statisticsIndex(uint32_t context, uint32_t stream,
+                                      uint32_t pass) const {
+  return (context * streamCount + stream) * (pointCount - 1) + pass;
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer,
+                             uint32_t context) {
+  if (!isEnabled()) {
+    return;
+  }
+  collect(context);
+  vkCmdResetQueryPool(commandBuffer, queryPool, queryIndex(context, 0, 0),
+                      streamCount * pointCount);
+  if (hasPipelineStatistics()) {
+    vkCmdResetQueryPool(commandBuffer, statisticsPool,
+                        statisticsIndex(context, 0, 0),
+                        streamCount * (pointCount - 1));
+  }
+  recorded[context] = true;
+
+  if (printInterval > 0.0) {
+    auto now = std::chrono::steady_clock::now();
+    if (std::chrono::duration<double>(now - lastPrint).count() >=
+        printInterval) {
+      lastPrint = now;
+      printStats(std::cout);
+    }
+  }
+}
+
+// Bottom of pipe: a timestamp is written once all earlier work is done.
+void GpuProfiler::beginPass(VkCommandBuffer commandBuffer, uint32_t context,
+                            uint32_t stream, uint32_t pass) {
+  if (!isEnabled()) {
+    return;
+  }
+  if (pass == 0) {
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                        queryPool, queryIndex(context, stream, 0));
+  }
+  if (hasPipelineStatistics()) {
+    vkCmdBeginQuery(commandBuffer, statisticsPool,
+                    statisticsIndex(context, stream, pass), 0);
+  }
+}
+
+void GpuProfiler::endPass(VkCommandBuffer commandBuffer, uint32_t context,
+                          uint32_t stream, uint32_t pass) {
+  if (!isEnabled()) {
+    return;
+  }
+  if (hasPipelineStatistics()) {
+    vkCmdEndQuery(commandBuffer, statisticsPool,
+                  statisticsIndex(context, stream, pass));
+  }
+  vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                      queryPool, queryIndex(context, stream, pass + 1));
+}
+
+double GpuProfiler::elapsedMs(uint64_t begin, uint64_t end) const {
+  uint64_t ticks = ((end & validMask) - (begin & validMask)) & validMask;
+  return ticks * timestampPeriod * 1e-6;
+}
+
+// The caller has waited for the context's fence, so the results are there;
+// without WAIT_BIT an unexpected miss is skipped instead of stalling.
+void GpuProfiler::collect(uint32_t context) {
+  if (!recorded[context]) {
+    return;
+  }
+  recorded[context] = false;
+
+  uint32_t count = streamCount * pointCount;
+  std::vector<uint64_t> ticks(count);
+  if (vkGetQueryPoolResults(device, queryPool, queryIndex(context, 0, 0),
+                            count, count * sizeof(uint64_t), ticks.data(),
+                            sizeof(uint64_t),
+                            VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+    return;
+  }
+  uint32_t passCount = static_cast<uint32_t>(passes.size());
+  std::vector<Counters> counters(streamCount * passCount, Counters{});
+  if (hasPipelineStatistics() &&
+      vkGetQueryPoolResults(device, statisticsPool,
+                            statisticsIndex(context, 0, 0),
+                            streamCount * passCount,
+                            counters.size() * sizeof(Counters),
+                            counters.data(), sizeof(Counters),
+                            VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+    return;
+  }
+
+  for (uint32_t s = 0; s < streamCount; s++) {
+    const uint64_t *points = &ticks[s * pointCount];
+    for (size_t p = 0; p < passes.size(); p++) {
+      PassSamples &pass = passes[p];
+      double ms = elapsedMs(points[p], points[p + 1]);
+      const Counters &passCounters = counters[s * passCount + p];
+      if (pass.ms.size() < WINDOW) {
+        pass.ms.push_back(ms);
+        pass.counters.push_back(passCounters);
+      } else {
+        pass.ms[pass.next] = ms;
+        pass.counters[pass.next] = passCounters;
+      }
+      pass.next = (pass.next + 1) % WINDOW;
+      pass.total++;
+    }
+  }
+}
+
+static double percentile(const std::vector<double> &sorted, double fraction) {
+  if (sorted.empty()) {
+    return 0.0;
+  }
+  size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+std::vector<GpuProfiler::PassStats> GpuProfiler::getStats() const {
+  std::vector<PassStats> stats(passes.size());
+  for (size_t p = 0; p < passes.size(); p++) {
+    stats[p].name = passNames[p];
+    std::vector<double> sorted = passes[p].ms;
+    if (sorted.empty()) {
+      continue;
+    }
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0.0;
+    for (double ms : sorted) {
+      sum += ms;
+    }
+    stats[p].samples = sorted.size();
+    stats[p].meanMs = sum / sorted.size();
+    stats[p].p50Ms = percentile(sorted, 0.50);
+    stats[p].p99Ms = percentile(sorted, 0.99);
+    for (const Counters &counters : passes[p].counters) {
+      for (int c = 0; c < COUNTER_COUNT; c++) {
+        stats[p].counters[c] += counters[c];
+      }
+    }
+    for (double &counter : stats[p].counters) {
+      counter /= sorted.size();
+    }
+  }
+  return stats;
+}
+
+std::vector<double> GpuProfiler::getSamples(size_t pass) const {
+  const PassSamples &samples = passes[pass];
+  if (samples.ms.size() < WINDOW) {
+    return samples.ms;
+  }
+  // A full ring: the oldest sample is the next one to be overwritten.
+  std::vector<double> ordered(samples.ms.begin() + samples.next,
+                              samples.ms.end());
+  ordered.insert(ordered.end(), samples.ms.begin(),
+                 samples.ms.begin() + samples.next);
+  return ordered;
+}
+
+void GpuProfiler::printStats(std::ostream &out) const {
+  if (!isEnabled()) {
+    return;
+  }
+  std::vector<PassStats> stats = getStats();
+  double totalMean = 0.0;
+  out << "=== GPU Pass Times (last " << WINDOW << " samples) ===" << std::endl;
+  out << std::left << std::setw(10) << "Pass" << std::right << std::setw(10)
+      << "mean ms" << std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms";
+  if (hasPipelineStatistics()) {
+    // Per frame and stream
+    out << std::setw(12) << "vertices" << std::setw(12) << "clip prims"
+        << std::setw(14) << "fragments" << std::setw(12) << "compute";
+  }
+  out << std::endl;
+  for (const auto &pass : stats) {
+    out << std::fixed << std::setprecision(3) << std::left << std::setw(10)
+        << pass.name << std::right << std::setw(10) << pass.meanMs
+        << std::setw(10) << pass.p50Ms << std::setw(10) << pass.p99Ms;
+    if (hasPipelineStatistics()) {
+      out << std::setprecision(0) << std::setw(12)
+          << pass.counters[VertexInvocations] << std::setw(12)
+          << pass.counters[ClippingPrimitives] << std::setw(14)
+          << pass.counters[FragmentInvocations] << std::setw(12)
+          << pass.counters[ComputeInvocations];
+    }
+    out << std::endl;
+    totalMean += pass.meanMs;
+  }
+  out << std::setprecision(3);
+  out << std::left << std::setw(10) << "Total" << std::right << std::setw(10)
+      << totalMean << std::endl;
+  out << std::defaultfloat;
+}
+
+void GpuProfiler::exportStats(const std::string &path) const {
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open " + path + " for writing!");
+  }
+  std::vector<PassStats> stats = getStats();
+  bool json =
+      path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+  file << std::fixed << std::setprecision(4);
+  if (json) {
+    file << "{\n  \"window\": " << WINDOW << ",\n  \"passes\": [\n";
+    for (size_t p = 0; p < stats.size(); p++) {
+      file << "    {\"name\": \"" << stats[p].name
+           << "\", \"samples\": " << stats[p].samples
+           << ", \"mean_ms\": " << stats[p].meanMs
+           << ", \"p50_ms\": " << stats[p].p50Ms
+           << ", \"p99_ms\": " << stats[p].p99Ms;
+      for (int c = 0; hasPipelineStatistics() && c < COUNTER_COUNT; c++) {
+        file << ", \"" << counterName(static_cast<Counter>(c))
+             << "\": " << stats[p].counters[c];
+      }
+      file << "}" << (p + 1 < stats.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+  } else {
+    file << "pass,samples,mean_ms,p50_ms,p99_ms";
+    for (int c = 0; hasPipelineStatistics() && c < COUNTER_COUNT; c++) {
+      file << "," << counterName(static_cast<Counter>(c));
+    }
+    file << "\n";
+    for (const auto &pass : stats) {
+      file << pass.name << "," << pass.samples << "," << pass.meanMs << ","
+           << pass.p50Ms << "," << pass.p99Ms;
+      for (int c = 0; hasPipelineStatistics() && c < COUNTER_COUNT; c++) {
+        file << "," << pass.counters[c];
+      }
+      file << "\n";
+    }
+  }
+}
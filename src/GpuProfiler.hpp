@@ -0,0 +1,96 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Per-pass GPU times from timestamp queries.
+//
+// Every frame context owns a range of a query pool with one timestamp per
+// pass boundary of every stream: point 0 before the first pass, point p + 1
+// after pass p. A context's results are read when the context is recorded
+// again, after its fence has signalled, so reading never stalls the GPU.
+// Samples are kept in a rolling window per pass (all streams together); with
+// several streams the passes of different streams overlap on the GPU, so a
+// pass time then includes time shared with the other streams.
+//
+// Optionally every pass also runs a pipeline statistics query (needs the
+// pipelineStatisticsQuery device feature), reported as per-frame means next
+// to the times.
+class GpuProfiler {
+public:
+    static const size_t WINDOW = 240; // Samples kept per pass
+
+    // Pipeline statistics, in the order Vulkan writes them (flag bit order)
+    enum Counter { VertexInvocations, ClippingInvocations, ClippingPrimitives, FragmentInvocations, ComputeInvocations, COUNTER_COUNT };
+    static const char* counterName(Counter counter);
+
+    struct PassStats {
+        std::string name;
+        size_t samples = 0;
+        double meanMs = 0.0;
+        double p50Ms = 0.0;
+        double p99Ms = 0.0;
+        std::array<double, COUNTER_COUNT> counters{}; // Means; zero without statistics
+    };
+
+    // Disables itself (isEnabled() == false) when the queue has no timestamps.
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex,
+              uint32_t contextCount, uint32_t streamCount, const std::vector<std::string>& passNames,
+              double printInterval, bool pipelineStatistics);
+    void destroy();
+    bool isEnabled() const { return queryPool != VK_NULL_HANDLE; }
+    bool hasPipelineStatistics() const { return statisticsPool != VK_NULL_HANDLE; }
+    // Milliseconds between two raw timestamps of the profiled queue, with
+    // their invalid high bits masked off and wrap-around handled.
+    double elapsedMs(uint64_t begin, uint64_t end) const;
+
+    // Start of a context's command buffer, outside any render pass: collects
+    // what the context measured last time and resets its queries.
+    void beginFrame(VkCommandBuffer commandBuffer, uint32_t context);
+    // Around each pass's render pass instance, in pass order. The time of a
+    // pass runs from the end of the previous one (or the first beginPass) to
+    // its endPass, so barriers in between count towards the next pass.
+    void beginPass(VkCommandBuffer commandBuffer, uint32_t context, uint32_t stream, uint32_t pass);
+    void endPass(VkCommandBuffer commandBuffer, uint32_t context, uint32_t stream, uint32_t pass);
+
+    std::vector<PassStats> getStats() const;
+    // The pass's samples in the window, oldest first.
+    std::vector<double> getSamples(size_t pass) const;
+    void printStats(std::ostream& out) const;
+    // Writes the current statistics; ".json" files get JSON, anything else CSV.
+    void exportStats(const std::string& path) const;
+
+private:
+    using Counters = std::array<uint64_t, COUNTER_COUNT>;
+    struct PassSamples {
+        std::vector<double> ms;          // Ring buffer of up to WINDOW samples
+        std::vector<Counters> counters;  // Same slots as ms (with statistics)
+        size_t next = 0;
+        uint64_t total = 0;              // Samples ever recorded
+    };
+
+    uint32_t queryIndex(uint32_t context, uint32_t stream, uint32_t point) const;
+    uint32_t statisticsIndex(uint32_t context, uint32_t stream, uint32_t pass) const;
+    void collect(uint32_t context);
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    VkQueryPool statisticsPool = VK_NULL_HANDLE; // One query per pass
+    double timestampPeriod = 1.0; // Nanoseconds per tick
+    uint64_t validMask = ~0ull;
+    uint32_t streamCount = 0;
+    uint32_t pointCount = 0;       // Per stream: passes + 1
+    std::vector<bool> recorded;    // Per context: has results pending
+    std::vector<std::string> passNames;
+    std::vector<PassSamples> passes;
+
+    double printInterval = 0.0; // Seconds between console reports; 0 = never
+    std::chrono::steady_clock::time_point lastPrint;
+};
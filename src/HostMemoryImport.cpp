@@ -0,0 +1,139 @@
+#include "HostMemoryImport.hpp"
+#include <cstdint>
+
+// The import alignment is only reported through
+// VK_KHR_get_physical_device_properties2; without it the page size is the
+// usual requirement.
+void HostMemoryImporter::init(VkInstance instance,
+                              VkPhysicalDevice physicalDevice, VkDevice device,
+                              bool extensionEnabled) {
+  this->device = device;
+  if (!extensionEnabled) {
+    return;
+  }
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+  auto getProperties2 =
+      (PFN_vkGetPhysicalDeviceProperties2KHR)vkGetInstanceProcAddr(
+          instance, "vkGetPhysicalDeviceProperties2KHR");
+  if (getProperties2) {
+    VkPhysicalDeviceExternalMemoryHostPropertiesEXT hostProperties{};
+    hostProperties.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT;
+    VkPhysicalDeviceProperties2KHR properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+    properties.pNext = &hostProperties;
+    getProperties2(physicalDevice, &properties);
+    if (hostProperties.minImportedHostPointerAlignment > 0) {
+      alignment = hostProperties.minImportedHostPointerAlignment;
+    }
+  }
+
+  getHostPointerProperties =
+      (PFN_vkGetMemoryHostPointerPropertiesEXT)vkGetDeviceProcAddr(
+          device, "vkGetMemoryHostPointerPropertiesEXT");
+}
+
+bool HostMemoryImporter::import(const void *pointer, size_t size,
+                                ImportedHostBuffer &imported) {
+  if (!isEnabled() || size == 0) {
+    return false;
+  }
+
+  uintptr_t start = (uintptr_t)pointer / alignment * alignment;
+  uintptr_t end =
+      ((uintptr_t)pointer + size + alignment - 1) / alignment * alignment;
+  void *hostPointer = (void *)start;
+
+  // Plain allocations import as HOST_ALLOCATION; some drivers want mappings
+  // of files or device memory declared as foreign.
+  VkExternalMemoryHandleTypeFlagBits handleTypes[] = {
+      VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT,
+      VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_MAPPED_FOREIGN_MEMORY_BIT_EXT};
+  VkExternalMemoryHandleTypeFlagBits handleType;
+  VkMemoryHostPointerPropertiesEXT pointerProperties{};
+  bool supported = false;
+  for (VkExternalMemoryHandleTypeFlagBits type : handleTypes) {
+    pointerProperties = {};
+    pointerProperties.sType =
+        VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT;
+    if (getHostPointerProperties(device, type, hostPointer,
+                                 &pointerProperties) == VK_SUCCESS &&
+        pointerProperties.memoryTypeBits != 0) {
+      handleType = type;
+      supported = true;
+      break;
+    }
+  }
+  if (!supported) {
+    return false;
+  }
+
+  VkExternalMemoryBufferCreateInfoKHR externalInfo{};
+  externalInfo.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO_KHR;
+  externalInfo.handleTypes = handleType;
+
+  VkBufferCreateInfo bufferInfo{};
+  bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferInfo.pNext = &externalInfo;
+  bufferInfo.size = end - start;
+  bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  VkBuffer buffer;
+  if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+    return false;
+  }
+
+  VkMemoryRequirements requirements;
+  vkGetBufferMemoryRequirements(device, buffer, &requirements);
+  uint32_t typeBits =
+      requirements.memoryTypeBits & pointerProperties.memoryTypeBits;
+  uint32_t memoryTypeIndex = UINT32_MAX;
+  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+    if (typeBits & (1u << i)) {
+      memoryTypeIndex = i;
+      break;
+    }
+  }
+  if (memoryTypeIndex == UINT32_MAX) {
+    vkDestroyBuffer(device, buffer, nullptr);
+    return false;
+  }
+
+  VkImportMemoryHostPointerInfoEXT importInfo{};
+  importInfo.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT;
+  importInfo.handleType = handleType;
+  importInfo.pHostPointer = hostPointer;
+
+  VkMemoryAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.pNext = &importInfo;
+  allocInfo.allocationSize = end - start;
+  allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+  VkDeviceMemory memory;
+  if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+    vkDestroyBuffer(device, buffer, nullptr);
+    return false;
+  }
+  if (vkBindBufferMemory(device, buffer, memory, 0) != VK_SUCCESS) {
+    vkFreeMemory(device, memory, nullptr);
+    vkDestroyBuffer(device, buffer, nullptr);
+    return false;
+  }
+
+  imported.buffer = buffer;
+  imported.memory = memory;
+  imported.base = hostPointer;
+  imported.size = end - start;
+  return true;
+}
+
+void HostMemoryImporter::release(ImportedHostBuffer &imported) {
+  if (imported.buffer != VK_NULL_HANDLE) {
+    vkDestroyBuffer(device, imported.buffer, nullptr);
+    vkFreeMemory(device, imported.memory, nullptr);
+  }
+  imported = ImportedHostBuffer();
+}
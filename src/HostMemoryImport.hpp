@@ -0,0 +1,39 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstddef>
+
+// Caller-owned host memory wrapped as a transfer-source buffer.
+struct ImportedHostBuffer {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    const void* base = nullptr; // Host address of buffer offset 0
+    VkDeviceSize size = 0;
+};
+
+// Imports host memory through VK_EXT_external_memory_host, so data that is
+// already in memory (a decoder's output, an mmap'd container file) can be
+// copied to images without a staging memcpy. The imported range is the
+// requested one rounded out to minImportedHostPointerAlignment (usually the
+// page size), so that whole range must be mapped. The memory must stay valid
+// and unchanged until the buffer is released and the GPU is done with it.
+class HostMemoryImporter {
+public:
+    void init(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device, bool extensionEnabled);
+
+    bool isEnabled() const { return getHostPointerProperties != nullptr; }
+    VkDeviceSize getAlignment() const { return alignment; }
+
+    // Returns false when the device can't import this memory; callers then
+    // fall back to staging copies.
+    bool import(const void* pointer, size_t size, ImportedHostBuffer& imported);
+    void release(ImportedHostBuffer& imported);
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+    VkDeviceSize alignment = 4096;
+    PFN_vkGetMemoryHostPointerPropertiesEXT getHostPointerProperties = nullptr;
+};
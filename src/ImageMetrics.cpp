@@ -0,0 +1,346 @@
+#include "ImageMetrics.hpp"
+#include "CpuSimd.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// Widest filter radius: the chroma blur's 3 sigma.
+const int BORDER = 8;
+const uint32_t BAND_ROWS = 16;
+// luma (2), opponent (2 x 3), product (3), scratch
+const size_t PLANE_COUNT = 12;
+
+const int SSIM_RADIUS = 3; // 7x7 windows
+const float SSIM_C1 = 0.01f * 0.01f;
+const float SSIM_C2 = 0.03f * 0.03f;
+
+const float LUMA_SIGMA = 0.8f;
+const float CHROMA_SIGMA = 2.0f;
+const float FLIP_COLOR_EXPONENT = 0.7f;
+
+// D65 white of the sRGB primaries
+const float WHITE_X = 0.950456f;
+const float WHITE_Z = 1.088754f;
+
+VFloat srgbToLinear(VFloat c) {
+  return select(c <= 0.04045f, c / 12.92f,
+                pow((c + 0.055f) / 1.055f, splat(2.4f)));
+}
+
+VFloat luminance(const VFloat rgb[3]) {
+  return 0.2126f * rgb[0] + 0.7152f * rgb[1] + 0.0722f * rgb[2];
+}
+
+// Display RGB -> YCxCz, FLIP's opponent space.
+void toOpponent(const VFloat rgb[3], VFloat out[3]) {
+  VFloat r = srgbToLinear(rgb[0]);
+  VFloat g = srgbToLinear(rgb[1]);
+  VFloat b = srgbToLinear(rgb[2]);
+  VFloat x = (0.4124564f * r + 0.3575761f * g + 0.1804375f * b) / WHITE_X;
+  VFloat y = 0.2126729f * r + 0.7151522f * g + 0.0721750f * b;
+  VFloat z = (0.0193339f * r + 0.1191920f * g + 0.9503041f * b) / WHITE_Z;
+  out[0] = 116.0f * y - 16.0f;
+  out[1] = 500.0f * (x - y);
+  out[2] = 200.0f * (y - z);
+}
+
+VFloat labCurve(VFloat t) {
+  return select(t > 0.008856f, exp(log(t) * (1.0f / 3.0f)),
+                7.787f * t + 16.0f / 116.0f);
+}
+
+// Blurred YCxCz -> L*a*b*.
+void opponentToLab(VFloat yy, VFloat cx, VFloat cz, VFloat lab[3]) {
+  VFloat y = (yy + 16.0f) / 116.0f;
+  VFloat x = cx / 500.0f + y;
+  VFloat z = y - cz / 200.0f;
+  VFloat fy = labCurve(y);
+  lab[0] = 116.0f * fy - 16.0f;
+  lab[1] = 500.0f * (labCurve(x) - fy);
+  lab[2] = 200.0f * (fy - labCurve(z));
+}
+
+VFloat hyab(const VFloat a[3], const VFloat b[3]) {
+  VFloat da = a[1] - b[1], db = a[2] - b[2];
+  return abs(a[0] - b[0]) + sqrt(da * da + db * db);
+}
+
+// HyAB distance of pure green to pure blue, FLIP's normalization.
+float maxColorDifference() {
+  VFloat green[3] = {splat(0.0f), splat(1.0f), splat(0.0f)};
+  VFloat blue[3] = {splat(0.0f), splat(0.0f), splat(1.0f)};
+  VFloat lab[2][3];
+  for (VFloat *color : {green, blue}) {
+    VFloat opponent[3];
+    toOpponent(color, opponent);
+    opponentToLab(opponent[0], opponent[1], opponent[2],
+                  lab[color == green ? 0 : 1]);
+  }
+  float difference[SIMD_WIDTH];
+  store(difference, hyab(lab[0], lab[1]));
+  return difference[0];
+}
+
+// Sum of the first count lanes.
+double sumLanes(VFloat values, uint32_t count) {
+  float lanes[SIMD_WIDTH];
+  store(lanes, values);
+  double sum = 0.0;
+  for (uint32_t i = 0; i < std::min<uint32_t>(count, SIMD_WIDTH); i++) {
+    sum += lanes[i];
+  }
+  return sum;
+}
+
+std::vector<float> gaussianWeights(float sigma) {
+  int radius = (int)std::ceil(3.0f * sigma);
+  std::vector<float> weights(radius + 1);
+  float sum = 0.0f;
+  for (int i = 0; i <= radius; i++) {
+    weights[i] = std::exp(-0.5f * i * i / (sigma * sigma));
+    sum += i == 0 ? weights[i] : 2.0f * weights[i];
+  }
+  for (float &weight : weights) {
+    weight /= sum;
+  }
+  return weights;
+}
+
+double sumRows(const std::vector<double> &rows) {
+  double sum = 0.0;
+  for (double row : rows) {
+    sum += row;
+  }
+  return sum;
+}
+
+} // namespace
+
+ImageMetrics::ImageMetrics(unsigned threadCount) : pool(threadCount) {}
+
+void ImageMetrics::resize(uint32_t newWidth, uint32_t newHeight) {
+  if (newWidth == width && newHeight == height) {
+    return;
+  }
+  width = newWidth;
+  height = newHeight;
+  // SIMD loops run up to 7 pixels past the right edge.
+  stride = BORDER + (ptrdiff_t)(width + 7) / 8 * 8 + BORDER;
+  planeSize = (size_t)stride * (height + 2 * BORDER);
+  storage.assign(planeSize * PLANE_COUNT, 0.0f);
+  rowSums.assign(height, 0.0);
+
+  size_t next = 0;
+  auto allocate = [&] {
+    Plane plane;
+    plane.origin = storage.data() + planeSize * next++ + BORDER * stride +
+                   BORDER;
+    plane.stride = stride;
+    return plane;
+  };
+  for (int i = 0; i < 2; i++) {
+    luma[i] = allocate();
+    for (Plane &plane : opponent[i]) {
+      plane = allocate();
+    }
+  }
+  for (Plane &plane : product) {
+    plane = allocate();
+  }
+  scratch = allocate();
+}
+
+void ImageMetrics::fillBorders(const Plane &plane) {
+  for (uint32_t y = 0; y < height; y++) {
+    float *row = plane.origin + (ptrdiff_t)y * stride;
+    for (int b = 1; b <= BORDER; b++) {
+      row[-b] = row[0];
+      row[width - 1 + b] = row[width - 1];
+    }
+  }
+  size_t rowBytes = (width + 2 * BORDER) * sizeof(float);
+  float *top = plane.origin - BORDER;
+  float *bottom = top + (ptrdiff_t)(height - 1) * stride;
+  for (int b = 1; b <= BORDER; b++) {
+    std::memcpy(top - b * stride, top, rowBytes);
+    std::memcpy(bottom + b * stride, bottom, rowBytes);
+  }
+}
+
+// Clamps both images, writes their luma, YCxCz and SSIM's products, and
+// leaves the squared RGB error of every row in rowSums. The clamped RGB goes
+// through the YCxCz planes, so that the SIMD loop reads planar data.
+void ImageMetrics::convert(const RefImage &reference, const RefImage &test) {
+  const RefImage *images[2] = {&reference, &test};
+  pool.parallelFor(height, [&](size_t y) {
+    ptrdiff_t row = (ptrdiff_t)y * stride;
+    for (int i = 0; i < 2; i++) {
+      const float *texel = images[i]->at(0, (uint32_t)y);
+      for (uint32_t x = 0; x < width; x++, texel += 4) {
+        for (int c = 0; c < 3; c++) {
+          // NaN -> 0
+          opponent[i][c].origin[row + x] =
+              texel[c] > 0.0f ? std::min(texel[c], 1.0f) : 0.0f;
+        }
+      }
+    }
+    double squaredError = 0.0;
+    for (uint32_t x = 0; x < width; x += SIMD_WIDTH) {
+      VFloat rgb[2][3], lumas[2];
+      VFloat error = splat(0.0f);
+      for (int i = 0; i < 2; i++) {
+        for (int c = 0; c < 3; c++) {
+          rgb[i][c] = load(opponent[i][c].origin + row + x);
+        }
+        VFloat yCxCz[3];
+        toOpponent(rgb[i], yCxCz);
+        for (int c = 0; c < 3; c++) {
+          store(opponent[i][c].origin + row + x, yCxCz[c]);
+        }
+        lumas[i] = luminance(rgb[i]);
+        store(luma[i].origin + row + x, lumas[i]);
+      }
+      for (int c = 0; c < 3; c++) {
+        VFloat diff = rgb[0][c] - rgb[1][c];
+        error = fma(diff, diff, error);
+      }
+      squaredError += sumLanes(error, width - x);
+      store(product[0].origin + row + x, lumas[0] * lumas[0]);
+      store(product[1].origin + row + x, lumas[1] * lumas[1]);
+      store(product[2].origin + row + x, lumas[0] * lumas[1]);
+    }
+    rowSums[y] = squaredError;
+  });
+  for (const Plane &plane : luma) {
+    fillBorders(plane);
+  }
+}
+
+// Separable filter with symmetric weights (weights[0] is the center), in
+// place. Edges clamp.
+void ImageMetrics::blur(const Plane &plane, const std::vector<float> &weights) {
+  const int radius = (int)weights.size() - 1;
+  const size_t bands = (height + BAND_ROWS - 1) / BAND_ROWS;
+  auto pass = [&](const Plane &source, const Plane &destination,
+                  ptrdiff_t step) {
+    pool.parallelFor(bands, [&](size_t band) {
+      uint32_t y1 = std::min((uint32_t)(band + 1) * BAND_ROWS, height);
+      for (uint32_t y = (uint32_t)band * BAND_ROWS; y < y1; y++) {
+        const float *in = source.origin + (ptrdiff_t)y * stride;
+        float *out = destination.origin + (ptrdiff_t)y * stride;
+        for (uint32_t x = 0; x < width; x += SIMD_WIDTH) {
+          VFloat sum = splat(weights[0]) * load(in + x);
+          for (int k = 1; k <= radius; k++) {
+            sum = fma(splat(weights[k]),
+                      load(in + x - k * step) + load(in + x + k * step), sum);
+          }
+          store(out + x, sum);
+        }
+      }
+    });
+    fillBorders(destination);
+  };
+  fillBorders(plane);
+  pass(plane, scratch, 1);
+  pass(scratch, plane, stride);
+}
+
+// SSIM as scikit-image computes it by default: 7x7 box windows, sample
+// (co)variances, and the mean over pixels at least 3 from the edge.
+double ImageMetrics::meanSsim() {
+  const std::vector<float> box(SSIM_RADIUS + 1, 1.0f / (2 * SSIM_RADIUS + 1));
+  for (const Plane &plane : luma) {
+    blur(plane, box);
+  }
+  for (const Plane &plane : product) {
+    blur(plane, box);
+  }
+  const float n = (2 * SSIM_RADIUS + 1) * (2 * SSIM_RADIUS + 1);
+  const VFloat sampleCorrection = splat(n / (n - 1.0f));
+  const VFloat c1 = splat(SSIM_C1), c2 = splat(SSIM_C2), two = splat(2.0f);
+  const uint32_t x0 = SSIM_RADIUS, x1 = width - SSIM_RADIUS;
+  const uint32_t y0 = SSIM_RADIUS, y1 = height - SSIM_RADIUS;
+  pool.parallelFor(y1 - y0, [&](size_t index) {
+    ptrdiff_t row = (ptrdiff_t)(y0 + index) * stride;
+    double sum = 0.0;
+    for (uint32_t x = x0; x < x1; x += SIMD_WIDTH) {
+      VFloat mx = load(luma[0].origin + row + x);
+      VFloat my = load(luma[1].origin + row + x);
+      VFloat vx = (load(product[0].origin + row + x) - mx * mx) *
+                  sampleCorrection;
+      VFloat vy = (load(product[1].origin + row + x) - my * my) *
+                  sampleCorrection;
+      VFloat cov = (load(product[2].origin + row + x) - mx * my) *
+                   sampleCorrection;
+      VFloat numerator = (two * mx * my + c1) * (two * cov + c2);
+      VFloat denominator = (mx * mx + my * my + c1) * (vx + vy + c2);
+      sum += sumLanes(numerator / denominator, x1 - x);
+    }
+    rowSums[index] = sum;
+  });
+  std::fill(rowSums.begin() + (y1 - y0), rowSums.end(), 0.0);
+  return sumRows(rowSums) / ((double)(x1 - x0) * (y1 - y0));
+}
+
+// Needs the unblurred luma, so it runs before meanSsim().
+double ImageMetrics::meanFlip() {
+  static const float maxDifference = maxColorDifference();
+  const std::vector<float> lumaWeights = gaussianWeights(LUMA_SIGMA);
+  const std::vector<float> chromaWeights = gaussianWeights(CHROMA_SIGMA);
+  for (auto &planes : opponent) {
+    blur(planes[0], lumaWeights);
+    blur(planes[1], chromaWeights);
+    blur(planes[2], chromaWeights);
+  }
+  const VFloat zero = splat(0.0f);
+  pool.parallelFor(height, [&](size_t y) {
+    ptrdiff_t row = (ptrdiff_t)y * stride;
+    double sum = 0.0;
+    for (uint32_t x = 0; x < width; x += SIMD_WIDTH) {
+      VFloat lab[2][3], gradient[2];
+      for (int i = 0; i < 2; i++) {
+        opponentToLab(load(opponent[i][0].origin + row + x),
+                      load(opponent[i][1].origin + row + x),
+                      load(opponent[i][2].origin + row + x), lab[i]);
+        const float *l = luma[i].origin + row + x;
+        VFloat gx = 0.5f * (load(l + 1) - load(l - 1));
+        VFloat gy = 0.5f * (load(l + stride) - load(l - stride));
+        gradient[i] = sqrt(gx * gx + gy * gy);
+      }
+      VFloat feature = sqrt(
+          min(abs(gradient[0] - gradient[1]) * 0.70710678f, splat(1.0f)));
+      // color = min((HyAB / max)^0.7, 1); error = color^(1 - feature)
+      VFloat difference = hyab(lab[0], lab[1]) / maxDifference;
+      VFloat logColor = min(log(difference) * FLIP_COLOR_EXPONENT, zero);
+      VFloat error = exp((1.0f - feature) * logColor);
+      sum += sumLanes(select(difference > zero, error, zero), width - x);
+    }
+    rowSums[y] = sum;
+  });
+  return sumRows(rowSums) / ((double)width * height);
+}
+
+QualityScores ImageMetrics::compare(const RefImage &reference,
+                                    const RefImage &test) {
+  if (reference.width != test.width || reference.height != test.height) {
+    throw std::runtime_error("compared images differ in size!");
+  }
+  if (reference.width <= 2 * SSIM_RADIUS ||
+      reference.height <= 2 * SSIM_RADIUS) {
+    throw std::runtime_error("images are too small for SSIM windows!");
+  }
+  resize(reference.width, reference.height);
+
+  QualityScores scores;
+  convert(reference, test);
+  double mse = sumRows(rowSums) / (3.0 * width * height);
+  scores.psnr = mse > 0.0 ? std::min(-10.0 * std::log10(mse), MAX_PSNR)
+                          : MAX_PSNR;
+  scores.flip = meanFlip();
+  scores.ssim = meanSsim();
+  return scores;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "CpuReference.hpp"
+#include "WorkStealingPool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Image quality of a run against a reference (golden) image, for the
+// benchmarks and the vulkanio_metrics tool. All three scores look at RGB
+// clamped to [0, 1] as a display would show it; alpha is ignored.
+struct QualityScores {
+    double psnr = 0.0; // dB; MAX_PSNR for identical images
+    double ssim = 0.0; // Mean SSIM of the luma over 7x7 windows, 1 = identical
+    double flip = 0.0; // Mean FLIP-lite error, 0 (identical) to 1
+};
+
+// Caps PSNR so that identical images still give a finite number for JSON
+// and averages.
+const double MAX_PSNR = 100.0;
+
+// Computes QualityScores with SIMD kernels (CpuSimd.hpp, baseline ISA) on a
+// work-stealing pool, one band of rows per task.
+//
+// FLIP-lite follows the structure of NVIDIA's FLIP for LDR images without
+// its tuned constants, so its values are only comparable with each other:
+// both images go to the YCxCz opponent space, are blurred (luma less than
+// chroma, roughly what the eye resolves at desktop viewing distance), then
+// compared in L*a*b* with the HyAB distance, normalized by the distance of
+// pure green to pure blue. Differences of the luma gradient (edges) raise
+// the color error to a power below 1, as FLIP's feature term does. The
+// score is the mean per-pixel error.
+class ImageMetrics {
+public:
+    // threadCount 0: one per core.
+    explicit ImageMetrics(unsigned threadCount = 0);
+
+    // Both images must have the same size.
+    QualityScores compare(const RefImage& reference, const RefImage& test);
+
+    unsigned getThreadCount() const { return pool.getThreadCount(); }
+
+private:
+    // A float plane with a border that repeats the edge pixels, like the
+    // CPU denoiser's.
+    struct Plane {
+        float* origin = nullptr;
+        ptrdiff_t stride = 0;
+    };
+
+    void resize(uint32_t newWidth, uint32_t newHeight);
+    void convert(const RefImage& reference, const RefImage& test);
+    void blur(const Plane& plane, const std::vector<float>& weights);
+    void fillBorders(const Plane& plane);
+    double meanSsim();
+    double meanFlip();
+
+    WorkStealingPool pool;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    ptrdiff_t stride = 0;
+    size_t planeSize = 0;
+    std::vector<float> storage;
+
+    Plane luma[2];        // Reference, test
+    Plane opponent[2][3]; // YCxCz
+    Plane product[3];     // SSIM's x*x, y*y, x*y
+    Plane scratch;        // Horizontal pass of blur()
+    std::vector<double> rowSums; // One partial sum per row, summed in order
+};
@@ -0,0 +1,303 @@
+#include "MemoryAllocator.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// Cache the memory properties once; they never change for a physical device.
+// The budget query is only available through
+// VK_KHR_get_physical_device_properties2, so we look it up by name and fall
+// back to estimates when it is missing.
+void MemoryAllocator::init(VkInstance instance, VkPhysicalDevice physicalDevice,
+                           VkDevice device, bool memoryBudgetEnabled) {
+  this->physicalDevice = physicalDevice;
+  this->device = device;
+
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+  bufferImageGranularity =
+      std::max<VkDeviceSize>(1, deviceProperties.limits.bufferImageGranularity);
+
+  if (memoryBudgetEnabled) {
+    getMemoryProperties2 =
+        (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(
+            instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+  }
+
+  heapBlockBytes.assign(memoryProperties.memoryHeapCount, 0);
+  heapAllocatedBytes.assign(memoryProperties.memoryHeapCount, 0);
+}
+
+void MemoryAllocator::destroy() {
+  for (auto &block : blocks) {
+    if (block.mapped) {
+      vkUnmapMemory(device, block.memory);
+    }
+    vkFreeMemory(device, block.memory, nullptr);
+  }
+  blocks.clear();
+}
+
+uint32_t MemoryAllocator::findMemoryType(
+    uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+    if ((typeFilter & (1 << i)) &&
+        (memoryProperties.memoryTypes[i].propertyFlags & properties) ==
+            properties) {
+      return i;
+    }
+  }
+  throw std::runtime_error("failed to find suitable memory type!");
+}
+
+// Small heaps (integrated GPUs, BAR memory) get smaller blocks so one block
+// doesn't eat a large share of the heap.
+VkDeviceSize MemoryAllocator::preferredBlockSize(uint32_t memoryTypeIndex) const {
+  uint32_t heapIndex = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+  VkDeviceSize heapSize = memoryProperties.memoryHeaps[heapIndex].size;
+  if (heapSize <= 1024ull * 1024 * 1024) {
+    return std::min(DEFAULT_BLOCK_SIZE, heapSize / 8);
+  }
+  return DEFAULT_BLOCK_SIZE;
+}
+
+MemoryAllocator::Block &
+MemoryAllocator::createBlock(uint32_t memoryTypeIndex, VkDeviceSize minSize,
+                             bool linear) {
+  uint32_t heapIndex = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+  VkDeviceSize blockSize = std::max(preferredBlockSize(memoryTypeIndex), minSize);
+
+  // If a full block would push the heap over budget, only reserve what this
+  // resource needs.
+  HeapBudget heap = getHeapBudgets()[heapIndex];
+  if (blockSize > minSize && heap.usage + blockSize > heap.budget) {
+    blockSize = minSize;
+  }
+  if (heap.usage + blockSize > heap.budget) {
+    std::cerr << "memory heap " << heapIndex << " over budget: "
+              << (heap.usage + blockSize) / (1024 * 1024) << " MiB of "
+              << heap.budget / (1024 * 1024) << " MiB" << std::endl;
+  }
+
+  VkMemoryAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize = blockSize;
+  allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+  Block block;
+  if (vkAllocateMemory(device, &allocInfo, nullptr, &block.memory) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate device memory block!");
+  }
+  block.id = nextBlockId++;
+  block.size = blockSize;
+  block.memoryTypeIndex = memoryTypeIndex;
+  block.linear = linear;
+  block.freeRanges.push_back({0, blockSize});
+
+  // Keep host-visible blocks mapped for their whole lifetime so staging
+  // uploads don't pay for vkMapMemory/vkUnmapMemory every frame.
+  if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags &
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    if (vkMapMemory(device, block.memory, 0, VK_WHOLE_SIZE, 0,
+                    &block.mapped) != VK_SUCCESS) {
+      vkFreeMemory(device, block.memory, nullptr);
+      throw std::runtime_error("failed to map device memory block!");
+    }
+  }
+
+  heapBlockBytes[heapIndex] += blockSize;
+  blocks.push_back(block);
+  return blocks.back();
+}
+
+// First-fit search over the block's free list.
+bool MemoryAllocator::tryAllocateFromBlock(Block &block, VkDeviceSize size,
+                                           VkDeviceSize alignment,
+                                           MemoryAllocation &allocation) {
+  for (size_t i = 0; i < block.freeRanges.size(); i++) {
+    FreeRange range = block.freeRanges[i];
+    VkDeviceSize offset = alignUp(range.offset, alignment);
+    if (offset + size > range.offset + range.size) {
+      continue;
+    }
+
+    // Split the free range into the (optional) alignment gap before the
+    // allocation and the remainder after it.
+    std::vector<FreeRange> replacement;
+    if (offset > range.offset) {
+      replacement.push_back({range.offset, offset - range.offset});
+    }
+    VkDeviceSize end = offset + size;
+    if (end < range.offset + range.size) {
+      replacement.push_back({end, range.offset + range.size - end});
+    }
+    block.freeRanges.erase(block.freeRanges.begin() + i);
+    block.freeRanges.insert(block.freeRanges.begin() + i, replacement.begin(),
+                            replacement.end());
+
+    block.used += size;
+    allocation.memory = block.memory;
+    allocation.offset = offset;
+    allocation.size = size;
+    allocation.memoryTypeIndex = block.memoryTypeIndex;
+    allocation.blockId = block.id;
+    allocation.mapped =
+        block.mapped ? static_cast<char *>(block.mapped) + offset : nullptr;
+    allocation.alias = false;
+    return true;
+  }
+  return false;
+}
+
+MemoryAllocation
+MemoryAllocator::allocate(const VkMemoryRequirements &requirements,
+                          VkMemoryPropertyFlags properties, bool linear) {
+  uint32_t memoryTypeIndex =
+      findMemoryType(requirements.memoryTypeBits, properties);
+  uint32_t heapIndex = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+
+  // Linear and optimal resources only share a block when the device has no
+  // granularity restriction between them.
+  bool separateTiling = bufferImageGranularity > 1;
+  VkDeviceSize alignment = std::max<VkDeviceSize>(1, requirements.alignment);
+
+  MemoryAllocation allocation;
+  for (auto &block : blocks) {
+    if (block.memoryTypeIndex != memoryTypeIndex ||
+        (separateTiling && block.linear != linear)) {
+      continue;
+    }
+    if (tryAllocateFromBlock(block, requirements.size, alignment, allocation)) {
+      heapAllocatedBytes[heapIndex] += allocation.size;
+      return allocation;
+    }
+  }
+
+  Block &block = createBlock(memoryTypeIndex, requirements.size, linear);
+  if (!tryAllocateFromBlock(block, requirements.size, alignment, allocation)) {
+    throw std::runtime_error("failed to sub-allocate device memory!");
+  }
+  heapAllocatedBytes[heapIndex] += allocation.size;
+  return allocation;
+}
+
+MemoryAllocation
+MemoryAllocator::alias(const MemoryAllocation &base,
+                       const VkMemoryRequirements &requirements) const {
+  if (!(requirements.memoryTypeBits & (1 << base.memoryTypeIndex)) ||
+      requirements.size > base.size ||
+      base.offset % std::max<VkDeviceSize>(1, requirements.alignment) != 0) {
+    throw std::runtime_error("resource cannot alias the given allocation!");
+  }
+  MemoryAllocation allocation = base;
+  allocation.size = requirements.size;
+  allocation.alias = true;
+  return allocation;
+}
+
+// Return the range to its block's free list, merging it with its neighbours.
+// Empty blocks are released back to the driver.
+void MemoryAllocator::free(MemoryAllocation &allocation) {
+  if (allocation.memory == VK_NULL_HANDLE) {
+    return;
+  }
+  if (allocation.alias) {
+    allocation = MemoryAllocation{};
+    return;
+  }
+
+  auto blockIt = std::find_if(blocks.begin(), blocks.end(), [&](const Block &b) {
+    return b.id == allocation.blockId;
+  });
+  if (blockIt == blocks.end()) {
+    throw std::runtime_error("freeing memory from an unknown block!");
+  }
+  Block &block = *blockIt;
+  uint32_t heapIndex =
+      memoryProperties.memoryTypes[block.memoryTypeIndex].heapIndex;
+
+  auto it = std::lower_bound(
+      block.freeRanges.begin(), block.freeRanges.end(), allocation.offset,
+      [](const FreeRange &r, VkDeviceSize offset) { return r.offset < offset; });
+  it = block.freeRanges.insert(it, {allocation.offset, allocation.size});
+
+  auto next = it + 1;
+  if (next != block.freeRanges.end() && it->offset + it->size == next->offset) {
+    it->size += next->size;
+    block.freeRanges.erase(next);
+  }
+  if (it != block.freeRanges.begin()) {
+    auto prev = it - 1;
+    if (prev->offset + prev->size == it->offset) {
+      prev->size += it->size;
+      block.freeRanges.erase(it);
+    }
+  }
+
+  block.used -= allocation.size;
+  heapAllocatedBytes[heapIndex] -= allocation.size;
+
+  if (block.used == 0) {
+    if (block.mapped) {
+      vkUnmapMemory(device, block.memory);
+    }
+    vkFreeMemory(device, block.memory, nullptr);
+    heapBlockBytes[heapIndex] -= block.size;
+    blocks.erase(blockIt);
+  }
+
+  allocation = MemoryAllocation{};
+}
+
+std::vector<MemoryAllocator::HeapBudget>
+MemoryAllocator::getHeapBudgets() const {
+  std::vector<HeapBudget> heaps(memoryProperties.memoryHeapCount);
+
+  VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+  budgetProperties.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+  if (getMemoryProperties2) {
+    VkPhysicalDeviceMemoryProperties2KHR properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR;
+    properties2.pNext = &budgetProperties;
+    getMemoryProperties2(physicalDevice, &properties2);
+  }
+
+  for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+    heaps[i].blockBytes = heapBlockBytes[i];
+    heaps[i].allocatedBytes = heapAllocatedBytes[i];
+    if (getMemoryProperties2) {
+      heaps[i].budget = budgetProperties.heapBudget[i];
+      heaps[i].usage = budgetProperties.heapUsage[i];
+    } else {
+      heaps[i].budget = memoryProperties.memoryHeaps[i].size * 8 / 10;
+      heaps[i].usage = heapBlockBytes[i];
+    }
+  }
+  return heaps;
+}
+
+void MemoryAllocator::printStats() const {
+  auto heaps = getHeapBudgets();
+  std::cout << "Device memory (" << blocks.size() << " blocks"
+            << (isMemoryBudgetEnabled() ? ", VK_EXT_memory_budget" : "")
+            << "):" << std::endl;
+  for (size_t i = 0; i < heaps.size(); i++) {
+    if (heaps[i].blockBytes == 0 && heaps[i].usage == 0) {
+      continue;
+    }
+    std::cout << "  heap " << i << ": " << std::fixed << std::setprecision(1)
+              << heaps[i].allocatedBytes / (1024.0 * 1024.0) << " MiB used in "
+              << heaps[i].blockBytes / (1024.0 * 1024.0) << " MiB of blocks, "
+              << heaps[i].usage / (1024.0 * 1024.0) << " / "
+              << heaps[i].budget / (1024.0 * 1024.0) << " MiB budget"
+              << std::endl;
+  }
+}
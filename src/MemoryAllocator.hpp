@@ -0,0 +1,85 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <vector>
+
+// A sub-range of a larger VkDeviceMemory block handed out by MemoryAllocator.
+// Resources bind to (memory, offset) instead of owning a whole allocation.
+struct MemoryAllocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    uint32_t memoryTypeIndex = 0;
+    uint32_t blockId = 0;
+    void* mapped = nullptr; // Persistent mapping (host-visible memory only)
+    bool alias = false;     // Shares the range of another allocation; not freed
+};
+
+// Block sub-allocator for device memory.
+// Instead of one vkAllocateMemory per image/buffer, memory is reserved in large
+// blocks per memory type and resources are carved out of them (first-fit with
+// alignment). Linear resources (buffers) and optimal-tiling images live in
+// separate blocks so bufferImageGranularity never has to be padded for.
+class MemoryAllocator {
+public:
+    static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+    void init(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device, bool memoryBudgetEnabled);
+    void destroy();
+
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+    const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const { return memoryProperties; }
+
+    MemoryAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear);
+    // Returns an allocation sharing the memory of `base`, for resources whose
+    // lifetimes never overlap. Throws if the requirements don't fit the range.
+    MemoryAllocation alias(const MemoryAllocation& base, const VkMemoryRequirements& requirements) const;
+    void free(MemoryAllocation& allocation);
+
+    // Per-heap usage. Uses VK_EXT_memory_budget when enabled, otherwise
+    // estimates the budget as 80% of the heap and the usage from our blocks.
+    struct HeapBudget {
+        VkDeviceSize budget = 0;
+        VkDeviceSize usage = 0;
+        VkDeviceSize blockBytes = 0;      // Reserved by this allocator
+        VkDeviceSize allocatedBytes = 0;  // Handed out to resources
+    };
+    std::vector<HeapBudget> getHeapBudgets() const;
+    bool isMemoryBudgetEnabled() const { return getMemoryProperties2 != nullptr; }
+    void printStats() const;
+
+private:
+    struct FreeRange {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+    };
+
+    struct Block {
+        uint32_t id = 0;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        VkDeviceSize used = 0;
+        uint32_t memoryTypeIndex = 0;
+        bool linear = false;
+        void* mapped = nullptr;
+        std::vector<FreeRange> freeRanges; // Sorted by offset, never adjacent
+    };
+
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+    VkDeviceSize bufferImageGranularity = 1;
+    PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2 = nullptr;
+
+    std::vector<Block> blocks;
+    uint32_t nextBlockId = 0;
+    std::vector<VkDeviceSize> heapBlockBytes;
+    std::vector<VkDeviceSize> heapAllocatedBytes;
+
+    bool tryAllocateFromBlock(Block& block, VkDeviceSize size, VkDeviceSize alignment, MemoryAllocation& allocation);
+    Block& createBlock(uint32_t memoryTypeIndex, VkDeviceSize minSize, bool linear);
+    VkDeviceSize preferredBlockSize(uint32_t memoryTypeIndex) const;
+};
@@ -0,0 +1,95 @@
+#include "MemoryLedger.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+static const char *categoryName(MemoryCategory category) {
+  switch (category) {
+  case MemoryCategory::Input:
+    return "input";
+  case MemoryCategory::Staging:
+    return "staging";
+  case MemoryCategory::History:
+    return "history";
+  case MemoryCategory::Transient:
+    return "transient";
+  }
+  return "unknown";
+}
+
+static double toMiB(VkDeviceSize bytes) { return bytes / (1024.0 * 1024.0); }
+
+void MemoryLedger::record(const MemoryTag &tag,
+                          const MemoryAllocation &allocation,
+                          bool hostVisible) {
+  // Aliases share memory that is already accounted for.
+  if (allocation.alias) {
+    return;
+  }
+  entries[{allocation.memory, allocation.offset}] = {tag, allocation.size,
+                                                     hostVisible};
+  if (hostVisible) {
+    hostBytes += allocation.size;
+  } else {
+    deviceBytes += allocation.size;
+  }
+  peakDeviceBytes = std::max(peakDeviceBytes, deviceBytes);
+  peakHostBytes = std::max(peakHostBytes, hostBytes);
+  peakBytes = std::max(peakBytes, deviceBytes + hostBytes);
+}
+
+void MemoryLedger::release(const MemoryAllocation &allocation) {
+  if (allocation.alias) {
+    return;
+  }
+  auto it = entries.find({allocation.memory, allocation.offset});
+  if (it == entries.end()) {
+    return;
+  }
+  if (it->second.hostVisible) {
+    hostBytes -= it->second.size;
+  } else {
+    deviceBytes -= it->second.size;
+  }
+  entries.erase(it);
+}
+
+// Prints one line per resource, then totals per pass and per category, then
+// how the allocator's blocks relate to the heap budgets.
+void MemoryLedger::printReport(const MemoryAllocator &allocator) const {
+  std::map<std::string, VkDeviceSize> passTotals;
+  std::map<std::string, VkDeviceSize> categoryTotals;
+
+  std::cout << "==== Memory Report ====" << std::endl;
+  std::cout << std::left << std::setw(10) << "pass" << std::setw(24)
+            << "resource" << std::setw(11) << "category" << std::setw(8)
+            << "heap" << std::right << std::setw(10) << "MiB" << std::endl;
+  for (const auto &[key, entry] : entries) {
+    std::cout << std::left << std::setw(10) << entry.tag.pass << std::setw(24)
+              << entry.tag.name << std::setw(11)
+              << categoryName(entry.tag.category) << std::setw(8)
+              << (entry.hostVisible ? "host" : "device") << std::right
+              << std::setw(10) << std::fixed << std::setprecision(2)
+              << toMiB(entry.size) << std::endl;
+    passTotals[entry.tag.pass] += entry.size;
+    categoryTotals[categoryName(entry.tag.category)] += entry.size;
+  }
+
+  std::cout << "-- by pass:";
+  for (const auto &[pass, bytes] : passTotals) {
+    std::cout << " " << pass << "=" << std::setprecision(1) << toMiB(bytes);
+  }
+  std::cout << std::endl << "-- by category:";
+  for (const auto &[category, bytes] : categoryTotals) {
+    std::cout << " " << category << "=" << std::setprecision(1)
+              << toMiB(bytes);
+  }
+  std::cout << std::endl;
+
+  std::cout << std::setprecision(1) << "-- device " << toMiB(deviceBytes)
+            << " MiB (peak " << toMiB(peakDeviceBytes) << "), host "
+            << toMiB(hostBytes) << " MiB (peak " << toMiB(peakHostBytes)
+            << "), total " << toMiB(deviceBytes + hostBytes) << " MiB (peak "
+            << toMiB(peakBytes) << ")" << std::endl;
+  allocator.printStats();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "MemoryAllocator.hpp"
+
+#include <map>
+#include <string>
+#include <utility>
+
+// What a resource is used for. History resources must persist across frames,
+// transient ones only live within a frame, inputs hold the uploaded sequence
+// and staging buffers are the host-visible upload copies.
+enum class MemoryCategory { Input, Staging, History, Transient };
+
+// Identifies the owner of an allocation in the memory report.
+struct MemoryTag {
+    std::string pass;     // e.g. "TNR", "SNR2", "Input"
+    std::string name;     // e.g. "info[0]"
+    MemoryCategory category;
+};
+
+// Records every allocation made through createImage()/createBuffer() so we
+// can tell how much device and host memory each pass owns, and what the peak
+// was.
+class MemoryLedger {
+public:
+    void record(const MemoryTag& tag, const MemoryAllocation& allocation, bool hostVisible);
+    void release(const MemoryAllocation& allocation);
+
+    VkDeviceSize getCurrentBytes() const { return deviceBytes + hostBytes; }
+    VkDeviceSize getDeviceBytes() const { return deviceBytes; }
+    VkDeviceSize getHostBytes() const { return hostBytes; }
+    VkDeviceSize getPeakBytes() const { return peakBytes; }
+    void printReport(const MemoryAllocator& allocator) const;
+
+private:
+    struct Entry {
+        MemoryTag tag;
+        VkDeviceSize size;
+        bool hostVisible;
+    };
+
+    std::map<std::pair<VkDeviceMemory, VkDeviceSize>, Entry> entries;
+    VkDeviceSize deviceBytes = 0;
+    VkDeviceSize hostBytes = 0;
+    VkDeviceSize peakBytes = 0;
+    VkDeviceSize peakDeviceBytes = 0;
+    VkDeviceSize peakHostBytes = 0;
+};
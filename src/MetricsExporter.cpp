@@ -0,0 +1,189 @@
+#include "MetricsExporter.hpp"
+#include <cstring>
+#include <iomanip>
+#include <stdexcept>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // macOS: SO_NOSIGPIPE on the socket instead
+#endif
+
+void PrometheusText::counter(const std::string &name, const std::string &help,
+                             double value, const std::string &labels) {
+  sample(name, "counter", help, value, labels);
+}
+
+void PrometheusText::gauge(const std::string &name, const std::string &help,
+                           double value, const std::string &labels) {
+  sample(name, "gauge", help, value, labels);
+}
+
+// labels: already formatted, e.g. pass="TNR"
+void PrometheusText::sample(const std::string &name, const char *type,
+                            const std::string &help, double value,
+                            const std::string &labels) {
+  if (described.insert(name).second) {
+    out << "# HELP " << name << " " << help << "\n";
+    out << "# TYPE " << name << " " << type << "\n";
+  }
+  out << name;
+  if (!labels.empty()) {
+    out << "{" << labels << "}";
+  }
+  // Enough digits that large counters aren't printed in rounded exponent form
+  out << " " << std::setprecision(15) << value << "\n";
+}
+
+MetricsExporter::~MetricsExporter() { stop(); }
+
+void MetricsExporter::start(const std::string &address) {
+  static const std::string UNIX_PREFIX = "unix:";
+  if (address.compare(0, UNIX_PREFIX.size(), UNIX_PREFIX) == 0) {
+    sockaddr_un unixAddress{};
+    std::string path = address.substr(UNIX_PREFIX.size());
+    if (path.empty() || path.size() >= sizeof(unixAddress.sun_path)) {
+      throw std::runtime_error("invalid metrics socket path: " + path + "!");
+    }
+    unixAddress.sun_family = AF_UNIX;
+    std::strncpy(unixAddress.sun_path, path.c_str(),
+                 sizeof(unixAddress.sun_path) - 1);
+    // A socket left over from a previous run is replaced; anything else at
+    // the path (a typo naming a regular file) is left alone.
+    struct stat existing;
+    if (lstat(path.c_str(), &existing) == 0) {
+      if (!S_ISSOCK(existing.st_mode)) {
+        throw std::runtime_error("failed to bind metrics socket " + path +
+                                 ": not a socket!");
+      }
+      unlink(path.c_str());
+    }
+    listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenSocket < 0 ||
+        bind(listenSocket, reinterpret_cast<sockaddr *>(&unixAddress),
+             sizeof(unixAddress)) != 0) {
+      stop();
+      throw std::runtime_error("failed to bind metrics socket " + path + "!");
+    }
+    socketPath = path; // Bound: stop() removes it, also if listen() fails
+  } else {
+    // Loopback only: the node's scraping agent is local.
+    sockaddr_in inetAddress{};
+    inetAddress.sin_family = AF_INET;
+    inetAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int port = 0;
+    try {
+      port = std::stoi(address);
+    } catch (const std::exception &) {
+    }
+    if (port <= 0 || port > 65535) {
+      throw std::runtime_error("invalid metrics address: " + address + "!");
+    }
+    inetAddress.sin_port = htons(static_cast<uint16_t>(port));
+    listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    if (listenSocket >= 0) {
+      setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse,
+                 sizeof(reuse));
+    }
+    if (listenSocket < 0 ||
+        bind(listenSocket, reinterpret_cast<sockaddr *>(&inetAddress),
+             sizeof(inetAddress)) != 0) {
+      stop();
+      throw std::runtime_error("failed to bind metrics port " + address +
+                               "!");
+    }
+  }
+  if (listen(listenSocket, 8) != 0) {
+    stop();
+    throw std::runtime_error("failed to listen on " + address + "!");
+  }
+
+  stopping = false;
+  server = std::thread(&MetricsExporter::serveLoop, this);
+}
+
+void MetricsExporter::stop() {
+  stopping = true;
+  if (server.joinable()) {
+    server.join();
+  }
+  if (listenSocket >= 0) {
+    close(listenSocket);
+    listenSocket = -1;
+  }
+  if (!socketPath.empty()) {
+    unlink(socketPath.c_str());
+    socketPath.clear();
+  }
+}
+
+void MetricsExporter::publish(std::string page) {
+  std::lock_guard<std::mutex> lock(pageMutex);
+  this->page = std::move(page);
+}
+
+// Polls with a timeout so stop() is noticed within a fraction of a second.
+void MetricsExporter::serveLoop() {
+  while (!stopping) {
+    pollfd listening{listenSocket, POLLIN, 0};
+    if (poll(&listening, 1, 200) <= 0) {
+      continue;
+    }
+    int client = accept(listenSocket, nullptr, nullptr);
+    if (client >= 0) {
+      serveClient(client);
+      close(client);
+    }
+  }
+}
+
+// Every request gets the page: the exporter has a single endpoint.
+void MetricsExporter::serveClient(int client) {
+#ifdef SO_NOSIGPIPE
+  int noSigpipe = 1;
+  setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &noSigpipe, sizeof(noSigpipe));
+#endif
+  // Read the request head; give up on clients that send nothing.
+  std::string request;
+  char buffer[1024];
+  while (request.find("\r\n\r\n") == std::string::npos &&
+         request.size() < 8192) {
+    pollfd readable{client, POLLIN, 0};
+    if (poll(&readable, 1, 1000) <= 0) {
+      return;
+    }
+    ssize_t received = recv(client, buffer, sizeof(buffer), 0);
+    if (received <= 0) {
+      return;
+    }
+    request.append(buffer, received);
+  }
+
+  std::string body;
+  {
+    std::lock_guard<std::mutex> lock(pageMutex);
+    body = page;
+  }
+  std::string response =
+      "HTTP/1.1 200 OK\r\n"
+      "Content-Type: text/plain; version=0.0.4\r\n"
+      "Content-Length: " +
+      std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+
+  size_t sent = 0;
+  while (sent < response.size()) {
+    ssize_t written = send(client, response.data() + sent,
+                           response.size() - sent, MSG_NOSIGNAL);
+    if (written <= 0) {
+      return;
+    }
+    sent += written;
+  }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// Builds a page in the Prometheus text exposition format.
+class PrometheusText {
+public:
+    void counter(const std::string& name, const std::string& help, double value,
+                 const std::string& labels = "");
+    void gauge(const std::string& name, const std::string& help, double value,
+               const std::string& labels = "");
+    std::string str() const { return out.str(); }
+
+private:
+    void sample(const std::string& name, const char* type, const std::string& help, double value,
+                const std::string& labels);
+
+    std::ostringstream out;
+    std::set<std::string> described; // Names whose HELP/TYPE lines are out
+};
+
+// Serves the latest published page over HTTP, for a Prometheus scraper or
+// curl. The address is a TCP port on 127.0.0.1 ("9464") or a Unix domain
+// socket ("unix:/run/vulkanio.sock", for curl --unix-socket). The server runs
+// on its own thread and only ever copies the page under a lock, so a slow or
+// stuck client can't hold up rendering.
+class MetricsExporter {
+public:
+    ~MetricsExporter();
+
+    // Throws if the address can't be bound.
+    void start(const std::string& address);
+    void stop();
+    bool isRunning() const { return listenSocket >= 0; }
+
+    void publish(std::string page);
+
+private:
+    void serveLoop();
+    void serveClient(int client);
+
+    int listenSocket = -1;
+    std::string socketPath; // Unix socket to remove on stop()
+    std::thread server;
+    std::atomic<bool> stopping{false};
+
+    std::mutex pageMutex;
+    std::string page;
+};
@@ -0,0 +1,524 @@
+#include "OutputEncoder.hpp"
+#include "CpuTracer.hpp"
+#include "PixelConvert.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+using EncoderClock = std::chrono::steady_clock;
+
+static double secondsSince(EncoderClock::time_point start) {
+  return std::chrono::duration<double>(EncoderClock::now() - start).count();
+}
+
+static void appendBytes(std::vector<uint8_t> &out, const void *data,
+                        size_t size) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  out.insert(out.end(), bytes, bytes + size);
+}
+
+static void appendBE32(std::vector<uint8_t> &out, uint32_t value) {
+  uint8_t bytes[4] = {(uint8_t)(value >> 24), (uint8_t)(value >> 16),
+                      (uint8_t)(value >> 8), (uint8_t)value};
+  appendBytes(out, bytes, 4);
+}
+
+template <typename T>
+static void appendLE(std::vector<uint8_t> &out, T value) {
+  for (size_t i = 0; i < sizeof(T); i++) {
+    out.push_back((uint8_t)((uint64_t)value >> (8 * i)));
+  }
+}
+
+static void appendFloatLE(std::vector<uint8_t> &out, float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  appendLE(out, bits);
+}
+
+// zlib stream of `size` bytes. Without zlib we emit stored (uncompressed)
+// deflate blocks, which every reader accepts.
+static std::vector<uint8_t> zlibCompress(const uint8_t *data, size_t size) {
+#ifdef HAVE_ZLIB
+  uLongf compressedSize = compressBound((uLong)size);
+  std::vector<uint8_t> out(compressedSize);
+  if (compress2(out.data(), &compressedSize, data, (uLong)size,
+                Z_BEST_SPEED) != Z_OK) {
+    throw std::runtime_error("failed to compress output frame!");
+  }
+  out.resize(compressedSize);
+  return out;
+#else
+  std::vector<uint8_t> out = {0x78, 0x01};
+  size_t offset = 0;
+  do {
+    size_t blockSize = std::min<size_t>(size - offset, 65535);
+    bool last = offset + blockSize == size;
+    out.push_back(last ? 1 : 0);
+    appendLE(out, (uint16_t)blockSize);
+    appendLE(out, (uint16_t)~blockSize);
+    appendBytes(out, data + offset, blockSize);
+    offset += blockSize;
+  } while (offset < size);
+
+  uint32_t a = 1, b = 0; // Adler-32
+  for (size_t i = 0; i < size; i++) {
+    a = (a + data[i]) % 65521;
+    b = (b + a) % 65521;
+  }
+  appendBE32(out, (b << 16) | a);
+  return out;
+#endif
+}
+
+static uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t size) {
+  static const std::vector<uint32_t> table = [] {
+    std::vector<uint32_t> t(256);
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; k++) {
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      t[n] = c;
+    }
+    return t;
+  }();
+  crc = ~crc;
+  for (size_t i = 0; i < size; i++) {
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+static void appendPngChunk(std::vector<uint8_t> &out, const char *type,
+                           const std::vector<uint8_t> &data) {
+  appendBE32(out, (uint32_t)data.size());
+  size_t typeOffset = out.size();
+  appendBytes(out, type, 4);
+  appendBytes(out, data.data(), data.size());
+  appendBE32(out, crc32Update(0, out.data() + typeOffset, data.size() + 4));
+}
+
+// EXR attribute: name, type name, size, value.
+static void appendExrAttribute(std::vector<uint8_t> &out, const char *name,
+                               const char *type,
+                               const std::vector<uint8_t> &value) {
+  appendBytes(out, name, std::strlen(name) + 1);
+  appendBytes(out, type, std::strlen(type) + 1);
+  appendLE(out, (int32_t)value.size());
+  appendBytes(out, value.data(), value.size());
+}
+
+OutputEncoder::OutputEncoder(const std::string &directory,
+                             const std::string &filePrefix,
+                             OutputFormat format, OutputPixels pixels,
+                             uint32_t width, uint32_t height,
+                             unsigned workerCount)
+    : directory(directory), filePrefix(filePrefix), format(format),
+      pixels(pixels), width(width), height(height),
+      jobs(std::max(1u, workerCount)),
+      reorderLimit(2 * std::max(1u, workerCount)) {
+  startTime = EncoderClock::now();
+  workersRunning = std::max(1u, workerCount);
+  for (unsigned i = 0; i < workersRunning; i++) {
+    workers.emplace_back(&OutputEncoder::workerLoop, this);
+  }
+  writer = std::thread(&OutputEncoder::writerLoop, this);
+}
+
+OutputEncoder::~OutputEncoder() {
+  if (!finished) {
+    fail();
+    for (auto &worker : workers) {
+      worker.join();
+    }
+    writer.join();
+  }
+}
+
+const char *OutputEncoder::formatExtension(OutputFormat format) {
+  switch (format) {
+  case OutputFormat::Raw:
+    return ".raw";
+  case OutputFormat::PNG:
+    return ".png";
+  case OutputFormat::EXR:
+    return ".exr";
+  }
+  return "";
+}
+
+void OutputEncoder::submit(int frameIndex, const void *pixels,
+                           std::function<void()> release) {
+  std::function<void()> releaseOnError = release;
+  if (!jobs.push({nextSequence++, frameIndex, pixels, std::move(release)})) {
+    // The encoder has failed and stopped accepting frames.
+    releaseOnError();
+    std::lock_guard<std::mutex> lock(reorderMutex);
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    throw std::runtime_error("output encoder is closed!");
+  }
+}
+
+void OutputEncoder::finish() {
+  jobs.close();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  writer.join();
+  finished = true;
+  wallSeconds = secondsSince(startTime);
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+// Stops everything after an error. Queued jobs are still released.
+void OutputEncoder::fail() {
+  {
+    std::lock_guard<std::mutex> lock(reorderMutex);
+    failed = true;
+  }
+  jobs.close();
+  reorderReady.notify_all();
+  reorderSpace.notify_all();
+}
+
+void OutputEncoder::workerLoop() {
+  CpuTracer::setThreadName("encoder");
+  while (std::optional<Job> job = jobs.pop()) {
+    bool skip;
+    {
+      std::lock_guard<std::mutex> lock(reorderMutex);
+      skip = failed;
+    }
+    if (skip) {
+      job->release();
+      continue;
+    }
+
+    try {
+      double convert = 0.0;
+      double compress = 0.0;
+      EncodedFrame frame;
+      {
+        TRACE_SCOPE("encodeFrame");
+        frame = {job->frameIndex,
+                 encode(job->pixels, job->release, convert, compress)};
+      }
+
+      std::unique_lock<std::mutex> lock(reorderMutex);
+      // Don't run too far ahead of the writer, or frames pile up in memory.
+      // The frame the writer waits for is always accepted.
+      reorderSpace.wait(lock, [&] {
+        return failed || job->sequence < nextToWrite + reorderLimit;
+      });
+      convertSeconds += convert;
+      compressSeconds += compress;
+      if (!failed) {
+        reorder.emplace(job->sequence, std::move(frame));
+        reorderPeak = std::max(reorderPeak, reorder.size());
+        reorderReady.notify_all();
+      }
+    } catch (...) {
+      {
+        std::lock_guard<std::mutex> lock(reorderMutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+      // encode() may have thrown before releasing the pixels.
+      if (job->release) {
+        job->release();
+      }
+      fail();
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(reorderMutex);
+  workersRunning--;
+  reorderReady.notify_all();
+}
+
+void OutputEncoder::writerLoop() {
+  CpuTracer::setThreadName("writer");
+  while (true) {
+    EncodedFrame frame;
+    {
+      std::unique_lock<std::mutex> lock(reorderMutex);
+      reorderReady.wait(lock, [&] {
+        return failed || reorder.count(nextToWrite) ||
+               (workersRunning == 0 && reorder.empty());
+      });
+      if (failed || !reorder.count(nextToWrite)) {
+        return;
+      }
+      auto it = reorder.find(nextToWrite);
+      frame = std::move(it->second);
+      reorder.erase(it);
+    }
+
+    TRACE_SCOPE("writeFile");
+    EncoderClock::time_point start = EncoderClock::now();
+    std::ostringstream oss;
+    oss << directory << "/" << filePrefix << std::setw(4) << std::setfill('0')
+        << frame.frameIndex << formatExtension(format);
+    std::ofstream file(oss.str(), std::ios::binary);
+    file.write(reinterpret_cast<const char *>(frame.bytes.data()),
+               frame.bytes.size());
+    if (!file) {
+      std::lock_guard<std::mutex> lock(reorderMutex);
+      if (!error) {
+        error = std::make_exception_ptr(
+            std::runtime_error("failed to write " + oss.str() + "!"));
+      }
+    }
+    file.close();
+
+    bool writeFailed;
+    {
+      std::lock_guard<std::mutex> lock(reorderMutex);
+      writeSeconds += secondsSince(start);
+      framesWritten++;
+      bytesWritten += frame.bytes.size();
+      nextToWrite++;
+      writeFailed = error != nullptr;
+    }
+    reorderSpace.notify_all();
+    if (writeFailed) {
+      fail();
+      return;
+    }
+  }
+}
+
+// Converts and compresses one frame. The pixels are released (handed back to
+// the caller) right after the conversion, before the slower compression.
+std::vector<uint8_t> OutputEncoder::encode(const void *src,
+                                           std::function<void()> &release,
+                                           double &convertTime,
+                                           double &compressTime) const {
+  auto releaseSource = [&]() {
+    release();
+    release = nullptr;
+  };
+
+  EncoderClock::time_point start = EncoderClock::now();
+  size_t pixelCount = (size_t)width * height;
+  size_t bytesPerPixel = pixels == OutputPixels::RGBA16F ? 8 : 4;
+  std::vector<uint8_t> out;
+
+  if (format == OutputFormat::Raw) {
+    // Rows bottom-up, like the input frames.
+    size_t rowSize = width * bytesPerPixel;
+    out.resize(pixelCount * bytesPerPixel);
+    const uint8_t *rows = static_cast<const uint8_t *>(src);
+    for (uint32_t y = 0; y < height; y++) {
+      std::memcpy(out.data() + y * rowSize,
+                  rows + (size_t)(height - 1 - y) * rowSize, rowSize);
+    }
+    releaseSource();
+    convertTime = secondsSince(start);
+    compressTime = 0.0;
+    return out;
+  }
+
+  if (format == OutputFormat::PNG) {
+    // Filtered scanlines: one filter byte ("Up") per row, then RGBA8.
+    size_t rowSize = (size_t)width * 4;
+    std::vector<uint8_t> rgba(pixelCount * 4);
+    if (pixels == OutputPixels::RGBA16F) {
+      halfToUnorm8(static_cast<const uint16_t *>(src), rgba.data(),
+                   pixelCount * 4);
+    } else {
+      const uint8_t *bgra = static_cast<const uint8_t *>(src);
+      for (size_t i = 0; i < pixelCount; i++) {
+        rgba[i * 4 + 0] = bgra[i * 4 + 2];
+        rgba[i * 4 + 1] = bgra[i * 4 + 1];
+        rgba[i * 4 + 2] = bgra[i * 4 + 0];
+        rgba[i * 4 + 3] = bgra[i * 4 + 3];
+      }
+    }
+    releaseSource();
+    std::vector<uint8_t> filtered((rowSize + 1) * height);
+    for (uint32_t y = 0; y < height; y++) {
+      uint8_t *dst = filtered.data() + y * (rowSize + 1);
+      const uint8_t *row = rgba.data() + y * rowSize;
+      dst[0] = 2; // Up
+      if (y == 0) {
+        std::memcpy(dst + 1, row, rowSize);
+      } else {
+        const uint8_t *above = row - rowSize;
+        for (size_t i = 0; i < rowSize; i++) {
+          dst[1 + i] = (uint8_t)(row[i] - above[i]);
+        }
+      }
+    }
+    convertTime = secondsSince(start);
+
+    EncoderClock::time_point compressStart = EncoderClock::now();
+    static const uint8_t signature[8] = {0x89, 'P',  'N',  'G',
+                                         '\r', '\n', 0x1A, '\n'};
+    appendBytes(out, signature, sizeof(signature));
+    std::vector<uint8_t> header;
+    appendBE32(header, width);
+    appendBE32(header, height);
+    header.insert(header.end(), {8, 6, 0, 0, 0}); // 8-bit RGBA
+    appendPngChunk(out, "IHDR", header);
+    appendPngChunk(out, "IDAT", zlibCompress(filtered.data(), filtered.size()));
+    appendPngChunk(out, "IEND", {});
+    compressTime = secondsSince(compressStart);
+    return out;
+  }
+
+  // EXR: one scanline per block, channels stored planar in alphabetical
+  // order (A, B, G, R).
+  std::vector<uint16_t> lineHalfs((size_t)width * 4);
+  std::vector<std::vector<uint8_t>> lines(height);
+  for (uint32_t y = 0; y < height; y++) {
+    const uint16_t *rgba;
+    if (pixels == OutputPixels::RGBA16F) {
+      rgba = static_cast<const uint16_t *>(src) + (size_t)y * width * 4;
+    } else {
+      // BGRA8 -> half, then swap to RGBA order.
+      const uint8_t *bgra = static_cast<const uint8_t *>(src) + y * width * 4;
+      unorm8ToHalf(bgra, lineHalfs.data(), (size_t)width * 4);
+      for (uint32_t x = 0; x < width; x++) {
+        std::swap(lineHalfs[x * 4 + 0], lineHalfs[x * 4 + 2]);
+      }
+      rgba = lineHalfs.data();
+    }
+    std::vector<uint8_t> &line = lines[y];
+    line.resize((size_t)width * 8);
+    uint16_t *planar = reinterpret_cast<uint16_t *>(line.data());
+    static const int channelOrder[4] = {3, 2, 1, 0}; // A, B, G, R
+    for (int c = 0; c < 4; c++) {
+      uint16_t *plane = planar + (size_t)c * width;
+      for (uint32_t x = 0; x < width; x++) {
+        plane[x] = rgba[x * 4 + channelOrder[c]];
+      }
+    }
+  }
+  releaseSource();
+  convertTime = secondsSince(start);
+
+  EncoderClock::time_point compressStart = EncoderClock::now();
+#ifdef HAVE_ZLIB
+  const uint8_t compression = 2; // ZIPS_COMPRESSION
+  std::vector<uint8_t> scratch((size_t)width * 8);
+  for (auto &line : lines) {
+    // Split even and odd bytes, then delta-encode, as OpenEXR does before
+    // deflating. Lines that don't shrink are stored as they are.
+    size_t n = line.size();
+    uint8_t *t1 = scratch.data();
+    uint8_t *t2 = scratch.data() + (n + 1) / 2;
+    for (size_t i = 0; i < n; i++) {
+      if (i % 2 == 0) {
+        *t1++ = line[i];
+      } else {
+        *t2++ = line[i];
+      }
+    }
+    int previous = scratch[0];
+    for (size_t i = 1; i < n; i++) {
+      int d = int(scratch[i]) - previous + (128 + 256);
+      previous = scratch[i];
+      scratch[i] = (uint8_t)d;
+    }
+    std::vector<uint8_t> packed = zlibCompress(scratch.data(), n);
+    if (packed.size() < n) {
+      line = std::move(packed);
+    }
+  }
+#else
+  const uint8_t compression = 0; // NO_COMPRESSION
+#endif
+
+  static const uint8_t magic[4] = {0x76, 0x2F, 0x31, 0x01};
+  appendBytes(out, magic, 4);
+  appendLE(out, (int32_t)2); // Version 2, single-part scanline
+
+  std::vector<uint8_t> channels;
+  for (const char *name : {"A", "B", "G", "R"}) {
+    appendBytes(channels, name, 2);
+    appendLE(channels, (int32_t)1); // HALF
+    channels.insert(channels.end(), {0, 0, 0, 0}); // pLinear + reserved
+    appendLE(channels, (int32_t)1);                // xSampling
+    appendLE(channels, (int32_t)1);                // ySampling
+  }
+  channels.push_back(0);
+  std::vector<uint8_t> window;
+  appendLE(window, (int32_t)0);
+  appendLE(window, (int32_t)0);
+  appendLE(window, (int32_t)(width - 1));
+  appendLE(window, (int32_t)(height - 1));
+  std::vector<uint8_t> one;
+  appendFloatLE(one, 1.0f);
+  std::vector<uint8_t> center;
+  appendFloatLE(center, 0.0f);
+  appendFloatLE(center, 0.0f);
+
+  appendExrAttribute(out, "channels", "chlist", channels);
+  appendExrAttribute(out, "compression", "compression", {compression});
+  appendExrAttribute(out, "dataWindow", "box2i", window);
+  appendExrAttribute(out, "displayWindow", "box2i", window);
+  appendExrAttribute(out, "lineOrder", "lineOrder", {0}); // INCREASING_Y
+  appendExrAttribute(out, "pixelAspectRatio", "float", one);
+  appendExrAttribute(out, "screenWindowCenter", "v2f", center);
+  appendExrAttribute(out, "screenWindowWidth", "float", one);
+  out.push_back(0);
+
+  uint64_t offset = out.size() + (uint64_t)height * 8;
+  for (const auto &line : lines) {
+    appendLE(out, offset);
+    offset += 8 + line.size();
+  }
+  for (uint32_t y = 0; y < height; y++) {
+    appendLE(out, (int32_t)y);
+    appendLE(out, (int32_t)lines[y].size());
+    appendBytes(out, lines[y].data(), lines[y].size());
+  }
+  compressTime = secondsSince(compressStart);
+  return out;
+}
+
+void OutputEncoder::printStats() const {
+  static const char *formatNames[] = {"raw", "png", "exr"};
+  double frames = framesWritten > 0 ? (double)framesWritten : 1.0;
+  double convertMs = 1000.0 * convertSeconds / frames;
+  double compressMs = 1000.0 * compressSeconds / frames;
+  double writeMs = 1000.0 * writeSeconds / frames;
+  double encodeMs = convertMs + compressMs;
+
+  std::cout << std::fixed << std::setprecision(1) << "Encoder ("
+            << formatNames[static_cast<int>(format)] << ", "
+            << workers.size() << " workers, " << pixelConvertBackend()
+            << "): " << framesWritten << " frames, "
+            << bytesWritten / (1024.0 * 1024.0) << " MiB written"
+            << std::endl;
+  std::cout << "  per frame: convert " << std::setprecision(2) << convertMs
+            << " ms, compress " << compressMs << " ms, write " << writeMs
+            << " ms" << std::endl;
+  // One worker sustains 1000 / encodeMs fps; the pool scales that by the
+  // worker count until the (single) writer becomes the limit.
+  std::cout << std::setprecision(1) << "  throughput: "
+            << (wallSeconds > 0.0 ? framesWritten / wallSeconds : 0.0)
+            << " fps achieved, "
+            << (encodeMs > 0.0 ? 1000.0 / encodeMs : 0.0)
+            << " fps per worker, "
+            << (encodeMs > 0.0 ? workers.size() * 1000.0 / encodeMs : 0.0)
+            << " fps pool limit, "
+            << (writeMs > 0.0 ? 1000.0 / writeMs : 0.0)
+            << " fps writer limit, reorder peak " << reorderPeak << std::endl;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "BoundedQueue.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// File format of the frames written by batch mode.
+enum class OutputFormat { Raw, PNG, EXR };
+
+// Which image is read back for every frame: the TNR2 output or the final
+// (upscaled) image.
+enum class OutputSource { TNR2, Final };
+
+// Layout of the pixels handed to the encoder (what was read back).
+enum class OutputPixels { RGBA16F, BGRA8 };
+
+// Output stage of batch mode. A pool of workers converts and compresses
+// frames in parallel; a single writer thread stores them strictly in
+// submission order through a reorder buffer.
+//
+//   raw : the read-back pixels unchanged, rows bottom-up like the inputs
+//   png : RGBA8 (half floats clamped to [0, 1]), deflate-compressed
+//   exr : RGBA half float scanlines (ZIPS compressed when zlib is available)
+class OutputEncoder {
+public:
+    OutputEncoder(const std::string& directory, const std::string& filePrefix,
+                  OutputFormat format, OutputPixels pixels,
+                  uint32_t width, uint32_t height, unsigned workerCount);
+    ~OutputEncoder();
+
+    // Queues a frame. Blocks while all workers are busy and the queue is
+    // full. release() is called from a worker as soon as the pixels have
+    // been consumed, so the caller can reuse the memory.
+    void submit(int frameIndex, const void* pixels, std::function<void()> release);
+
+    // Waits for every queued frame to be written. Rethrows the first error
+    // raised by a worker or the writer.
+    void finish();
+
+    unsigned getWorkerCount() const { return static_cast<unsigned>(workers.size()); }
+    void printStats() const;
+
+    static const char* formatExtension(OutputFormat format);
+
+private:
+    struct Job {
+        uint64_t sequence;
+        int frameIndex;
+        const void* pixels;
+        std::function<void()> release;
+    };
+    struct EncodedFrame {
+        int frameIndex;
+        std::vector<uint8_t> bytes;
+    };
+
+    void workerLoop();
+    void writerLoop();
+    std::vector<uint8_t> encode(const void* pixels, std::function<void()>& release,
+                                double& convertSeconds, double& compressSeconds) const;
+    void fail();
+
+    std::string directory;
+    std::string filePrefix;
+    OutputFormat format;
+    OutputPixels pixels;
+    uint32_t width;
+    uint32_t height;
+
+    BoundedQueue<Job> jobs;
+    std::vector<std::thread> workers;
+    std::thread writer;
+    uint64_t nextSequence = 0;
+
+    // Reorder buffer: frames finished out of order wait here for the writer.
+    std::mutex reorderMutex;
+    std::condition_variable reorderReady;
+    std::condition_variable reorderSpace;
+    std::map<uint64_t, EncodedFrame> reorder;
+    uint64_t nextToWrite = 0;
+    size_t reorderLimit;
+    size_t reorderPeak = 0;
+    unsigned workersRunning = 0;
+    bool failed = false;
+    bool finished = false;
+    std::exception_ptr error;
+
+    // Statistics (seconds are summed over all workers)
+    double convertSeconds = 0.0;
+    double compressSeconds = 0.0;
+    double writeSeconds = 0.0;
+    uint64_t framesWritten = 0;
+    uint64_t bytesWritten = 0;
+    double wallSeconds = 0.0;
+    std::chrono::steady_clock::time_point startTime;
+};
@@ -0,0 +1,202 @@
+#include "PipelineCache.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+const char MAGIC[8] = {'V', 'K', 'I', 'O', 'P', 'C', '0', '1'};
+
+// Our header in front of the driver's data.
+struct FileHeader {
+  char magic[8];
+  uint64_t dataSize;
+  uint64_t dataHash;
+};
+
+// VkPipelineCacheHeaderVersionOne as laid out in the data
+const size_t DRIVER_HEADER_SIZE = 16 + VK_UUID_SIZE;
+
+uint64_t fnv1a(const char *data, size_t size) {
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ static_cast<uint8_t>(data[i])) * 1099511628211ull;
+  }
+  return hash;
+}
+
+uint32_t readUint32(const char *data) {
+  uint32_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+} // namespace
+
+std::string PipelineCache::defaultPath() {
+  std::filesystem::path base;
+  if (const char *cache = std::getenv("XDG_CACHE_HOME"); cache && *cache) {
+    base = cache;
+  } else if (const char *home = std::getenv("HOME"); home && *home) {
+    base = std::filesystem::path(home) / ".cache";
+  } else if (const char *local = std::getenv("LOCALAPPDATA");
+             local && *local) {
+    base = local;
+  } else {
+    return "";
+  }
+  return (base / "vulkanio" / "pipeline_cache.bin").string();
+}
+
+// Reads the driver data of path into data; returns why it can't be used, or
+// an empty string.
+std::string PipelineCache::load(const VkPhysicalDeviceProperties &properties,
+                                std::string &data) const {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return "no cache file yet";
+  }
+  std::string contents((std::istreambuf_iterator<char>(file)),
+                       std::istreambuf_iterator<char>());
+  FileHeader header;
+  if (contents.size() < sizeof(header)) {
+    return "truncated file";
+  }
+  std::memcpy(&header, contents.data(), sizeof(header));
+  data = contents.substr(sizeof(header));
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+    return "not a pipeline cache file";
+  }
+  if (header.dataSize != data.size() ||
+      header.dataHash != fnv1a(data.data(), data.size())) {
+    return "corrupt file";
+  }
+
+  if (data.size() < DRIVER_HEADER_SIZE ||
+      readUint32(data.data()) < DRIVER_HEADER_SIZE ||
+      readUint32(data.data() + 4) != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {
+    return "unknown driver header";
+  }
+  if (readUint32(data.data() + 8) != properties.vendorID ||
+      readUint32(data.data() + 12) != properties.deviceID ||
+      std::memcmp(data.data() + 16, properties.pipelineCacheUUID,
+                  VK_UUID_SIZE) != 0) {
+    return "written by another device or driver version";
+  }
+  return "";
+}
+
+void PipelineCache::init(VkPhysicalDevice physicalDevice, VkDevice device,
+                         const std::string &path) {
+  this->device = device;
+  this->path = path;
+  loadedBytes = 0;
+  loadedHash = 0;
+
+  std::string data;
+  if (!path.empty()) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    std::string problem = load(properties, data);
+    if (!problem.empty()) {
+      std::cout << "Pipeline cache: " << problem << " (" << path
+                << "), starting cold" << std::endl;
+      data.clear();
+    }
+  }
+
+  VkPipelineCacheCreateInfo cacheInfo{};
+  cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  cacheInfo.initialDataSize = data.size();
+  cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+  if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) !=
+      VK_SUCCESS) {
+    if (data.empty()) {
+      throw std::runtime_error("failed to create pipeline cache!");
+    }
+    std::cout << "Pipeline cache: the driver rejected " << path
+              << ", starting cold" << std::endl;
+    cacheInfo.initialDataSize = 0;
+    cacheInfo.pInitialData = nullptr;
+    data.clear();
+    if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to create pipeline cache!");
+    }
+  }
+  if (!data.empty()) {
+    loadedBytes = data.size();
+    loadedHash = fnv1a(data.data(), data.size());
+    std::cout << "Pipeline cache: loaded " << loadedBytes / 1024 << " KB from "
+              << path << std::endl;
+  }
+}
+
+void PipelineCache::save() const {
+  size_t size = 0;
+  if (vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS) {
+    return;
+  }
+  std::vector<char> data(size);
+  if (size == 0 ||
+      vkGetPipelineCacheData(device, cache, &size, data.data()) !=
+          VK_SUCCESS) {
+    return;
+  }
+  data.resize(size);
+  FileHeader header;
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.dataSize = size;
+  header.dataHash = fnv1a(data.data(), size);
+  if (size == loadedBytes && header.dataHash == loadedHash) {
+    return; // Nothing new since the load
+  }
+
+  namespace fs = std::filesystem;
+  std::error_code error;
+  fs::path target(path);
+  if (target.has_parent_path()) {
+    fs::create_directories(target.parent_path(), error);
+  }
+  fs::path temporary =
+      target.string() + ".tmp" + std::to_string(std::random_device()());
+  {
+    std::ofstream file(temporary, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(data.data(), size);
+    file.close();
+    if (!file) {
+      std::cerr << "Pipeline cache: failed to write " << temporary.string()
+                << std::endl;
+      fs::remove(temporary, error);
+      return;
+    }
+  }
+  fs::rename(temporary, target, error);
+  if (error) {
+    std::cerr << "Pipeline cache: failed to replace " << path << ": "
+              << error.message() << std::endl;
+    fs::remove(temporary, error);
+    return;
+  }
+  std::cout << "Pipeline cache: saved " << size / 1024 << " KB to " << path
+            << std::endl;
+}
+
+void PipelineCache::destroy() {
+  if (cache == VK_NULL_HANDLE) {
+    return;
+  }
+  if (!path.empty()) {
+    save();
+  }
+  vkDestroyPipelineCache(device, cache, nullptr);
+  cache = VK_NULL_HANDLE;
+}
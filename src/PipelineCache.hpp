@@ -0,0 +1,47 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A VkPipelineCache kept on disk between runs, so that the driver skips
+// compiling the shaders of pipelines it has built before.
+//
+// The file holds the driver's cache data (vkGetPipelineCacheData) behind a
+// small header of our own: a magic, the data size and a hash of the data.
+// Loading checks that header, then the driver's
+// VkPipelineCacheHeaderVersionOne against the device: vendor, device ID and
+// pipelineCacheUUID, which changes with the driver version. A file that
+// fails any check is ignored and the run starts cold; drivers are supposed
+// to reject bad data themselves, but some crash on it instead. Saving writes
+// a temporary file and renames it over the old one, so a crash or a second
+// process never leaves a torn file behind.
+class PipelineCache {
+public:
+    // $XDG_CACHE_HOME/vulkanio/pipeline_cache.bin, ~/.cache/... or
+    // %LOCALAPPDATA%\vulkanio\...; empty when none of them is set.
+    static std::string defaultPath();
+
+    // Loads path if it holds a cache of this device; path empty: the cache
+    // lives in memory for this run only.
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path);
+    // Saves the cache if pipelines were added to it, and destroys it.
+    void destroy();
+
+    VkPipelineCache get() const { return cache; }
+    // Bytes of cache data loaded at init; 0: a cold start.
+    size_t getLoadedBytes() const { return loadedBytes; }
+
+private:
+    std::string load(const VkPhysicalDeviceProperties& properties, std::string& data) const;
+    void save() const;
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkPipelineCache cache = VK_NULL_HANDLE;
+    std::string path;
+    size_t loadedBytes = 0;
+    uint64_t loadedHash = 0;
+};
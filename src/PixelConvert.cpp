@@ -0,0 +1,300 @@
+#include "PixelConvert.hpp"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#include <immintrin.h>
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+// Compiled for F16C already, no runtime check needed.
+#define PIXEL_CONVERT_F16C 1
+#define PIXEL_TARGET_F16C
+#define PIXEL_HAS_F16C() true
+#elif defined(__GNUC__)
+// Build the F16C path anyway and pick it at runtime.
+#define PIXEL_CONVERT_F16C 1
+#define PIXEL_TARGET_F16C __attribute__((target("avx,f16c")))
+#define PIXEL_HAS_F16C()                                                       \
+  (__builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c"))
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PIXEL_CONVERT_NEON 1
+#endif
+
+float halfToFloat(uint16_t value) {
+  uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+  uint32_t exponent = (value >> 10) & 0x1F;
+  uint32_t mantissa = value & 0x3FF;
+  uint32_t bits;
+
+  if (exponent == 0) {
+    if (mantissa == 0) {
+      bits = sign;
+    } else {
+      // Subnormal half: normalize into a float.
+      exponent = 113;
+      while (!(mantissa & 0x400)) {
+        mantissa <<= 1;
+        exponent--;
+      }
+      bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    }
+  } else if (exponent == 31) {
+    bits = sign | 0x7F800000 | (mantissa << 13); // Inf / NaN
+  } else {
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  }
+
+  float result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+uint16_t floatToHalf(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  uint32_t sign = (bits >> 16) & 0x8000;
+  uint32_t magnitude = bits & 0x7FFFFFFF;
+
+  if (magnitude >= 0x7F800000) {
+    // Inf stays Inf, NaN stays a (quiet) NaN.
+    return sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 : 0);
+  }
+  if (magnitude >= 0x477FF000) {
+    return sign | 0x7C00; // Rounds to beyond 65504
+  }
+  if (magnitude < 0x38800000) {
+    // Subnormal (or zero) half: count units of 2^-24.
+    if (magnitude < 0x33000000) {
+      return sign;
+    }
+    uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+    uint32_t shift = 126 - (magnitude >> 23);
+    uint32_t half = mantissa >> shift;
+    uint32_t remainder = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half & 1))) {
+      half++;
+    }
+    return sign | half;
+  }
+
+  uint32_t half = (magnitude >> 13) - 0x1C000; // Rebias 127 -> 15
+  uint32_t remainder = magnitude & 0x1FFF;
+  if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+    half++;
+  }
+  return sign | half;
+}
+
+static uint8_t floatToUnorm8(float value) {
+  if (!(value > 0.0f)) {
+    return 0; // Also catches NaN
+  }
+  if (value >= 1.0f) {
+    return 255;
+  }
+  return (uint8_t)std::lrint(value * 255.0f);
+}
+
+// Scalar paths, also used for the tails of the SIMD loops.
+
+static void halfToUnorm8Scalar(const uint16_t *src, uint8_t *dst,
+                               size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    dst[i] = floatToUnorm8(halfToFloat(src[i]));
+  }
+}
+
+static void unorm8ToHalfScalar(const uint8_t *src, uint16_t *dst,
+                               size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    dst[i] = floatToHalf(src[i] / 255.0f);
+  }
+}
+
+static void halfToFloatScalar(const uint16_t *src, float *dst, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    dst[i] = halfToFloat(src[i]);
+  }
+}
+
+static void floatToHalfScalar(const float *src, uint16_t *dst, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    dst[i] = floatToHalf(src[i]);
+  }
+}
+
+#if defined(PIXEL_CONVERT_F16C)
+
+PIXEL_TARGET_F16C static void halfToUnorm8F16C(const uint16_t *src,
+                                               uint8_t *dst, size_t count) {
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 scale = _mm256_set1_ps(255.0f);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 f = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(src + i)));
+    // max() returns its second operand for NaN, so NaN maps to 0.
+    f = _mm256_min_ps(_mm256_max_ps(f, zero), one);
+    __m256i v = _mm256_cvtps_epi32(_mm256_mul_ps(f, scale));
+    __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(v),
+                                     _mm256_extractf128_si256(v, 1));
+    _mm_storel_epi64((__m128i *)(dst + i), _mm_packus_epi16(words, words));
+  }
+  halfToUnorm8Scalar(src + i, dst + i, count - i);
+}
+
+PIXEL_TARGET_F16C static void unorm8ToHalfF16C(const uint8_t *src,
+                                               uint16_t *dst, size_t count) {
+  const __m256 scale = _mm256_set1_ps(1.0f / 255.0f);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i bytes = _mm_loadl_epi64((const __m128i *)(src + i));
+    __m128i lo = _mm_cvtepu8_epi32(bytes);
+    __m128i hi = _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 4));
+    __m256i ints =
+        _mm256_insertf128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    __m256 f = _mm256_mul_ps(_mm256_cvtepi32_ps(ints), scale);
+    _mm_storeu_si128((__m128i *)(dst + i),
+                     _mm256_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT));
+  }
+  unorm8ToHalfScalar(src + i, dst + i, count - i);
+}
+
+PIXEL_TARGET_F16C static void halfToFloatF16C(const uint16_t *src, float *dst,
+                                              size_t count) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(
+                                  (const __m128i *)(src + i))));
+  }
+  halfToFloatScalar(src + i, dst + i, count - i);
+}
+
+PIXEL_TARGET_F16C static void floatToHalfF16C(const float *src, uint16_t *dst,
+                                              size_t count) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    _mm_storeu_si128(
+        (__m128i *)(dst + i),
+        _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+  }
+  floatToHalfScalar(src + i, dst + i, count - i);
+}
+
+#elif defined(PIXEL_CONVERT_NEON)
+
+static void halfToUnorm8Neon(const uint16_t *src, uint8_t *dst,
+                             size_t count) {
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+  const float32x4_t one = vdupq_n_f32(1.0f);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    uint16x8_t h = vld1q_u16(src + i);
+    float32x4_t lo = vcvt_f32_f16(vreinterpret_f16_u16(vget_low_u16(h)));
+    float32x4_t hi = vcvt_f32_f16(vreinterpret_f16_u16(vget_high_u16(h)));
+    // vmaxnm returns the number when one operand is NaN, so NaN maps to 0.
+    lo = vminq_f32(vmaxnmq_f32(lo, zero), one);
+    hi = vminq_f32(vmaxnmq_f32(hi, zero), one);
+    uint32x4_t ilo = vcvtnq_u32_f32(vmulq_n_f32(lo, 255.0f));
+    uint32x4_t ihi = vcvtnq_u32_f32(vmulq_n_f32(hi, 255.0f));
+    uint16x8_t words = vcombine_u16(vmovn_u32(ilo), vmovn_u32(ihi));
+    vst1_u8(dst + i, vmovn_u16(words));
+  }
+  halfToUnorm8Scalar(src + i, dst + i, count - i);
+}
+
+static void unorm8ToHalfNeon(const uint8_t *src, uint16_t *dst,
+                             size_t count) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    uint16x8_t words = vmovl_u8(vld1_u8(src + i));
+    float32x4_t lo = vmulq_n_f32(
+        vcvtq_f32_u32(vmovl_u16(vget_low_u16(words))), 1.0f / 255.0f);
+    float32x4_t hi = vmulq_n_f32(
+        vcvtq_f32_u32(vmovl_u16(vget_high_u16(words))), 1.0f / 255.0f);
+    vst1q_u16(dst + i,
+              vcombine_u16(vreinterpret_u16_f16(vcvt_f16_f32(lo)),
+                           vreinterpret_u16_f16(vcvt_f16_f32(hi))));
+  }
+  unorm8ToHalfScalar(src + i, dst + i, count - i);
+}
+
+static void halfToFloatNeon(const uint16_t *src, float *dst, size_t count) {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    vst1q_f32(dst + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src + i))));
+  }
+  halfToFloatScalar(src + i, dst + i, count - i);
+}
+
+static void floatToHalfNeon(const float *src, uint16_t *dst, size_t count) {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    vst1_u16(dst + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src + i))));
+  }
+  floatToHalfScalar(src + i, dst + i, count - i);
+}
+
+#endif
+
+namespace {
+struct ConvertTable {
+  void (*halfToUnorm8)(const uint16_t *, uint8_t *, size_t);
+  void (*unorm8ToHalf)(const uint8_t *, uint16_t *, size_t);
+  void (*halfToFloat)(const uint16_t *, float *, size_t);
+  void (*floatToHalf)(const float *, uint16_t *, size_t);
+  const char *name;
+};
+} // namespace
+
+static ConvertTable selectConvertTable() {
+#if defined(PIXEL_CONVERT_F16C)
+  if (PIXEL_HAS_F16C()) {
+    return {halfToUnorm8F16C, unorm8ToHalfF16C, halfToFloatF16C,
+            floatToHalfF16C, "f16c"};
+  }
+#elif defined(PIXEL_CONVERT_NEON)
+  return {halfToUnorm8Neon, unorm8ToHalfNeon, halfToFloatNeon,
+          floatToHalfNeon, "neon"};
+#endif
+  return {halfToUnorm8Scalar, unorm8ToHalfScalar, halfToFloatScalar,
+          floatToHalfScalar, "scalar"};
+}
+
+static const ConvertTable &convertTable() {
+  static const ConvertTable table = selectConvertTable();
+  return table;
+}
+
+void halfToUnorm8(const uint16_t *src, uint8_t *dst, size_t count) {
+  convertTable().halfToUnorm8(src, dst, count);
+}
+
+void unorm8ToHalf(const uint8_t *src, uint16_t *dst, size_t count) {
+  convertTable().unorm8ToHalf(src, dst, count);
+}
+
+void halfToFloat(const uint16_t *src, float *dst, size_t count) {
+  convertTable().halfToFloat(src, dst, count);
+}
+
+void floatToHalf(const float *src, uint16_t *dst, size_t count) {
+  convertTable().floatToHalf(src, dst, count);
+}
+
+void flipRows(void *pixels, size_t rowBytes, size_t rows) {
+  std::vector<char> rowBuffer(rowBytes);
+  char *data = static_cast<char *>(pixels);
+  for (size_t y = 0; y < rows / 2; y++) {
+    char *rowTop = data + y * rowBytes;
+    char *rowBottom = data + (rows - 1 - y) * rowBytes;
+    std::memcpy(rowBuffer.data(), rowTop, rowBytes);
+    std::memcpy(rowTop, rowBottom, rowBytes);
+    std::memcpy(rowBottom, rowBuffer.data(), rowBytes);
+  }
+}
+
+const char *pixelConvertBackend() { return convertTable().name; }
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Conversions between the GPU's half-float (RGBA16F) images and the 8-bit and
+// 32-bit formats used on the CPU. The bulk functions use F16C on x86 (picked
+// at runtime) and NEON on AArch64, with a scalar fallback elsewhere.
+
+float halfToFloat(uint16_t value);
+uint16_t floatToHalf(float value); // Round to nearest even
+
+// Clamps to [0, 1] and rounds to 8-bit unorm. NaN becomes 0.
+void halfToUnorm8(const uint16_t* src, uint8_t* dst, size_t count);
+void unorm8ToHalf(const uint8_t* src, uint16_t* dst, size_t count);
+void halfToFloat(const uint16_t* src, float* dst, size_t count);
+void floatToHalf(const float* src, uint16_t* dst, size_t count);
+
+// Reverses the order of rows in place (the raw inputs are stored bottom-up).
+void flipRows(void* pixels, size_t rowBytes, size_t rows);
+
+// Name of the code path the bulk conversions use ("f16c", "neon", "scalar").
+const char* pixelConvertBackend();
@@ -0,0 +1,106 @@
+#include "Roofline.hpp"
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+const uint32_t SPIRV_MAGIC = 0x07230203;
+const uint32_t HEADER_WORDS = 5;
+
+// Opcodes (SPIR-V specification, section 3.49)
+const uint32_t OP_EXT_INST = 12;
+const uint32_t OP_IMAGE_SAMPLE_FIRST = 87; // OpImageSampleImplicitLod
+const uint32_t OP_IMAGE_FETCH = 95;
+const uint32_t OP_ARITHMETIC_FIRST = 126; // OpSNegate
+const uint32_t OP_BITWISE_LAST = 200;     // OpNot; relational ops in between
+const uint32_t OP_LOOP_MERGE = 246;
+
+// Passes moving at least this share of the copy bandwidth are memory-bound.
+const double MEMORY_BOUND_SHARE = 0.5;
+
+} // namespace
+
+ShaderOps countShaderOps(const std::vector<char> &spirv) {
+  std::vector<uint32_t> words(spirv.size() / 4);
+  std::memcpy(words.data(), spirv.data(), words.size() * 4);
+  if (words.size() < HEADER_WORDS || words[0] != SPIRV_MAGIC) {
+    throw std::runtime_error("not a SPIR-V module!");
+  }
+
+  ShaderOps ops;
+  size_t i = HEADER_WORDS;
+  while (i < words.size()) {
+    uint32_t opcode = words[i] & 0xffff;
+    uint32_t wordCount = words[i] >> 16;
+    if (wordCount == 0) {
+      throw std::runtime_error("malformed SPIR-V instruction!");
+    }
+    if (opcode == OP_EXT_INST ||
+        (opcode >= OP_ARITHMETIC_FIRST && opcode <= OP_BITWISE_LAST)) {
+      ops.alu++;
+    } else if (opcode >= OP_IMAGE_SAMPLE_FIRST && opcode <= OP_IMAGE_FETCH) {
+      ops.samples++;
+    } else if (opcode == OP_LOOP_MERGE) {
+      ops.hasLoops = true;
+    }
+    i += wordCount;
+  }
+  return ops;
+}
+
+void printRoofline(std::ostream &out, const std::vector<PassTraffic> &passes,
+                   const std::vector<GpuProfiler::PassStats> &stats,
+                   double copyGBps) {
+  out << "=== Roofline (per stream and frame; copy bandwidth " << std::fixed
+      << std::setprecision(1);
+  if (copyGBps > 0.0) {
+    out << copyGBps << " GB/s";
+  } else {
+    out << "unavailable";
+  }
+  out << ") ===" << std::endl;
+  out << "  " << std::left << std::setw(9) << "pass" << std::right
+      << std::setw(8) << "ms" << std::setw(9) << "read MB" << std::setw(9)
+      << "write MB" << std::setw(8) << "GB/s" << std::setw(8) << "% peak"
+      << std::setw(8) << "ops/px" << std::setw(8) << "ops/B"
+      << "  bound" << std::endl;
+
+  for (const PassTraffic &pass : passes) {
+    double ms = 0.0;
+    for (const auto &stat : stats) {
+      if (stat.name == pass.name) {
+        ms = stat.meanMs;
+      }
+    }
+    uint64_t bytes = pass.readBytes + pass.writeBytes;
+    double gbps = ms > 0.0 ? bytes / (ms * 1e6) : 0.0;
+    double share = copyGBps > 0.0 ? gbps / copyGBps : 0.0;
+    double intensity =
+        bytes > 0 ? (double)pass.ops.alu * pass.fragments / bytes : 0.0;
+
+    // Loop bodies count once: their op counts are lower bounds.
+    std::string opsPerPixel = std::to_string(pass.ops.alu);
+    if (pass.ops.hasLoops) {
+      opsPerPixel += "+";
+    }
+    // Without a copy bandwidth there is no peak to compare against.
+    std::ostringstream peak;
+    peak << std::fixed << std::setprecision(1) << 100.0 * share;
+    out << "  " << std::left << std::setw(9) << pass.name << std::right
+        << std::setprecision(3) << std::setw(8) << ms << std::setprecision(1)
+        << std::setw(9) << pass.readBytes / 1e6 << std::setw(9)
+        << pass.writeBytes / 1e6 << std::setw(8) << gbps << std::setw(8)
+        << (copyGBps > 0.0 ? peak.str() : "-") << std::setw(8) << opsPerPixel
+        << std::setprecision(2) << std::setw(8) << intensity << "  "
+        << (ms <= 0.0 || copyGBps <= 0.0  ? "-"
+            : share >= MEMORY_BOUND_SHARE ? "memory"
+                                          : "compute/latency")
+        << std::endl;
+  }
+  out << "  traffic: each sampled texel read once, each attachment written "
+         "once; '+': shader loops, ops counted once"
+      << std::endl;
+  out << std::defaultfloat;
+}
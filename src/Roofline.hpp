@@ -0,0 +1,40 @@
+#pragma once
+
+#include "GpuProfiler.hpp"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Static instruction counts of a fragment shader's SPIR-V. Every arithmetic,
+// relational or bitwise instruction and every GLSL.std.450 call counts as one
+// op whatever its vector width; loop bodies count once, so a shader with
+// loops (see hasLoops) does at least this much work per fragment.
+struct ShaderOps {
+    uint32_t alu = 0;
+    uint32_t samples = 0; // Image sample and fetch instructions
+    bool hasLoops = false;
+};
+
+// Throws if the code isn't a SPIR-V module.
+ShaderOps countShaderOps(const std::vector<char>& spirv);
+
+// The memory traffic a pass can't avoid in one frame of one stream: every
+// texel of every sampled image read once and every attachment written once.
+// Caches make neighbourhood re-reads (SNR's 3x3, SNR2's radius) nearly free,
+// so this is the traffic to compare against DRAM bandwidth.
+struct PassTraffic {
+    std::string name;
+    uint64_t fragments = 0;
+    uint64_t readBytes = 0;
+    uint64_t writeBytes = 0;
+    ShaderOps ops;
+};
+
+// Achieved bandwidth and arithmetic intensity of every pass next to the
+// measured copy bandwidth of the device. A pass moving at least half the copy
+// bandwidth is memory-bound: smaller formats or fusing it with a neighbour
+// would speed it up, more ALU work would not.
+void printRoofline(std::ostream& out, const std::vector<PassTraffic>& passes,
+                   const std::vector<GpuProfiler::PassStats>& stats, double copyGBps);
@@ -0,0 +1,84 @@
+#include "SequenceInfo.hpp"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+static bool fileExists(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  return file.is_open();
+}
+
+SequenceInfo SequenceInfo::load(const std::string &directory) {
+  SequenceInfo info;
+  info.directory = directory;
+
+  // Like the frame loader, also look one level up when running from build/.
+  std::ifstream metadata(directory + "/sequence.txt");
+  if (!metadata.is_open()) {
+    metadata.open("../" + directory + "/sequence.txt");
+  }
+
+  if (metadata.is_open()) {
+    std::string line;
+    while (std::getline(metadata, line)) {
+      if (line.empty() || line[0] == '#') {
+        continue;
+      }
+      size_t eq = line.find('=');
+      if (eq == std::string::npos) {
+        continue;
+      }
+      std::string key = line.substr(0, eq);
+      std::string value = line.substr(eq + 1);
+      try {
+        if (key == "width") {
+          info.width = static_cast<uint32_t>(std::stoul(value));
+        } else if (key == "height") {
+          info.height = static_cast<uint32_t>(std::stoul(value));
+        } else if (key == "frames") {
+          info.frameCount = std::stoi(value);
+        }
+      } catch (const std::exception &) {
+        throw std::runtime_error("invalid value for '" + key + "' in " +
+                                 directory + "/sequence.txt");
+      }
+    }
+  } else {
+    std::cerr << "No sequence.txt in " << directory << ", assuming "
+              << info.width << "x" << info.height << std::endl;
+  }
+
+  if (info.width == 0 || info.height == 0) {
+    throw std::runtime_error("sequence resolution must be non-zero!");
+  }
+
+  if (info.frameCount <= 0) {
+    while (fileExists(info.framePath(COLOR_FILE_PREFIX, info.frameCount)) ||
+           fileExists("../" +
+                      info.framePath(COLOR_FILE_PREFIX, info.frameCount))) {
+      info.frameCount++;
+    }
+    if (info.frameCount == 0) {
+      info.frameCount = 1; // Nothing on disk; the loader shows black frames
+    }
+  }
+
+  std::cout << "Sequence " << directory << ": " << info.width << "x"
+            << info.height << ", " << info.frameCount << " frames"
+            << std::endl;
+  return info;
+}
+
+std::string SequenceInfo::pathPrefix(const std::string &filePrefix) const {
+  return directory + "/" + filePrefix;
+}
+
+std::string SequenceInfo::framePath(const std::string &filePrefix,
+                                    int frameIndex) const {
+  std::ostringstream oss;
+  oss << pathPrefix(filePrefix) << std::setw(4) << std::setfill('0')
+      << frameIndex << FILE_EXTENSION;
+  return oss.str();
+}
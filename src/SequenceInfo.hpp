@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Default input sequence (relative to the working directory).
+inline const std::string DEFAULT_SEQUENCE_DIR = "nvt_2026_01_23_11_43_31_45";
+
+// File name prefixes of the per-frame raw inputs inside a sequence directory.
+inline const std::string COLOR_FILE_PREFIX = "color_input_0_";
+inline const std::string DEPTH_FILE_PREFIX = "depth_input_0_";
+inline const std::string NORMAL_FILE_PREFIX = "normal_input_0_";
+inline const std::string ALBEDO_FILE_PREFIX = "albedo_0_";
+inline const std::string MV_FILE_PREFIX = "mv_input_0_";
+inline const std::string FILE_EXTENSION = ".raw";
+
+// Describes an input sequence: where it lives, its resolution and length.
+// Read from "<directory>/sequence.txt", a key=value file:
+//   width=1920
+//   height=864
+//   frames=148
+// Missing keys keep the defaults below; a missing frame count is found by
+// probing for color frames on disk.
+struct SequenceInfo {
+    std::string directory = DEFAULT_SEQUENCE_DIR;
+    uint32_t width = 1920;
+    uint32_t height = 864;
+    int frameCount = 0;
+
+    static SequenceInfo load(const std::string& directory);
+
+    std::string pathPrefix(const std::string& filePrefix) const;
+    std::string framePath(const std::string& filePrefix, int frameIndex) const;
+    size_t frameBytes() const { return (size_t)width * height * 4; } // RGBA8
+};
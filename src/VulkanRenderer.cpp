@@ -1,7 +1,11 @@
 #include "VulkanRenderer.hpp"
+#include "PixelConvert.hpp"
+#include "WorkStealingPool.hpp"
+#include <array>
 #include <cstring>
 #include <iomanip>
 #include <sstream>
+#include <thread>
 
 // Defines the directory where compiled shader files (.spv) are located.
 #ifndef SHADER_DIR
@@ -19,19 +23,6 @@ const std::vector<const char *> validationLayers = {
 const std::vector<const char *> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
-// Paths to our input raw data sequences.
-const std::string COLOR_PATH_PREFIX =
-    "nvt_2026_01_23_11_43_31_45/color_input_0_";
-const std::string DEPTH_PATH_PREFIX =
-    "nvt_2026_01_23_11_43_31_45/depth_input_0_";
-const std::string NORMAL_PATH_PREFIX =
-    "nvt_2026_01_23_11_43_31_45/normal_input_0_";
-const std::string ALBEDO_PATH_PREFIX =
-    "nvt_2026_01_23_11_43_31_45/albedo_0_"; // New Path
-const std::string MV_PATH_PREFIX = "nvt_2026_01_23_11_43_31_45/mv_input_0_";
-const std::string FILE_EXTENSION = ".raw";
-const uint32_t FILE_STRIDE = 4; // 4 bytes per pixel (RGBA)
-
 // Enable validation layers only in Debug builds to save performance in Release.
 #ifdef NDEBUG
 const bool enableValidationLayers = false;
@@ -69,36 +60,387 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance,
 // Main class entry point.
 // Orchestrates the application lifecycle: Init Window -> Init Vulkan -> Run
 // Loop -> Cleanup.
+VulkanRenderer::VulkanRenderer(const RendererConfig &config)
+    : config(config) {
+  // Batch mode never presents, so it always runs without a window.
+  if (this->config.batch) {
+    this->config.headless = true;
+  }
+  if (this->config.framesInFlight < 1 ||
+      this->config.framesInFlight > MAX_FRAMES_IN_FLIGHT) {
+    throw std::runtime_error("frames in flight must be between 1 and 4!");
+  }
+  if (!this->config.traceOutput.empty()) {
+    CpuTracer::enable();
+  }
+}
+
 void VulkanRenderer::run() {
-  initWindow();
+  CpuTracer::setThreadName("main");
+  loadSequence();
+  if (!config.headless) {
+    initWindow();
+  }
   initVulkan();
-  mainLoop();
+  if (config.batch) {
+    runBatch();
+  } else {
+    mainLoop();
+  }
   cleanup();
 }
 
+void VulkanRenderer::initHeadless() {
+  if (!config.headless) {
+    throw std::runtime_error("initHeadless() needs a headless config!");
+  }
+  loadSequence();
+  initVulkan();
+}
+
+void VulkanRenderer::shutdown() { cleanup(); }
+
+std::string VulkanRenderer::getDeviceName() const {
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  return properties.deviceName;
+}
+
+void VulkanRenderer::renderFrame() {
+  drawFrame();
+  vkDeviceWaitIdle(device);
+}
+
+void *VulkanRenderer::getInputStaging() {
+  return streams[0].stagingBufferMemory.mapped;
+}
+
+void VulkanRenderer::loadInput(const std::string &filename,
+                               const std::string &fallbackPrefix) {
+  loadRawImage(filename, getInputStaging(), fallbackPrefix);
+}
+
+void VulkanRenderer::uploadInput() { uploadInputs(streams[0]); }
+
+// Read the sequence metadata. Every image, staging buffer, framebuffer and
+// viewport is sized from it, so one binary handles any input resolution.
+// Each sequence becomes one stream; all streams share the pipelines, so they
+// must share a resolution too. Streams pushed from memory come with their
+// metadata already filled in.
+void VulkanRenderer::loadSequence() {
+  size_t streamCount = config.memoryStreams.empty()
+                           ? config.sequenceDirectories.size()
+                           : config.memoryStreams.size();
+  if (streamCount == 0) {
+    throw std::runtime_error("no input sequence given!");
+  }
+  if (!config.headless && streamCount > 1) {
+    throw std::runtime_error("multiple streams need headless or batch mode!");
+  }
+
+  streams.resize(streamCount);
+  for (size_t i = 0; i < streams.size(); i++) {
+    StreamResources &stream = streams[i];
+    if (config.memoryStreams.empty()) {
+      stream.sequence = SequenceInfo::load(config.sequenceDirectories[i]);
+    } else {
+      stream.sequence = config.memoryStreams[i];
+    }
+    if (streams.size() > 1) {
+      stream.tagPrefix = "s" + std::to_string(i) + "/";
+    }
+    if (stream.sequence.width != streams[0].sequence.width ||
+        stream.sequence.height != streams[0].sequence.height) {
+      throw std::runtime_error("all streams must have the same resolution!");
+    }
+  }
+
+  frameWidth = streams[0].sequence.width;
+  frameHeight = streams[0].sequence.height;
+  rmWidth = std::max(1u, frameWidth / STRIDE);
+  rmHeight = std::max(1u, frameHeight / STRIDE);
+
+  // Headless runs consume one input frame per rendered frame.
+  if (config.headless) {
+    frameDelay = 1;
+  }
+  frameDelayCounter = frameDelay - 1; // Load frame 0 on the first drawFrame()
+}
+
 // Initialize the GLFW library and create a window.
 // We tell GLFW *not* to create an OpenGL context because we are using Vulkan.
 void VulkanRenderer::initWindow() {
   glfwInit();
   glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API); // No OpenGL
   glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE); // Disable resizing for simplicity
-  window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan Image Sequence Player",
-                            nullptr, nullptr);
+  window = glfwCreateWindow(frameWidth, frameHeight,
+                            "Vulkan Image Sequence Player", nullptr, nullptr);
+  glfwSetWindowUserPointer(window, this);
+  glfwSetKeyCallback(window, keyCallback);
+}
+
+// Keyboard shortcuts: M prints the memory report, P the GPU pass times.
+void VulkanRenderer::keyCallback(GLFWwindow *window, int key,
+                                 int /*scancode*/, int action, int /*mods*/) {
+  auto app =
+      reinterpret_cast<VulkanRenderer *>(glfwGetWindowUserPointer(window));
+  if (action == GLFW_PRESS && key == GLFW_KEY_M) {
+    app->printMemoryReport();
+  }
+  if (action == GLFW_PRESS && key == GLFW_KEY_P) {
+    app->printGpuProfile();
+  }
+}
+
+// Prints every tracked allocation with its owning pass, plus current and peak
+// totals.
+void VulkanRenderer::printMemoryReport() {
+  memoryLedger.printReport(memoryAllocator);
+}
+
+// Prints the rolling per-pass GPU times (nothing unless profiling is on).
+void VulkanRenderer::printGpuProfile() { gpuProfiler.printStats(std::cout); }
+
+// Mean GPU time of every pass of every stream in one frame; 0 unless
+// profiling. Overlapping streams make this an upper bound.
+double VulkanRenderer::gpuMsPerFrame() const {
+  double total = 0.0;
+  if (gpuProfiler.isEnabled()) {
+    for (const auto &pass : gpuProfiler.getStats()) {
+      total += pass.meanMs;
+    }
+  }
+  return total * streams.size();
+}
+
+// Refreshes the metrics page, at most once a second unless forced. Runs on
+// the render thread, which owns every counter it reads.
+void VulkanRenderer::publishMetrics(bool force) {
+  if (!metricsExporter.isRunning()) {
+    return;
+  }
+  auto now = std::chrono::steady_clock::now();
+  double elapsed =
+      std::chrono::duration<double>(now - lastMetricsTime).count();
+  if (!force && elapsed < 1.0) {
+    return;
+  }
+  double fps =
+      elapsed > 0.0 ? (framesRendered - lastMetricsFrames) / elapsed : 0.0;
+  lastMetricsTime = now;
+  lastMetricsFrames = framesRendered;
+
+  PrometheusText page;
+  page.counter("vulkanio_frames_total", "Frames rendered (all streams at once)",
+               framesRendered);
+  page.gauge("vulkanio_fps", "Frames per second since the last update", fps);
+  page.gauge("vulkanio_streams", "Streams processed side by side",
+             static_cast<double>(streams.size()));
+  page.counter("vulkanio_frame_stalls_total",
+               "Frame intervals over the frame budget",
+               static_cast<double>(framePacing.getStalls()));
+  page.counter("vulkanio_loader_hits_total",
+               "Batch frames whose input was loaded before it was needed",
+               static_cast<double>(loaderHits));
+  page.counter("vulkanio_loader_stalls_total",
+               "Batch frames that waited for the loader",
+               static_cast<double>(loaderStalls));
+  page.counter("vulkanio_upload_bytes_total", "Input bytes uploaded to the GPU",
+               static_cast<double>(uploadBytes));
+  page.gauge("vulkanio_device_memory_bytes",
+             "Device-local memory allocated by the renderer",
+             static_cast<double>(memoryLedger.getDeviceBytes()));
+  page.gauge("vulkanio_host_memory_bytes",
+             "Host-visible memory allocated by the renderer",
+             static_cast<double>(memoryLedger.getHostBytes()));
+  if (gpuProfiler.isEnabled()) {
+    for (const auto &pass : gpuProfiler.getStats()) {
+      std::string labels = "pass=\"" + pass.name + "\"";
+      page.gauge("vulkanio_gpu_pass_ms", "Mean GPU time per pass and stream",
+                 pass.meanMs, labels);
+      page.gauge("vulkanio_gpu_pass_p99_ms",
+                 "p99 GPU time per pass and stream", pass.p99Ms, labels);
+    }
+  }
+  metricsExporter.publish(page.str());
+}
+
+// Prints the roofline report: the passes' measured times against their
+// compulsory traffic and the device's copy bandwidth. Needs an idle device.
+void VulkanRenderer::printRoofline() {
+  if (!gpuProfiler.isEnabled()) {
+    return;
+  }
+  double copyGBps = measureCopyBandwidth();
+  ::printRoofline(std::cout, passTraffic(), gpuProfiler.getStats(), copyGBps);
+}
+
+// Compulsory traffic of every pass for one stream and frame, from the
+// formats and sizes of its sampled images and attachments. Inputs are RGBA8,
+// the intermediate images RGBA16F, the output BGRA8.
+std::vector<PassTraffic> VulkanRenderer::passTraffic() const {
+  const uint64_t rm = (uint64_t)rmWidth * rmHeight;
+  const uint64_t full = (uint64_t)frameWidth * frameHeight;
+  const uint64_t INPUT = 4, HALF4 = 8, OUTPUT = 4; // Bytes per texel
+
+  // name, shader, fragments, bytes read, bytes written
+  struct Pass {
+    const char *name;
+    const char *shader;
+    uint64_t fragments, readBytes, writeBytes;
+  };
+  const Pass table[] = {
+      // depth, normal, albedo -> downsampled depth
+      {"DepthDS", "depthDS", rm, 3 * full * INPUT, rm * HALF4},
+      // color, normal, depthDS -> ray marched color
+      {"RM", "RM", rm, 2 * full * INPUT + rm * HALF4, rm * HALF4},
+      // RM, depthDS, SNR history, info history, mv -> color, info, out2
+      {"TNR", "TNR", rm, 4 * rm * HALF4 + full * INPUT, 3 * rm * HALF4},
+      // TNR color, depthDS, info -> filtered
+      {"SNR", "SNR", rm, 3 * rm * HALF4, rm * HALF4},
+      {"SNR2", "SNR2", rm, rm * HALF4, rm * HALF4},
+      // depth -> fresnel (the normal input is bound but unused)
+      {"Fresnel", "computeFresnel", full, full * INPUT, full * HALF4},
+      // SNR2, info, history, fresnel, depth, mv -> upsampled color
+      {"TNR2", "TNR2", full,
+       2 * rm * HALF4 + 2 * full * HALF4 + 2 * full * INPUT, full * HALF4},
+      {"Final", "draw", full, full * HALF4, full * OUTPUT},
+  };
+
+  std::vector<PassTraffic> passes;
+  for (const Pass &pass : table) {
+    PassTraffic traffic;
+    traffic.name = pass.name;
+    traffic.fragments = pass.fragments;
+    traffic.readBytes = pass.readBytes;
+    traffic.writeBytes = pass.writeBytes;
+    traffic.ops = countShaderOps(readFile(std::string(SHADER_DIR) + "/" +
+                                          pass.shader + ".frag.spv"));
+    passes.push_back(traffic);
+  }
+  return passes;
+}
+
+// Device bandwidth from buffer-to-buffer copies between two device-local
+// buffers, timed with timestamps. A copy reads and writes every byte, which
+// is the same read + write mix as a render pass. Returns GB/s, or -1 when
+// the copies couldn't be timed.
+double VulkanRenderer::measureCopyBandwidth() {
+  const VkDeviceSize SIZE = 64ull * 1024 * 1024;
+  const int COPIES = 8;
+
+  VkBuffer buffers[2];
+  MemoryAllocation memory[2];
+  for (int b = 0; b < 2; b++) {
+    createBuffer(SIZE,
+                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                     VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffers[b], memory[b],
+                 {"Roofline", b == 0 ? "copy source" : "copy destination",
+                  MemoryCategory::Transient});
+  }
+
+  VkQueryPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  poolInfo.queryCount = 2;
+  VkQueryPool queryPool;
+  if (vkCreateQueryPool(device, &poolInfo, nullptr, &queryPool) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create query pool!");
+  }
+
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandPool = commandPool;
+  allocInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer;
+  vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(commandBuffer, &beginInfo);
+  vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+
+  // Copies alternate direction, each waiting for the previous one, so the
+  // timed span is COPIES full copies back to back. The first one warms up
+  // the caches and clocks and isn't timed.
+  VkBufferCopy region{0, 0, SIZE};
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask =
+      VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  for (int c = 0; c <= COPIES; c++) {
+    if (c == 1) {
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          queryPool, 0);
+    }
+    vkCmdCopyBuffer(commandBuffer, buffers[c % 2], buffers[1 - c % 2], 1,
+                    &region);
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0,
+                         nullptr, 0, nullptr);
+  }
+  vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                      queryPool, 1);
+  vkEndCommandBuffer(commandBuffer);
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &commandBuffer;
+  bool timed =
+      vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) ==
+          VK_SUCCESS &&
+      vkQueueWaitIdle(graphicsQueue) == VK_SUCCESS;
+
+  uint64_t ticks[2] = {};
+  timed = timed &&
+          vkGetQueryPoolResults(device, queryPool, 0, 2, sizeof(ticks), ticks,
+                                sizeof(uint64_t),
+                                VK_QUERY_RESULT_64_BIT |
+                                    VK_QUERY_RESULT_WAIT_BIT) == VK_SUCCESS;
+
+  vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+  vkDestroyQueryPool(device, queryPool, nullptr);
+  for (int b = 0; b < 2; b++) {
+    vkDestroyBuffer(device, buffers[b], nullptr);
+    freeMemory(memory[b]);
+  }
+
+  // The profiler is on, so the queue has timestamps; it knows their valid
+  // bits and period.
+  double seconds = timed ? gpuProfiler.elapsedMs(ticks[0], ticks[1]) * 1e-3
+                         : 0.0;
+  return seconds > 0.0 ? 2.0 * SIZE * COPIES / seconds / 1e9 : -1.0;
 }
 
 // Master initialization function. Calls all the sub-init functions in the
 // required order. Vulkan is very explicit; everything needs to be created
 // manually.
 void VulkanRenderer::initVulkan() {
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
   createInstance(); // The connection between our app and the Vulkan library.
   setupDebugMessenger(); // Setup error logging.
-  createSurface();       // The interface between Vulkan and the Window System.
+  if (!config.headless) {
+    createSurface(); // The interface between Vulkan and the Window System.
+  }
   pickPhysicalDevice();  // Select a graphics card (GPU).
   createLogicalDevice(); // Create a logical interface to the selected GPU.
-  createSwapchain(); // Create the chain of images that will be presented to the
-                     // screen.
-  createImageViews(); // Create views (wrappers) for the swapchain images so the
-                      // pipeline can see them.
+  // Warm from an earlier run, pipeline creation skips shader compilation.
+  pipelineCache.init(physicalDevice, device, config.pipelineCachePath);
+  if (config.headless) {
+    createHeadlessTarget(); // Offscreen image standing in for the swapchain.
+  } else {
+    createSwapchain(); // Create the chain of images that will be presented to
+                       // the screen.
+    createImageViews(); // Create views (wrappers) for the swapchain images so
+                        // the pipeline can see them.
+  }
   createRenderPass(); // Define the structure of a rendering pass (attachments,
                       // subpasses, dependencies).
   createDescriptorSetLayout(); // Define the "signatures" of shaders (what
@@ -108,173 +450,241 @@ void VulkanRenderer::initVulkan() {
 
   // Create resources for offscreen passes (Ray Marching, Denoising, etc.)
   createOffscreenResources();
-  createDepthDSResources();
 
   createGraphicsPipeline(); // Create the pipeline state objects (shaders,
                             // blending, rasterization settings).
   createFramebuffers(); // Connect image views to the render pass attachments.
 
-  // Create texture resources (Images, Views, Samplers) on the GPU
-  createTextureImage();
-  createTextureImageView();
+  // Samplers, render passes and pipelines are shared by all streams.
   createTextureSampler();
-
-  createDepthTextureImage();
-  createDepthTextureImageView();
   createDepthTextureSampler();
-
-  createNormalTextureImage();
-  createNormalTextureImageView();
   createNormalTextureSampler();
-
-  createAlbedoTextureImage();
-  createAlbedoTextureImageView();
   createAlbedoTextureSampler();
-
-  createMVTextureImage();
-  createMVTextureImageView();
   createMVTextureSampler();
 
   createTNRResources(); // Temporal Noise Reduction resources
   createSNRResources(); // Spatial Noise Reduction resources
-
-  createSNRResources();            // Spatial Noise Reduction resources
+  createSNR2Resources();
   createTNR2Resources();           // TNR2 resources
   createComputeFresnelResources(); // Compute Fresnel resources
+  createPipelines(); // Compile every pipeline requested above, in parallel.
 
   createDescriptorPool(); // Pool for allocating descriptor sets.
-  createDescriptorSets(); // Allocate and update descriptor sets (bind images to
-                          // shaders).
-  createTNRDescriptorSets();
-  createSNRDescriptorSets();
-  createSNR2Resources();
-  createSNR2DescriptorSets();
-  createTNR2DescriptorSets();
-  createComputeFresnelDescriptorSets();
+
+  // Images, framebuffers and descriptor sets of every stream.
+  for (auto &stream : streams) {
+    createStreamResources(stream);
+  }
 
   createSyncObjects(); // Create semaphores and fences for frame
                        // synchronization.
+  framePacing.init(frames.size(), config.frameBudgetMs);
+
+  if (config.gpuProfile) {
+    // One timestamp before the first pass and one after every pass, per
+    // stream and frame context.
+    gpuProfiler.init(physicalDevice, device, graphicsQueueFamilyIndex,
+                     static_cast<uint32_t>(frames.size()),
+                     static_cast<uint32_t>(streams.size()),
+                     {"DepthDS", "RM", "TNR", "SNR", "SNR2", "Fresnel", "TNR2",
+                      "Final"},
+                     config.gpuProfileInterval, pipelineStatisticsSupported);
+  }
+
+  if (config.batch) {
+    createBatchResources(); // Upload and readback slots for batch mode.
+  } else {
+    // One upload slot per frame context, so the CPU can load the next frame
+    // while the GPU still copies the last one.
+    createUploadSlots(static_cast<int>(frames.size()), "Upload");
+  }
+
+  std::cout << "Startup took " << std::fixed << std::setprecision(1)
+            << std::chrono::duration<double, std::milli>(
+                   std::chrono::steady_clock::now() - start)
+                   .count()
+            << " ms (pipelines " << pipelineMs << " ms on "
+            << pipelineThreadsUsed << " threads, pipeline cache "
+            << (pipelineCache.getLoadedBytes() > 0 ? "warm" : "cold") << ")"
+            << std::defaultfloat << std::endl;
+  printMemoryReport();
+
+  if (!config.metricsAddress.empty()) {
+    metricsExporter.start(config.metricsAddress);
+    lastMetricsTime = std::chrono::steady_clock::now();
+    publishMetrics(true);
+    std::cout << "Serving metrics on " << config.metricsAddress << std::endl;
+  }
+}
+
+// Creates everything one stream owns. The shared render passes, samplers and
+// descriptor pool must exist already.
+void VulkanRenderer::createStreamResources(StreamResources &stream) {
+  createOffscreenImage(stream);
+  createDepthDSResources(stream);
+  if (config.headless) {
+    createHeadlessImage(stream);
+  }
+
+  // Create texture resources (Images, Views) on the GPU
+  createTextureImage(stream);
+  createTextureImageView(stream);
+
+  createDepthTextureImage(stream);
+  createDepthTextureImageView(stream);
+
+  createNormalTextureImage(stream);
+  createNormalTextureImageView(stream);
+
+  createAlbedoTextureImage(stream);
+  createAlbedoTextureImageView(stream);
+
+  createMVTextureImage(stream);
+  createMVTextureImageView(stream);
+
+  createTNRImages(stream);
+  createSNRImages(stream);
+  createSNR2Images(stream);
+  createTNR2Images(stream);
+  createFresnelImages(stream);
+
+  // One group of descriptor sets per frame context
+  stream.frameSets.resize(config.framesInFlight);
+  createDescriptorSets(stream); // Allocate and update descriptor sets (bind
+                                // images to shaders).
+  createTNRDescriptorSets(stream);
+  createSNRDescriptorSets(stream);
+  createSNR2DescriptorSets(stream);
+  createTNR2DescriptorSets(stream);
+  createComputeFresnelDescriptorSets(stream);
 }
 
 void VulkanRenderer::mainLoop() {
-  while (!glfwWindowShouldClose(window)) {
+  bottleneck.start(config.diagnosisInterval);
+  if (config.headless) {
+    // No window to close: stop after the requested number of frames, or once
+    // every sequence has been processed.
+    int totalFrames = config.frameCount;
+    if (totalFrames <= 0) {
+      for (const auto &stream : streams) {
+        totalFrames = std::max(totalFrames, stream.sequence.frameCount);
+      }
+    }
+    while (framesRendered < totalFrames) {
+      drawFrame();
+    }
+    vkDeviceWaitIdle(device);
+    // The frames still in flight are done now, oldest first.
+    for (size_t i = 0; i < frames.size(); i++) {
+      framePacing.frameFinished((currentFrame + i) % frames.size());
+    }
+    std::cout << "Rendered " << framesRendered << " frames (headless)"
+              << std::endl;
+    framePacing.printReport(std::cout, "GPU complete");
+    bottleneck.printReport(std::cout, gpuMsPerFrame());
+    if (config.referenceCheck) {
+      checkReference();
+    }
+    return;
+  }
+
+  while (!glfwWindowShouldClose(window) &&
+         (config.frameCount == 0 || framesRendered < config.frameCount)) {
     glfwPollEvents();
     drawFrame();
   }
   vkDeviceWaitIdle(device);
+  framePacing.printReport(std::cout, "present");
+  bottleneck.printReport(std::cout, gpuMsPerFrame());
 }
 
 void VulkanRenderer::cleanup() {
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
-    vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
-    vkDestroyFence(device, inFlightFences[i], nullptr);
+  metricsExporter.stop();
+
+  if (CpuTracer::isEnabled() && !config.traceOutput.empty()) {
+    size_t events = CpuTracer::writeChromeTrace(config.traceOutput);
+    std::cout << "CPU trace (" << events << " events) written to "
+              << config.traceOutput << std::endl;
+  }
+
+  if (gpuProfiler.isEnabled()) {
+    gpuProfiler.printStats(std::cout);
+    if (config.roofline) {
+      printRoofline();
+    }
+    if (!config.gpuProfileOutput.empty()) {
+      gpuProfiler.exportStats(config.gpuProfileOutput);
+      std::cout << "GPU profile written to " << config.gpuProfileOutput
+                << std::endl;
+    }
+    gpuProfiler.destroy();
+  }
+
+  if (config.batch) {
+    destroyBatchResources();
+  } else {
+    destroyUploadSlots();
+  }
+
+  for (FrameContext &frame : frames) {
+    vkDestroySemaphore(device, frame.renderFinished, nullptr);
+    vkDestroySemaphore(device, frame.imageAvailable, nullptr);
+    vkDestroyFence(device, frame.inFlight, nullptr);
   }
 
   vkDestroyCommandPool(device, commandPool, nullptr);
+  for (auto &stream : streams) {
+    destroyStreamResources(stream);
+  }
+  streams.clear();
   vkDestroyDescriptorPool(device, descriptorPool, nullptr);
-  vkDestroySampler(device, textureSampler, nullptr);
-  vkDestroyImageView(device, textureImageView, nullptr);
-  vkDestroyImage(device, textureImage, nullptr);
-  vkFreeMemory(device, textureImageMemory, nullptr);
 
+  vkDestroySampler(device, textureSampler, nullptr);
   vkDestroySampler(device, depthTextureSampler, nullptr);
-  vkDestroyImageView(device, depthTextureImageView, nullptr);
-  vkDestroyImage(device, depthTextureImage, nullptr);
-  vkFreeMemory(device, depthTextureImageMemory, nullptr);
-
   vkDestroySampler(device, normalTextureSampler, nullptr);
-  vkDestroyImageView(device, normalTextureImageView, nullptr);
-  vkDestroyImage(device, normalTextureImage, nullptr);
-  vkFreeMemory(device, normalTextureImageMemory, nullptr);
-
   vkDestroySampler(device, albedoTextureSampler, nullptr);
-  vkDestroyImageView(device, albedoTextureImageView, nullptr);
-  vkDestroyImage(device, albedoTextureImage, nullptr);
-  vkFreeMemory(device, albedoTextureImageMemory, nullptr);
-
-  vkDestroyBuffer(device, stagingBuffer, nullptr);
-  vkFreeMemory(device, stagingBufferMemory, nullptr);
-
-  vkDestroyBuffer(device, depthStagingBuffer, nullptr);
-  vkFreeMemory(device, depthStagingBufferMemory, nullptr);
-
-  vkDestroyBuffer(device, normalStagingBuffer, nullptr);
-  vkFreeMemory(device, normalStagingBufferMemory, nullptr);
-
-  vkDestroyBuffer(device, albedoStagingBuffer, nullptr);
-  vkFreeMemory(device, albedoStagingBufferMemory, nullptr);
+  vkDestroySampler(device, mvTextureSampler, nullptr);
+  vkDestroySampler(device, offscreenSampler, nullptr);
 
   vkDestroyPipeline(device, depthDSPipeline, nullptr);
   vkDestroyPipelineLayout(device, depthDSPipelineLayout, nullptr);
   vkDestroyDescriptorSetLayout(device, depthDSDescriptorSetLayout, nullptr);
-  vkDestroyFramebuffer(device, depthDSFramebuffer, nullptr);
   vkDestroyRenderPass(device, depthDSRenderPass, nullptr);
-  vkDestroyImageView(device, depthDSImageView, nullptr);
-  vkDestroyImage(device, depthDSImage, nullptr);
-  vkFreeMemory(device, depthDSImageMemory, nullptr);
 
   vkDestroyPipeline(device, offscreenPipeline, nullptr);
   vkDestroyPipelineLayout(device, offscreenPipelineLayout, nullptr);
-  vkDestroyFramebuffer(device, offscreenFramebuffer, nullptr);
   vkDestroyRenderPass(device, offscreenRenderPass, nullptr);
-  vkDestroyImageView(device, offscreenImageView, nullptr);
-  vkDestroyImage(device, offscreenImage, nullptr);
-  vkFreeMemory(device, offscreenImageMemory, nullptr);
-  vkDestroySampler(device, offscreenSampler, nullptr);
 
   vkDestroyPipeline(device, tnrPipeline, nullptr);
   vkDestroyPipelineLayout(device, tnrPipelineLayout, nullptr);
   vkDestroyRenderPass(device, tnrRenderPass, nullptr);
   vkDestroyDescriptorSetLayout(device, tnrDescriptorSetLayout, nullptr);
 
-  vkDestroyImageView(device, tnrIntermediateColorImageView, nullptr);
-  vkDestroyImage(device, tnrIntermediateColorImage, nullptr);
-  vkFreeMemory(device, tnrIntermediateColorImageMemory, nullptr);
-
-  vkDestroyImageView(device, tnrOut2ImageView, nullptr);
-  vkDestroyImage(device, tnrOut2Image, nullptr);
-  vkFreeMemory(device, tnrOut2ImageMemory, nullptr);
-
-  for (int i = 0; i < 2; i++) {
-    vkDestroyFramebuffer(device, tnrFramebuffers[i], nullptr);
-    vkDestroyImageView(device, tnrInfoImageViews[i], nullptr);
-    vkDestroyImage(device, tnrInfoImages[i], nullptr);
-    vkFreeMemory(device, tnrInfoImageMemories[i], nullptr);
-  }
-
   vkDestroyPipeline(device, snrPipeline, nullptr);
   vkDestroyPipelineLayout(device, snrPipelineLayout, nullptr);
   vkDestroyRenderPass(device, snrRenderPass, nullptr);
   vkDestroyDescriptorSetLayout(device, snrDescriptorSetLayout, nullptr);
-  for (int i = 0; i < 2; i++) {
-    vkDestroyFramebuffer(device, snrFramebuffers[i], nullptr);
-    vkDestroyImageView(device, snrImageViews[i], nullptr);
-    vkDestroyImage(device, snrImages[i], nullptr);
-    vkFreeMemory(device, snrImageMemories[i], nullptr);
-  }
 
   vkDestroyPipeline(device, snr2Pipeline, nullptr);
   vkDestroyPipelineLayout(device, snr2PipelineLayout, nullptr);
   vkDestroyRenderPass(device, snr2RenderPass, nullptr);
   vkDestroyDescriptorSetLayout(device, snr2DescriptorSetLayout, nullptr);
-  for (int i = 0; i < 2; i++) {
-    vkDestroyFramebuffer(device, snr2Framebuffers[i], nullptr);
-    vkDestroyImageView(device, snr2ImageViews[i], nullptr);
-    vkDestroyImage(device, snr2Images[i], nullptr);
-    vkFreeMemory(device, snr2ImageMemories[i], nullptr);
-  }
 
-  vkDestroySampler(device, mvTextureSampler, nullptr);
-  vkDestroyImageView(device, mvTextureImageView, nullptr);
-  vkDestroyImage(device, mvTextureImage, nullptr);
-  vkFreeMemory(device, mvTextureImageMemory, nullptr);
-  vkDestroyBuffer(device, mvStagingBuffer, nullptr);
-  vkFreeMemory(device, mvStagingBufferMemory, nullptr);
+  vkDestroyPipeline(device, computeFresnelPipeline, nullptr);
+  vkDestroyPipelineLayout(device, computeFresnelPipelineLayout, nullptr);
+  vkDestroyRenderPass(device, computeFresnelRenderPass, nullptr);
+  vkDestroyDescriptorSetLayout(device, computeFresnelDescriptorSetLayout,
+                               nullptr);
+
+  vkDestroyPipeline(device, tnr2Pipeline, nullptr);
+  vkDestroyPipelineLayout(device, tnr2PipelineLayout, nullptr);
+  vkDestroyRenderPass(device, tnr2RenderPass, nullptr);
+  vkDestroyDescriptorSetLayout(device, tnr2DescriptorSetLayout, nullptr);
 
   vkDestroyPipeline(device, finalPipeline, nullptr);
   vkDestroyPipelineLayout(device, finalPipelineLayout, nullptr);
   vkDestroyDescriptorSetLayout(device, finalDescriptorSetLayout, nullptr);
+  pipelineCache.destroy(); // Saves what this run compiled
 
   for (auto framebuffer : swapchainFramebuffers) {
     vkDestroyFramebuffer(device, framebuffer, nullptr);
@@ -286,18 +696,108 @@ void VulkanRenderer::cleanup() {
     vkDestroyImageView(device, imageView, nullptr);
   }
 
-  vkDestroySwapchainKHR(device, swapchain, nullptr);
+  if (!config.headless) {
+    vkDestroySwapchainKHR(device, swapchain, nullptr);
+  }
   vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+  memoryAllocator.destroy(); // Releases any blocks still holding resources
   vkDestroyDevice(device, nullptr);
 
   if (enableValidationLayers) {
     DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
   }
 
-  vkDestroySurfaceKHR(instance, surface, nullptr);
+  if (!config.headless) {
+    vkDestroySurfaceKHR(instance, surface, nullptr);
+  }
   vkDestroyInstance(instance, nullptr);
-  glfwDestroyWindow(window);
-  glfwTerminate();
+  if (!config.headless) {
+    glfwDestroyWindow(window);
+    glfwTerminate();
+  }
+}
+
+// Destroys the images, buffers and framebuffers of one stream. Its descriptor
+// sets go away with the descriptor pool.
+void VulkanRenderer::destroyStreamResources(StreamResources &stream) {
+  VkImage images[] = {stream.textureImage, stream.depthTextureImage,
+                      stream.normalTextureImage, stream.albedoTextureImage,
+                      stream.mvTextureImage};
+  VkImageView views[] = {
+      stream.textureImageView, stream.depthTextureImageView,
+      stream.normalTextureImageView, stream.albedoTextureImageView,
+      stream.mvTextureImageView};
+  MemoryAllocation *memories[] = {
+      &stream.textureImageMemory, &stream.depthTextureImageMemory,
+      &stream.normalTextureImageMemory, &stream.albedoTextureImageMemory,
+      &stream.mvTextureImageMemory};
+  VkBuffer stagingBuffers[] = {stream.stagingBuffer, stream.depthStagingBuffer,
+                               stream.normalStagingBuffer,
+                               stream.albedoStagingBuffer,
+                               stream.mvStagingBuffer};
+  MemoryAllocation *stagingMemories[] = {
+      &stream.stagingBufferMemory, &stream.depthStagingBufferMemory,
+      &stream.normalStagingBufferMemory, &stream.albedoStagingBufferMemory,
+      &stream.mvStagingBufferMemory};
+  for (int c = 0; c < INPUT_CHANNELS; c++) {
+    vkDestroyImageView(device, views[c], nullptr);
+    vkDestroyImage(device, images[c], nullptr);
+    freeMemory(*memories[c]);
+    vkDestroyBuffer(device, stagingBuffers[c], nullptr);
+    freeMemory(*stagingMemories[c]);
+  }
+
+  vkDestroyFramebuffer(device, stream.depthDSFramebuffer, nullptr);
+  vkDestroyImageView(device, stream.depthDSImageView, nullptr);
+  vkDestroyImage(device, stream.depthDSImage, nullptr);
+  freeMemory(stream.depthDSImageMemory);
+
+  vkDestroyFramebuffer(device, stream.offscreenFramebuffer, nullptr);
+  vkDestroyImageView(device, stream.offscreenImageView, nullptr);
+  vkDestroyImage(device, stream.offscreenImage, nullptr);
+  freeMemory(stream.offscreenImageMemory);
+
+  vkDestroyImageView(device, stream.tnrIntermediateColorImageView, nullptr);
+  vkDestroyImage(device, stream.tnrIntermediateColorImage, nullptr);
+  freeMemory(stream.tnrIntermediateColorImageMemory);
+
+  vkDestroyImageView(device, stream.tnrOut2ImageView, nullptr);
+  vkDestroyImage(device, stream.tnrOut2Image, nullptr);
+  freeMemory(stream.tnrOut2ImageMemory);
+
+  for (int i = 0; i < 2; i++) {
+    vkDestroyFramebuffer(device, stream.tnrFramebuffers[i], nullptr);
+    vkDestroyImageView(device, stream.tnrInfoImageViews[i], nullptr);
+    vkDestroyImage(device, stream.tnrInfoImages[i], nullptr);
+    freeMemory(stream.tnrInfoImageMemories[i]);
+
+    vkDestroyFramebuffer(device, stream.snrFramebuffers[i], nullptr);
+    vkDestroyImageView(device, stream.snrImageViews[i], nullptr);
+    vkDestroyImage(device, stream.snrImages[i], nullptr);
+    freeMemory(stream.snrImageMemories[i]);
+
+    vkDestroyFramebuffer(device, stream.snr2Framebuffers[i], nullptr);
+    vkDestroyImageView(device, stream.snr2ImageViews[i], nullptr);
+    vkDestroyImage(device, stream.snr2Images[i], nullptr);
+    freeMemory(stream.snr2ImageMemories[i]);
+
+    vkDestroyFramebuffer(device, stream.tnr2Framebuffers[i], nullptr);
+    vkDestroyImageView(device, stream.tnr2ImageViews[i], nullptr);
+    vkDestroyImage(device, stream.tnr2Images[i], nullptr);
+    freeMemory(stream.tnr2ImageMemories[i]);
+  }
+
+  vkDestroyFramebuffer(device, stream.computeFresnelFramebuffer, nullptr);
+  vkDestroyImageView(device, stream.fresnelImageView, nullptr);
+  vkDestroyImage(device, stream.fresnelImage, nullptr);
+  freeMemory(stream.fresnelImageMemory);
+
+  if (config.headless) {
+    vkDestroyFramebuffer(device, stream.finalFramebuffer, nullptr);
+    vkDestroyImageView(device, stream.finalImageView, nullptr);
+    vkDestroyImage(device, stream.finalImage, nullptr);
+    freeMemory(stream.finalImageMemory);
+  }
 }
 
 // 1. Create the Vulkan Instance.
@@ -423,6 +923,16 @@ void VulkanRenderer::pickPhysicalDevice() {
   if (physicalDevice == VK_NULL_HANDLE) {
     throw std::runtime_error("failed to find a suitable GPU!");
   }
+
+  // The sequence resolution is only known at runtime, so make sure the GPU
+  // can actually create images that large.
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  if (frameWidth > properties.limits.maxImageDimension2D ||
+      frameHeight > properties.limits.maxImageDimension2D) {
+    throw std::runtime_error("sequence resolution exceeds the GPU's maximum "
+                             "image size!");
+  }
 }
 
 // 5. Create a Logical Device (interface to the physical GPU).
@@ -454,11 +964,28 @@ void VulkanRenderer::createLogicalDevice() {
   queueCreateInfo.queueCount = 1;
   queueCreateInfo.pQueuePriorities = &queuePriority;
 
-  // Device features we want to enable (e.g., geometry shaders). Leaving empty
-  // for now.
+  // Device features we want to enable. Pipeline statistics queries are only
+  // turned on when asked for (--gpu-stats).
   VkPhysicalDeviceFeatures deviceFeatures{};
+  if (config.gpuProfile && config.gpuPipelineStatistics) {
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    if (supportedFeatures.pipelineStatisticsQuery) {
+      deviceFeatures.pipelineStatisticsQuery = VK_TRUE;
+      pipelineStatisticsSupported = true;
+    } else {
+      std::cerr << "GPU profiling: no pipeline statistics queries on this "
+                   "device, timing only"
+                << std::endl;
+    }
+  }
 
-  std::vector<const char *> enabledExtensions = deviceExtensions;
+  // Headless runs never present, so they don't need the swapchain extension
+  // (render nodes and CPU drivers may not expose it).
+  std::vector<const char *> enabledExtensions;
+  if (!config.headless) {
+    enabledExtensions = deviceExtensions;
+  }
 
   // Check for "portability subset" again (macOS requirement).
   uint32_t extensionCount;
@@ -471,8 +998,34 @@ void VulkanRenderer::createLogicalDevice() {
   for (const auto &extension : availableExtensions) {
     if (strcmp(extension.extensionName, "VK_KHR_portability_subset") == 0) {
       enabledExtensions.push_back("VK_KHR_portability_subset");
-      break;
     }
+    // Optional: lets the memory allocator track usage against the real
+    // per-heap budget reported by the driver.
+    if (strcmp(extension.extensionName,
+               VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0) {
+      enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+      memoryBudgetSupported = true;
+    }
+    if (strcmp(extension.extensionName,
+               VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME) == 0) {
+      hostMemoryImportSupported = true;
+    }
+  }
+  // Optional: importing host memory as buffers (zero-copy inputs). Needs
+  // VK_KHR_external_memory as well on Vulkan 1.0.
+  if (hostMemoryImportSupported) {
+    bool externalMemory = false;
+    for (const auto &extension : availableExtensions) {
+      if (strcmp(extension.extensionName,
+                 VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME) == 0) {
+        externalMemory = true;
+      }
+    }
+    hostMemoryImportSupported = externalMemory && externalMemoryCapabilities;
+  }
+  if (hostMemoryImportSupported) {
+    enabledExtensions.push_back(VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME);
+    enabledExtensions.push_back(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
   }
 
   // Main Logical Device creation info.
@@ -503,6 +1056,11 @@ void VulkanRenderer::createLogicalDevice() {
   vkGetDeviceQueue(device, graphicsFamily, 0, &graphicsQueue);
   vkGetDeviceQueue(device, graphicsFamily, 0,
                    &presentQueue); // Assuming same family for simplicity
+
+  memoryAllocator.init(instance, physicalDevice, device,
+                       memoryBudgetSupported);
+  hostMemoryImporter.init(instance, physicalDevice, device,
+                          hostMemoryImportSupported);
 }
 
 // 6. Create the Swapchain.
@@ -519,7 +1077,7 @@ void VulkanRenderer::createSwapchain() {
       VK_FORMAT_B8G8R8A8_UNORM; // Standard color format (Blue, Green, Red,
                                 // Alpha)
   createInfo.imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
-  createInfo.imageExtent = {WIDTH, HEIGHT}; // Resolution
+  createInfo.imageExtent = {frameWidth, frameHeight}; // Resolution
   createInfo.imageArrayLayers = 1;          // Always 1 for 2D images
   createInfo.imageUsage =
       VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; // We will render directly to these
@@ -563,6 +1121,44 @@ void VulkanRenderer::createImageViews() {
   }
 }
 
+// 6b. Headless: Pick the Final Output Format.
+// Without a window there is no swapchain. The final pass keeps the swapchain's
+// format and extent but renders into one offscreen image per stream (see
+// createHeadlessImage), so the render pass and pipeline stay unchanged.
+void VulkanRenderer::createHeadlessTarget() {
+  swapchainImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+  swapchainExtent = {frameWidth, frameHeight};
+}
+
+// The final image of one headless stream, with the framebuffer the final pass
+// draws into.
+void VulkanRenderer::createHeadlessImage(StreamResources &stream) {
+  createImage(frameWidth, frameHeight, swapchainImageFormat,
+              VK_IMAGE_TILING_OPTIMAL,
+              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                  VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, stream.finalImage,
+              stream.finalImageMemory,
+              {"Final", stream.tagPrefix + "output",
+               MemoryCategory::Transient});
+  stream.finalImageView =
+      createImageView(stream.finalImage, swapchainImageFormat);
+
+  VkFramebufferCreateInfo framebufferInfo{};
+  framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebufferInfo.renderPass = renderPass;
+  framebufferInfo.attachmentCount = 1;
+  framebufferInfo.pAttachments = &stream.finalImageView;
+  framebufferInfo.width = swapchainExtent.width;
+  framebufferInfo.height = swapchainExtent.height;
+  framebufferInfo.layers = 1;
+
+  if (vkCreateFramebuffer(device, &framebufferInfo, nullptr,
+                          &stream.finalFramebuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create final framebuffer!");
+  }
+}
+
 // 8. Create Render Passes.
 // A Render Pass tells Vulkan about the attachments (images) we will be using
 // during a drawing operation. It describes formats, sample counts, and what to
@@ -582,7 +1178,10 @@ void VulkanRenderer::createRenderPass() {
   colorAttachment.initialLayout =
       VK_IMAGE_LAYOUT_UNDEFINED; // We don't care what was here before
   colorAttachment.finalLayout =
-      VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; // Ready to be presented to swapchain
+      config.headless
+          ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL // Ready to be read back
+          : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; // Ready to be presented to
+                                             // swapchain
 
   VkAttachmentReference colorAttachmentRef{};
   colorAttachmentRef.attachment = 0; // Index in the pAttachments array
@@ -595,12 +1194,27 @@ void VulkanRenderer::createRenderPass() {
   subpass.colorAttachmentCount = 1;
   subpass.pColorAttachments = &colorAttachmentRef;
 
+  // Headless frame contexts share one final image, and batch mode copies the
+  // previous frame out of it. The copy must finish before this pass clears
+  // it. On a swapchain, wait for the stage the acquire semaphore unblocks.
+  VkSubpassDependency dependency{};
+  dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependency.dstSubpass = 0;
+  dependency.srcStageMask = config.headless
+                                ? VK_PIPELINE_STAGE_TRANSFER_BIT
+                                : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependency.srcAccessMask = 0;
+  dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
   VkRenderPassCreateInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
   renderPassInfo.attachmentCount = 1;
   renderPassInfo.pAttachments = &colorAttachment;
   renderPassInfo.subpassCount = 1;
   renderPassInfo.pSubpasses = &subpass;
+  renderPassInfo.dependencyCount = 1;
+  renderPassInfo.pDependencies = &dependency;
 
   if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) !=
       VK_SUCCESS) {
@@ -785,41 +1399,94 @@ void VulkanRenderer::createDescriptorSetLayout() {
 // A pipeline combines Shaders + Fixed Function states (rasterizer, blending,
 // depth test, viewport). Once created, these states are immutable (you can't
 // change them without creating a new pipeline).
+//
+// Here only the pipeline layouts are created; the pipelines themselves are
+// requested and compiled together with those of the denoise passes in
+// createPipelines().
 void VulkanRenderer::createGraphicsPipeline() {
-  // Load compiled shader code (SPIR-V binary)
-  auto vertShaderCode = readFile(std::string(SHADER_DIR) + "/shader.vert.spv");
-  auto rmFragShaderCode = readFile(std::string(SHADER_DIR) + "/RM.frag.spv");
-  auto drawFragShaderCode =
-      readFile(std::string(SHADER_DIR) + "/draw.frag.spv");
-  auto dsFragShaderCode =
-      readFile(std::string(SHADER_DIR) + "/depthDS.frag.spv");
-
-  VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-  VkShaderModule rmFragShaderModule = createShaderModule(rmFragShaderCode);
-  VkShaderModule drawFragShaderModule = createShaderModule(drawFragShaderCode);
-  VkShaderModule dsFragShaderModule = createShaderModule(dsFragShaderCode);
+  // Offscreen Pipeline Layout (connects descriptor layouts to pipeline)
+  VkPipelineLayoutCreateInfo offscreenPipelineLayoutInfo{};
+  offscreenPipelineLayoutInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  offscreenPipelineLayoutInfo.setLayoutCount = 1;
+  offscreenPipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
 
+  if (vkCreatePipelineLayout(device, &offscreenPipelineLayoutInfo, nullptr,
+                             &offscreenPipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create offscreen pipeline layout!");
+  }
   // === RM Pipeline (Offscreen Ray Marching) ===
-  VkPipelineShaderStageCreateInfo rmVertShaderStageInfo{};
-  rmVertShaderStageInfo.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  rmVertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-  rmVertShaderStageInfo.module = vertShaderModule;
-  rmVertShaderStageInfo.pName = "main";
-
-  VkPipelineShaderStageCreateInfo rmFragShaderStageInfo{};
-  rmFragShaderStageInfo.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  rmFragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-  rmFragShaderStageInfo.module = rmFragShaderModule;
-  rmFragShaderStageInfo.pName = "main";
-
-  VkPipelineShaderStageCreateInfo rmShaderStages[] = {rmVertShaderStageInfo,
-                                                      rmFragShaderStageInfo};
+  requestPipeline({"offscreen", "RM.frag.spv", offscreenPipelineLayout,
+                   offscreenRenderPass, 1, &offscreenPipeline});
+
+  // === DepthDS Pipeline ===
+  VkPipelineLayoutCreateInfo dsPipelineLayoutInfo{};
+  dsPipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  dsPipelineLayoutInfo.setLayoutCount = 1;
+  dsPipelineLayoutInfo.pSetLayouts = &depthDSDescriptorSetLayout;
+
+  if (vkCreatePipelineLayout(device, &dsPipelineLayoutInfo, nullptr,
+                             &depthDSPipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create depthDS pipeline layout!");
+  }
+  requestPipeline({"depthDS", "depthDS.frag.spv", depthDSPipelineLayout,
+                   depthDSRenderPass, 1, &depthDSPipeline});
+
+  // === Final (Upscale) Pipeline ===
+  VkPipelineLayoutCreateInfo finalPipelineLayoutInfo{};
+  finalPipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  finalPipelineLayoutInfo.setLayoutCount = 1;
+  finalPipelineLayoutInfo.pSetLayouts = &finalDescriptorSetLayout;
+
+  if (vkCreatePipelineLayout(device, &finalPipelineLayoutInfo, nullptr,
+                             &finalPipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create final pipeline layout!");
+  }
+  requestPipeline({"final", "draw.frag.spv", finalPipelineLayout, renderPass,
+                   1, &finalPipeline});
+}
+
+// Queues a pipeline for createPipelines(). Its layout and render pass must
+// exist by then.
+void VulkanRenderer::requestPipeline(const PipelineRequest &request) {
+  pipelineRequests.push_back(request);
+}
+
+// The shader module of a SPIR-V file in SHADER_DIR, read and created on the
+// first request only: every pass shares shader.vert.spv.
+VkShaderModule VulkanRenderer::getShaderModule(const std::string &file) {
+  auto found = shaderModules.find(file);
+  if (found != shaderModules.end()) {
+    return found->second;
+  }
+  VkShaderModule module =
+      createShaderModule(readFile(std::string(SHADER_DIR) + "/" + file));
+  shaderModules.emplace(file, module);
+  return module;
+}
+
+// Pipelines only need their shader modules while they are created.
+void VulkanRenderer::destroyShaderModules() {
+  for (auto &entry : shaderModules) {
+    vkDestroyShaderModule(device, entry.second, nullptr);
+  }
+  shaderModules.clear();
+}
+
+// 10b. Compile the requested pipelines.
+// Every pass draws a fullscreen quad with the same fixed function state;
+// the passes differ in fragment shader, layout, render pass and number of
+// color attachments. Compiling the shaders is most of the startup time on
+// drivers with slow compilers (lavapipe's LLVM JIT), so the pipelines are
+// created in parallel: vkCreateGraphicsPipelines may be called from several
+// threads at once, and the pipeline cache synchronizes itself.
+void VulkanRenderer::createPipelines() {
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
 
   // Vertex Input: How data is passed from vertex buffers to the vertex shader.
-  // We are generating a fullscreen triangle in code, so we don't need input
-  // buffers here.
+  // We are generating a fullscreen quad (two triangles) in code, so we don't
+  // need input buffers here.
   VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
   vertexInputInfo.sType =
       VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -858,19 +1525,19 @@ void VulkanRenderer::createGraphicsPipeline() {
   multisampling.sampleShadingEnable = VK_FALSE;
   multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 
-  // Color Blending: How to mix new pixel colors with existing ones.
+  // Color Blending: How to mix new pixel colors with existing ones. One
+  // attachment state per color attachment; TNR writes three.
+  uint32_t maxAttachments = 1;
+  for (const PipelineRequest &request : pipelineRequests) {
+    maxAttachments = std::max(maxAttachments, request.colorAttachments);
+  }
   VkPipelineColorBlendAttachmentState colorBlendAttachment{};
   colorBlendAttachment.colorWriteMask =
       VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
       VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
   colorBlendAttachment.blendEnable = VK_FALSE; // Overwrite existing color
-
-  VkPipelineColorBlendStateCreateInfo colorBlending{};
-  colorBlending.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-  colorBlending.logicOpEnable = VK_FALSE;
-  colorBlending.attachmentCount = 1;
-  colorBlending.pAttachments = &colorBlendAttachment;
+  std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments(
+      maxAttachments, colorBlendAttachment);
 
   // Dynamic State: States that CAN be changed without recreating the pipeline
   // (e.g., resizing viewport).
@@ -881,105 +1548,73 @@ void VulkanRenderer::createGraphicsPipeline() {
   dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
   dynamicState.pDynamicStates = dynamicStates.data();
 
-  // Offscreen Pipeline Layout (connects descriptor layouts to pipeline)
-  VkPipelineLayoutCreateInfo offscreenPipelineLayoutInfo{};
-  offscreenPipelineLayoutInfo.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  offscreenPipelineLayoutInfo.setLayoutCount = 1;
-  offscreenPipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+  // Everything a create info points to lives in these vectors until the
+  // workers are done. The shader modules are created here, on this thread.
+  size_t count = pipelineRequests.size();
+  std::vector<std::array<VkPipelineShaderStageCreateInfo, 2>> stages(count);
+  std::vector<VkPipelineColorBlendStateCreateInfo> colorBlending(count);
+  std::vector<VkGraphicsPipelineCreateInfo> pipelineInfos(count);
+  VkShaderModule vertShaderModule = getShaderModule("shader.vert.spv");
+  for (size_t i = 0; i < count; i++) {
+    const PipelineRequest &request = pipelineRequests[i];
+    stages[i][0] = {};
+    stages[i][0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[i][0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[i][0].module = vertShaderModule;
+    stages[i][0].pName = "main";
+    stages[i][1] = stages[i][0];
+    stages[i][1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[i][1].module = getShaderModule(request.fragmentShader);
+
+    colorBlending[i].sType =
+        VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending[i].logicOpEnable = VK_FALSE;
+    colorBlending[i].attachmentCount = request.colorAttachments;
+    colorBlending[i].pAttachments = colorBlendAttachments.data();
+
+    VkGraphicsPipelineCreateInfo &pipelineInfo = pipelineInfos[i];
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = stages[i].data();
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pColorBlendState = &colorBlending[i];
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = request.layout;
+    pipelineInfo.renderPass = request.renderPass;
+    pipelineInfo.subpass = 0;
+  }
 
-  if (vkCreatePipelineLayout(device, &offscreenPipelineLayoutInfo, nullptr,
-                             &offscreenPipelineLayout) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create offscreen pipeline layout!");
+  // One pipeline per task; the thread calling parallelFor() works too.
+  unsigned threads = config.pipelineThreads != 0
+                         ? config.pipelineThreads
+                         : std::thread::hardware_concurrency();
+  threads = static_cast<unsigned>(
+      std::max<size_t>(1, std::min<size_t>(threads, count)));
+  {
+    WorkStealingPool pool(threads);
+    pool.parallelFor(count, [&](size_t i) {
+      TRACE_SCOPE("createPipeline");
+      if (vkCreateGraphicsPipelines(device, pipelineCache.get(), 1,
+                                    &pipelineInfos[i], nullptr,
+                                    pipelineRequests[i].pipeline) !=
+          VK_SUCCESS) {
+        throw std::runtime_error(std::string("failed to create ") +
+                                 pipelineRequests[i].name +
+                                 " graphics pipeline!");
+      }
+    });
   }
 
-  VkGraphicsPipelineCreateInfo offscreenPipelineInfo{};
-  offscreenPipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  offscreenPipelineInfo.stageCount = 2;
-  offscreenPipelineInfo.pStages = rmShaderStages;
-  offscreenPipelineInfo.pVertexInputState = &vertexInputInfo;
-  offscreenPipelineInfo.pInputAssemblyState = &inputAssembly;
-  offscreenPipelineInfo.pViewportState = &viewportState;
-  offscreenPipelineInfo.pRasterizationState = &rasterizer;
-  offscreenPipelineInfo.pMultisampleState = &multisampling;
-  offscreenPipelineInfo.pColorBlendState = &colorBlending;
-  offscreenPipelineInfo.pDynamicState = &dynamicState;
-  offscreenPipelineInfo.layout = offscreenPipelineLayout;
-  offscreenPipelineInfo.renderPass = offscreenRenderPass;
-  offscreenPipelineInfo.subpass = 0;
-
-  if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1,
-                                &offscreenPipelineInfo, nullptr,
-                                &offscreenPipeline) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create offscreen graphics pipeline!");
-  }
-
-  // === DepthDS Pipeline ===
-  VkPipelineShaderStageCreateInfo dsFragShaderStageInfo{};
-  dsFragShaderStageInfo.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  dsFragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-  dsFragShaderStageInfo.module = dsFragShaderModule;
-  dsFragShaderStageInfo.pName = "main";
-
-  VkPipelineShaderStageCreateInfo dsShaderStages[] = {rmVertShaderStageInfo,
-                                                      dsFragShaderStageInfo};
-
-  VkPipelineLayoutCreateInfo dsPipelineLayoutInfo{};
-  dsPipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  dsPipelineLayoutInfo.setLayoutCount = 1;
-  dsPipelineLayoutInfo.pSetLayouts = &depthDSDescriptorSetLayout;
-
-  if (vkCreatePipelineLayout(device, &dsPipelineLayoutInfo, nullptr,
-                             &depthDSPipelineLayout) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create depthDS pipeline layout!");
-  }
-
-  VkGraphicsPipelineCreateInfo dsPipelineInfo = offscreenPipelineInfo;
-  dsPipelineInfo.pStages = dsShaderStages;
-  dsPipelineInfo.layout = depthDSPipelineLayout;
-  dsPipelineInfo.renderPass = depthDSRenderPass;
-
-  if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &dsPipelineInfo,
-                                nullptr, &depthDSPipeline) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create depthDS graphics pipeline!");
-  }
-
-  // === Final (Upscale) Pipeline ===
-  VkPipelineShaderStageCreateInfo finalFragShaderStageInfo{};
-  finalFragShaderStageInfo.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  finalFragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-  finalFragShaderStageInfo.module = drawFragShaderModule;
-  finalFragShaderStageInfo.pName = "main";
-
-  VkPipelineShaderStageCreateInfo finalShaderStages[] = {
-      rmVertShaderStageInfo, finalFragShaderStageInfo};
-
-  VkPipelineLayoutCreateInfo finalPipelineLayoutInfo{};
-  finalPipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  finalPipelineLayoutInfo.setLayoutCount = 1;
-  finalPipelineLayoutInfo.pSetLayouts = &finalDescriptorSetLayout;
-
-  if (vkCreatePipelineLayout(device, &finalPipelineLayoutInfo, nullptr,
-                             &finalPipelineLayout) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create final pipeline layout!");
-  }
-
-  VkGraphicsPipelineCreateInfo finalPipelineInfo = offscreenPipelineInfo;
-  finalPipelineInfo.pStages = finalShaderStages;
-  finalPipelineInfo.layout = finalPipelineLayout;
-  finalPipelineInfo.renderPass = renderPass;
-
-  if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &finalPipelineInfo,
-                                nullptr, &finalPipeline) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create final graphics pipeline!");
-  }
-
-  vkDestroyShaderModule(device, dsFragShaderModule, nullptr);
-  vkDestroyShaderModule(device, drawFragShaderModule, nullptr);
-  vkDestroyShaderModule(device, rmFragShaderModule, nullptr);
-  vkDestroyShaderModule(device, vertShaderModule, nullptr);
+  destroyShaderModules();
+  pipelineRequests.clear();
+  pipelineThreadsUsed = threads;
+  pipelineMs = std::chrono::duration<double, std::milli>(
+                   std::chrono::steady_clock::now() - start)
+                   .count();
 }
 
 // 11. Create Framebuffers.
@@ -1008,24 +1643,6 @@ void VulkanRenderer::createFramebuffers() {
       throw std::runtime_error("failed to create framebuffer!");
     }
   }
-
-  // Offscreen Framebuffer (connects Offscreen Image View to Offscreen Render
-  // Pass)
-  VkImageView offscreenAttachments[] = {offscreenImageView};
-
-  VkFramebufferCreateInfo offscreenFramebufferInfo{};
-  offscreenFramebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-  offscreenFramebufferInfo.renderPass = offscreenRenderPass;
-  offscreenFramebufferInfo.attachmentCount = 1;
-  offscreenFramebufferInfo.pAttachments = offscreenAttachments;
-  offscreenFramebufferInfo.width = RM_WIDTH;
-  offscreenFramebufferInfo.height = RM_HEIGHT;
-  offscreenFramebufferInfo.layers = 1;
-
-  if (vkCreateFramebuffer(device, &offscreenFramebufferInfo, nullptr,
-                          &offscreenFramebuffer) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create offscreen framebuffer!");
-  }
 }
 
 // 12. Create Command Pool.
@@ -1050,8 +1667,8 @@ void VulkanRenderer::createCommandPool() {
 // 13. Create Texture Image.
 // This loads an image into CPU memory, creates a GPU image, and copies the data
 // over.
-void VulkanRenderer::createTextureImage() {
-  VkDeviceSize imageSize = WIDTH * HEIGHT * 4;
+void VulkanRenderer::createTextureImage(StreamResources &stream) {
+  VkDeviceSize imageSize = stream.sequence.frameBytes();
 
   // Create a temporary "Staging Buffer" in CPU-visible memory.
   // GPU memory is often not directly accessible by the CPU, so we map this
@@ -1059,31 +1676,34 @@ void VulkanRenderer::createTextureImage() {
   createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-               stagingBuffer, stagingBufferMemory);
-
-  // Load initial data (e.g. from file) into the staging buffer
-  updateTexture();
+               stream.stagingBuffer, stream.stagingBufferMemory,
+               {"Input", stream.tagPrefix + "colorStaging",
+                MemoryCategory::Staging});
 
   // Create the actual Image on the GPU (Fast local memory).
-  createImage(WIDTH, HEIGHT, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
+  createImage(frameWidth, frameHeight, VK_FORMAT_R8G8B8A8_UNORM,
+              VK_IMAGE_TILING_OPTIMAL,
               VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage,
-              textureImageMemory);
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, stream.textureImage,
+              stream.textureImageMemory,
+              {"Input", stream.tagPrefix + "color", MemoryCategory::Input});
 
   // Prepare image to receive data
-  transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_UNORM,
+  transitionImageLayout(stream.textureImage, VK_FORMAT_R8G8B8A8_UNORM,
                         VK_IMAGE_LAYOUT_UNDEFINED,
                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
   // Copy data from Staging Buffer to GPU Image
-  copyBufferToImage(stagingBuffer, textureImage, WIDTH, HEIGHT);
+  copyBufferToImage(stream.stagingBuffer, stream.textureImage, frameWidth,
+                    frameHeight);
   // Prepare image for reading by the shader
-  transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_UNORM,
+  transitionImageLayout(stream.textureImage, VK_FORMAT_R8G8B8A8_UNORM,
                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 }
 
-void VulkanRenderer::createTextureImageView() {
-  textureImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_UNORM);
+void VulkanRenderer::createTextureImageView(StreamResources &stream) {
+  stream.textureImageView = createImageView(stream.textureImage,
+                                            VK_FORMAT_R8G8B8A8_UNORM);
 }
 
 // 14. Create Texture Sampler.
@@ -1113,31 +1733,35 @@ void VulkanRenderer::createTextureSampler() {
   }
 }
 
-void VulkanRenderer::createDepthTextureImage() {
-  VkDeviceSize imageSize = WIDTH * HEIGHT * 4;
+void VulkanRenderer::createDepthTextureImage(StreamResources &stream) {
+  VkDeviceSize imageSize = stream.sequence.frameBytes();
 
   createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-               depthStagingBuffer, depthStagingBufferMemory);
+               stream.depthStagingBuffer, stream.depthStagingBufferMemory,
+               {"Input", stream.tagPrefix + "depthStaging",
+                MemoryCategory::Staging});
 
-  createImage(WIDTH, HEIGHT, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
+  createImage(frameWidth, frameHeight, VK_FORMAT_R8G8B8A8_UNORM,
+              VK_IMAGE_TILING_OPTIMAL,
               VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthTextureImage,
-              depthTextureImageMemory);
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, stream.depthTextureImage,
+              stream.depthTextureImageMemory,
+              {"Input", stream.tagPrefix + "depth", MemoryCategory::Input});
 
-  transitionImageLayout(depthTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
+  transitionImageLayout(stream.depthTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
                         VK_IMAGE_LAYOUT_UNDEFINED,
                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
   // Initial data will be loaded in the first updateTexture call
-  transitionImageLayout(depthTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
+  transitionImageLayout(stream.depthTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 }
 
-void VulkanRenderer::createDepthTextureImageView() {
-  depthTextureImageView =
-      createImageView(depthTextureImage, VK_FORMAT_R8G8B8A8_UNORM);
+void VulkanRenderer::createDepthTextureImageView(StreamResources &stream) {
+  stream.depthTextureImageView =
+      createImageView(stream.depthTextureImage, VK_FORMAT_R8G8B8A8_UNORM);
 }
 
 void VulkanRenderer::createDepthTextureSampler() {
@@ -1163,17 +1787,6 @@ void VulkanRenderer::createDepthTextureSampler() {
 }
 
 void VulkanRenderer::createOffscreenResources() {
-  createImage(RM_WIDTH, RM_HEIGHT, VK_FORMAT_R16G16B16A16_SFLOAT,
-              VK_IMAGE_TILING_OPTIMAL,
-              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, offscreenImage,
-              offscreenImageMemory);
-  offscreenImageView =
-      createImageView(offscreenImage, VK_FORMAT_R16G16B16A16_SFLOAT);
-  transitionImageLayout(offscreenImage, VK_FORMAT_R16G16B16A16_SFLOAT,
-                        VK_IMAGE_LAYOUT_UNDEFINED,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
   VkSamplerCreateInfo samplerInfo{};
   samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
   samplerInfo.magFilter = VK_FILTER_LINEAR;
@@ -1194,6 +1807,40 @@ void VulkanRenderer::createOffscreenResources() {
   }
 }
 
+void VulkanRenderer::createOffscreenImage(StreamResources &stream) {
+  createImage(rmWidth, rmHeight, VK_FORMAT_R16G16B16A16_SFLOAT,
+              VK_IMAGE_TILING_OPTIMAL,
+              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                  VK_IMAGE_USAGE_TRANSFER_SRC_BIT, // Reference check
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, stream.offscreenImage,
+              stream.offscreenImageMemory,
+              {"RM", stream.tagPrefix + "offscreen",
+               MemoryCategory::Transient});
+  stream.offscreenImageView =
+      createImageView(stream.offscreenImage, VK_FORMAT_R16G16B16A16_SFLOAT);
+  transitionImageLayout(stream.offscreenImage, VK_FORMAT_R16G16B16A16_SFLOAT,
+                        VK_IMAGE_LAYOUT_UNDEFINED,
+                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+  // Offscreen Framebuffer (connects Offscreen Image View to Offscreen Render
+  // Pass)
+  VkImageView offscreenAttachments[] = {stream.offscreenImageView};
+
+  VkFramebufferCreateInfo offscreenFramebufferInfo{};
+  offscreenFramebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  offscreenFramebufferInfo.renderPass = offscreenRenderPass;
+  offscreenFramebufferInfo.attachmentCount = 1;
+  offscreenFramebufferInfo.pAttachments = offscreenAttachments;
+  offscreenFramebufferInfo.width = rmWidth;
+  offscreenFramebufferInfo.height = rmHeight;
+  offscreenFramebufferInfo.layers = 1;
+
+  if (vkCreateFramebuffer(device, &offscreenFramebufferInfo, nullptr,
+                          &stream.offscreenFramebuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create offscreen framebuffer!");
+  }
+}
+
 void VulkanRenderer::createFinalDescriptorSetLayout() {
   VkDescriptorSetLayoutBinding samplerLayoutBinding{};
   samplerLayoutBinding.binding = 0;
@@ -1237,13 +1884,15 @@ void VulkanRenderer::createFinalDescriptorSetLayout() {
 void VulkanRenderer::createDescriptorPool() {
   std::vector<VkDescriptorPoolSize> poolSizes(1);
   poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-  poolSizes[0].descriptorCount = 100; // Enough for all our frames and textures
+  // Enough for all our textures, for every frame context of every stream
+  uint32_t perContext = 50 * static_cast<uint32_t>(streams.size());
+  poolSizes[0].descriptorCount = perContext * config.framesInFlight;
 
   VkDescriptorPoolCreateInfo poolInfo{};
   poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
   poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
   poolInfo.pPoolSizes = poolSizes.data();
-  poolInfo.maxSets = 100;
+  poolInfo.maxSets = perContext * config.framesInFlight;
 
   if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) !=
       VK_SUCCESS) {
@@ -1254,39 +1903,40 @@ void VulkanRenderer::createDescriptorPool() {
 // 16. Create Descriptor Sets.
 // This actually allocates the "Descriptor Sets" from the pool and points them
 // to the specific resources (Texture Image, Sampler).
-void VulkanRenderer::createDescriptorSets() {
+void VulkanRenderer::createDescriptorSets(StreamResources &stream) {
   // We need one set per frame-in-flight to avoid race conditions.
-  std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT,
+  uint32_t contextCount = static_cast<uint32_t>(stream.frameSets.size());
+  std::vector<VkDescriptorSetLayout> layouts(contextCount,
                                              descriptorSetLayout);
   VkDescriptorSetAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
   allocInfo.descriptorPool = descriptorPool;
-  allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+  allocInfo.descriptorSetCount = contextCount;
   allocInfo.pSetLayouts = layouts.data();
 
-  descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
-  if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) !=
-      VK_SUCCESS) {
+  std::vector<VkDescriptorSet> descriptorSets(contextCount);
+  if (vkAllocateDescriptorSets(device, &allocInfo,
+                               descriptorSets.data()) != VK_SUCCESS) {
     throw std::runtime_error("failed to allocate descriptor sets!");
   }
 
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (uint32_t i = 0; i < contextCount; i++) {
     // Info about the Texture to bind to Binding 0
     VkDescriptorImageInfo imageInfo{};
     imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    imageInfo.imageView = textureImageView;
+    imageInfo.imageView = stream.textureImageView;
     imageInfo.sampler = textureSampler;
 
     // Info about the Depth Texture to bind to Binding 1
     VkDescriptorImageInfo depthImageInfo{};
     depthImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    depthImageInfo.imageView = depthTextureImageView;
+    depthImageInfo.imageView = stream.depthTextureImageView;
     depthImageInfo.sampler = depthTextureSampler;
 
     // Info about the Normal Texture to bind to Binding 2
     VkDescriptorImageInfo normalImageInfo{};
     normalImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    normalImageInfo.imageView = normalTextureImageView;
+    normalImageInfo.imageView = stream.normalTextureImageView;
     normalImageInfo.sampler = normalTextureSampler;
 
     std::vector<VkWriteDescriptorSet> descriptorWrites(3);
@@ -1328,39 +1978,40 @@ void VulkanRenderer::createDescriptorSets() {
   }
 
   // DepthDS descriptor sets
-  std::vector<VkDescriptorSetLayout> dsLayouts(MAX_FRAMES_IN_FLIGHT,
+  std::vector<VkDescriptorSetLayout> dsLayouts(contextCount,
                                                depthDSDescriptorSetLayout);
   VkDescriptorSetAllocateInfo dsAllocInfo{};
   dsAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
   dsAllocInfo.descriptorPool = descriptorPool;
-  dsAllocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+  dsAllocInfo.descriptorSetCount = contextCount;
   dsAllocInfo.pSetLayouts = dsLayouts.data();
 
-  depthDSDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+  std::vector<VkDescriptorSet> depthDSDescriptorSets(contextCount);
   if (vkAllocateDescriptorSets(device, &dsAllocInfo,
-                               depthDSDescriptorSets.data()) != VK_SUCCESS) {
+                               depthDSDescriptorSets.data()) !=
+      VK_SUCCESS) {
     throw std::runtime_error("failed to allocate depthDS descriptor sets!");
   }
 
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (uint32_t i = 0; i < contextCount; i++) {
     VkDescriptorImageInfo depthInfo{};
     depthInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    depthInfo.imageView = depthTextureImageView;
+    depthInfo.imageView = stream.depthTextureImageView;
     depthInfo.sampler = depthTextureSampler;
 
     VkDescriptorImageInfo albedoInfo{};
     albedoInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    albedoInfo.imageView = textureImageView;
+    albedoInfo.imageView = stream.textureImageView;
     albedoInfo.sampler = textureSampler;
 
     VkDescriptorImageInfo normalInfo{};
     normalInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    normalInfo.imageView = normalTextureImageView;
+    normalInfo.imageView = stream.normalTextureImageView;
     normalInfo.sampler = normalTextureSampler;
 
     VkDescriptorImageInfo newAlbedoInfo{};
     newAlbedoInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    newAlbedoInfo.imageView = albedoTextureImageView;
+    newAlbedoInfo.imageView = stream.albedoTextureImageView;
     newAlbedoInfo.sampler = albedoTextureSampler;
 
     std::vector<VkWriteDescriptorSet> writes(4);
@@ -1397,10 +2048,10 @@ void VulkanRenderer::createDescriptorSets() {
   }
 
   // Update RM descriptor sets to use depthDS output
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (uint32_t i = 0; i < contextCount; i++) {
     VkDescriptorImageInfo depthInfo{};
     depthInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    depthInfo.imageView = depthDSImageView;
+    depthInfo.imageView = stream.depthDSImageView;
     depthInfo.sampler = depthTextureSampler;
 
     VkWriteDescriptorSet write{};
@@ -1415,36 +2066,37 @@ void VulkanRenderer::createDescriptorSets() {
   }
 
   // Final descriptor sets (for upscaling/presenting)
-  std::vector<VkDescriptorSetLayout> finalLayouts(MAX_FRAMES_IN_FLIGHT,
+  std::vector<VkDescriptorSetLayout> finalLayouts(contextCount,
                                                   finalDescriptorSetLayout);
   VkDescriptorSetAllocateInfo finalAllocInfo{};
   finalAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
   finalAllocInfo.descriptorPool = descriptorPool;
-  finalAllocInfo.descriptorSetCount =
-      static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+  finalAllocInfo.descriptorSetCount = contextCount;
   finalAllocInfo.pSetLayouts = finalLayouts.data();
 
-  finalDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+  std::vector<VkDescriptorSet> finalDescriptorSets(contextCount);
   if (vkAllocateDescriptorSets(device, &finalAllocInfo,
-                               finalDescriptorSets.data()) != VK_SUCCESS) {
+                               finalDescriptorSets.data()) !=
+      VK_SUCCESS) {
     throw std::runtime_error("failed to allocate final descriptor sets!");
   }
 
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (uint32_t i = 0; i < contextCount; i++) {
     // Initial binding (will be updated dynamically if needed)
     VkDescriptorImageInfo snrInfo{};
     snrInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    snrInfo.imageView = offscreenImageView; // DEBUG: Show RM (Offscreen) output
+    snrInfo.imageView =
+        stream.offscreenImageView; // DEBUG: Show RM (Offscreen) output
     snrInfo.sampler = offscreenSampler;
 
     VkDescriptorImageInfo colorInfo{};
     colorInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    colorInfo.imageView = textureImageView;
+    colorInfo.imageView = stream.textureImageView;
     colorInfo.sampler = textureSampler;
 
     VkDescriptorImageInfo normalInfo{};
     normalInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    normalInfo.imageView = normalTextureImageView;
+    normalInfo.imageView = stream.normalTextureImageView;
     normalInfo.sampler = normalTextureSampler;
 
     VkWriteDescriptorSet writes[3]{};
@@ -1471,12 +2123,18 @@ void VulkanRenderer::createDescriptorSets() {
 
     vkUpdateDescriptorSets(device, 3, writes, 0, nullptr);
   }
+
+  for (uint32_t i = 0; i < contextCount; i++) {
+    stream.frameSets[i].rm = descriptorSets[i];
+    stream.frameSets[i].depthDS = depthDSDescriptorSets[i];
+    stream.frameSets[i].final = finalDescriptorSets[i];
+  }
 }
 
 void VulkanRenderer::createCommandBuffers() {
   // Deprecated step if we record on the fly, but standard structure often
   // pre-allocates them
-  commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  std::vector<VkCommandBuffer> commandBuffers(frames.size());
 
   VkCommandBufferAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -1488,15 +2146,16 @@ void VulkanRenderer::createCommandBuffers() {
       VK_SUCCESS) {
     throw std::runtime_error("failed to allocate command buffers!");
   }
+  for (size_t i = 0; i < frames.size(); i++) {
+    frames[i].commandBuffer = commandBuffers[i];
+  }
 }
 
 // 17. Create Synchronization Objects.
 // Vulkan is asynchronous. We need Semaphores (GPU-GPU sync) and Fences (CPU-GPU
-// sync).
+// sync), one set per frame context.
 void VulkanRenderer::createSyncObjects() {
-  imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+  frames.resize(config.framesInFlight);
 
   VkSemaphoreCreateInfo semaphoreInfo{};
   semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -1506,12 +2165,12 @@ void VulkanRenderer::createSyncObjects() {
   fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT; // Start signaled so we don't
                                                   // wait on the first frame
 
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (FrameContext &frame : frames) {
     if (vkCreateSemaphore(device, &semaphoreInfo, nullptr,
-                          &imageAvailableSemaphores[i]) != VK_SUCCESS ||
+                          &frame.imageAvailable) != VK_SUCCESS ||
         vkCreateSemaphore(device, &semaphoreInfo, nullptr,
-                          &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-        vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) !=
+                          &frame.renderFinished) != VK_SUCCESS ||
+        vkCreateFence(device, &fenceInfo, nullptr, &frame.inFlight) !=
             VK_SUCCESS) {
       throw std::runtime_error(
           "failed to create synchronization objects for a frame!");
@@ -1530,127 +2189,190 @@ void VulkanRenderer::createSyncObjects() {
 // 4. Submit the commands to the GPU.
 // 5. Present the image to the screen.
 void VulkanRenderer::drawFrame() {
-  // 1. Wait until the GPU has finished rendering the last frame.
-  vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE,
-                  UINT64_MAX);
-
-  // 2. Acquire an image from the swap chain
-  uint32_t imageIndex;
-  VkResult result = vkAcquireNextImageKHR(
-      device, swapchain, UINT64_MAX, imageAvailableSemaphores[currentFrame],
-      VK_NULL_HANDLE, &imageIndex);
-
-  if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-    // The window has been resized and the swapchain is incompatible (not
-    // handled here for simplicity)
-    return;
-  } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-    throw std::runtime_error("failed to acquire swap chain image!");
+  TRACE_SCOPE("drawFrame");
+  FrameContext &frame = frames[currentFrame];
+
+  // 1. Wait until the GPU has finished the last frame that used this context.
+  {
+    TRACE_SCOPE("waitForFence");
+    BottleneckClassifier::Scope phase(bottleneck,
+                                      BottleneckClassifier::GpuWait);
+    vkWaitForFences(device, 1, &frame.inFlight, VK_TRUE, UINT64_MAX);
+  }
+  if (config.headless) {
+    framePacing.frameFinished(currentFrame); // Its last frame is complete
+  }
+  framePacing.frameStarted(currentFrame);
+
+  // 2. Acquire an image from the swap chain (headless always renders into
+  // the single offscreen output image)
+  uint32_t imageIndex = 0;
+  if (!config.headless) {
+    TRACE_SCOPE("acquireImage");
+    BottleneckClassifier::Scope phase(bottleneck,
+                                      BottleneckClassifier::Present);
+    VkResult result = vkAcquireNextImageKHR(
+        device, swapchain, UINT64_MAX, frame.imageAvailable, VK_NULL_HANDLE,
+        &imageIndex);
+
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+      // The window has been resized and the swapchain is incompatible (not
+      // handled here for simplicity)
+      return;
+    } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+      throw std::runtime_error("failed to acquire swap chain image!");
+    }
+    framePacing.frameAcquired(currentFrame);
   }
 
   // Only reset the fence if we are submitting work
-  vkResetFences(device, 1, &inFlightFences[currentFrame]);
+  vkResetFences(device, 1, &frame.inFlight);
+
+  // Update texture logic for animation (CPU side): every stream moves to its
+  // next input frame at the same time. The inputs go to this context's
+  // upload slot, which the fence above says the GPU is done with, and the
+  // copies to the input images are recorded into this frame's commands.
+  // Frames in between keep the images as they are.
+  frameDelayCounter++;
+  const UploadSlot *upload = nullptr;
+  if (frameDelayCounter >= frameDelay) {
+    frameDelayCounter = 0;
+    UploadSlot &slot = uploadSlots[currentFrame];
+    for (size_t s = 0; s < streams.size(); s++) {
+      updateTexture(streams[s], &slot.memories[s * INPUT_CHANNELS]);
+    }
+    lastUploadSlot = static_cast<int>(currentFrame);
+    upload = &slot;
+  }
+
+  // 3. Record drawing commands for this frame
+  {
+    TRACE_SCOPE("recordCommandBuffer");
+    BottleneckClassifier::Scope phase(bottleneck, BottleneckClassifier::Record);
+    vkResetCommandBuffer(frame.commandBuffer, 0);
+    recordCommandBuffer(frame.commandBuffer, imageIndex, upload);
+  }
+
+  // 4. Submit the command buffer
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+  VkSemaphore waitSemaphores[] = {frame.imageAvailable};
+  VkPipelineStageFlags waitStages[] = {
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+  submitInfo.waitSemaphoreCount = config.headless ? 0 : 1;
+  submitInfo.pWaitSemaphores = waitSemaphores; // Wait for image to be available
+  submitInfo.pWaitDstStageMask = waitStages;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &frame.commandBuffer;
+
+  VkSemaphore signalSemaphores[] = {frame.renderFinished};
+  submitInfo.signalSemaphoreCount = config.headless ? 0 : 1;
+  submitInfo.pSignalSemaphores =
+      signalSemaphores; // Signal when rendering is finished
+
+  {
+    TRACE_SCOPE("queueSubmit");
+    BottleneckClassifier::Scope phase(bottleneck, BottleneckClassifier::Record);
+    if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, frame.inFlight) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to submit draw command buffer!");
+    }
+  }
+  framePacing.frameSubmitted(currentFrame);
+
+  // 5. Present the image (Show it on screen)
+  if (!config.headless) {
+    TRACE_SCOPE("queuePresent");
+    BottleneckClassifier::Scope phase(bottleneck,
+                                      BottleneckClassifier::Present);
+    VkPresentInfoKHR presentInfo{};
+    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pWaitSemaphores =
+        signalSemaphores; // Wait for rendering to finish
+
+    VkSwapchainKHR swapchains[] = {swapchain};
+    presentInfo.swapchainCount = 1;
+    presentInfo.pSwapchains = swapchains;
+    presentInfo.pImageIndices = &imageIndex;
+
+    vkQueuePresentKHR(presentQueue, &presentInfo);
+    framePacing.frameFinished(currentFrame);
+  }
+  framesRendered++;
+  bottleneck.frameDone();
+  bottleneck.maybePrintPeriodic(std::cout, gpuMsPerFrame());
+  publishMetrics();
+
+  // Flip TNR history index (for temporal effects)
+  tnrHistoryIndex = 1 - tnrHistoryIndex;
 
-  // Update texture logic for animation (CPU side)
-  updateTexture();
+  // Advance to next frame index
+  currentFrame = (currentFrame + 1) % frames.size();
+}
 
-  // Upload new texture data to the GPU immediately.
-  // Note: In a production engine, this would use a separate transfer
-  // queue/command buffer to avoid stalling graphics.
-  transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_UNORM,
+// Copies one stream's staging buffers into its input textures and waits for
+// every step. Frames record their uploads instead (recordUploadCommands());
+// this is what uploadInput() times.
+void VulkanRenderer::uploadInputs(StreamResources &stream) {
+  TRACE_SCOPE("uploadInputs");
+  BottleneckClassifier::Scope phase(bottleneck, BottleneckClassifier::Upload);
+  uploadBytes += INPUT_CHANNELS * (uint64_t)frameWidth * frameHeight * 4;
+  transitionImageLayout(stream.textureImage, VK_FORMAT_R8G8B8A8_UNORM,
                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  copyBufferToImage(stagingBuffer, textureImage, WIDTH, HEIGHT);
-  transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_UNORM,
+  copyBufferToImage(stream.stagingBuffer, stream.textureImage, frameWidth,
+                    frameHeight);
+  transitionImageLayout(stream.textureImage, VK_FORMAT_R8G8B8A8_UNORM,
                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-  transitionImageLayout(depthTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
+  transitionImageLayout(stream.depthTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  copyBufferToImage(depthStagingBuffer, depthTextureImage, WIDTH, HEIGHT);
-  transitionImageLayout(depthTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
+  copyBufferToImage(stream.depthStagingBuffer, stream.depthTextureImage,
+                    frameWidth, frameHeight);
+  transitionImageLayout(stream.depthTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-  transitionImageLayout(normalTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
+  transitionImageLayout(stream.normalTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  copyBufferToImage(normalStagingBuffer, normalTextureImage, WIDTH, HEIGHT);
-  transitionImageLayout(normalTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
+  copyBufferToImage(stream.normalStagingBuffer, stream.normalTextureImage,
+                    frameWidth, frameHeight);
+  transitionImageLayout(stream.normalTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-  transitionImageLayout(albedoTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
+  transitionImageLayout(stream.albedoTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  copyBufferToImage(albedoStagingBuffer, albedoTextureImage, WIDTH, HEIGHT);
-  transitionImageLayout(albedoTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
+  copyBufferToImage(stream.albedoStagingBuffer, stream.albedoTextureImage,
+                    frameWidth, frameHeight);
+  transitionImageLayout(stream.albedoTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-  transitionImageLayout(mvTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
+  transitionImageLayout(stream.mvTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  copyBufferToImage(mvStagingBuffer, mvTextureImage, WIDTH, HEIGHT);
-  transitionImageLayout(mvTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
+  copyBufferToImage(stream.mvStagingBuffer, stream.mvTextureImage, frameWidth,
+                    frameHeight);
+  transitionImageLayout(stream.mvTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-  // 3. Record drawing commands for this frame
-  vkResetCommandBuffer(commandBuffers[currentFrame], 0);
-  recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
-
-  // 4. Submit the command buffer
-  VkSubmitInfo submitInfo{};
-  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-  VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-  VkPipelineStageFlags waitStages[] = {
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-  submitInfo.waitSemaphoreCount = 1;
-  submitInfo.pWaitSemaphores = waitSemaphores; // Wait for image to be available
-  submitInfo.pWaitDstStageMask = waitStages;
-  submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
-
-  VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-  submitInfo.signalSemaphoreCount = 1;
-  submitInfo.pSignalSemaphores =
-      signalSemaphores; // Signal when rendering is finished
-
-  if (vkQueueSubmit(graphicsQueue, 1, &submitInfo,
-                    inFlightFences[currentFrame]) != VK_SUCCESS) {
-    throw std::runtime_error("failed to submit draw command buffer!");
-  }
-
-  // 5. Present the image (Show it on screen)
-  VkPresentInfoKHR presentInfo{};
-  presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-  presentInfo.waitSemaphoreCount = 1;
-  presentInfo.pWaitSemaphores =
-      signalSemaphores; // Wait for rendering to finish
-
-  VkSwapchainKHR swapchains[] = {swapchain};
-  presentInfo.swapchainCount = 1;
-  presentInfo.pSwapchains = swapchains;
-  presentInfo.pImageIndices = &imageIndex;
-
-  vkQueuePresentKHR(presentQueue, &presentInfo);
-
-  // Flip TNR history index (for temporal effects)
-  tnrHistoryIndex = 1 - tnrHistoryIndex;
-
-  // Advance to next frame index
-  currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 }
 
 // 19. Record Commands.
 // This function writes the actual GPU commands into the command buffer.
 // It sets up the render passes, binds pipelines, descriptor sets, and issues
 // draw calls.
+// upload (optional) holds new inputs to copy to the input images first.
 void VulkanRenderer::recordCommandBuffer(VkCommandBuffer commandBuffer,
-                                         uint32_t imageIndex) {
+                                         uint32_t imageIndex,
+                                         const UploadSlot *upload) {
   VkCommandBufferBeginInfo beginInfo{};
   beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
@@ -1658,21 +2380,53 @@ void VulkanRenderer::recordCommandBuffer(VkCommandBuffer commandBuffer,
     throw std::runtime_error("failed to begin recording command buffer!");
   }
 
+  if (upload) {
+    recordUploadCommands(commandBuffer, *upload);
+  }
+  recordFramePasses(commandBuffer, imageIndex);
+
+  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record command buffer!");
+  }
+}
+
+// Records every stream's passes into an already-begun command buffer. The
+// streams share nothing but pipelines, so one submit carries all of them and
+// the GPU can overlap their passes.
+void VulkanRenderer::recordFramePasses(VkCommandBuffer commandBuffer,
+                                       uint32_t imageIndex) {
+  // The context's fence has signalled, so last time's timestamps are ready.
+  gpuProfiler.beginFrame(commandBuffer, currentFrame);
+  for (auto &stream : streams) {
+    VkFramebuffer finalFramebuffer = config.headless
+                                         ? stream.finalFramebuffer
+                                         : swapchainFramebuffers[imageIndex];
+    recordStreamPasses(commandBuffer, stream, finalFramebuffer);
+  }
+}
+
+// Records every pass of one stream's frame (DepthDS -> RM -> TNR -> SNR ->
+// SNR2 -> Fresnel -> TNR2 -> Final).
+void VulkanRenderer::recordStreamPasses(VkCommandBuffer commandBuffer,
+                                        StreamResources &stream,
+                                        VkFramebuffer finalFramebuffer) {
   VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
+  uint32_t streamIndex = static_cast<uint32_t>(&stream - streams.data());
 
   // --- Pass 0: Depth Downsampling (DepthDS) ---
   // We render into the depthDSFramebuffer (Offscreen)
   VkRenderPassBeginInfo dsRenderPassInfo{};
   dsRenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
   dsRenderPassInfo.renderPass = depthDSRenderPass;
-  dsRenderPassInfo.framebuffer = depthDSFramebuffer;
+  dsRenderPassInfo.framebuffer = stream.depthDSFramebuffer;
   dsRenderPassInfo.renderArea.offset = {0, 0};
-  dsRenderPassInfo.renderArea.extent = {RM_WIDTH, RM_HEIGHT};
+  dsRenderPassInfo.renderArea.extent = {rmWidth, rmHeight};
 
   dsRenderPassInfo.clearValueCount = 1;
   dsRenderPassInfo.pClearValues = &clearColor;
 
   // Begin the pass
+  gpuProfiler.beginPass(commandBuffer, currentFrame, streamIndex, 0);
   vkCmdBeginRenderPass(commandBuffer, &dsRenderPassInfo,
                        VK_SUBPASS_CONTENTS_INLINE);
   // Bind the pipeline (Depth Downsampling logic)
@@ -1683,37 +2437,40 @@ void VulkanRenderer::recordCommandBuffer(VkCommandBuffer commandBuffer,
   VkViewport dsViewport{};
   dsViewport.x = 0.0f;
   dsViewport.y = 0.0f;
-  dsViewport.width = (float)RM_WIDTH;
-  dsViewport.height = (float)RM_HEIGHT;
+  dsViewport.width = (float)rmWidth;
+  dsViewport.height = (float)rmHeight;
   dsViewport.minDepth = 0.0f;
   dsViewport.maxDepth = 1.0f;
   vkCmdSetViewport(commandBuffer, 0, 1, &dsViewport);
 
   VkRect2D dsScissor{};
   dsScissor.offset = {0, 0};
-  dsScissor.extent = {RM_WIDTH, RM_HEIGHT};
+  dsScissor.extent = {rmWidth, rmHeight};
   vkCmdSetScissor(commandBuffer, 0, 1, &dsScissor);
 
   // Bind resources (Input images)
   vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
                           depthDSPipelineLayout, 0, 1,
-                          &depthDSDescriptorSets[currentFrame], 0, nullptr);
+                          &stream.frameSets[currentFrame].depthDS, 0,
+                          nullptr);
   // Draw a fullscreen quad (2 triangles = 6 vertices). The vertex shader
   // generates the coordinates.
   vkCmdDraw(commandBuffer, 6, 1, 0, 0);
   vkCmdEndRenderPass(commandBuffer);
+  gpuProfiler.endPass(commandBuffer, currentFrame, streamIndex, 0);
 
   // --- Pass 1: Offscreen Ray Marching (RM) ---
   VkRenderPassBeginInfo offscreenRenderPassInfo{};
   offscreenRenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
   offscreenRenderPassInfo.renderPass = offscreenRenderPass;
-  offscreenRenderPassInfo.framebuffer = offscreenFramebuffer;
+  offscreenRenderPassInfo.framebuffer = stream.offscreenFramebuffer;
   offscreenRenderPassInfo.renderArea.offset = {0, 0};
-  offscreenRenderPassInfo.renderArea.extent = {RM_WIDTH, RM_HEIGHT};
+  offscreenRenderPassInfo.renderArea.extent = {rmWidth, rmHeight};
 
   offscreenRenderPassInfo.clearValueCount = 1;
   offscreenRenderPassInfo.pClearValues = &clearColor;
 
+  gpuProfiler.beginPass(commandBuffer, currentFrame, streamIndex, 1);
   vkCmdBeginRenderPass(commandBuffer, &offscreenRenderPassInfo,
                        VK_SUBPASS_CONTENTS_INLINE);
   vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -1722,31 +2479,32 @@ void VulkanRenderer::recordCommandBuffer(VkCommandBuffer commandBuffer,
   VkViewport rmViewport{};
   rmViewport.x = 0.0f;
   rmViewport.y = 0.0f;
-  rmViewport.width = (float)RM_WIDTH;
-  rmViewport.height = (float)RM_HEIGHT;
+  rmViewport.width = (float)rmWidth;
+  rmViewport.height = (float)rmHeight;
   rmViewport.minDepth = 0.0f;
   rmViewport.maxDepth = 1.0f;
   vkCmdSetViewport(commandBuffer, 0, 1, &rmViewport);
 
   VkRect2D rmScissor{};
   rmScissor.offset = {0, 0};
-  rmScissor.extent = {RM_WIDTH, RM_HEIGHT};
+  rmScissor.extent = {rmWidth, rmHeight};
   vkCmdSetScissor(commandBuffer, 0, 1, &rmScissor);
 
   vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
                           offscreenPipelineLayout, 0, 1,
-                          &descriptorSets[currentFrame], 0, nullptr);
+                          &stream.frameSets[currentFrame].rm, 0, nullptr);
   vkCmdDraw(commandBuffer, 6, 1, 0, 0);
   vkCmdEndRenderPass(commandBuffer);
+  gpuProfiler.endPass(commandBuffer, currentFrame, streamIndex, 1);
 
   // --- Pass 2: Temporal Noise Reduction (TNR) ---
   VkRenderPassBeginInfo tnrRenderPassInfo{};
   tnrRenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
   tnrRenderPassInfo.renderPass = tnrRenderPass;
   // Write to the NEXT history index, read from current history index in shader
-  tnrRenderPassInfo.framebuffer = tnrFramebuffers[1 - tnrHistoryIndex];
+  tnrRenderPassInfo.framebuffer = stream.tnrFramebuffers[1 - tnrHistoryIndex];
   tnrRenderPassInfo.renderArea.offset = {0, 0};
-  tnrRenderPassInfo.renderArea.extent = {RM_WIDTH, RM_HEIGHT};
+  tnrRenderPassInfo.renderArea.extent = {rmWidth, rmHeight};
 
   VkClearValue tnrClearValues[3] = {{{0.0f, 0.0f, 0.0f, 1.0f}},
                                     {{0.0f, 0.0f, 0.0f, 1.0f}},
@@ -1754,6 +2512,7 @@ void VulkanRenderer::recordCommandBuffer(VkCommandBuffer commandBuffer,
   tnrRenderPassInfo.clearValueCount = 3;
   tnrRenderPassInfo.pClearValues = tnrClearValues;
 
+  gpuProfiler.beginPass(commandBuffer, currentFrame, streamIndex, 2);
   vkCmdBeginRenderPass(commandBuffer, &tnrRenderPassInfo,
                        VK_SUBPASS_CONTENTS_INLINE);
   vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -1769,21 +2528,24 @@ void VulkanRenderer::recordCommandBuffer(VkCommandBuffer commandBuffer,
 
   vkCmdBindDescriptorSets(
       commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, tnrPipelineLayout, 0, 1,
-      &tnrDescriptorSets[currentFrame * 2 + tnrHistoryIndex], 0, nullptr);
+      &stream.frameSets[currentFrame].tnr[tnrHistoryIndex], 0,
+      nullptr);
   vkCmdDraw(commandBuffer, 6, 1, 0, 0);
   vkCmdEndRenderPass(commandBuffer);
+  gpuProfiler.endPass(commandBuffer, currentFrame, streamIndex, 2);
 
   // --- Pass 3: SNR ---
   VkRenderPassBeginInfo snrRenderPassInfo{};
   snrRenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
   snrRenderPassInfo.renderPass = snrRenderPass;
-  snrRenderPassInfo.framebuffer = snrFramebuffers[1 - tnrHistoryIndex];
+  snrRenderPassInfo.framebuffer = stream.snrFramebuffers[1 - tnrHistoryIndex];
   snrRenderPassInfo.renderArea.offset = {0, 0};
-  snrRenderPassInfo.renderArea.extent = {RM_WIDTH, RM_HEIGHT};
+  snrRenderPassInfo.renderArea.extent = {rmWidth, rmHeight};
 
   snrRenderPassInfo.clearValueCount = 1;
   snrRenderPassInfo.pClearValues = &clearColor;
 
+  gpuProfiler.beginPass(commandBuffer, currentFrame, streamIndex, 3);
   vkCmdBeginRenderPass(commandBuffer, &snrRenderPassInfo,
                        VK_SUBPASS_CONTENTS_INLINE);
   vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -1792,21 +2554,22 @@ void VulkanRenderer::recordCommandBuffer(VkCommandBuffer commandBuffer,
   vkCmdSetViewport(commandBuffer, 0, 1, &rmViewport);
   vkCmdSetScissor(commandBuffer, 0, 1, &rmScissor);
 
-  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                          snrPipelineLayout, 0, 1,
-                          &snrDescriptorSets[currentFrame], 0, nullptr);
+  vkCmdBindDescriptorSets(
+      commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, snrPipelineLayout, 0, 1,
+      &stream.frameSets[currentFrame].snr[tnrHistoryIndex], 0, nullptr);
   vkCmdDraw(commandBuffer, 6, 1, 0, 0);
   vkCmdEndRenderPass(commandBuffer);
+  gpuProfiler.endPass(commandBuffer, currentFrame, streamIndex, 3);
 
   // --- Pass 3.5: SNR2 ---
   VkDescriptorImageInfo snrOutInfo{};
   snrOutInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-  snrOutInfo.imageView = snrImageViews[1 - tnrHistoryIndex];
+  snrOutInfo.imageView = stream.snrImageViews[1 - tnrHistoryIndex];
   snrOutInfo.sampler = offscreenSampler;
 
   VkWriteDescriptorSet snr2Write{};
   snr2Write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-  snr2Write.dstSet = snr2DescriptorSets[currentFrame];
+  snr2Write.dstSet = stream.frameSets[currentFrame].snr2;
   snr2Write.dstBinding = 0;
   snr2Write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
   snr2Write.descriptorCount = 1;
@@ -1816,13 +2579,14 @@ void VulkanRenderer::recordCommandBuffer(VkCommandBuffer commandBuffer,
   VkRenderPassBeginInfo snr2RenderPassInfo{};
   snr2RenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
   snr2RenderPassInfo.renderPass = snr2RenderPass;
-  snr2RenderPassInfo.framebuffer = snr2Framebuffers[1 - tnrHistoryIndex];
+  snr2RenderPassInfo.framebuffer = stream.snr2Framebuffers[1 - tnrHistoryIndex];
   snr2RenderPassInfo.renderArea.offset = {0, 0};
-  snr2RenderPassInfo.renderArea.extent = {RM_WIDTH, RM_HEIGHT};
+  snr2RenderPassInfo.renderArea.extent = {rmWidth, rmHeight};
 
   snr2RenderPassInfo.clearValueCount = 1;
   snr2RenderPassInfo.pClearValues = &clearColor;
 
+  gpuProfiler.beginPass(commandBuffer, currentFrame, streamIndex, 4);
   vkCmdBeginRenderPass(commandBuffer, &snr2RenderPassInfo,
                        VK_SUBPASS_CONTENTS_INLINE);
   vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -1833,20 +2597,22 @@ void VulkanRenderer::recordCommandBuffer(VkCommandBuffer commandBuffer,
 
   vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
                           snr2PipelineLayout, 0, 1,
-                          &snr2DescriptorSets[currentFrame], 0, nullptr);
+                          &stream.frameSets[currentFrame].snr2, 0, nullptr);
   vkCmdDraw(commandBuffer, 6, 1, 0, 0);
   vkCmdEndRenderPass(commandBuffer);
+  gpuProfiler.endPass(commandBuffer, currentFrame, streamIndex, 4);
 
   // --- Pass 3.6: Compute Fresnel ---
   VkRenderPassBeginInfo fresnelPassInfo{};
   fresnelPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
   fresnelPassInfo.renderPass = computeFresnelRenderPass;
-  fresnelPassInfo.framebuffer = computeFresnelFramebuffer;
+  fresnelPassInfo.framebuffer = stream.computeFresnelFramebuffer;
   fresnelPassInfo.renderArea.offset = {0, 0};
-  fresnelPassInfo.renderArea.extent = {WIDTH, HEIGHT};
+  fresnelPassInfo.renderArea.extent = {frameWidth, frameHeight};
   fresnelPassInfo.clearValueCount = 1;
   fresnelPassInfo.pClearValues = &clearColor;
 
+  gpuProfiler.beginPass(commandBuffer, currentFrame, streamIndex, 5);
   vkCmdBeginRenderPass(commandBuffer, &fresnelPassInfo,
                        VK_SUBPASS_CONTENTS_INLINE);
   vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -1855,23 +2621,24 @@ void VulkanRenderer::recordCommandBuffer(VkCommandBuffer commandBuffer,
   VkViewport fullViewport{};
   fullViewport.x = 0.0f;
   fullViewport.y = 0.0f;
-  fullViewport.width = (float)WIDTH;
-  fullViewport.height = (float)HEIGHT;
+  fullViewport.width = (float)frameWidth;
+  fullViewport.height = (float)frameHeight;
   fullViewport.minDepth = 0.0f;
   fullViewport.maxDepth = 1.0f;
 
   VkRect2D fullScissor{};
   fullScissor.offset = {0, 0};
-  fullScissor.extent = {WIDTH, HEIGHT};
+  fullScissor.extent = {frameWidth, frameHeight};
 
   vkCmdSetViewport(commandBuffer, 0, 1, &fullViewport);
   vkCmdSetScissor(commandBuffer, 0, 1, &fullScissor);
   vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
                           computeFresnelPipelineLayout, 0, 1,
-                          &computeFresnelDescriptorSets[currentFrame], 0,
+                          &stream.frameSets[currentFrame].computeFresnel, 0,
                           nullptr);
   vkCmdDraw(commandBuffer, 6, 1, 0, 0);
   vkCmdEndRenderPass(commandBuffer);
+  gpuProfiler.endPass(commandBuffer, currentFrame, streamIndex, 5);
 
   // Barrier to ensure Fresnel and SNR2 outputs are ready for TNR2
   VkImageMemoryBarrier barriers[2]{};
@@ -1882,7 +2649,7 @@ void VulkanRenderer::recordCommandBuffer(VkCommandBuffer commandBuffer,
   barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
   barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
   barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barriers[0].image = fresnelImage;
+  barriers[0].image = stream.fresnelImage;
   barriers[0].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
 
   barriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -1892,7 +2659,7 @@ void VulkanRenderer::recordCommandBuffer(VkCommandBuffer commandBuffer,
   barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
   barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
   barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barriers[1].image = snr2Images[1 - tnrHistoryIndex];
+  barriers[1].image = stream.snr2Images[1 - tnrHistoryIndex];
   barriers[1].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
 
   vkCmdPipelineBarrier(commandBuffer,
@@ -1904,13 +2671,14 @@ void VulkanRenderer::recordCommandBuffer(VkCommandBuffer commandBuffer,
   VkRenderPassBeginInfo tnr2RenderPassInfo{};
   tnr2RenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
   tnr2RenderPassInfo.renderPass = tnr2RenderPass;
-  tnr2RenderPassInfo.framebuffer = tnr2Framebuffers[1 - tnrHistoryIndex];
+  tnr2RenderPassInfo.framebuffer = stream.tnr2Framebuffers[1 - tnrHistoryIndex];
   tnr2RenderPassInfo.renderArea.offset = {0, 0};
-  tnr2RenderPassInfo.renderArea.extent = {WIDTH, HEIGHT};
+  tnr2RenderPassInfo.renderArea.extent = {frameWidth, frameHeight};
   tnr2RenderPassInfo.clearValueCount = 1; // Color
   VkClearValue tnr2ClearValues[1] = {clearColor};
   tnr2RenderPassInfo.pClearValues = tnr2ClearValues;
 
+  gpuProfiler.beginPass(commandBuffer, currentFrame, streamIndex, 6);
   vkCmdBeginRenderPass(commandBuffer, &tnr2RenderPassInfo,
                        VK_SUBPASS_CONTENTS_INLINE);
   vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -1919,21 +2687,24 @@ void VulkanRenderer::recordCommandBuffer(VkCommandBuffer commandBuffer,
   vkCmdSetScissor(commandBuffer, 0, 1, &fullScissor);
   vkCmdBindDescriptorSets(
       commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, tnr2PipelineLayout, 0, 1,
-      &tnr2DescriptorSets[currentFrame * 2 + tnrHistoryIndex], 0, nullptr);
+      &stream.frameSets[currentFrame].tnr2[tnrHistoryIndex], 0,
+      nullptr);
   vkCmdDraw(commandBuffer, 6, 1, 0, 0);
   vkCmdEndRenderPass(commandBuffer);
+  gpuProfiler.endPass(commandBuffer, currentFrame, streamIndex, 6);
 
   // --- Pass 4: Final Upscale ---
   VkRenderPassBeginInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
   renderPassInfo.renderPass = renderPass;
-  renderPassInfo.framebuffer = swapchainFramebuffers[imageIndex];
+  renderPassInfo.framebuffer = finalFramebuffer;
   renderPassInfo.renderArea.offset = {0, 0};
   renderPassInfo.renderArea.extent = swapchainExtent;
 
   renderPassInfo.clearValueCount = 1;
   renderPassInfo.pClearValues = &clearColor;
 
+  gpuProfiler.beginPass(commandBuffer, currentFrame, streamIndex, 7);
   vkCmdBeginRenderPass(commandBuffer, &renderPassInfo,
                        VK_SUBPASS_CONTENTS_INLINE);
   vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -1956,25 +2727,26 @@ void VulkanRenderer::recordCommandBuffer(VkCommandBuffer commandBuffer,
   // Update final descriptor set to read from the TNR2 output
   VkDescriptorImageInfo resultInfo{};
   resultInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-  resultInfo.imageView = tnr2ImageViews[1 - tnrHistoryIndex]; // TNR2_out0
+  resultInfo.imageView =
+      stream.tnr2ImageViews[1 - tnrHistoryIndex]; // TNR2_out0
   // resultInfo.imageView = fresnelImageView; // TNR2_out0
   resultInfo.sampler = offscreenSampler;
 
   VkDescriptorImageInfo colorInfo{};
   colorInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-  colorInfo.imageView = textureImageView; // Original Color
+  colorInfo.imageView = stream.textureImageView; // Original Color
   colorInfo.sampler = textureSampler;
 
   VkWriteDescriptorSet finalWrites[2]{};
   finalWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-  finalWrites[0].dstSet = finalDescriptorSets[currentFrame];
+  finalWrites[0].dstSet = stream.frameSets[currentFrame].final;
   finalWrites[0].dstBinding = 0;
   finalWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
   finalWrites[0].descriptorCount = 1;
   finalWrites[0].pImageInfo = &resultInfo;
 
   finalWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-  finalWrites[1].dstSet = finalDescriptorSets[currentFrame];
+  finalWrites[1].dstSet = stream.frameSets[currentFrame].final;
   finalWrites[1].dstBinding = 1;
   finalWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
   finalWrites[1].descriptorCount = 1;
@@ -1985,77 +2757,48 @@ void VulkanRenderer::recordCommandBuffer(VkCommandBuffer commandBuffer,
 
   vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
                           finalPipelineLayout, 0, 1,
-                          &finalDescriptorSets[currentFrame], 0, nullptr);
+                          &stream.frameSets[currentFrame].final, 0,
+                          nullptr);
   vkCmdDraw(commandBuffer, 6, 1, 0, 0);
   vkCmdEndRenderPass(commandBuffer);
-
-  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
-    throw std::runtime_error("failed to record command buffer!");
-  }
+  gpuProfiler.endPass(commandBuffer, currentFrame, streamIndex, 7);
 }
 
-void VulkanRenderer::updateTexture() {
-  frameDelayCounter++;
-  if (frameDelayCounter < frameDelay) {
-    return;
+// Loads the stream's next input frame into its staging buffers.
+// Loads the stream's next input frame into inputs, its five buffers of an
+// upload slot.
+void VulkanRenderer::updateTexture(StreamResources &stream,
+                                   MemoryAllocation *inputs) {
+  TRACE_SCOPE("updateTexture");
+  BottleneckClassifier::Scope phase(bottleneck, BottleneckClassifier::Load);
+  static const std::string *prefixes[INPUT_CHANNELS] = {
+      &COLOR_FILE_PREFIX, &DEPTH_FILE_PREFIX, &NORMAL_FILE_PREFIX,
+      &ALBEDO_FILE_PREFIX, &MV_FILE_PREFIX};
+
+  // Upload slots are persistently mapped, so we can load straight into
+  // them. A missing frame wraps back to frame 0, unless this is frame 0.
+  for (int c = 0; c < INPUT_CHANNELS; c++) {
+    std::string fallbackPrefix;
+    if (stream.currentFrameIndex > 0) {
+      fallbackPrefix = stream.sequence.pathPrefix(*prefixes[c]);
+    }
+    loadRawImage(
+        stream.sequence.framePath(*prefixes[c], stream.currentFrameIndex),
+        inputs[c].mapped, fallbackPrefix);
   }
-  frameDelayCounter = 0;
-
-  // Generate filenames
-  std::ostringstream oss, doss, noss;
-  oss << COLOR_PATH_PREFIX << std::setw(4) << std::setfill('0')
-      << currentFrameIndex << FILE_EXTENSION;
-  doss << DEPTH_PATH_PREFIX << std::setw(4) << std::setfill('0')
-       << currentFrameIndex << FILE_EXTENSION;
-  noss << NORMAL_PATH_PREFIX << std::setw(4) << std::setfill('0')
-       << currentFrameIndex << FILE_EXTENSION;
-
-  std::ostringstream aoss;
-  aoss << ALBEDO_PATH_PREFIX << std::setw(4) << std::setfill('0')
-       << currentFrameIndex << FILE_EXTENSION;
-
-  void *data;
-  vkMapMemory(device, stagingBufferMemory, 0, WIDTH * HEIGHT * 4, 0, &data);
-  loadRawImage(oss.str(), data, COLOR_PATH_PREFIX);
-  vkUnmapMemory(device, stagingBufferMemory);
-
-  void *ddata;
-  vkMapMemory(device, depthStagingBufferMemory, 0, WIDTH * HEIGHT * 4, 0,
-              &ddata);
-  loadRawImage(doss.str(), ddata, DEPTH_PATH_PREFIX);
-  vkUnmapMemory(device, depthStagingBufferMemory);
-
-  void *ndata;
-  vkMapMemory(device, normalStagingBufferMemory, 0, WIDTH * HEIGHT * 4, 0,
-              &ndata);
-  loadRawImage(noss.str(), ndata, NORMAL_PATH_PREFIX);
-  vkUnmapMemory(device, normalStagingBufferMemory);
-
-  void *adata;
-  vkMapMemory(device, albedoStagingBufferMemory, 0, WIDTH * HEIGHT * 4, 0,
-              &adata);
-  loadRawImage(aoss.str(), adata, ALBEDO_PATH_PREFIX);
-  vkUnmapMemory(device, albedoStagingBufferMemory);
-
-  std::ostringstream mvoss;
-  mvoss << MV_PATH_PREFIX << std::setw(4) << std::setfill('0')
-        << currentFrameIndex << FILE_EXTENSION;
-  void *mvdata;
-  vkMapMemory(device, mvStagingBufferMemory, 0, WIDTH * HEIGHT * 4, 0, &mvdata);
-  loadRawImage(mvoss.str(), mvdata, MV_PATH_PREFIX);
-  vkUnmapMemory(device, mvStagingBufferMemory);
-
-  currentFrameIndex++;
-  if (currentFrameIndex >= 148) {
-    currentFrameIndex = 0;
+
+  stream.currentFrameIndex++;
+  if (stream.currentFrameIndex >= stream.sequence.frameCount) {
+    stream.currentFrameIndex = 0;
   }
 }
 
 void VulkanRenderer::loadRawImage(const std::string &filename, void *pixels,
                                   const std::string &fallbackPrefix) {
+  TRACE_SCOPE("loadRawImage");
   std::ifstream file(filename, std::ios::ate | std::ios::binary);
 
-  size_t expectedSize = WIDTH * HEIGHT * 4;
+  size_t expectedSize = (size_t)frameWidth * frameHeight * 4;
 
   if (!file.is_open()) {
     // Try fallback if running from build directory
@@ -2067,7 +2810,7 @@ void VulkanRenderer::loadRawImage(const std::string &filename, void *pixels,
               << ". Check if working directory is correct." << std::endl;
 
     // Check if we should loop back to 0 using the provided prefix
-    if (!fallbackPrefix.empty() && currentFrameIndex > 0) {
+    if (!fallbackPrefix.empty()) {
       std::ostringstream oss;
       oss << fallbackPrefix << std::setw(4) << std::setfill('0') << 0
           << FILE_EXTENSION;
@@ -2096,7 +2839,7 @@ void VulkanRenderer::loadRawImage(const std::string &filename, void *pixels,
     if (fileSize != expectedSize) {
       std::cerr << "Warning: Incorrect file size for " << filename << std::endl;
       uint32_t *pDiv = (uint32_t *)pixels;
-      for (size_t i = 0; i < WIDTH * HEIGHT; i++) {
+      for (size_t i = 0; i < frameWidth * frameHeight; i++) {
         pDiv[i] = 0xFF00FF00; // Green warning
       }
       file.close();
@@ -2110,16 +2853,7 @@ void VulkanRenderer::loadRawImage(const std::string &filename, void *pixels,
 
 post_load_flip:
   // Flip vertically in-place
-  size_t rowSize = WIDTH * 4;
-  std::vector<char> rowBuffer(rowSize);
-  char *data = (char *)pixels;
-  for (size_t y = 0; y < HEIGHT / 2; y++) {
-    char *rowTop = data + (y * rowSize);
-    char *rowBottom = data + ((HEIGHT - 1 - y) * rowSize);
-    std::memcpy(rowBuffer.data(), rowTop, rowSize);
-    std::memcpy(rowTop, rowBottom, rowSize);
-    std::memcpy(rowBottom, rowBuffer.data(), rowSize);
-  }
+  flipRows(pixels, (size_t)frameWidth * 4, frameHeight);
 }
 
 // Helpers
@@ -2146,12 +2880,15 @@ bool VulkanRenderer::checkValidationLayerSupport() {
 }
 
 std::vector<const char *> VulkanRenderer::getRequiredExtensions() {
-  uint32_t glfwExtensionCount = 0;
-  const char **glfwExtensions;
-  glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-  std::vector<const char *> extensions(glfwExtensions,
-                                       glfwExtensions + glfwExtensionCount);
+  std::vector<const char *> extensions;
+
+  // Surface extensions are only needed when we have a window.
+  if (!config.headless) {
+    uint32_t glfwExtensionCount = 0;
+    const char **glfwExtensions;
+    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  }
 
   if (enableValidationLayers) {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -2174,6 +2911,12 @@ std::vector<const char *> VulkanRenderer::getRequiredExtensions() {
       extensions.push_back(
           VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
     }
+    // Instance half of external memory, for host memory import
+    if (strcmp(extension.extensionName,
+               VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME) == 0) {
+      extensions.push_back(VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME);
+      externalMemoryCapabilities = true;
+    }
   }
 
   return extensions;
@@ -2212,21 +2955,10 @@ VKAPI_ATTR VkBool32 VKAPI_CALL VulkanRenderer::debugCallback(
 // Boilerplate Helpers
 // Helper: Find Memory Type.
 // Vulkan requires us to manually find the right type of memory on the GPU
-// (e.g., VRAM vs System RAM).
+// (e.g., VRAM vs System RAM). The allocator caches the memory properties.
 uint32_t VulkanRenderer::findMemoryType(uint32_t typeFilter,
                                         VkMemoryPropertyFlags properties) {
-  VkPhysicalDeviceMemoryProperties memProperties;
-  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-  for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-    // Check if the bitmask asks for this type AND if it has the required
-    // properties (like being Host Visible)
-    if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags &
-                                    properties) == properties) {
-      return i;
-    }
-  }
-  throw std::runtime_error("failed to find suitable memory type!");
+  return memoryAllocator.findMemoryType(typeFilter, properties);
 }
 
 // Helper: Create Buffer.
@@ -2234,7 +2966,8 @@ uint32_t VulkanRenderer::findMemoryType(uint32_t typeFilter,
 void VulkanRenderer::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
                                   VkMemoryPropertyFlags properties,
                                   VkBuffer &buffer,
-                                  VkDeviceMemory &bufferMemory) {
+                                  MemoryAllocation &bufferMemory,
+                                  const MemoryTag &tag) {
   VkBufferCreateInfo bufferInfo{};
   bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   bufferInfo.size = size;
@@ -2250,19 +2983,14 @@ void VulkanRenderer::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
   VkMemoryRequirements memRequirements;
   vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex =
-      findMemoryType(memRequirements.memoryTypeBits, properties);
+  // Carve the memory out of a shared block. Host-visible memory comes back
+  // persistently mapped (bufferMemory.mapped).
+  bufferMemory = memoryAllocator.allocate(memRequirements, properties, true);
+  memoryLedger.record(tag, bufferMemory,
+                      properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
 
-  // Allocate the actual memory
-  if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) !=
-      VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate buffer memory!");
-  }
   // Bind the memory to the buffer handle
-  vkBindBufferMemory(device, buffer, bufferMemory, 0);
+  vkBindBufferMemory(device, buffer, bufferMemory.memory, bufferMemory.offset);
 }
 
 // Helper: Create Image.
@@ -2271,7 +2999,9 @@ void VulkanRenderer::createImage(uint32_t width, uint32_t height,
                                  VkFormat format, VkImageTiling tiling,
                                  VkImageUsageFlags usage,
                                  VkMemoryPropertyFlags properties,
-                                 VkImage &image, VkDeviceMemory &imageMemory) {
+                                 VkImage &image,
+                                 MemoryAllocation &imageMemory,
+                                 const MemoryTag &tag) {
   VkImageCreateInfo imageInfo{};
   imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
   imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -2294,18 +3024,20 @@ void VulkanRenderer::createImage(uint32_t width, uint32_t height,
   VkMemoryRequirements memRequirements;
   vkGetImageMemoryRequirements(device, image, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex =
-      findMemoryType(memRequirements.memoryTypeBits, properties);
+  imageMemory = memoryAllocator.allocate(memRequirements, properties,
+                                         tiling == VK_IMAGE_TILING_LINEAR);
 
-  if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) !=
-      VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate image memory!");
-  }
+  memoryLedger.record(tag, imageMemory,
+                      properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+
+  vkBindImageMemory(device, image, imageMemory.memory, imageMemory.offset);
+}
 
-  vkBindImageMemory(device, image, imageMemory, 0);
+// Helper: Free Memory.
+// Returns a sub-allocation to the allocator and drops it from the ledger.
+void VulkanRenderer::freeMemory(MemoryAllocation &allocation) {
+  memoryLedger.release(allocation);
+  memoryAllocator.free(allocation);
 }
 
 // Helper: Create Image View.
@@ -2337,6 +3069,7 @@ VkImageView VulkanRenderer::createImageView(VkImage image, VkFormat format) {
 void VulkanRenderer::transitionImageLayout(VkImage image, VkFormat format,
                                            VkImageLayout oldLayout,
                                            VkImageLayout newLayout) {
+  TRACE_SCOPE("transitionImageLayout");
   // Allocation of a temporary command buffer for the barrier command
   VkCommandBufferAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -2421,6 +3154,7 @@ void VulkanRenderer::transitionImageLayout(VkImage image, VkFormat format,
 // Copies data from a CPU-visible buffer (staging) to a GPU image.
 void VulkanRenderer::copyBufferToImage(VkBuffer buffer, VkImage image,
                                        uint32_t width, uint32_t height) {
+  TRACE_SCOPE("copyBufferToImage");
   VkCommandBufferAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
   allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -2463,6 +3197,71 @@ void VulkanRenderer::copyBufferToImage(VkBuffer buffer, VkImage image,
   vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
 }
 
+// Helper: Clear a history image to zero and leave it ready for sampling.
+// TNR and SNR read last frame's result before anything was written, so
+// history starts as black instead of whatever the memory held. That makes
+// the first frames deterministic, as the CPU reference assumes.
+void VulkanRenderer::clearHistoryImage(VkImage image) {
+  TRACE_SCOPE("clearHistoryImage");
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandPool = commandPool;
+  allocInfo.commandBufferCount = 1;
+
+  VkCommandBuffer commandBuffer;
+  vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+  vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &barrier);
+
+  VkClearColorValue black{};
+  vkCmdClearColorImage(commandBuffer, image,
+                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &black, 1,
+                       &barrier.subresourceRange);
+
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &barrier);
+
+  vkEndCommandBuffer(commandBuffer);
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &commandBuffer;
+
+  vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+  vkQueueWaitIdle(graphicsQueue);
+
+  vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+}
+
 // Helper: Create Shader Module.
 // Wraps the SPIR-V bytecode into a Vulkan Shader Module object.
 VkShaderModule
@@ -2481,27 +3280,31 @@ VulkanRenderer::createShaderModule(const std::vector<char> &code) {
   return shaderModule;
 }
 
-void VulkanRenderer::createNormalTextureImage() {
-  VkDeviceSize imageSize = WIDTH * HEIGHT * 4;
+void VulkanRenderer::createNormalTextureImage(StreamResources &stream) {
+  VkDeviceSize imageSize = stream.sequence.frameBytes();
   createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-               normalStagingBuffer, normalStagingBufferMemory);
-  createImage(WIDTH, HEIGHT, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
+               stream.normalStagingBuffer, stream.normalStagingBufferMemory,
+               {"Input", stream.tagPrefix + "normalStaging",
+                MemoryCategory::Staging});
+  createImage(frameWidth, frameHeight, VK_FORMAT_R8G8B8A8_UNORM,
+              VK_IMAGE_TILING_OPTIMAL,
               VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, normalTextureImage,
-              normalTextureImageMemory);
-  transitionImageLayout(normalTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, stream.normalTextureImage,
+              stream.normalTextureImageMemory,
+              {"Input", stream.tagPrefix + "normal", MemoryCategory::Input});
+  transitionImageLayout(stream.normalTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
                         VK_IMAGE_LAYOUT_UNDEFINED,
                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  transitionImageLayout(normalTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
+  transitionImageLayout(stream.normalTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 }
 
-void VulkanRenderer::createNormalTextureImageView() {
-  normalTextureImageView =
-      createImageView(normalTextureImage, VK_FORMAT_R8G8B8A8_UNORM);
+void VulkanRenderer::createNormalTextureImageView(StreamResources &stream) {
+  stream.normalTextureImageView =
+      createImageView(stream.normalTextureImage, VK_FORMAT_R8G8B8A8_UNORM);
 }
 
 void VulkanRenderer::createNormalTextureSampler() {
@@ -2525,15 +3328,18 @@ void VulkanRenderer::createNormalTextureSampler() {
   }
 }
 
-void VulkanRenderer::createDepthDSResources() {
-  createImage(RM_WIDTH, RM_HEIGHT, VK_FORMAT_R16G16B16A16_SFLOAT,
+void VulkanRenderer::createDepthDSResources(StreamResources &stream) {
+  createImage(rmWidth, rmHeight, VK_FORMAT_R16G16B16A16_SFLOAT,
               VK_IMAGE_TILING_OPTIMAL,
-              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthDSImage,
-              depthDSImageMemory);
-  depthDSImageView =
-      createImageView(depthDSImage, VK_FORMAT_R16G16B16A16_SFLOAT);
-  transitionImageLayout(depthDSImage, VK_FORMAT_R16G16B16A16_SFLOAT,
+              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                  VK_IMAGE_USAGE_TRANSFER_SRC_BIT, // Reference check
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, stream.depthDSImage,
+              stream.depthDSImageMemory,
+              {"DepthDS", stream.tagPrefix + "depthDS",
+               MemoryCategory::Transient});
+  stream.depthDSImageView =
+      createImageView(stream.depthDSImage, VK_FORMAT_R16G16B16A16_SFLOAT);
+  transitionImageLayout(stream.depthDSImage, VK_FORMAT_R16G16B16A16_SFLOAT,
                         VK_IMAGE_LAYOUT_UNDEFINED,
                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
@@ -2542,38 +3348,42 @@ void VulkanRenderer::createDepthDSResources() {
   framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
   framebufferInfo.renderPass = depthDSRenderPass;
   framebufferInfo.attachmentCount = 1;
-  framebufferInfo.pAttachments = &depthDSImageView;
-  framebufferInfo.width = RM_WIDTH;
-  framebufferInfo.height = RM_HEIGHT;
+  framebufferInfo.pAttachments = &stream.depthDSImageView;
+  framebufferInfo.width = rmWidth;
+  framebufferInfo.height = rmHeight;
   framebufferInfo.layers = 1;
 
   if (vkCreateFramebuffer(device, &framebufferInfo, nullptr,
-                          &depthDSFramebuffer) != VK_SUCCESS) {
+                          &stream.depthDSFramebuffer) != VK_SUCCESS) {
     throw std::runtime_error("failed to create depthDS framebuffer!");
   }
 }
 
-void VulkanRenderer::createMVTextureImage() {
-  VkDeviceSize imageSize = WIDTH * HEIGHT * 4;
+void VulkanRenderer::createMVTextureImage(StreamResources &stream) {
+  VkDeviceSize imageSize = stream.sequence.frameBytes();
   createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-               mvStagingBuffer, mvStagingBufferMemory);
-  createImage(WIDTH, HEIGHT, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
+               stream.mvStagingBuffer, stream.mvStagingBufferMemory,
+               {"Input", stream.tagPrefix + "mvStaging",
+                MemoryCategory::Staging});
+  createImage(frameWidth, frameHeight, VK_FORMAT_R8G8B8A8_UNORM,
+              VK_IMAGE_TILING_OPTIMAL,
               VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mvTextureImage,
-              mvTextureImageMemory);
-  transitionImageLayout(mvTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, stream.mvTextureImage,
+              stream.mvTextureImageMemory,
+              {"Input", stream.tagPrefix + "mv", MemoryCategory::Input});
+  transitionImageLayout(stream.mvTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
                         VK_IMAGE_LAYOUT_UNDEFINED,
                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  transitionImageLayout(mvTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
+  transitionImageLayout(stream.mvTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 }
 
-void VulkanRenderer::createMVTextureImageView() {
-  mvTextureImageView =
-      createImageView(mvTextureImage, VK_FORMAT_R8G8B8A8_UNORM);
+void VulkanRenderer::createMVTextureImageView(StreamResources &stream) {
+  stream.mvTextureImageView =
+      createImageView(stream.mvTextureImage, VK_FORMAT_R8G8B8A8_UNORM);
 }
 
 void VulkanRenderer::createMVTextureSampler() {
@@ -2597,27 +3407,31 @@ void VulkanRenderer::createMVTextureSampler() {
   }
 }
 
-void VulkanRenderer::createAlbedoTextureImage() {
-  VkDeviceSize imageSize = WIDTH * HEIGHT * 4;
+void VulkanRenderer::createAlbedoTextureImage(StreamResources &stream) {
+  VkDeviceSize imageSize = stream.sequence.frameBytes();
   createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-               albedoStagingBuffer, albedoStagingBufferMemory);
-  createImage(WIDTH, HEIGHT, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
+               stream.albedoStagingBuffer, stream.albedoStagingBufferMemory,
+               {"Input", stream.tagPrefix + "albedoStaging",
+                MemoryCategory::Staging});
+  createImage(frameWidth, frameHeight, VK_FORMAT_R8G8B8A8_UNORM,
+              VK_IMAGE_TILING_OPTIMAL,
               VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, albedoTextureImage,
-              albedoTextureImageMemory);
-  transitionImageLayout(albedoTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, stream.albedoTextureImage,
+              stream.albedoTextureImageMemory,
+              {"Input", stream.tagPrefix + "albedo", MemoryCategory::Input});
+  transitionImageLayout(stream.albedoTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
                         VK_IMAGE_LAYOUT_UNDEFINED,
                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  transitionImageLayout(albedoTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
+  transitionImageLayout(stream.albedoTextureImage, VK_FORMAT_R8G8B8A8_UNORM,
                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 }
 
-void VulkanRenderer::createAlbedoTextureImageView() {
-  albedoTextureImageView =
-      createImageView(albedoTextureImage, VK_FORMAT_R8G8B8A8_UNORM);
+void VulkanRenderer::createAlbedoTextureImageView(StreamResources &stream) {
+  stream.albedoTextureImageView =
+      createImageView(stream.albedoTextureImage, VK_FORMAT_R8G8B8A8_UNORM);
 }
 
 void VulkanRenderer::createAlbedoTextureSampler() {
@@ -2642,30 +3456,6 @@ void VulkanRenderer::createAlbedoTextureSampler() {
 }
 
 void VulkanRenderer::createTNRResources() {
-  // Intermediate output image
-  createImage(RM_WIDTH, RM_HEIGHT, VK_FORMAT_R16G16B16A16_SFLOAT,
-              VK_IMAGE_TILING_OPTIMAL,
-              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, tnrIntermediateColorImage,
-              tnrIntermediateColorImageMemory);
-  tnrIntermediateColorImageView =
-      createImageView(tnrIntermediateColorImage, VK_FORMAT_R16G16B16A16_SFLOAT);
-  transitionImageLayout(
-      tnrIntermediateColorImage, VK_FORMAT_R16G16B16A16_SFLOAT,
-      VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-  // Out2 Image
-  createImage(RM_WIDTH, RM_HEIGHT, VK_FORMAT_R16G16B16A16_SFLOAT,
-              VK_IMAGE_TILING_OPTIMAL,
-              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, tnrOut2Image,
-              tnrOut2ImageMemory);
-  tnrOut2ImageView =
-      createImageView(tnrOut2Image, VK_FORMAT_R16G16B16A16_SFLOAT);
-  transitionImageLayout(tnrOut2Image, VK_FORMAT_R16G16B16A16_SFLOAT,
-                        VK_IMAGE_LAYOUT_UNDEFINED,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
   // 1. Render Pass
   VkAttachmentDescription colorAttachment{};
   colorAttachment.format = VK_FORMAT_R16G16B16A16_SFLOAT;
@@ -2725,38 +3515,7 @@ void VulkanRenderer::createTNRResources() {
     throw std::runtime_error("failed to create TNR render pass!");
   }
 
-  // 2. Info Images (Double buffered for flip)
-  for (int i = 0; i < 2; i++) {
-    createImage(RM_WIDTH, RM_HEIGHT, VK_FORMAT_R16G16B16A16_SFLOAT,
-                VK_IMAGE_TILING_OPTIMAL,
-                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
-                    VK_IMAGE_USAGE_SAMPLED_BIT,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, tnrInfoImages[i],
-                tnrInfoImageMemories[i]);
-    tnrInfoImageViews[i] =
-        createImageView(tnrInfoImages[i], VK_FORMAT_R16G16B16A16_SFLOAT);
-    transitionImageLayout(tnrInfoImages[i], VK_FORMAT_R16G16B16A16_SFLOAT,
-                          VK_IMAGE_LAYOUT_UNDEFINED,
-                          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-    VkImageView attachmentsFB[] = {tnrIntermediateColorImageView,
-                                   tnrInfoImageViews[i], tnrOut2ImageView};
-    VkFramebufferCreateInfo framebufferInfo{};
-    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    framebufferInfo.renderPass = tnrRenderPass;
-    framebufferInfo.attachmentCount = 3;
-    framebufferInfo.pAttachments = attachmentsFB;
-    framebufferInfo.width = RM_WIDTH;
-    framebufferInfo.height = RM_HEIGHT;
-    framebufferInfo.layers = 1;
-
-    if (vkCreateFramebuffer(device, &framebufferInfo, nullptr,
-                            &tnrFramebuffers[i]) != VK_SUCCESS) {
-      throw std::runtime_error("failed to create TNR framebuffer!");
-    }
-  }
-
-  // 3. Descriptor Set Layout
+  // 2. Descriptor Set Layout
   VkDescriptorSetLayoutBinding bindings[6]{};
   for (int i = 0; i < 6; i++) {
     bindings[i].binding = i;
@@ -2775,65 +3534,7 @@ void VulkanRenderer::createTNRResources() {
     throw std::runtime_error("failed to create TNR descriptor set layout!");
   }
 
-  // 4. Pipeline
-  auto tnrFragCode = readFile(std::string(SHADER_DIR) + "/TNR.frag.spv");
-  VkShaderModule tnrFragModule = createShaderModule(tnrFragCode);
-
-  auto vertShaderCode = readFile(std::string(SHADER_DIR) + "/shader.vert.spv");
-  VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-
-  VkPipelineShaderStageCreateInfo stages[2]{};
-  stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-  stages[0].module = vertShaderModule;
-  stages[0].pName = "main";
-  stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-  stages[1].module = tnrFragModule;
-  stages[1].pName = "main";
-
-  VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-  vertexInputInfo.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-  VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-  inputAssembly.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-  inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-  VkPipelineViewportStateCreateInfo viewportState{};
-  viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-  viewportState.viewportCount = 1;
-  viewportState.scissorCount = 1;
-  VkPipelineRasterizationStateCreateInfo rasterizer{};
-  rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-  rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-  rasterizer.lineWidth = 1.0f;
-  rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-  rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-  VkPipelineMultisampleStateCreateInfo multisampling{};
-  multisampling.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-  multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-
-  VkPipelineColorBlendAttachmentState blendAttachments[3]{};
-  blendAttachments[0].colorWriteMask = 0xF;
-  blendAttachments[0].blendEnable = VK_FALSE;
-  blendAttachments[1].colorWriteMask = 0xF;
-  blendAttachments[1].blendEnable = VK_FALSE;
-  blendAttachments[2].colorWriteMask = 0xF;
-  blendAttachments[2].blendEnable = VK_FALSE;
-  VkPipelineColorBlendStateCreateInfo colorBlending{};
-  colorBlending.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-  colorBlending.attachmentCount = 3;
-  colorBlending.pAttachments = blendAttachments;
-
-  VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT,
-                                    VK_DYNAMIC_STATE_SCISSOR};
-  VkPipelineDynamicStateCreateInfo dynamicState{};
-  dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-  dynamicState.dynamicStateCount = 2;
-  dynamicState.pDynamicStates = dynamicStates;
-
+  // 3. Pipeline, compiled with the others in createPipelines()
   VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   pipelineLayoutInfo.setLayoutCount = 1;
@@ -2843,29 +3544,76 @@ void VulkanRenderer::createTNRResources() {
                              &tnrPipelineLayout) != VK_SUCCESS) {
     throw std::runtime_error("failed to create TNR pipeline layout!");
   }
+  requestPipeline({"TNR", "TNR.frag.spv", tnrPipelineLayout, tnrRenderPass, 3,
+                   &tnrPipeline});
+}
+
+// Per-stream TNR targets: the intermediate and out2 images plus the
+// double-buffered info history, each with its framebuffer.
+void VulkanRenderer::createTNRImages(StreamResources &stream) {
+  // Intermediate output image
+  createImage(rmWidth, rmHeight, VK_FORMAT_R16G16B16A16_SFLOAT,
+              VK_IMAGE_TILING_OPTIMAL,
+              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                  VK_IMAGE_USAGE_TRANSFER_SRC_BIT, // Reference check
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+              stream.tnrIntermediateColorImage,
+              stream.tnrIntermediateColorImageMemory,
+              {"TNR", stream.tagPrefix + "intermediateColor",
+               MemoryCategory::Transient});
+  stream.tnrIntermediateColorImageView = createImageView(
+      stream.tnrIntermediateColorImage, VK_FORMAT_R16G16B16A16_SFLOAT);
+  transitionImageLayout(
+      stream.tnrIntermediateColorImage, VK_FORMAT_R16G16B16A16_SFLOAT,
+      VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-  VkGraphicsPipelineCreateInfo pipelineInfo{};
-  pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  pipelineInfo.stageCount = 2;
-  pipelineInfo.pStages = stages;
-  pipelineInfo.pVertexInputState = &vertexInputInfo;
-  pipelineInfo.pInputAssemblyState = &inputAssembly;
-  pipelineInfo.pViewportState = &viewportState;
-  pipelineInfo.pRasterizationState = &rasterizer;
-  pipelineInfo.pMultisampleState = &multisampling;
-  pipelineInfo.pColorBlendState = &colorBlending;
-  pipelineInfo.pDynamicState = &dynamicState;
-  pipelineInfo.layout = tnrPipelineLayout;
-  pipelineInfo.renderPass = tnrRenderPass;
-  pipelineInfo.subpass = 0;
+  // Out2 Image
+  createImage(rmWidth, rmHeight, VK_FORMAT_R16G16B16A16_SFLOAT,
+              VK_IMAGE_TILING_OPTIMAL,
+              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                  VK_IMAGE_USAGE_TRANSFER_SRC_BIT, // Reference check
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, stream.tnrOut2Image,
+              stream.tnrOut2ImageMemory,
+              {"TNR", stream.tagPrefix + "out2", MemoryCategory::Transient});
+  stream.tnrOut2ImageView =
+      createImageView(stream.tnrOut2Image, VK_FORMAT_R16G16B16A16_SFLOAT);
+  transitionImageLayout(stream.tnrOut2Image, VK_FORMAT_R16G16B16A16_SFLOAT,
+                        VK_IMAGE_LAYOUT_UNDEFINED,
+                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-  if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo,
-                                nullptr, &tnrPipeline) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create TNR graphics pipeline!");
-  }
+  // Info Images (Double buffered for flip)
+  for (int i = 0; i < 2; i++) {
+    createImage(rmWidth, rmHeight, VK_FORMAT_R16G16B16A16_SFLOAT,
+                VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                    VK_IMAGE_USAGE_SAMPLED_BIT |
+                    VK_IMAGE_USAGE_TRANSFER_SRC_BIT | // Reference check
+                    VK_IMAGE_USAGE_TRANSFER_DST_BIT,  // Cleared history
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, stream.tnrInfoImages[i],
+                stream.tnrInfoImageMemories[i],
+                {"TNR", stream.tagPrefix + "info[" + std::to_string(i) + "]",
+                 MemoryCategory::History});
+    stream.tnrInfoImageViews[i] =
+        createImageView(stream.tnrInfoImages[i], VK_FORMAT_R16G16B16A16_SFLOAT);
+    clearHistoryImage(stream.tnrInfoImages[i]);
+
+    VkImageView attachmentsFB[] = {stream.tnrIntermediateColorImageView,
+                                   stream.tnrInfoImageViews[i],
+                                   stream.tnrOut2ImageView};
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = tnrRenderPass;
+    framebufferInfo.attachmentCount = 3;
+    framebufferInfo.pAttachments = attachmentsFB;
+    framebufferInfo.width = rmWidth;
+    framebufferInfo.height = rmHeight;
+    framebufferInfo.layers = 1;
 
-  vkDestroyShaderModule(device, tnrFragModule, nullptr);
-  vkDestroyShaderModule(device, vertShaderModule, nullptr);
+    if (vkCreateFramebuffer(device, &framebufferInfo, nullptr,
+                            &stream.tnrFramebuffers[i]) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create TNR framebuffer!");
+    }
+  }
 }
 
 void VulkanRenderer::createSNRResources() {
@@ -2900,35 +3648,7 @@ void VulkanRenderer::createSNRResources() {
     throw std::runtime_error("failed to create SNR render pass!");
   }
 
-  // 2. Images (Double buffered for flip)
-  for (int i = 0; i < 2; i++) {
-    createImage(
-        RM_WIDTH, RM_HEIGHT, VK_FORMAT_R16G16B16A16_SFLOAT,
-        VK_IMAGE_TILING_OPTIMAL,
-        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, snrImages[i], snrImageMemories[i]);
-    snrImageViews[i] =
-        createImageView(snrImages[i], VK_FORMAT_R16G16B16A16_SFLOAT);
-    transitionImageLayout(snrImages[i], VK_FORMAT_R16G16B16A16_SFLOAT,
-                          VK_IMAGE_LAYOUT_UNDEFINED,
-                          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-    VkFramebufferCreateInfo framebufferInfo{};
-    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    framebufferInfo.renderPass = snrRenderPass;
-    framebufferInfo.attachmentCount = 1;
-    framebufferInfo.pAttachments = &snrImageViews[i];
-    framebufferInfo.width = RM_WIDTH;
-    framebufferInfo.height = RM_HEIGHT;
-    framebufferInfo.layers = 1;
-
-    if (vkCreateFramebuffer(device, &framebufferInfo, nullptr,
-                            &snrFramebuffers[i]) != VK_SUCCESS) {
-      throw std::runtime_error("failed to create SNR framebuffer!");
-    }
-  }
-
-  // 3. Descriptor Set Layout
+  // 2. Descriptor Set Layout
   VkDescriptorSetLayoutBinding bindings[3]{};
   for (int i = 0; i < 3; i++) {
     bindings[i].binding = i;
@@ -2947,61 +3667,7 @@ void VulkanRenderer::createSNRResources() {
     throw std::runtime_error("failed to create SNR descriptor set layout!");
   }
 
-  // 4. Pipeline
-  auto snrFragCode = readFile(std::string(SHADER_DIR) + "/SNR.frag.spv");
-  VkShaderModule snrFragModule = createShaderModule(snrFragCode);
-
-  auto vertShaderCode = readFile(std::string(SHADER_DIR) + "/shader.vert.spv");
-  VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-
-  VkPipelineShaderStageCreateInfo stages[2]{};
-  stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-  stages[0].module = vertShaderModule;
-  stages[0].pName = "main";
-  stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-  stages[1].module = snrFragModule;
-  stages[1].pName = "main";
-
-  VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-  vertexInputInfo.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-  VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-  inputAssembly.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-  inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-  VkPipelineViewportStateCreateInfo viewportState{};
-  viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-  viewportState.viewportCount = 1;
-  viewportState.scissorCount = 1;
-  VkPipelineRasterizationStateCreateInfo rasterizer{};
-  rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-  rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-  rasterizer.lineWidth = 1.0f;
-  rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-  rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-  VkPipelineMultisampleStateCreateInfo multisampling{};
-  multisampling.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-  multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-
-  VkPipelineColorBlendAttachmentState blendAttachment{};
-  blendAttachment.colorWriteMask = 0xF;
-  blendAttachment.blendEnable = VK_FALSE;
-  VkPipelineColorBlendStateCreateInfo colorBlending{};
-  colorBlending.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-  colorBlending.attachmentCount = 1;
-  colorBlending.pAttachments = &blendAttachment;
-
-  VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT,
-                                    VK_DYNAMIC_STATE_SCISSOR};
-  VkPipelineDynamicStateCreateInfo dynamicState{};
-  dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-  dynamicState.dynamicStateCount = 2;
-  dynamicState.pDynamicStates = dynamicStates;
-
+  // 3. Pipeline, compiled with the others in createPipelines()
   VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   pipelineLayoutInfo.setLayoutCount = 1;
@@ -3011,33 +3677,45 @@ void VulkanRenderer::createSNRResources() {
                              &snrPipelineLayout) != VK_SUCCESS) {
     throw std::runtime_error("failed to create SNR pipeline layout!");
   }
+  requestPipeline({"SNR", "SNR.frag.spv", snrPipelineLayout, snrRenderPass, 1,
+                   &snrPipeline});
+}
 
-  VkGraphicsPipelineCreateInfo pipelineInfo{};
-  pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  pipelineInfo.stageCount = 2;
-  pipelineInfo.pStages = stages;
-  pipelineInfo.pVertexInputState = &vertexInputInfo;
-  pipelineInfo.pInputAssemblyState = &inputAssembly;
-  pipelineInfo.pViewportState = &viewportState;
-  pipelineInfo.pRasterizationState = &rasterizer;
-  pipelineInfo.pMultisampleState = &multisampling;
-  pipelineInfo.pColorBlendState = &colorBlending;
-  pipelineInfo.pDynamicState = &dynamicState;
-  pipelineInfo.layout = snrPipelineLayout;
-  pipelineInfo.renderPass = snrRenderPass;
-  pipelineInfo.subpass = 0;
+void VulkanRenderer::createSNRImages(StreamResources &stream) {
+  // Images (Double buffered for flip)
+  for (int i = 0; i < 2; i++) {
+    createImage(
+        rmWidth, rmHeight, VK_FORMAT_R16G16B16A16_SFLOAT,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT | // Reference check
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT,  // Cleared history
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, stream.snrImages[i],
+        stream.snrImageMemories[i],
+        {"SNR", stream.tagPrefix + "snr[" + std::to_string(i) + "]",
+         MemoryCategory::History});
+    stream.snrImageViews[i] =
+        createImageView(stream.snrImages[i], VK_FORMAT_R16G16B16A16_SFLOAT);
+    clearHistoryImage(stream.snrImages[i]);
 
-  if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo,
-                                nullptr, &snrPipeline) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create SNR graphics pipeline!");
-  }
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = snrRenderPass;
+    framebufferInfo.attachmentCount = 1;
+    framebufferInfo.pAttachments = &stream.snrImageViews[i];
+    framebufferInfo.width = rmWidth;
+    framebufferInfo.height = rmHeight;
+    framebufferInfo.layers = 1;
 
-  vkDestroyShaderModule(device, snrFragModule, nullptr);
-  vkDestroyShaderModule(device, vertShaderModule, nullptr);
+    if (vkCreateFramebuffer(device, &framebufferInfo, nullptr,
+                            &stream.snrFramebuffers[i]) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create SNR framebuffer!");
+    }
+  }
 }
 
-void VulkanRenderer::createTNRDescriptorSets() {
-  uint32_t setCount = MAX_FRAMES_IN_FLIGHT * 2;
+void VulkanRenderer::createTNRDescriptorSets(StreamResources &stream) {
+  uint32_t setCount = static_cast<uint32_t>(stream.frameSets.size()) * 2;
   std::vector<VkDescriptorSetLayout> layouts(setCount, tnrDescriptorSetLayout);
   VkDescriptorSetAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
@@ -3045,29 +3723,29 @@ void VulkanRenderer::createTNRDescriptorSets() {
   allocInfo.descriptorSetCount = setCount;
   allocInfo.pSetLayouts = layouts.data();
 
-  tnrDescriptorSets.resize(setCount);
-  if (vkAllocateDescriptorSets(device, &allocInfo, tnrDescriptorSets.data()) !=
-      VK_SUCCESS) {
+  std::vector<VkDescriptorSet> tnrDescriptorSets(setCount);
+  if (vkAllocateDescriptorSets(device, &allocInfo,
+                               tnrDescriptorSets.data()) != VK_SUCCESS) {
     throw std::runtime_error("failed to allocate TNR descriptor sets!");
   }
 
   for (uint32_t i = 0; i < setCount; i++) {
     uint32_t historyIdx = i % 2; // Which history to READ from
 
-    VkDescriptorImageInfo rmInfo{offscreenSampler, offscreenImageView,
+    VkDescriptorImageInfo rmInfo{offscreenSampler, stream.offscreenImageView,
                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
-    VkDescriptorImageInfo dsInfo{depthTextureSampler, depthDSImageView,
+    VkDescriptorImageInfo dsInfo{depthTextureSampler, stream.depthDSImageView,
                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
-    VkDescriptorImageInfo mvInfo{mvTextureSampler, mvTextureImageView,
+    VkDescriptorImageInfo mvInfo{mvTextureSampler, stream.mvTextureImageView,
                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
     // History color comes from SNR output
     VkDescriptorImageInfo prevColorInfo{
-        offscreenSampler, snrImageViews[historyIdx],
+        offscreenSampler, stream.snrImageViews[historyIdx],
         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
     VkDescriptorImageInfo prevInfoInfo{
-        offscreenSampler, tnrInfoImageViews[historyIdx],
+        offscreenSampler, stream.tnrInfoImageViews[historyIdx],
         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
-    VkDescriptorImageInfo colorInfo{textureSampler, textureImageView,
+    VkDescriptorImageInfo colorInfo{textureSampler, stream.textureImageView,
                                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
 
     VkWriteDescriptorSet writes[6]{};
@@ -3087,10 +3765,14 @@ void VulkanRenderer::createTNRDescriptorSets() {
 
     vkUpdateDescriptorSets(device, 6, writes, 0, nullptr);
   }
+
+  for (uint32_t i = 0; i < setCount; i++) {
+    stream.frameSets[i / 2].tnr[i % 2] = tnrDescriptorSets[i];
+  }
 }
 
-void VulkanRenderer::createSNRDescriptorSets() {
-  uint32_t setCount = MAX_FRAMES_IN_FLIGHT;
+void VulkanRenderer::createSNRDescriptorSets(StreamResources &stream) {
+  uint32_t setCount = static_cast<uint32_t>(stream.frameSets.size()) * 2;
   std::vector<VkDescriptorSetLayout> layouts(setCount, snrDescriptorSetLayout);
   VkDescriptorSetAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
@@ -3098,24 +3780,24 @@ void VulkanRenderer::createSNRDescriptorSets() {
   allocInfo.descriptorSetCount = setCount;
   allocInfo.pSetLayouts = layouts.data();
 
-  snrDescriptorSets.resize(setCount);
-  if (vkAllocateDescriptorSets(device, &allocInfo, snrDescriptorSets.data()) !=
-      VK_SUCCESS) {
+  std::vector<VkDescriptorSet> snrDescriptorSets(setCount);
+  if (vkAllocateDescriptorSets(device, &allocInfo,
+                               snrDescriptorSets.data()) != VK_SUCCESS) {
     throw std::runtime_error("failed to allocate SNR descriptor sets!");
   }
 
   for (uint32_t i = 0; i < setCount; i++) {
     VkDescriptorImageInfo tnrOutInfo{offscreenSampler,
-                                     tnrIntermediateColorImageView,
+                                     stream.tnrIntermediateColorImageView,
                                      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
-    VkDescriptorImageInfo metaInfo{depthTextureSampler, depthDSImageView,
+    VkDescriptorImageInfo metaInfo{depthTextureSampler, stream.depthDSImageView,
                                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
-    // TNR writes to '1 - historyIdx'. So SNR reads from '1 - historyIdx' of
-    // current frame. Assuming 'i' is current frame index.
+    // TNR writes to '1 - historyIdx' and SNR reads what it just wrote. Set
+    // i is bound while tnrHistoryIndex == i % 2, whatever the frame context.
     uint32_t currentHistoryIdx = i % 2;
     uint32_t readIdx = 1 - currentHistoryIdx;
     VkDescriptorImageInfo tnrAuxInfo{offscreenSampler,
-                                     tnrInfoImageViews[readIdx],
+                                     stream.tnrInfoImageViews[readIdx],
                                      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
 
     VkWriteDescriptorSet writes[3]{};
@@ -3143,6 +3825,10 @@ void VulkanRenderer::createSNRDescriptorSets() {
 
     vkUpdateDescriptorSets(device, 3, writes, 0, nullptr);
   }
+
+  for (uint32_t i = 0; i < setCount; i++) {
+    stream.frameSets[i / 2].snr[i % 2] = snrDescriptorSets[i];
+  }
 }
 
 void VulkanRenderer::createSNR2Resources() {
@@ -3177,36 +3863,7 @@ void VulkanRenderer::createSNR2Resources() {
     throw std::runtime_error("failed to create SNR2 render pass!");
   }
 
-  // 2. Images
-  for (int i = 0; i < 2; i++) {
-    createImage(RM_WIDTH, RM_HEIGHT, VK_FORMAT_R16G16B16A16_SFLOAT,
-                VK_IMAGE_TILING_OPTIMAL,
-                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
-                    VK_IMAGE_USAGE_SAMPLED_BIT,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, snr2Images[i],
-                snr2ImageMemories[i]);
-    snr2ImageViews[i] =
-        createImageView(snr2Images[i], VK_FORMAT_R16G16B16A16_SFLOAT);
-    transitionImageLayout(snr2Images[i], VK_FORMAT_R16G16B16A16_SFLOAT,
-                          VK_IMAGE_LAYOUT_UNDEFINED,
-                          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-    VkFramebufferCreateInfo framebufferInfo{};
-    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    framebufferInfo.renderPass = snr2RenderPass;
-    framebufferInfo.attachmentCount = 1;
-    framebufferInfo.pAttachments = &snr2ImageViews[i];
-    framebufferInfo.width = RM_WIDTH;
-    framebufferInfo.height = RM_HEIGHT;
-    framebufferInfo.layers = 1;
-
-    if (vkCreateFramebuffer(device, &framebufferInfo, nullptr,
-                            &snr2Framebuffers[i]) != VK_SUCCESS) {
-      throw std::runtime_error("failed to create SNR2 framebuffer!");
-    }
-  }
-
-  // 3. Descriptor Set Layout
+  // 2. Descriptor Set Layout
   VkDescriptorSetLayoutBinding binding{};
   binding.binding = 0;
   binding.descriptorCount = 1;
@@ -3223,59 +3880,7 @@ void VulkanRenderer::createSNR2Resources() {
     throw std::runtime_error("failed to create SNR2 descriptor set layout!");
   }
 
-  // 4. Pipeline
-  auto snr2FragCode = readFile(std::string(SHADER_DIR) + "/SNR2.frag.spv");
-  VkShaderModule snr2FragModule = createShaderModule(snr2FragCode);
-
-  auto vertShaderCode = readFile(std::string(SHADER_DIR) + "/shader.vert.spv");
-  VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-
-  VkPipelineShaderStageCreateInfo stages[2]{};
-  stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-  stages[0].module = vertShaderModule;
-  stages[0].pName = "main";
-  stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-  stages[1].module = snr2FragModule;
-  stages[1].pName = "main";
-
-  VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-  vertexInputInfo.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-  VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-  inputAssembly.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-  inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-  VkPipelineViewportStateCreateInfo viewportState{};
-  viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-  viewportState.viewportCount = 1;
-  viewportState.scissorCount = 1;
-  VkPipelineRasterizationStateCreateInfo rasterizer{};
-  rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-  rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-  rasterizer.lineWidth = 1.0f;
-  rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-  rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-  VkPipelineMultisampleStateCreateInfo multisampling{};
-  multisampling.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-  multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-  VkPipelineColorBlendAttachmentState blendAttachment{};
-  blendAttachment.colorWriteMask = 0xF;
-  blendAttachment.blendEnable = VK_FALSE;
-  VkPipelineColorBlendStateCreateInfo colorBlending{};
-  colorBlending.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-  colorBlending.attachmentCount = 1;
-  colorBlending.pAttachments = &blendAttachment;
-  VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT,
-                                    VK_DYNAMIC_STATE_SCISSOR};
-  VkPipelineDynamicStateCreateInfo dynamicState{};
-  dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-  dynamicState.dynamicStateCount = 2;
-  dynamicState.pDynamicStates = dynamicStates;
-
+  // 3. Pipeline, compiled with the others in createPipelines()
   VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   pipelineLayoutInfo.setLayoutCount = 1;
@@ -3285,33 +3890,46 @@ void VulkanRenderer::createSNR2Resources() {
                              &snr2PipelineLayout) != VK_SUCCESS) {
     throw std::runtime_error("failed to create SNR2 pipeline layout!");
   }
+  requestPipeline({"SNR2", "SNR2.frag.spv", snr2PipelineLayout,
+                   snr2RenderPass, 1, &snr2Pipeline});
+}
 
-  VkGraphicsPipelineCreateInfo pipelineInfo{};
-  pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  pipelineInfo.stageCount = 2;
-  pipelineInfo.pStages = stages;
-  pipelineInfo.pVertexInputState = &vertexInputInfo;
-  pipelineInfo.pInputAssemblyState = &inputAssembly;
-  pipelineInfo.pViewportState = &viewportState;
-  pipelineInfo.pRasterizationState = &rasterizer;
-  pipelineInfo.pMultisampleState = &multisampling;
-  pipelineInfo.pColorBlendState = &colorBlending;
-  pipelineInfo.pDynamicState = &dynamicState;
-  pipelineInfo.layout = snr2PipelineLayout;
-  pipelineInfo.renderPass = snr2RenderPass;
-  pipelineInfo.subpass = 0;
+void VulkanRenderer::createSNR2Images(StreamResources &stream) {
+  // Images
+  for (int i = 0; i < 2; i++) {
+    createImage(rmWidth, rmHeight, VK_FORMAT_R16G16B16A16_SFLOAT,
+                VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                    VK_IMAGE_USAGE_SAMPLED_BIT |
+                    VK_IMAGE_USAGE_TRANSFER_SRC_BIT, // Reference check
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, stream.snr2Images[i],
+                stream.snr2ImageMemories[i],
+                {"SNR2", stream.tagPrefix + "snr2[" + std::to_string(i) + "]",
+                 MemoryCategory::History});
+    stream.snr2ImageViews[i] =
+        createImageView(stream.snr2Images[i], VK_FORMAT_R16G16B16A16_SFLOAT);
+    transitionImageLayout(stream.snr2Images[i], VK_FORMAT_R16G16B16A16_SFLOAT,
+                          VK_IMAGE_LAYOUT_UNDEFINED,
+                          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-  if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo,
-                                nullptr, &snr2Pipeline) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create SNR2 graphics pipeline!");
-  }
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = snr2RenderPass;
+    framebufferInfo.attachmentCount = 1;
+    framebufferInfo.pAttachments = &stream.snr2ImageViews[i];
+    framebufferInfo.width = rmWidth;
+    framebufferInfo.height = rmHeight;
+    framebufferInfo.layers = 1;
 
-  vkDestroyShaderModule(device, snr2FragModule, nullptr);
-  vkDestroyShaderModule(device, vertShaderModule, nullptr);
+    if (vkCreateFramebuffer(device, &framebufferInfo, nullptr,
+                            &stream.snr2Framebuffers[i]) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create SNR2 framebuffer!");
+    }
+  }
 }
 
-void VulkanRenderer::createSNR2DescriptorSets() {
-  uint32_t setCount = MAX_FRAMES_IN_FLIGHT;
+void VulkanRenderer::createSNR2DescriptorSets(StreamResources &stream) {
+  uint32_t setCount = static_cast<uint32_t>(stream.frameSets.size());
   std::vector<VkDescriptorSetLayout> layouts(setCount, snr2DescriptorSetLayout);
   VkDescriptorSetAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
@@ -3319,15 +3937,16 @@ void VulkanRenderer::createSNR2DescriptorSets() {
   allocInfo.descriptorSetCount = setCount;
   allocInfo.pSetLayouts = layouts.data();
 
-  snr2DescriptorSets.resize(setCount);
-  if (vkAllocateDescriptorSets(device, &allocInfo, snr2DescriptorSets.data()) !=
+  std::vector<VkDescriptorSet> snr2DescriptorSets(setCount);
+  if (vkAllocateDescriptorSets(device, &allocInfo,
+                               snr2DescriptorSets.data()) !=
       VK_SUCCESS) {
     throw std::runtime_error("failed to allocate SNR2 descriptor sets!");
   }
 
   for (uint32_t i = 0; i < setCount; i++) {
     // Initial binding, will be updated in drawFrame
-    VkDescriptorImageInfo snrInfo{offscreenSampler, snrImageViews[0],
+    VkDescriptorImageInfo snrInfo{offscreenSampler, stream.snrImageViews[0],
                                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
     VkWriteDescriptorSet write{};
     write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
@@ -3339,6 +3958,10 @@ void VulkanRenderer::createSNR2DescriptorSets() {
 
     vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
   }
+
+  for (uint32_t i = 0; i < setCount; i++) {
+    stream.frameSets[i].snr2 = snr2DescriptorSets[i];
+  }
 }
 
 void VulkanRenderer::createComputeFresnelResources() {
@@ -3373,32 +3996,7 @@ void VulkanRenderer::createComputeFresnelResources() {
     throw std::runtime_error("failed to create ComputeFresnel render pass!");
   }
 
-  // 2. Images
-  createImage(
-      WIDTH, HEIGHT, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
-      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, fresnelImage, fresnelImageMemory);
-  fresnelImageView =
-      createImageView(fresnelImage, VK_FORMAT_R16G16B16A16_SFLOAT);
-  transitionImageLayout(fresnelImage, VK_FORMAT_R16G16B16A16_SFLOAT,
-                        VK_IMAGE_LAYOUT_UNDEFINED,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-  VkFramebufferCreateInfo framebufferInfo{};
-  framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-  framebufferInfo.renderPass = computeFresnelRenderPass;
-  framebufferInfo.attachmentCount = 1;
-  framebufferInfo.pAttachments = &fresnelImageView;
-  framebufferInfo.width = WIDTH;
-  framebufferInfo.height = HEIGHT;
-  framebufferInfo.layers = 1;
-
-  if (vkCreateFramebuffer(device, &framebufferInfo, nullptr,
-                          &computeFresnelFramebuffer) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create ComputeFresnel framebuffer!");
-  }
-
-  // 3. Descriptor Set Layout
+  // 2. Descriptor Set Layout
   VkDescriptorSetLayoutBinding bindings[2]{};
   bindings[0].binding = 0;
   bindings[0].descriptorCount = 1;
@@ -3422,62 +4020,7 @@ void VulkanRenderer::createComputeFresnelResources() {
         "failed to create ComputeFresnel descriptor set layout!");
   }
 
-  // 4. Pipeline
-  auto fragCode =
-      readFile(std::string(SHADER_DIR) + "/computeFresnel.frag.spv");
-  VkShaderModule fragModule = createShaderModule(fragCode);
-
-  auto vertShaderCode = readFile(std::string(SHADER_DIR) + "/shader.vert.spv");
-  VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-
-  VkPipelineShaderStageCreateInfo stages[2]{};
-  stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-  stages[0].module = vertShaderModule;
-  stages[0].pName = "main";
-  stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-  stages[1].module = fragModule;
-  stages[1].pName = "main";
-
-  VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-  vertexInputInfo.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-  VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-  inputAssembly.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-  inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-  VkPipelineViewportStateCreateInfo viewportState{};
-  viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-  viewportState.viewportCount = 1;
-  viewportState.scissorCount = 1;
-  VkPipelineRasterizationStateCreateInfo rasterizer{};
-  rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-  rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-  rasterizer.lineWidth = 1.0f;
-  rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-  rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-  VkPipelineMultisampleStateCreateInfo multisampling{};
-  multisampling.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-  multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-
-  VkPipelineColorBlendAttachmentState blendAttachment{};
-  blendAttachment.colorWriteMask = 0xF;
-  blendAttachment.blendEnable = VK_FALSE;
-  VkPipelineColorBlendStateCreateInfo colorBlending{};
-  colorBlending.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-  colorBlending.attachmentCount = 1;
-  colorBlending.pAttachments = &blendAttachment;
-
-  VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT,
-                                    VK_DYNAMIC_STATE_SCISSOR};
-  VkPipelineDynamicStateCreateInfo dynamicState{};
-  dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-  dynamicState.dynamicStateCount = 2;
-  dynamicState.pDynamicStates = dynamicStates;
-
+  // 3. Pipeline, compiled with the others in createPipelines()
   VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   pipelineLayoutInfo.setLayoutCount = 1;
@@ -3488,43 +4031,54 @@ void VulkanRenderer::createComputeFresnelResources() {
     throw std::runtime_error(
         "failed to create ComputeFresnel pipeline layout!");
   }
+  requestPipeline({"ComputeFresnel", "computeFresnel.frag.spv",
+                   computeFresnelPipelineLayout, computeFresnelRenderPass, 1,
+                   &computeFresnelPipeline});
+}
 
-  VkGraphicsPipelineCreateInfo pipelineInfo{};
-  pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  pipelineInfo.stageCount = 2;
-  pipelineInfo.pStages = stages;
-  pipelineInfo.pVertexInputState = &vertexInputInfo;
-  pipelineInfo.pInputAssemblyState = &inputAssembly;
-  pipelineInfo.pViewportState = &viewportState;
-  pipelineInfo.pRasterizationState = &rasterizer;
-  pipelineInfo.pMultisampleState = &multisampling;
-  pipelineInfo.pColorBlendState = &colorBlending;
-  pipelineInfo.pDynamicState = &dynamicState;
-  pipelineInfo.layout = computeFresnelPipelineLayout;
-  pipelineInfo.renderPass = computeFresnelRenderPass;
-  pipelineInfo.subpass = 0;
-
-  if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo,
-                                nullptr,
-                                &computeFresnelPipeline) != VK_SUCCESS) {
-    throw std::runtime_error(
-        "failed to create ComputeFresnel graphics pipeline!");
-  }
+void VulkanRenderer::createFresnelImages(StreamResources &stream) {
+  // Images
+  createImage(frameWidth, frameHeight, VK_FORMAT_R16G16B16A16_SFLOAT,
+              VK_IMAGE_TILING_OPTIMAL,
+              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                  VK_IMAGE_USAGE_TRANSFER_SRC_BIT, // Reference check
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, stream.fresnelImage,
+              stream.fresnelImageMemory,
+              {"Fresnel", stream.tagPrefix + "fresnel",
+               MemoryCategory::Transient});
+  stream.fresnelImageView =
+      createImageView(stream.fresnelImage, VK_FORMAT_R16G16B16A16_SFLOAT);
+  transitionImageLayout(stream.fresnelImage, VK_FORMAT_R16G16B16A16_SFLOAT,
+                        VK_IMAGE_LAYOUT_UNDEFINED,
+                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-  vkDestroyShaderModule(device, fragModule, nullptr);
-  vkDestroyShaderModule(device, vertShaderModule, nullptr);
+  VkFramebufferCreateInfo framebufferInfo{};
+  framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebufferInfo.renderPass = computeFresnelRenderPass;
+  framebufferInfo.attachmentCount = 1;
+  framebufferInfo.pAttachments = &stream.fresnelImageView;
+  framebufferInfo.width = frameWidth;
+  framebufferInfo.height = frameHeight;
+  framebufferInfo.layers = 1;
+
+  if (vkCreateFramebuffer(device, &framebufferInfo, nullptr,
+                          &stream.computeFresnelFramebuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create ComputeFresnel framebuffer!");
+  }
 }
 
-void VulkanRenderer::createComputeFresnelDescriptorSets() {
-  std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT,
+void VulkanRenderer::createComputeFresnelDescriptorSets(
+    StreamResources &stream) {
+  uint32_t contextCount = static_cast<uint32_t>(stream.frameSets.size());
+  std::vector<VkDescriptorSetLayout> layouts(contextCount,
                                              computeFresnelDescriptorSetLayout);
   VkDescriptorSetAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
   allocInfo.descriptorPool = descriptorPool;
-  allocInfo.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
+  allocInfo.descriptorSetCount = contextCount;
   allocInfo.pSetLayouts = layouts.data();
 
-  computeFresnelDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+  std::vector<VkDescriptorSet> computeFresnelDescriptorSets(contextCount);
   if (vkAllocateDescriptorSets(device, &allocInfo,
                                computeFresnelDescriptorSets.data()) !=
       VK_SUCCESS) {
@@ -3532,11 +4086,12 @@ void VulkanRenderer::createComputeFresnelDescriptorSets() {
         "failed to allocate ComputeFresnel descriptor sets!");
   }
 
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    VkDescriptorImageInfo depthInfo{depthTextureSampler, depthTextureImageView,
+  for (uint32_t i = 0; i < contextCount; i++) {
+    VkDescriptorImageInfo depthInfo{depthTextureSampler,
+                                    stream.depthTextureImageView,
                                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
     VkDescriptorImageInfo normalInfo{normalTextureSampler,
-                                     normalTextureImageView,
+                                     stream.normalTextureImageView,
                                      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
 
     VkWriteDescriptorSet descriptorWrites[2]{};
@@ -3559,6 +4114,10 @@ void VulkanRenderer::createComputeFresnelDescriptorSets() {
 
     vkUpdateDescriptorSets(device, 2, descriptorWrites, 0, nullptr);
   }
+
+  for (uint32_t i = 0; i < contextCount; i++) {
+    stream.frameSets[i].computeFresnel = computeFresnelDescriptorSets[i];
+  }
 }
 
 void VulkanRenderer::createTNR2Resources() {
@@ -3595,37 +4154,7 @@ void VulkanRenderer::createTNR2Resources() {
     throw std::runtime_error("failed to create TNR2 render pass!");
   }
 
-  // 2. Images
-  for (int i = 0; i < 2; i++) {
-    // Color
-    createImage(
-        WIDTH, HEIGHT, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
-        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, tnr2Images[i],
-        tnr2ImageMemories[i]);
-    tnr2ImageViews[i] =
-        createImageView(tnr2Images[i], VK_FORMAT_R16G16B16A16_SFLOAT);
-    transitionImageLayout(tnr2Images[i], VK_FORMAT_R16G16B16A16_SFLOAT,
-                          VK_IMAGE_LAYOUT_UNDEFINED,
-                          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-    VkImageView attachmentsFB[] = {tnr2ImageViews[i]};
-    VkFramebufferCreateInfo framebufferInfo{};
-    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    framebufferInfo.renderPass = tnr2RenderPass;
-    framebufferInfo.attachmentCount = 1;
-    framebufferInfo.pAttachments = attachmentsFB;
-    framebufferInfo.width = WIDTH;
-    framebufferInfo.height = HEIGHT;
-    framebufferInfo.layers = 1;
-
-    if (vkCreateFramebuffer(device, &framebufferInfo, nullptr,
-                            &tnr2Framebuffers[i]) != VK_SUCCESS) {
-      throw std::runtime_error("failed to create TNR2 framebuffer!");
-    }
-  }
-
-  // 3. Descriptor Set Layout
+  // 2. Descriptor Set Layout
   VkDescriptorSetLayoutBinding bindings[6]{};
   for (int i = 0; i < 6; i++) {
     bindings[i].binding = i;
@@ -3644,61 +4173,7 @@ void VulkanRenderer::createTNR2Resources() {
     throw std::runtime_error("failed to create TNR2 descriptor set layout!");
   }
 
-  // 4. Pipeline
-  auto fragCode = readFile(std::string(SHADER_DIR) + "/TNR2.frag.spv");
-  VkShaderModule fragModule = createShaderModule(fragCode);
-
-  auto vertShaderCode = readFile(std::string(SHADER_DIR) + "/shader.vert.spv");
-  VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-
-  VkPipelineShaderStageCreateInfo stages[2]{};
-  stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-  stages[0].module = vertShaderModule;
-  stages[0].pName = "main";
-  stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-  stages[1].module = fragModule;
-  stages[1].pName = "main";
-
-  VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-  vertexInputInfo.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-  VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-  inputAssembly.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-  inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-  VkPipelineViewportStateCreateInfo viewportState{};
-  viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-  viewportState.viewportCount = 1;
-  viewportState.scissorCount = 1;
-  VkPipelineRasterizationStateCreateInfo rasterizer{};
-  rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-  rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-  rasterizer.lineWidth = 1.0f;
-  rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-  rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-  VkPipelineMultisampleStateCreateInfo multisampling{};
-  multisampling.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-  multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-
-  VkPipelineColorBlendAttachmentState blendAttachments[1]{};
-  blendAttachments[0].colorWriteMask = 0xF;
-  blendAttachments[0].blendEnable = VK_FALSE;
-  VkPipelineColorBlendStateCreateInfo colorBlending{};
-  colorBlending.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-  colorBlending.attachmentCount = 1;
-  colorBlending.pAttachments = blendAttachments;
-
-  VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT,
-                                    VK_DYNAMIC_STATE_SCISSOR};
-  VkPipelineDynamicStateCreateInfo dynamicState{};
-  dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-  dynamicState.dynamicStateCount = 2;
-  dynamicState.pDynamicStates = dynamicStates;
-
+  // 3. Pipeline, compiled with the others in createPipelines()
   VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   pipelineLayoutInfo.setLayoutCount = 1;
@@ -3708,33 +4183,47 @@ void VulkanRenderer::createTNR2Resources() {
                              &tnr2PipelineLayout) != VK_SUCCESS) {
     throw std::runtime_error("failed to create TNR2 pipeline layout!");
   }
+  requestPipeline({"TNR2", "TNR2.frag.spv", tnr2PipelineLayout,
+                   tnr2RenderPass, 1, &tnr2Pipeline});
+}
 
-  VkGraphicsPipelineCreateInfo pipelineInfo{};
-  pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  pipelineInfo.stageCount = 2;
-  pipelineInfo.pStages = stages;
-  pipelineInfo.pVertexInputState = &vertexInputInfo;
-  pipelineInfo.pInputAssemblyState = &inputAssembly;
-  pipelineInfo.pViewportState = &viewportState;
-  pipelineInfo.pRasterizationState = &rasterizer;
-  pipelineInfo.pMultisampleState = &multisampling;
-  pipelineInfo.pColorBlendState = &colorBlending;
-  pipelineInfo.pDynamicState = &dynamicState;
-  pipelineInfo.layout = tnr2PipelineLayout;
-  pipelineInfo.renderPass = tnr2RenderPass;
-  pipelineInfo.subpass = 0;
+void VulkanRenderer::createTNR2Images(StreamResources &stream) {
+  // Images
+  for (int i = 0; i < 2; i++) {
+    // Color
+    createImage(
+        frameWidth, frameHeight, VK_FORMAT_R16G16B16A16_SFLOAT,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT | // Batch readback
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT,  // Cleared history
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, stream.tnr2Images[i],
+        stream.tnr2ImageMemories[i],
+        {"TNR2", stream.tagPrefix + "tnr2[" + std::to_string(i) + "]",
+         MemoryCategory::History});
+    stream.tnr2ImageViews[i] =
+        createImageView(stream.tnr2Images[i], VK_FORMAT_R16G16B16A16_SFLOAT);
+    clearHistoryImage(stream.tnr2Images[i]);
+
+    VkImageView attachmentsFB[] = {stream.tnr2ImageViews[i]};
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = tnr2RenderPass;
+    framebufferInfo.attachmentCount = 1;
+    framebufferInfo.pAttachments = attachmentsFB;
+    framebufferInfo.width = frameWidth;
+    framebufferInfo.height = frameHeight;
+    framebufferInfo.layers = 1;
 
-  if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo,
-                                nullptr, &tnr2Pipeline) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create TNR2 graphics pipeline!");
+    if (vkCreateFramebuffer(device, &framebufferInfo, nullptr,
+                            &stream.tnr2Framebuffers[i]) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create TNR2 framebuffer!");
+    }
   }
-
-  vkDestroyShaderModule(device, fragModule, nullptr);
-  vkDestroyShaderModule(device, vertShaderModule, nullptr);
 }
 
-void VulkanRenderer::createTNR2DescriptorSets() {
-  uint32_t setCount = MAX_FRAMES_IN_FLIGHT * 2;
+void VulkanRenderer::createTNR2DescriptorSets(StreamResources &stream) {
+  uint32_t setCount = static_cast<uint32_t>(stream.frameSets.size()) * 2;
   std::vector<VkDescriptorSetLayout> layouts(setCount, tnr2DescriptorSetLayout);
   VkDescriptorSetAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
@@ -3742,8 +4231,9 @@ void VulkanRenderer::createTNR2DescriptorSets() {
   allocInfo.descriptorSetCount = setCount;
   allocInfo.pSetLayouts = layouts.data();
 
-  tnr2DescriptorSets.resize(setCount);
-  if (vkAllocateDescriptorSets(device, &allocInfo, tnr2DescriptorSets.data()) !=
+  std::vector<VkDescriptorSet> tnr2DescriptorSets(setCount);
+  if (vkAllocateDescriptorSets(device, &allocInfo,
+                               tnr2DescriptorSets.data()) !=
       VK_SUCCESS) {
     throw std::runtime_error("failed to allocate TNR2 descriptor sets!");
   }
@@ -3757,32 +4247,33 @@ void VulkanRenderer::createTNR2DescriptorSets() {
 
     // 1. Prior stage Output (SNR2) is available in [1 - historyIdx].
     VkDescriptorImageInfo snrInfo{offscreenSampler,
-                                  snr2ImageViews[1 - historyIdx],
+                                  stream.snr2ImageViews[1 - historyIdx],
                                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
 
     // 2. TNR2 History: "sTNR2_History should be the TNR2's previous(t-1)
     // TNR2_out0" This corresponds to [historyIdx].
     VkDescriptorImageInfo historyInfo{offscreenSampler,
-                                      tnr2ImageViews[historyIdx],
+                                      stream.tnr2ImageViews[historyIdx],
                                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
 
     // 3. Depth
-    VkDescriptorImageInfo depthInfo{depthTextureSampler, depthTextureImageView,
+    VkDescriptorImageInfo depthInfo{depthTextureSampler,
+                                    stream.depthTextureImageView,
                                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
 
     // 4. Motion Vectors
-    VkDescriptorImageInfo mvInfo{mvTextureSampler, mvTextureImageView,
+    VkDescriptorImageInfo mvInfo{mvTextureSampler, stream.mvTextureImageView,
                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
 
     // 5. Fresnel
-    VkDescriptorImageInfo fresnelInfo{offscreenSampler, fresnelImageView,
+    VkDescriptorImageInfo fresnelInfo{offscreenSampler, stream.fresnelImageView,
                                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
 
     // 6. TNR Info: "sTNR_Info should be the TNR's current(t) TNR_out1"
     // TNR (Pass 2) writes to [1 - historyIdx]. So we read from [1 -
     // historyIdx].
     VkDescriptorImageInfo tnrInfoInfo{offscreenSampler,
-                                      tnrInfoImageViews[1 - historyIdx],
+                                      stream.tnrInfoImageViews[1 - historyIdx],
                                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
 
     VkWriteDescriptorSet writes[6]{};
@@ -3831,4 +4322,8 @@ void VulkanRenderer::createTNR2DescriptorSets() {
 
     vkUpdateDescriptorSets(device, 6, writes, 0, nullptr);
   }
+
+  for (uint32_t i = 0; i < setCount; i++) {
+    stream.frameSets[i / 2].tnr2[i % 2] = tnr2DescriptorSets[i];
+  }
 }
@@ -12,19 +12,124 @@
 #include <optional>
 #include <set>
 #include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <functional>
+#include <map>
+
+#include "BottleneckClassifier.hpp"
+#include "BoundedQueue.hpp"
+#include "CpuReference.hpp"
+#include "CpuTracer.hpp"
+#include "FramePacing.hpp"
+#include "GpuProfiler.hpp"
+#include "HostMemoryImport.hpp"
+#include "MemoryLedger.hpp"
+#include "MetricsExporter.hpp"
+#include "OutputEncoder.hpp"
+#include "PipelineCache.hpp"
+#include "Roofline.hpp"
+#include "SequenceInfo.hpp"
+
+// Runtime options, usually filled in from the command line.
+struct RendererConfig {
+    // One entry per stream. Several streams are processed side by side on one
+    // device (headless only) and must share a resolution.
+    std::vector<std::string> sequenceDirectories = {DEFAULT_SEQUENCE_DIR};
+    // Streams whose frames are pushed from memory (DenoisePipeline). When set
+    // they replace sequenceDirectories and nothing is read from disk.
+    std::vector<SequenceInfo> memoryStreams;
+    bool headless = false; // No window, surface or swapchain
+    int frameCount = 0;    // Frames to render; 0 = forever (headless: one pass over the sequence)
+
+    // Batch mode: process [firstFrame, firstFrame + frameCount) as fast as
+    // possible and write every output frame (implies headless).
+    bool batch = false;
+    int firstFrame = 0;
+    std::string outputDirectory; // Empty: read back but don't write
+    OutputSource outputSource = OutputSource::TNR2;
+    OutputFormat outputFormat = OutputFormat::Raw;
+    unsigned encoderThreads = 0; // Total over all streams; 0: one per core, minus render and writer
+
+    // Frame contexts the CPU may record ahead of the GPU (1-4). More hides
+    // CPU/GPU jitter at the cost of latency and per-frame resources.
+    int framesInFlight = 2;
+
+    // Per-pass GPU timestamps: rolling mean/p50/p99, printed every
+    // gpuProfileInterval seconds (0: only at exit) and written to
+    // gpuProfileOutput (.csv or .json) at exit. gpuPipelineStatistics adds
+    // per-pass shader invocation counts where the device supports them.
+    bool gpuProfile = false;
+    bool gpuPipelineStatistics = false;
+    double gpuProfileInterval = 5.0;
+    std::string gpuProfileOutput;
+    // At exit, compare every pass's bandwidth with a copy benchmark (implies
+    // gpuProfile).
+    bool roofline = false;
+    // After a headless run, recompute stream 0's last frame pass by pass on
+    // the CPU and print each pass's error against the GPU.
+    bool referenceCheck = false;
+
+    // Run batch mode on the CPU backend (CpuDenoiser) instead of Vulkan, on
+    // cpuThreads threads (0: one per core). cpuScaling times 1, 2, 4, ...
+    // cpuThreads threads on the first frames instead and writes nothing.
+    bool cpuBackend = false;
+    unsigned cpuThreads = 0;
+    bool cpuScaling = false;
+
+    // Frame intervals above this count as stalls in the frame pacing report.
+    double frameBudgetMs = 1000.0 / 60.0;
+    // Seconds between bottleneck diagnoses while running; 0: only at the end.
+    double diagnosisInterval = 0.0;
+
+    // Live Prometheus metrics over HTTP: a localhost TCP port ("9464") or a
+    // Unix domain socket ("unix:/path"). Empty: no exporter.
+    std::string metricsAddress;
+
+    // Chrome trace of the CPU work of every thread (frame phases, loading,
+    // encoding), written at exit. Empty: tracing off.
+    std::string traceOutput;
+
+    // Pipeline cache file, loaded at startup and saved at exit. Empty: no
+    // file, every run compiles the shaders again. The player sets
+    // PipelineCache::defaultPath(); library users opt in.
+    std::string pipelineCachePath;
+    unsigned pipelineThreads = 0; // Startup pipeline compilation; 0: one per core
+};
 
 class VulkanRenderer {
 public:
+    explicit VulkanRenderer(const RendererConfig& config = RendererConfig());
     void run();
+    void printMemoryReport();
+    void printGpuProfile();
+    double gpuMsPerFrame() const;
+    void publishMetrics(bool force = false);
+    void printRoofline();
+
+    // Step-by-step access for bench/vulkanio_bench.cpp, which times the
+    // pieces of a headless frame of stream 0 one at a time.
+    void initHeadless(); // loadSequence() and initVulkan(); config.headless must be set
+    void shutdown();     // cleanup()
+    std::string getDeviceName() const;
+    void renderFrame();     // drawFrame(), then waits for the GPU
+    void* getInputStaging(); // Color staging memory, what loadInput() fills
+    void loadInput(const std::string& filename, const std::string& fallbackPrefix = "");
+    void uploadInput();     // Copies the five staging buffers to the input images
+    RefImage readbackTnr2(); // TNR2 output of the last frame
+    const GpuProfiler& getGpuProfiler() const { return gpuProfiler; }
 
 private:
-    // Window settings
-    const uint32_t WIDTH = 1920;
-    const uint32_t HEIGHT = 864;
+    friend class DenoisePipeline;
+
+    RendererConfig config;
+
+    // Window settings (the resolution comes from the sequence at startup)
+    uint32_t frameWidth = 0;
+    uint32_t frameHeight = 0;
     const uint32_t STRIDE = 1;
-    const uint32_t RM_WIDTH = WIDTH / STRIDE;
-    const uint32_t RM_HEIGHT = HEIGHT / STRIDE;
+    uint32_t rmWidth = 0;
+    uint32_t rmHeight = 0;
     
     // Core Vulkan
     GLFWwindow* window;
@@ -36,6 +141,41 @@ private:
     VkQueue graphicsQueue;
     VkQueue presentQueue;
     uint32_t graphicsQueueFamilyIndex;
+    bool memoryBudgetSupported = false;
+    bool externalMemoryCapabilities = false; // Instance extension enabled
+    bool hostMemoryImportSupported = false;
+    bool pipelineStatisticsSupported = false; // Feature enabled (--gpu-stats)
+
+    // Device memory is sub-allocated from large blocks
+    MemoryAllocator memoryAllocator;
+    MemoryLedger memoryLedger;
+    HostMemoryImporter hostMemoryImporter; // Zero-copy inputs (DenoisePipeline)
+    GpuProfiler gpuProfiler; // Only initialized with config.gpuProfile
+    PipelineCache pipelineCache; // Used by every vkCreateGraphicsPipelines
+
+    // A fullscreen pass pipeline waiting for createPipelines()
+    struct PipelineRequest {
+        const char* name;           // For errors
+        std::string fragmentShader; // SPIR-V file in SHADER_DIR
+        VkPipelineLayout layout;
+        VkRenderPass renderPass;
+        uint32_t colorAttachments;
+        VkPipeline* pipeline;       // Set by createPipelines()
+    };
+    std::vector<PipelineRequest> pipelineRequests;
+    std::map<std::string, VkShaderModule> shaderModules; // By file, until the pipelines exist
+    double pipelineMs = 0.0; // Startup time spent in createPipelines()
+    unsigned pipelineThreadsUsed = 0;
+    FramePacing framePacing; // Per-frame timestamps, interval/latency histograms
+    BottleneckClassifier bottleneck; // Where the render thread's time goes
+
+    // Metrics endpoint and the counters only it reports
+    MetricsExporter metricsExporter;
+    uint64_t uploadBytes = 0;  // Input bytes copied to the GPU
+    uint64_t loaderHits = 0;   // Batch frames whose input was already loaded
+    uint64_t loaderStalls = 0; // ... and those that had to wait for it
+    std::chrono::steady_clock::time_point lastMetricsTime;
+    int lastMetricsFrames = 0;
     
     // Swapchain
     VkSwapchainKHR swapchain;
@@ -44,6 +184,8 @@ private:
     VkExtent2D swapchainExtent;
     std::vector<VkImageView> swapchainImageViews;
     std::vector<VkFramebuffer> swapchainFramebuffers;
+
+    int framesRendered = 0;
     
     // Graphics Pipeline
     VkRenderPass renderPass;
@@ -51,173 +193,241 @@ private:
     
     // Command Buffers
     VkCommandPool commandPool;
-    std::vector<VkCommandBuffer> commandBuffers;
     
-    // Synchronization
-    std::vector<VkSemaphore> imageAvailableSemaphores;
-    std::vector<VkSemaphore> renderFinishedSemaphores;
-    std::vector<VkFence> inFlightFences;
+    // Frame Contexts. Everything one in-flight frame owns; the CPU records
+    // frames[currentFrame] while the GPU may still run the others. Per-stream
+    // descriptor sets live in StreamResources::frameSets, same index.
+    static const int MAX_FRAMES_IN_FLIGHT = 4; // Upper bound for config.framesInFlight
+    struct FrameContext {
+        VkCommandBuffer commandBuffer;
+        VkSemaphore imageAvailable; // Unused in headless mode
+        VkSemaphore renderFinished; // Unused in headless mode
+        VkFence inFlight;
+    };
+    std::vector<FrameContext> frames;
     uint32_t currentFrame = 0;
-    const int MAX_FRAMES_IN_FLIGHT = 2;
     
-    // Texture Resources
-    VkImage textureImage;
-    VkDeviceMemory textureImageMemory;
-    VkImageView textureImageView;
+    // Samplers (shared by all streams)
     VkSampler textureSampler;
-
-    // Depth Texture Resources
-    VkImage depthTextureImage;
-    VkDeviceMemory depthTextureImageMemory;
-    VkImageView depthTextureImageView;
     VkSampler depthTextureSampler;
-    
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-
-    VkBuffer depthStagingBuffer;
-    VkDeviceMemory depthStagingBufferMemory;
-
-    // Normal Texture Resources
-    VkImage normalTextureImage;
-    VkDeviceMemory normalTextureImageMemory;
-    VkImageView normalTextureImageView;
     VkSampler normalTextureSampler;
-    VkBuffer normalStagingBuffer;
-    VkDeviceMemory normalStagingBufferMemory;
-
-    // Albedo Texture Resources (New)
-    VkImage albedoTextureImage;
-    VkDeviceMemory albedoTextureImageMemory;
-    VkImageView albedoTextureImageView;
     VkSampler albedoTextureSampler;
-    VkBuffer albedoStagingBuffer;
-    VkDeviceMemory albedoStagingBufferMemory;
-    
-    // Offscreen (Low-Res RM)
-    VkImage offscreenImage;
-    VkDeviceMemory offscreenImageMemory;
-    VkImageView offscreenImageView;
+    VkSampler mvTextureSampler;
     VkSampler offscreenSampler;
+
+    // Render passes and pipelines (shared by all streams)
     VkRenderPass offscreenRenderPass;
-    VkFramebuffer offscreenFramebuffer;
     VkPipeline offscreenPipeline;
     VkPipelineLayout offscreenPipelineLayout;
-    
-    // Final Pass (Upscale)
+
     VkDescriptorSetLayout finalDescriptorSetLayout;
     VkPipeline finalPipeline;
     VkPipelineLayout finalPipelineLayout;
-    std::vector<VkDescriptorSet> finalDescriptorSets;
 
-    // DepthDS Pass
-    VkImage depthDSImage;
-    VkDeviceMemory depthDSImageMemory;
-    VkImageView depthDSImageView;
     VkRenderPass depthDSRenderPass;
-    VkFramebuffer depthDSFramebuffer;
     VkPipeline depthDSPipeline;
     VkPipelineLayout depthDSPipelineLayout;
     VkDescriptorSetLayout depthDSDescriptorSetLayout;
-    std::vector<VkDescriptorSet> depthDSDescriptorSets;
 
     VkDescriptorPool descriptorPool;
-    std::vector<VkDescriptorSet> descriptorSets;
 
-    // TNR Pass
     VkRenderPass tnrRenderPass;
     VkPipeline tnrPipeline;
     VkPipelineLayout tnrPipelineLayout;
     VkDescriptorSetLayout tnrDescriptorSetLayout;
-    std::vector<VkDescriptorSet> tnrDescriptorSets;
-    
-    // TNR Textures (Double buffered for feedback)
-    VkImage tnrColorImages[2];
-    VkDeviceMemory tnrColorImageMemories[2];
-    VkImageView tnrColorImageViews[2];
-    
-    VkImage tnrInfoImages[2];
-    VkDeviceMemory tnrInfoImageMemories[2];
-    VkImageView tnrInfoImageViews[2];
-    
-    VkFramebuffer tnrFramebuffers[2];
-    uint32_t tnrHistoryIndex = 0;
 
-    // SNR Pass
     VkRenderPass snrRenderPass;
     VkPipeline snrPipeline;
     VkPipelineLayout snrPipelineLayout;
     VkDescriptorSetLayout snrDescriptorSetLayout;
-    std::vector<VkDescriptorSet> snrDescriptorSets;
-
-    VkImage tnrIntermediateColorImage;
-    VkDeviceMemory tnrIntermediateColorImageMemory;
-    VkImageView tnrIntermediateColorImageView;
-
-    VkImage tnrOut2Image;
-    VkDeviceMemory tnrOut2ImageMemory;
-    VkImageView tnrOut2ImageView;
-
-    VkImage snrImages[2];
-    VkDeviceMemory snrImageMemories[2];
-    VkImageView snrImageViews[2];
-    VkFramebuffer snrFramebuffers[2];
 
-    // SNR2 Pass
     VkRenderPass snr2RenderPass;
     VkPipeline snr2Pipeline;
     VkPipelineLayout snr2PipelineLayout;
     VkDescriptorSetLayout snr2DescriptorSetLayout;
-    std::vector<VkDescriptorSet> snr2DescriptorSets;
 
-    VkImage snr2Images[2];
-    VkDeviceMemory snr2ImageMemories[2];
-    VkImageView snr2ImageViews[2];
-    VkFramebuffer snr2Framebuffers[2];
-
-    // ComputeFresnel Pass
     VkRenderPass computeFresnelRenderPass;
     VkPipeline computeFresnelPipeline;
     VkPipelineLayout computeFresnelPipelineLayout;
     VkDescriptorSetLayout computeFresnelDescriptorSetLayout;
-    std::vector<VkDescriptorSet> computeFresnelDescriptorSets;
-
-    VkImage fresnelImage;
-    VkDeviceMemory fresnelImageMemory;
-    VkImageView fresnelImageView;
-    VkFramebuffer computeFresnelFramebuffer;
 
-    // TNR2 Pass
     VkRenderPass tnr2RenderPass;
     VkPipeline tnr2Pipeline;
     VkPipelineLayout tnr2PipelineLayout;
     VkDescriptorSetLayout tnr2DescriptorSetLayout;
-    std::vector<VkDescriptorSet> tnr2DescriptorSets;
 
-    VkImage tnr2Images[2]; // Ping-pong for output/history
-    VkDeviceMemory tnr2ImageMemories[2];
-    VkImageView tnr2ImageViews[2];
-    
-    VkImage tnr2InfoImages[2]; // Ping-pong for info history
-    VkDeviceMemory tnr2InfoImageMemories[2];
-    VkImageView tnr2InfoImageViews[2];
-    
-    VkFramebuffer tnr2Framebuffers[2];
-    uint32_t tnr2HistoryIndex = 0;
+    // All streams advance one frame per submit, so they share the history
+    // ping-pong index.
+    uint32_t tnrHistoryIndex = 0;
 
-    // MV Texture Resources
-    VkImage mvTextureImage;
-    VkDeviceMemory mvTextureImageMemory;
-    VkImageView mvTextureImageView;
-    VkSampler mvTextureSampler;
-    VkBuffer mvStagingBuffer;
-    VkDeviceMemory mvStagingBufferMemory;
+    // Everything one input sequence needs: its inputs, every intermediate and
+    // history image, and the descriptor sets pointing at them. Each stream is
+    // denoised independently; all streams share the pipelines above and are
+    // recorded into the same command buffer.
+    struct StreamResources {
+        SequenceInfo sequence;
+        int currentFrameIndex = 0;
+        std::string tagPrefix; // Memory ledger name prefix, e.g. "s1/"
+
+        // Descriptor sets of one frame context. The TNR passes, and SNR
+        // which reads the TNR info written this frame, get one per history
+        // direction, picked by tnrHistoryIndex.
+        struct FrameDescriptorSets {
+            VkDescriptorSet rm;
+            VkDescriptorSet depthDS;
+            VkDescriptorSet tnr[2];
+            VkDescriptorSet snr[2];
+            VkDescriptorSet snr2;
+            VkDescriptorSet computeFresnel;
+            VkDescriptorSet tnr2[2];
+            VkDescriptorSet final;
+        };
+        std::vector<FrameDescriptorSets> frameSets; // Indexed like frames
+
+        // Inputs
+        VkImage textureImage;
+        MemoryAllocation textureImageMemory;
+        VkImageView textureImageView;
+        VkBuffer stagingBuffer;
+        MemoryAllocation stagingBufferMemory;
+
+        VkImage depthTextureImage;
+        MemoryAllocation depthTextureImageMemory;
+        VkImageView depthTextureImageView;
+        VkBuffer depthStagingBuffer;
+        MemoryAllocation depthStagingBufferMemory;
+
+        VkImage normalTextureImage;
+        MemoryAllocation normalTextureImageMemory;
+        VkImageView normalTextureImageView;
+        VkBuffer normalStagingBuffer;
+        MemoryAllocation normalStagingBufferMemory;
+
+        VkImage albedoTextureImage;
+        MemoryAllocation albedoTextureImageMemory;
+        VkImageView albedoTextureImageView;
+        VkBuffer albedoStagingBuffer;
+        MemoryAllocation albedoStagingBufferMemory;
+
+        VkImage mvTextureImage;
+        MemoryAllocation mvTextureImageMemory;
+        VkImageView mvTextureImageView;
+        VkBuffer mvStagingBuffer;
+        MemoryAllocation mvStagingBufferMemory;
+
+        // Offscreen (Low-Res RM)
+        VkImage offscreenImage;
+        MemoryAllocation offscreenImageMemory;
+        VkImageView offscreenImageView;
+        VkFramebuffer offscreenFramebuffer;
+
+        // DepthDS Pass
+        VkImage depthDSImage;
+        MemoryAllocation depthDSImageMemory;
+        VkImageView depthDSImageView;
+        VkFramebuffer depthDSFramebuffer;
+
+        // TNR Pass (info double buffered for feedback)
+        VkImage tnrIntermediateColorImage;
+        MemoryAllocation tnrIntermediateColorImageMemory;
+        VkImageView tnrIntermediateColorImageView;
+        VkImage tnrOut2Image;
+        MemoryAllocation tnrOut2ImageMemory;
+        VkImageView tnrOut2ImageView;
+        VkImage tnrInfoImages[2];
+        MemoryAllocation tnrInfoImageMemories[2];
+        VkImageView tnrInfoImageViews[2];
+        VkFramebuffer tnrFramebuffers[2];
+
+        // SNR Pass
+        VkImage snrImages[2];
+        MemoryAllocation snrImageMemories[2];
+        VkImageView snrImageViews[2];
+        VkFramebuffer snrFramebuffers[2];
+
+        // SNR2 Pass
+        VkImage snr2Images[2];
+        MemoryAllocation snr2ImageMemories[2];
+        VkImageView snr2ImageViews[2];
+        VkFramebuffer snr2Framebuffers[2];
+
+        // ComputeFresnel Pass
+        VkImage fresnelImage;
+        MemoryAllocation fresnelImageMemory;
+        VkImageView fresnelImageView;
+        VkFramebuffer computeFresnelFramebuffer;
+
+        // TNR2 Pass
+        VkImage tnr2Images[2]; // Ping-pong for output/history
+        MemoryAllocation tnr2ImageMemories[2];
+        VkImageView tnr2ImageViews[2];
+        VkFramebuffer tnr2Framebuffers[2];
+
+        // Final Pass (Upscale). Headless streams render into their own
+        // image; windowed mode draws into the swapchain instead.
+        VkImage finalImage = VK_NULL_HANDLE;
+        MemoryAllocation finalImageMemory;
+        VkImageView finalImageView = VK_NULL_HANDLE;
+        VkFramebuffer finalFramebuffer = VK_NULL_HANDLE;
+    };
+    std::vector<StreamResources> streams;
+
+    // Batch Pipeline (load -> upload -> render -> readback -> write).
+    // Interactive and headless runs use the upload slots too, one per frame
+    // context.
+    static const int INPUT_CHANNELS = 5; // color, depth, normal, albedo, mv
+    struct UploadSlot {
+        // One set of inputs per stream: [stream * INPUT_CHANNELS + channel]
+        std::vector<VkBuffer> buffers;
+        std::vector<MemoryAllocation> memories;
+        // Per input: imported host memory to copy from instead of the staging
+        // buffer (VK_NULL_HANDLE: use buffers[b]), and the offset in it.
+        std::vector<VkBuffer> sources;
+        std::vector<VkDeviceSize> sourceOffsets;
+    };
+    struct ReadbackSlot {
+        // Every stream's output frame, stream s at s * outputFrameBytes()
+        VkBuffer buffer;
+        MemoryAllocation memory;
+    };
+    std::vector<UploadSlot> uploadSlots;
+    std::vector<ReadbackSlot> readbackSlots;
+
+    // Frame Pipeline (batch mode and DenoisePipeline). Producers fill free
+    // upload slots and queue them with their frame number; renderFrames()
+    // hands each finished readback slot to a handler, which pushes it back to
+    // freeReadbacks once the pixels have been consumed.
+    struct FrameQueues {
+        explicit FrameQueues(size_t slotCount)
+            : freeUploads(slotCount), loadedUploads(slotCount), freeReadbacks(slotCount) {
+            for (size_t i = 0; i < slotCount; i++) {
+                freeUploads.push(static_cast<int>(i));
+                freeReadbacks.push(static_cast<int>(i));
+            }
+        }
+        void close() {
+            freeUploads.close();
+            loadedUploads.close();
+            freeReadbacks.close();
+        }
+
+        BoundedQueue<int> freeUploads;
+        BoundedQueue<std::pair<int64_t, int>> loadedUploads; // frame, upload slot
+        BoundedQueue<int> freeReadbacks;
+    };
+    struct FrameTimes {
+        double renderBusy = 0.0; // Recording and submitting
+        double gpuWait = 0.0;    // Waiting on frame context fences
+        double inputWait = 0.0;  // Waiting for loaded inputs or free readbacks
+    };
+    using ReadbackHandler = std::function<void(int64_t frame, int readbackSlot)>;
 
     // Image Sequence Logic
-    int currentFrameIndex = 0;
     int frameDelayCounter = 0;
-    const int frameDelay = 2; // Simple delay to control playback speed if needed
+    int frameDelay = 2; // Simple delay to control playback speed if needed (1 when headless)
+    int lastUploadSlot = 0; // Upload slot of the last loaded inputs (interactive/headless)
     
+    void loadSequence();
     void initWindow();
     void initVulkan();
     void mainLoop();
@@ -231,71 +441,111 @@ private:
     void createLogicalDevice();
     void createSwapchain();
     void createImageViews();
+    void createHeadlessTarget();
     void createRenderPass();
     void createDescriptorSetLayout();
     void createGraphicsPipeline();
+    void requestPipeline(const PipelineRequest& request);
+    void createPipelines();
+    VkShaderModule getShaderModule(const std::string& file);
+    void destroyShaderModules();
     void createFramebuffers();
     void createCommandPool();
-    void createTextureImage(); // Initial dummy/first frame
-    void createTextureImageView();
+    void createStreamResources(StreamResources& stream);
+    void destroyStreamResources(StreamResources& stream);
+    void createTextureImage(StreamResources& stream); // Initial dummy/first frame
+    void createTextureImageView(StreamResources& stream);
     void createTextureSampler();
-    void createDepthTextureImage();
-    void createDepthTextureImageView();
+    void createDepthTextureImage(StreamResources& stream);
+    void createDepthTextureImageView(StreamResources& stream);
     void createDepthTextureSampler();
     void createDescriptorPool();
-    void createDescriptorSets();
+    void createDescriptorSets(StreamResources& stream);
     void createCommandBuffers();
     void createOffscreenResources();
-    void createDepthDSResources();
+    void createOffscreenImage(StreamResources& stream);
+    void createDepthDSResources(StreamResources& stream);
+    void createHeadlessImage(StreamResources& stream);
     void createFinalDescriptorSetLayout();
     void createSyncObjects();
     
-    void createNormalTextureImage();
-    void createNormalTextureImageView();
+    void createNormalTextureImage(StreamResources& stream);
+    void createNormalTextureImageView(StreamResources& stream);
     void createNormalTextureSampler();
 
-    void createAlbedoTextureImage();
-    void createAlbedoTextureImageView();
+    void createAlbedoTextureImage(StreamResources& stream);
+    void createAlbedoTextureImageView(StreamResources& stream);
     void createAlbedoTextureSampler();
 
-    void createMVTextureImage();
-    void createMVTextureImageView();
+    void createMVTextureImage(StreamResources& stream);
+    void createMVTextureImageView(StreamResources& stream);
     void createMVTextureSampler();
 
     void createTNRResources();
-    void createTNRDescriptorSets();
+    void createTNRImages(StreamResources& stream);
+    void createTNRDescriptorSets(StreamResources& stream);
 
     void createSNRResources();
-    void createSNRDescriptorSets();
+    void createSNRImages(StreamResources& stream);
+    void createSNRDescriptorSets(StreamResources& stream);
 
     void createSNR2Resources();
-    void createSNR2DescriptorSets();
+    void createSNR2Images(StreamResources& stream);
+    void createSNR2DescriptorSets(StreamResources& stream);
 
     void createComputeFresnelResources();
-    void createComputeFresnelDescriptorSets();
+    void createFresnelImages(StreamResources& stream);
+    void createComputeFresnelDescriptorSets(StreamResources& stream);
 
     void createTNR2Resources();
-    void createTNR2DescriptorSets();
+    void createTNR2Images(StreamResources& stream);
+    void createTNR2DescriptorSets(StreamResources& stream);
 
     // Rendering
     void drawFrame();
-    void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+    void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, const UploadSlot* upload);
+    void recordFramePasses(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+    void recordStreamPasses(VkCommandBuffer commandBuffer, StreamResources& stream, VkFramebuffer finalFramebuffer);
+    void uploadInputs(StreamResources& stream);
+
+    // Batch Processing
+    void createUploadSlots(int slotCount, const std::string& group);
+    void destroyUploadSlots();
+    void createBatchResources();
+    void destroyBatchResources();
+    void runBatch();
+    void renderFrames(FrameQueues& queues, const ReadbackHandler& onReadback, FrameTimes& times);
+    void recordUploadCommands(VkCommandBuffer commandBuffer, const UploadSlot& slot);
+    void recordReadbackCommands(VkCommandBuffer commandBuffer, const ReadbackSlot& slot);
+    void recordStreamReadback(VkCommandBuffer commandBuffer, const StreamResources& stream, VkBuffer buffer, VkDeviceSize offset);
+    VkDeviceSize outputFrameBytes() const;
+
+    // Roofline
+    std::vector<PassTraffic> passTraffic() const;
+    double measureCopyBandwidth();
+
+    // CPU reference check (VulkanRendererReference.cpp)
+    RefImage readbackImage(VkImage image, VkFormat format, uint32_t width, uint32_t height, VkImageLayout layout);
+    void checkReference();
     
     // Texture Updating
-    void updateTexture();
+    void updateTexture(StreamResources& stream, MemoryAllocation* inputs);
     void loadRawImage(const std::string& filename, void* pixels, const std::string& fallbackPrefix = "");
     
     // Helpers
     bool checkValidationLayerSupport();
     std::vector<const char*> getRequiredExtensions();
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
-    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
-    void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, MemoryAllocation& bufferMemory, const MemoryTag& tag);
+    void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, MemoryAllocation& imageMemory, const MemoryTag& tag);
+    void freeMemory(MemoryAllocation& allocation);
     VkImageView createImageView(VkImage image, VkFormat format);
     void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
     void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+    void clearHistoryImage(VkImage image);
     VkShaderModule createShaderModule(const std::vector<char>& code);
     
     static std::vector<char> readFile(const std::string& filename);
+    static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
     static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData);
 };
@@ -0,0 +1,537 @@
+#include "BoundedQueue.hpp"
+#include "VulkanRenderer.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <iomanip>
+#include <memory>
+#include <thread>
+
+// Batch mode processes a sequence as fast as possible and keeps every stage
+// busy at the same time:
+//
+//   loader thread : disk -> upload slot (persistently mapped staging memory)
+//   render thread : upload copies + all passes + readback, one submit/frame
+//   encoder pool  : readback slot -> converted/compressed frame -> disk
+//
+// Slots are handed between the stages through bounded queues, so a slow disk
+// or a slow GPU throttles the other stages instead of growing memory.
+//
+// DenoisePipeline reuses the render thread's half (renderFrames) with the
+// caller as the loader and its result callback as the encoder.
+
+using BatchClock = std::chrono::steady_clock;
+
+static double secondsSince(BatchClock::time_point start) {
+  return std::chrono::duration<double>(BatchClock::now() - start).count();
+}
+
+// B1. Create Upload Slots.
+// One upload slot holds a full set of inputs (color, depth, normal, albedo,
+// mv) for every stream, in persistently mapped staging memory.
+void VulkanRenderer::createUploadSlots(int slotCount,
+                                       const std::string &group) {
+  static const char *inputNames[INPUT_CHANNELS] = {"color", "depth", "normal",
+                                                   "albedo", "mv"};
+  const size_t bufferCount = streams.size() * INPUT_CHANNELS;
+
+  uploadSlots.resize(slotCount);
+  for (int i = 0; i < slotCount; i++) {
+    uploadSlots[i].buffers.resize(bufferCount);
+    uploadSlots[i].memories.resize(bufferCount);
+    uploadSlots[i].sources.assign(bufferCount, VK_NULL_HANDLE);
+    uploadSlots[i].sourceOffsets.assign(bufferCount, 0);
+    for (size_t b = 0; b < bufferCount; b++) {
+      const StreamResources &stream = streams[b / INPUT_CHANNELS];
+      createBuffer(stream.sequence.frameBytes(),
+                   VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                       VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                   uploadSlots[i].buffers[b], uploadSlots[i].memories[b],
+                   {group,
+                    stream.tagPrefix + inputNames[b % INPUT_CHANNELS] +
+                        "Upload[" + std::to_string(i) + "]",
+                    MemoryCategory::Staging});
+    }
+  }
+}
+
+void VulkanRenderer::destroyUploadSlots() {
+  for (auto &slot : uploadSlots) {
+    for (size_t b = 0; b < slot.buffers.size(); b++) {
+      vkDestroyBuffer(device, slot.buffers[b], nullptr);
+      freeMemory(slot.memories[b]);
+    }
+  }
+  uploadSlots.clear();
+}
+
+// B2. Create Batch Resources.
+// Upload slots, and readback slots that each hold every stream's output
+// frame. framesInFlight slots are owned by the GPU at any time; the extra
+// ones let the loader and the encoder work ahead of and behind it.
+void VulkanRenderer::createBatchResources() {
+  const int slotCount = config.framesInFlight + 2;
+  createUploadSlots(slotCount, "Batch");
+
+  // The CPU reads the readback buffers, so prefer cached host memory when the
+  // device has it; uncached reads are very slow.
+  VkMemoryPropertyFlags readbackProperties =
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  const VkPhysicalDeviceMemoryProperties &memProperties =
+      memoryAllocator.getMemoryProperties();
+  for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+    VkMemoryPropertyFlags flags = memProperties.memoryTypes[i].propertyFlags;
+    if ((flags & readbackProperties) == readbackProperties &&
+        (flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT)) {
+      readbackProperties |= VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+      break;
+    }
+  }
+
+  readbackSlots.resize(slotCount);
+  for (int i = 0; i < slotCount; i++) {
+    createBuffer(outputFrameBytes() * streams.size(),
+                 VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                 readbackProperties, readbackSlots[i].buffer,
+                 readbackSlots[i].memory,
+                 {"Batch", "readback[" + std::to_string(i) + "]",
+                  MemoryCategory::Staging});
+  }
+}
+
+void VulkanRenderer::destroyBatchResources() {
+  destroyUploadSlots();
+
+  for (auto &slot : readbackSlots) {
+    vkDestroyBuffer(device, slot.buffer, nullptr);
+    freeMemory(slot.memory);
+  }
+  readbackSlots.clear();
+}
+
+// Size of one stream's output frame. TNR2 output is RGBA16F, the final image
+// BGRA8.
+VkDeviceSize VulkanRenderer::outputFrameBytes() const {
+  VkDeviceSize bytesPerPixel =
+      config.outputSource == OutputSource::TNR2 ? 8 : 4;
+  return (VkDeviceSize)frameWidth * frameHeight * bytesPerPixel;
+}
+
+// B3. Record Upload Commands.
+// Copies one upload slot into every stream's input textures at the start of
+// the frame's command buffer, instead of the blocking transitions and copies
+// uploadInputs() submits one by one.
+void VulkanRenderer::recordUploadCommands(VkCommandBuffer commandBuffer,
+                                          const UploadSlot &slot) {
+  std::vector<VkImage> images;
+  for (const auto &stream : streams) {
+    images.insert(images.end(),
+                  {stream.textureImage, stream.depthTextureImage,
+                   stream.normalTextureImage, stream.albedoTextureImage,
+                   stream.mvTextureImage});
+  }
+  const uint32_t imageCount = static_cast<uint32_t>(images.size());
+  uploadBytes += imageCount * (uint64_t)frameWidth * frameHeight * 4;
+
+  std::vector<VkImageMemoryBarrier> barriers(imageCount);
+  for (uint32_t b = 0; b < imageCount; b++) {
+    barriers[b].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barriers[b].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[b].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[b].image = images[b];
+    barriers[b].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barriers[b].subresourceRange.levelCount = 1;
+    barriers[b].subresourceRange.layerCount = 1;
+    // The previous frame's shaders must be done reading before we overwrite.
+    barriers[b].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[b].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[b].srcAccessMask = 0;
+    barriers[b].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  }
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                       nullptr, imageCount, barriers.data());
+
+  VkBufferImageCopy region{};
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.layerCount = 1;
+  region.imageExtent = {frameWidth, frameHeight, 1};
+  for (uint32_t b = 0; b < imageCount; b++) {
+    // Imported host memory is read in place, with no staging copy.
+    VkBuffer source = slot.buffers[b];
+    region.bufferOffset = 0;
+    if (slot.sources[b] != VK_NULL_HANDLE) {
+      source = slot.sources[b];
+      region.bufferOffset = slot.sourceOffsets[b];
+    }
+    vkCmdCopyBufferToImage(commandBuffer, source, images[b],
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+  }
+
+  for (auto &barrier : barriers) {
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  }
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0,
+                       nullptr, imageCount, barriers.data());
+}
+
+// B4. Record Readback Commands.
+// Copies every stream's output of this frame into a readback slot at the end
+// of the frame's command buffer.
+void VulkanRenderer::recordReadbackCommands(VkCommandBuffer commandBuffer,
+                                            const ReadbackSlot &slot) {
+  for (size_t s = 0; s < streams.size(); s++) {
+    recordStreamReadback(commandBuffer, streams[s], slot.buffer,
+                         s * outputFrameBytes());
+  }
+
+  // Make the copies visible to the host once the fence signals.
+  VkBufferMemoryBarrier hostBarrier{};
+  hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  hostBarrier.buffer = slot.buffer;
+  hostBarrier.offset = 0;
+  hostBarrier.size = VK_WHOLE_SIZE;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1,
+                       &hostBarrier, 0, nullptr);
+}
+
+void VulkanRenderer::recordStreamReadback(VkCommandBuffer commandBuffer,
+                                          const StreamResources &stream,
+                                          VkBuffer buffer,
+                                          VkDeviceSize offset) {
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.layerCount = 1;
+  barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+  VkImage source;
+  if (config.outputSource == OutputSource::TNR2) {
+    // This frame's TNR2 output (drawFrame flips tnrHistoryIndex afterwards).
+    // It stays the next frame's history, so return it to SHADER_READ below.
+    source = stream.tnr2Images[1 - tnrHistoryIndex];
+    barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  } else {
+    // The headless final render pass already ends in TRANSFER_SRC.
+    source = stream.finalImage;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  }
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  barrier.image = source;
+  vkCmdPipelineBarrier(commandBuffer,
+                       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                           VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &barrier);
+
+  VkBufferImageCopy region{};
+  region.bufferOffset = offset;
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.layerCount = 1;
+  region.imageExtent = {frameWidth, frameHeight, 1};
+  vkCmdCopyImageToBuffer(commandBuffer, source,
+                         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1,
+                         &region);
+
+  if (config.outputSource == OutputSource::TNR2) {
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr,
+                         0, nullptr, 1, &barrier);
+  }
+}
+
+// B5. Render Frames.
+// The render thread's half of the frame pipeline, shared by batch mode and
+// DenoisePipeline. Pops loaded upload slots in order, records upload, passes
+// and readback into the next frame context and submits it. Once a context's
+// fence has signalled its upload slot is freed and its readback slot handed to
+// onReadback, which must push it back to freeReadbacks when done with it.
+// Returns when loadedUploads is closed and drained, after the GPU has
+// finished every frame.
+void VulkanRenderer::renderFrames(FrameQueues &queues,
+                                  const ReadbackHandler &onReadback,
+                                  FrameTimes &times) {
+  // What each frame context is waiting on: {frame, upload slot, readback slot}
+  struct InFlight {
+    int64_t frame = -1;
+    int uploadSlot = -1;
+    int readbackSlot = -1;
+  };
+  std::vector<InFlight> inFlight(frames.size());
+
+  auto retire = [&](uint32_t context) {
+    BatchClock::time_point start = BatchClock::now();
+    {
+      TRACE_SCOPE("waitForFence");
+      BottleneckClassifier::Scope phase(bottleneck,
+                                        BottleneckClassifier::GpuWait);
+      vkWaitForFences(device, 1, &frames[context].inFlight, VK_TRUE,
+                      UINT64_MAX);
+    }
+    times.gpuWait += secondsSince(start);
+
+    InFlight &done = inFlight[context];
+    if (done.frame >= 0) {
+      TRACE_SCOPE("retireFrame");
+      framePacing.frameFinished(context);
+      queues.freeUploads.push(done.uploadSlot);
+      onReadback(done.frame, done.readbackSlot);
+      done = InFlight();
+    }
+  };
+
+  try {
+    while (true) {
+      retire(currentFrame);
+
+      BatchClock::time_point waitStart = BatchClock::now();
+      std::optional<std::pair<int64_t, int>> upload;
+      std::optional<int> readback;
+      {
+        TRACE_SCOPE("waitForSlots");
+        size_t loaded = queues.loadedUploads.size();
+        bottleneck.sampleInputQueue(loaded,
+                                    queues.loadedUploads.getCapacity());
+        if (loaded > 0) {
+          loaderHits++;
+        } else {
+          loaderStalls++;
+        }
+        {
+          BottleneckClassifier::Scope phase(bottleneck,
+                                            BottleneckClassifier::InputWait);
+          upload = queues.loadedUploads.pop();
+        }
+        if (upload) {
+          BottleneckClassifier::Scope phase(bottleneck,
+                                            BottleneckClassifier::OutputWait);
+          readback = queues.freeReadbacks.pop();
+        }
+      }
+      if (!upload || !readback) {
+        break;
+      }
+      times.inputWait += secondsSince(waitStart);
+      framePacing.frameStarted(currentFrame); // Its input is ready
+
+      TRACE_SCOPE("recordAndSubmit");
+      BottleneckClassifier::Scope phase(bottleneck,
+                                        BottleneckClassifier::Record);
+      BatchClock::time_point recordStart = BatchClock::now();
+      FrameContext &frame = frames[currentFrame];
+      VkCommandBuffer commandBuffer = frame.commandBuffer;
+      vkResetFences(device, 1, &frame.inFlight);
+      vkResetCommandBuffer(commandBuffer, 0);
+
+      VkCommandBufferBeginInfo beginInfo{};
+      beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+      beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+      if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording command buffer!");
+      }
+      recordUploadCommands(commandBuffer, uploadSlots[upload->second]);
+      recordFramePasses(commandBuffer, 0);
+      recordReadbackCommands(commandBuffer, readbackSlots[*readback]);
+      if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record command buffer!");
+      }
+
+      VkSubmitInfo submitInfo{};
+      submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+      submitInfo.commandBufferCount = 1;
+      submitInfo.pCommandBuffers = &commandBuffer;
+      if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, frame.inFlight) !=
+          VK_SUCCESS) {
+        throw std::runtime_error("failed to submit draw command buffer!");
+      }
+      framePacing.frameSubmitted(currentFrame);
+      times.renderBusy += secondsSince(recordStart);
+
+      inFlight[currentFrame] = {upload->first, upload->second, *readback};
+      framesRendered++;
+      bottleneck.frameDone();
+      bottleneck.maybePrintPeriodic(std::cout, gpuMsPerFrame());
+      publishMetrics();
+      tnrHistoryIndex = 1 - tnrHistoryIndex;
+      currentFrame = (currentFrame + 1) % frames.size();
+    }
+
+    // Drain the frames still on the GPU.
+    for (size_t i = 0; i < frames.size(); i++) {
+      retire(currentFrame);
+      currentFrame = (currentFrame + 1) % frames.size();
+    }
+  } catch (...) {
+    queues.close();
+    vkDeviceWaitIdle(device);
+    throw;
+  }
+}
+
+// B6. Batch Loop.
+// Renders frames [firstFrame, firstFrame + frameCount) of every stream and
+// reports how busy each stage was, which tells whether the run is disk, CPU or
+// GPU bound. Streams run in lockstep, so the shortest sequence sets the range.
+void VulkanRenderer::runBatch() {
+  int sequenceFrames = streams[0].sequence.frameCount;
+  for (const auto &stream : streams) {
+    sequenceFrames = std::min(sequenceFrames, stream.sequence.frameCount);
+  }
+  int firstFrame = config.firstFrame;
+  if (firstFrame < 0 || firstFrame >= sequenceFrames) {
+    throw std::runtime_error("first frame is outside the sequence!");
+  }
+  int frameCount = config.frameCount > 0 ? config.frameCount
+                                         : sequenceFrames - firstFrame;
+  int lastFrame = std::min(firstFrame + frameCount, sequenceFrames);
+
+  FrameQueues queues(uploadSlots.size());
+
+  // One encoder per stream, each writing its own directory when there are
+  // several. Without an output directory frames are read back and dropped.
+  std::vector<std::unique_ptr<OutputEncoder>> encoders;
+  if (!config.outputDirectory.empty()) {
+    unsigned workerCount = config.encoderThreads;
+    if (workerCount == 0) {
+      unsigned cores = std::thread::hardware_concurrency();
+      workerCount = cores > 3 ? cores - 3 : 1; // loader, render and writer
+    }
+    workerCount = std::max(1u, workerCount / (unsigned)streams.size());
+    for (size_t s = 0; s < streams.size(); s++) {
+      std::filesystem::path directory = config.outputDirectory;
+      if (streams.size() > 1) {
+        directory /= "stream" + std::to_string(s);
+      }
+      std::filesystem::create_directories(directory);
+      encoders.push_back(std::make_unique<OutputEncoder>(
+          directory.string(),
+          config.outputSource == OutputSource::TNR2 ? "tnr2_" : "final_",
+          config.outputFormat,
+          config.outputSource == OutputSource::TNR2 ? OutputPixels::RGBA16F
+                                                    : OutputPixels::BGRA8,
+          frameWidth, frameHeight, workerCount));
+    }
+  }
+
+  std::exception_ptr loaderError;
+  double loadBusy = 0.0;
+  FrameTimes times;
+
+  BatchClock::time_point batchStart = BatchClock::now();
+  bottleneck.start(config.diagnosisInterval);
+
+  std::thread loader([&]() {
+    CpuTracer::setThreadName("loader");
+    try {
+      static const std::string *prefixes[INPUT_CHANNELS] = {
+          &COLOR_FILE_PREFIX, &DEPTH_FILE_PREFIX, &NORMAL_FILE_PREFIX,
+          &ALBEDO_FILE_PREFIX, &MV_FILE_PREFIX};
+      for (int frame = firstFrame; frame < lastFrame; frame++) {
+        std::optional<int> slot = queues.freeUploads.pop();
+        if (!slot) {
+          break;
+        }
+        TRACE_SCOPE("loadFrame");
+        BottleneckClassifier::Scope phase(bottleneck,
+                                          BottleneckClassifier::LoaderBusy);
+        BatchClock::time_point start = BatchClock::now();
+        UploadSlot &upload = uploadSlots[*slot];
+        for (size_t b = 0; b < upload.memories.size(); b++) {
+          // No fallback prefix: batch mode never wraps to frame 0.
+          const SequenceInfo &sequence = streams[b / INPUT_CHANNELS].sequence;
+          loadRawImage(sequence.framePath(*prefixes[b % INPUT_CHANNELS], frame),
+                       upload.memories[b].mapped, "");
+        }
+        loadBusy += secondsSince(start);
+        queues.loadedUploads.push({frame, *slot});
+      }
+    } catch (...) {
+      loaderError = std::current_exception();
+      queues.close();
+    }
+    queues.loadedUploads.close();
+  });
+
+  // Hand each finished readback slot to the encoders. The last encoder to
+  // convert its stream's part returns the slot.
+  auto encode = [&](int64_t frame, int readbackSlot) {
+    if (encoders.empty()) {
+      queues.freeReadbacks.push(readbackSlot);
+      return;
+    }
+    auto pending =
+        std::make_shared<std::atomic<int>>(static_cast<int>(encoders.size()));
+    const uint8_t *pixels =
+        static_cast<const uint8_t *>(readbackSlots[readbackSlot].memory.mapped);
+    for (size_t s = 0; s < encoders.size(); s++) {
+      encoders[s]->submit(static_cast<int>(frame),
+                          pixels + s * outputFrameBytes(),
+                          [&queues, readbackSlot, pending]() {
+                            if (--*pending == 0) {
+                              queues.freeReadbacks.push(readbackSlot);
+                            }
+                          });
+    }
+  };
+
+  try {
+    renderFrames(queues, encode, times);
+  } catch (...) {
+    loader.join();
+    encoders.clear();
+    throw;
+  }
+
+  queues.freeUploads.close();
+  loader.join();
+  if (loaderError) {
+    std::rethrow_exception(loaderError);
+  }
+  for (auto &encoder : encoders) {
+    encoder->finish();
+  }
+
+  double wallTime = secondsSince(batchStart);
+  auto percent = [&](double seconds) {
+    return wallTime > 0.0 ? 100.0 * seconds / wallTime : 0.0;
+  };
+  double fps = wallTime > 0.0 ? framesRendered / wallTime : 0.0;
+  std::cout << std::fixed << std::setprecision(1) << "Batch: "
+            << framesRendered << " frames x " << streams.size()
+            << " stream(s) in " << wallTime << " s (" << fps << " fps, "
+            << fps * streams.size() << " stream frames/s aggregate, "
+            << frames.size() << " frame(s) in flight)" << std::endl
+            << "  load busy " << percent(loadBusy) << "%, render busy "
+            << percent(times.renderBusy) << "%, waiting on GPU "
+            << percent(times.gpuWait) << "%, waiting on input "
+            << percent(times.inputWait) << "%" << std::endl;
+  framePacing.printReport(std::cout, "GPU complete");
+  bottleneck.printReport(std::cout, gpuMsPerFrame());
+  for (size_t s = 0; s < encoders.size(); s++) {
+    if (encoders.size() > 1) {
+      std::cout << "Stream " << s << ":" << std::endl;
+    }
+    encoders[s]->printStats();
+  }
+}
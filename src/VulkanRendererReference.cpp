@@ -0,0 +1,194 @@
+#include "CpuReference.hpp"
+#include "VulkanRenderer.hpp"
+
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+// Reference check: after a headless run, every pass of stream 0's last frame
+// is recomputed on the CPU (CpuReference.hpp) and compared with what the GPU
+// wrote. Each pass gets the images the GPU actually bound to it, read back
+// from the device, so an error shows up in the pass that made it instead of
+// spreading down the chain.
+
+RefImage VulkanRenderer::readbackImage(VkImage image, VkFormat format,
+                                       uint32_t width, uint32_t height,
+                                       VkImageLayout layout) {
+  bool half = format == VK_FORMAT_R16G16B16A16_SFLOAT;
+  if (!half && format != VK_FORMAT_B8G8R8A8_UNORM) {
+    throw std::runtime_error("unsupported readback format!");
+  }
+  VkDeviceSize size = (VkDeviceSize)width * height * (half ? 8 : 4);
+
+  VkBuffer buffer;
+  MemoryAllocation memory;
+  createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+               buffer, memory,
+               {"Reference", "readback", MemoryCategory::Staging});
+
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandPool = commandPool;
+  allocInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer;
+  vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.layerCount = 1;
+  barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  barrier.oldLayout = layout;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  vkCmdPipelineBarrier(commandBuffer,
+                       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &barrier);
+
+  VkBufferImageCopy region{};
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.layerCount = 1;
+  region.imageExtent = {width, height, 1};
+  vkCmdCopyImageToBuffer(commandBuffer, image,
+                         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1,
+                         &region);
+
+  // Back to where the next frame expects it.
+  if (layout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+    std::swap(barrier.oldLayout, barrier.newLayout);
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr,
+                         0, nullptr, 1, &barrier);
+  }
+  vkEndCommandBuffer(commandBuffer);
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &commandBuffer;
+  vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+  vkQueueWaitIdle(graphicsQueue);
+  vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+
+  RefImage result;
+  if (half) {
+    result = RefImage::fromHalf(static_cast<const uint16_t *>(memory.mapped),
+                                width, height);
+  } else {
+    result = RefImage::fromUnorm8(static_cast<const uint8_t *>(memory.mapped),
+                                  width, height);
+    for (size_t i = 0; i < result.texels.size(); i += 4) {
+      std::swap(result.texels[i], result.texels[i + 2]); // BGRA -> RGBA
+    }
+  }
+  vkDestroyBuffer(device, buffer, nullptr);
+  freeMemory(memory);
+  return result;
+}
+
+// drawFrame() flips tnrHistoryIndex after recording, so it points at the
+// history images the last frame wrote.
+RefImage VulkanRenderer::readbackTnr2() {
+  return readbackImage(streams[0].tnr2Images[tnrHistoryIndex],
+                       VK_FORMAT_R16G16B16A16_SFLOAT, frameWidth, frameHeight,
+                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+void VulkanRenderer::checkReference() {
+  if (framesRendered == 0) {
+    return;
+  }
+  StreamResources &stream = streams[0];
+  const VkFormat HALF4 = VK_FORMAT_R16G16B16A16_SFLOAT;
+  const VkImageLayout SHADER_READ = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  auto readback = [&](VkImage image, uint32_t width, uint32_t height) {
+    return readbackImage(image, HALF4, width, height, SHADER_READ);
+  };
+
+  // drawFrame has flipped tnrHistoryIndex since the last frame was
+  // recorded: that frame wrote the history images at `written` and read the
+  // others.
+  uint32_t written = tnrHistoryIndex;
+  uint32_t read = 1 - written;
+
+  // The upload slot of the last loaded frame still holds its inputs, already
+  // flipped. Stream 0's come first.
+  const UploadSlot &upload = uploadSlots[lastUploadSlot];
+  auto input = [&](int channel) {
+    return RefImage::fromUnorm8(
+        static_cast<const uint8_t *>(upload.memories[channel].mapped),
+        frameWidth, frameHeight);
+  };
+  RefImage color = input(0);
+  RefImage depth = input(1);
+  RefImage normal = input(2);
+  RefImage albedo = input(3);
+  RefImage mv = input(4);
+
+  RefImage depthDS = readback(stream.depthDSImage, rmWidth, rmHeight);
+  RefImage rm = readback(stream.offscreenImage, rmWidth, rmHeight);
+  RefImage tnrColor =
+      readback(stream.tnrIntermediateColorImage, rmWidth, rmHeight);
+  RefImage tnrOut2 = readback(stream.tnrOut2Image, rmWidth, rmHeight);
+  RefImage tnrInfo[2] = {
+      readback(stream.tnrInfoImages[0], rmWidth, rmHeight),
+      readback(stream.tnrInfoImages[1], rmWidth, rmHeight)};
+  RefImage snr[2] = {readback(stream.snrImages[0], rmWidth, rmHeight),
+                     readback(stream.snrImages[1], rmWidth, rmHeight)};
+  RefImage snr2 = readback(stream.snr2Images[written], rmWidth, rmHeight);
+  RefImage fresnel = readback(stream.fresnelImage, frameWidth, frameHeight);
+  RefImage tnr2[2] = {
+      readback(stream.tnr2Images[0], frameWidth, frameHeight),
+      readback(stream.tnr2Images[1], frameWidth, frameHeight)};
+  RefImage finalImage = readbackImage(stream.finalImage, swapchainImageFormat,
+                                      frameWidth, frameHeight,
+                                      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+
+  std::cout << "=== CPU reference check (stream 0, frame " << framesRendered
+            << "; absolute error per channel) ===" << std::endl;
+  std::cout << "  output              max       mean  worst (x, y)   NaN"
+            << std::endl;
+  auto report = [](const std::string &name, const RefImage &reference,
+                   const RefImage &gpu) {
+    printRefError(std::cout, name, compareImages(reference, gpu));
+  };
+
+  report("DepthDS",
+         referenceDepthDS(depth, normal, albedo, rmWidth, rmHeight), depthDS);
+  report("RM", referenceRM(color, depthDS, rmWidth, rmHeight), rm);
+
+  TnrOutputs tnr = referenceTNR(rm, depthDS, mv, snr[read], tnrInfo[read],
+                                rmWidth, rmHeight);
+  report("TNR color", tnr.color, tnrColor);
+  report("TNR info", tnr.info, tnrInfo[written]);
+  report("TNR out2", tnr.out2, tnrOut2);
+
+  // SNR reads the TNR info written this frame.
+  report("SNR",
+         referenceSNR(tnrColor, depthDS, tnrInfo[written], rmWidth, rmHeight),
+         snr[written]);
+  report("SNR2", referenceSNR2(snr[written], rmWidth, rmHeight), snr2);
+  report("Fresnel", referenceFresnel(depth, frameWidth, frameHeight),
+         fresnel);
+  report("TNR2",
+         referenceTNR2(snr2, tnr2[read], depth, mv, fresnel, tnrInfo[written],
+                       frameWidth, frameHeight),
+         tnr2[written]);
+  report("Final", referenceFinal(tnr2[written], frameWidth, frameHeight),
+         finalImage);
+}
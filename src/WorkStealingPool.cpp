@@ -0,0 +1,158 @@
+#include "WorkStealingPool.hpp"
+
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(unsigned threadCount) {
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (unsigned t = 0; t < threadCount; t++) {
+    ranges.push_back(std::make_unique<Range>());
+  }
+  for (unsigned t = 1; t < threadCount; t++) {
+    threads.emplace_back(&WorkStealingPool::workerLoop, this, t);
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  workReady.notify_all();
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+void WorkStealingPool::parallelFor(size_t count,
+                                   const std::function<void(size_t)> &task) {
+  if (count == 0) {
+    return;
+  }
+  size_t workers = ranges.size();
+  for (size_t w = 0; w < workers; w++) {
+    std::lock_guard<std::mutex> lock(ranges[w]->mutex);
+    ranges[w]->begin = count * w / workers;
+    ranges[w]->end = count * (w + 1) / workers;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    currentTask = &task;
+    error = nullptr;
+    busyWorkers = static_cast<unsigned>(threads.size());
+    generation++;
+  }
+  workReady.notify_all();
+
+  runTasks(0);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  workDone.wait(lock, [this]() { return busyWorkers == 0; });
+  currentTask = nullptr;
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+std::vector<size_t> WorkStealingPool::stealCounts() const {
+  std::vector<size_t> counts;
+  for (const auto &range : ranges) {
+    std::lock_guard<std::mutex> lock(range->mutex);
+    counts.push_back(range->steals);
+  }
+  return counts;
+}
+
+void WorkStealingPool::workerLoop(unsigned worker) {
+  uint64_t seen = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      workReady.wait(lock,
+                     [&]() { return stopping || generation != seen; });
+      if (stopping) {
+        return;
+      }
+      seen = generation;
+    }
+    runTasks(worker);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      busyWorkers--;
+    }
+    workDone.notify_one();
+  }
+}
+
+void WorkStealingPool::runTasks(unsigned worker) {
+  const std::function<void(size_t)> &task = *currentTask;
+  size_t index;
+  while (takeIndex(worker, index) || (steal(worker) &&
+                                      takeIndex(worker, index))) {
+    try {
+      task(index);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+      // Drop what is left so every worker finishes soon.
+      for (const auto &range : ranges) {
+        std::lock_guard<std::mutex> rangeLock(range->mutex);
+        range->begin = range->end;
+      }
+    }
+  }
+}
+
+bool WorkStealingPool::takeIndex(unsigned worker, size_t &index) {
+  Range &range = *ranges[worker];
+  std::lock_guard<std::mutex> lock(range.mutex);
+  if (range.begin == range.end) {
+    return false;
+  }
+  index = range.begin++;
+  return true;
+}
+
+// Moves the back half of the largest other range to this worker. Returns
+// false once every range is empty.
+bool WorkStealingPool::steal(unsigned worker) {
+  while (true) {
+    size_t victim = ranges.size();
+    size_t largest = 0;
+    for (size_t w = 0; w < ranges.size(); w++) {
+      if (w == worker) {
+        continue;
+      }
+      std::lock_guard<std::mutex> lock(ranges[w]->mutex);
+      size_t remaining = ranges[w]->end - ranges[w]->begin;
+      if (remaining > largest) {
+        largest = remaining;
+        victim = w;
+      }
+    }
+    if (victim == ranges.size()) {
+      return false;
+    }
+
+    size_t begin, end;
+    {
+      std::lock_guard<std::mutex> lock(ranges[victim]->mutex);
+      size_t remaining = ranges[victim]->end - ranges[victim]->begin;
+      if (remaining == 0) {
+        continue; // Drained meanwhile; look again
+      }
+      end = ranges[victim]->end;
+      begin = end - (remaining + 1) / 2;
+      ranges[victim]->end = begin;
+    }
+    std::lock_guard<std::mutex> lock(ranges[worker]->mutex);
+    ranges[worker]->begin = begin;
+    ranges[worker]->end = end;
+    ranges[worker]->steals += end - begin;
+    return true;
+  }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fork-join thread pool for data-parallel loops with uneven task costs (ray
+// marched tiles next to sky tiles). parallelFor() splits the index range
+// evenly over the workers; each takes indices from the front of its own
+// range, and a worker that runs dry steals the back half of the largest
+// remaining range. Neighbouring indices (tiles of one band) thus stay on one
+// core until the load has to be rebalanced.
+class WorkStealingPool {
+public:
+    // threadCount includes the thread calling parallelFor(); 0: one per core.
+    explicit WorkStealingPool(unsigned threadCount = 0);
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    unsigned getThreadCount() const { return static_cast<unsigned>(ranges.size()); }
+
+    // Runs task(index) for every index in [0, count) and returns when all
+    // are done. The calling thread works too. Rethrows the first exception a
+    // task threw; the remaining indices are skipped. Not reentrant.
+    void parallelFor(size_t count, const std::function<void(size_t)>& task);
+
+    // Tasks each worker stole from others since construction.
+    std::vector<size_t> stealCounts() const;
+
+private:
+    // Indices [begin, end) still to run on one worker.
+    struct Range {
+        mutable std::mutex mutex;
+        size_t begin = 0;
+        size_t end = 0;
+        size_t steals = 0;
+    };
+
+    void workerLoop(unsigned worker);
+    void runTasks(unsigned worker);
+    bool takeIndex(unsigned worker, size_t& index);
+    bool steal(unsigned worker);
+
+    std::vector<std::unique_ptr<Range>> ranges; // One per thread, [0] = caller
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable workReady;
+    std::condition_variable workDone;
+    const std::function<void(size_t)>* currentTask = nullptr;
+    uint64_t generation = 0; // Bumped for every parallelFor()
+    unsigned busyWorkers = 0;
+    bool stopping = false;
+    std::exception_ptr error;
+};
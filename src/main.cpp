@@ -1,12 +1,167 @@
+#include "CpuBatch.hpp"
 #include "VulkanRenderer.hpp"
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
-int main() {
-    VulkanRenderer app;
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [--sequence <dir>]... [--streams <n>] [--headless] [--frames <n>] [--frames-in-flight <n>] [--gpu-profile ...] [--trace <file>] [--pipeline-cache <file>] [--batch ...] [--cpu ...]" << std::endl
+              << "  --sequence <dir>  input sequence directory (default: " << DEFAULT_SEQUENCE_DIR << ")" << std::endl
+              << "                    repeat to process several sequences as independent streams (headless only)" << std::endl
+              << "  --streams <n>     run n streams, reusing the given sequences in turn" << std::endl
+              << "  --headless        render offscreen without a window or swapchain" << std::endl
+              << "  --frames <n>      stop after n frames (headless default: the whole sequence)" << std::endl
+              << "  --frames-in-flight <n>  frames recorded ahead of the GPU, 1-4 (default: 2)" << std::endl
+              << "  --frame-budget <ms>  frame intervals above this count as stalls (default: 16.67)" << std::endl
+              << "  --diagnose-interval <s>  also print the bottleneck diagnosis every s seconds (default: end of run only)" << std::endl
+              << "  --metrics <port|unix:path>  serve live Prometheus metrics over HTTP on 127.0.0.1:<port> or a Unix socket" << std::endl
+              << "  --gpu-profile     time every pass on the GPU and print rolling mean/p50/p99" << std::endl
+              << "  --gpu-profile-interval <s>  seconds between reports, 0: only at exit (default: 5)" << std::endl
+              << "  --gpu-stats       also count vertex/fragment/compute invocations and clipped primitives per pass (implies --gpu-profile)" << std::endl
+              << "  --gpu-profile-out <file>  write the pass times to a .csv or .json file at exit (implies --gpu-profile)" << std::endl
+              << "  --roofline        at exit, compare each pass's bandwidth with a copy benchmark (implies --gpu-profile)" << std::endl
+              << "  --reference-check  at exit, recompute the last frame's passes on the CPU and print their error (implies --headless)" << std::endl
+              << "  --trace <file>    write a Chrome trace (chrome://tracing, Perfetto) of the CPU work of every thread at exit" << std::endl
+              << "  --pipeline-cache <file>  load compiled pipelines from <file> and save them at exit (default: " << (PipelineCache::defaultPath().empty() ? "none" : PipelineCache::defaultPath()) << ")" << std::endl
+              << "  --no-pipeline-cache  compile every pipeline from scratch and save nothing" << std::endl
+              << "  --pipeline-threads <n>  threads compiling the pipelines at startup (default: one per core)" << std::endl
+              << "  --batch           process the sequence offline as fast as possible (implies --headless)" << std::endl
+              << "  --first <n>       batch: first frame to process (default: 0)" << std::endl
+              << "  --output <dir>    batch: write every output frame to <dir>" << std::endl
+              << "  --output-source <final|tnr2>  batch: image to write (default: tnr2)" << std::endl
+              << "  --output-format <raw|png|exr>  batch: file format (default: raw)" << std::endl
+              << "  --encoder-threads <n>  batch: output encoder workers (default: one per spare core)" << std::endl
+              << "  --cpu             run batch mode on the CPU (SIMD, multithreaded) instead of the GPU" << std::endl
+              << "  --cpu-threads <n>  CPU backend: worker threads (default: one per core)" << std::endl
+              << "  --cpu-scaling     time the CPU backend with 1, 2, 4, ... threads and print the scaling" << std::endl;
+}
 
+int main(int argc, char** argv) {
     try {
-        app.run();
+        RendererConfig config;
+        config.pipelineCachePath = PipelineCache::defaultPath();
+        std::vector<std::string> sequences;
+        int streamCount = 0;
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--sequence" && i + 1 < argc) {
+                sequences.push_back(argv[++i]);
+            } else if (arg == "--streams" && i + 1 < argc) {
+                streamCount = std::stoi(argv[++i]);
+                if (streamCount < 1) {
+                    std::cerr << "--streams needs at least 1 stream" << std::endl;
+                    return EXIT_FAILURE;
+                }
+            } else if (arg == "--headless") {
+                config.headless = true;
+            } else if (arg == "--frames" && i + 1 < argc) {
+                config.frameCount = std::stoi(argv[++i]);
+            } else if (arg == "--frames-in-flight" && i + 1 < argc) {
+                config.framesInFlight = std::stoi(argv[++i]);
+            } else if (arg == "--frame-budget" && i + 1 < argc) {
+                config.frameBudgetMs = std::stod(argv[++i]);
+            } else if (arg == "--diagnose-interval" && i + 1 < argc) {
+                config.diagnosisInterval = std::stod(argv[++i]);
+            } else if (arg == "--metrics" && i + 1 < argc) {
+                config.metricsAddress = argv[++i];
+            } else if (arg == "--gpu-profile") {
+                config.gpuProfile = true;
+            } else if (arg == "--gpu-stats") {
+                config.gpuProfile = true;
+                config.gpuPipelineStatistics = true;
+            } else if (arg == "--gpu-profile-interval" && i + 1 < argc) {
+                config.gpuProfileInterval = std::stod(argv[++i]);
+            } else if (arg == "--gpu-profile-out" && i + 1 < argc) {
+                config.gpuProfile = true;
+                config.gpuProfileOutput = argv[++i];
+            } else if (arg == "--roofline") {
+                config.gpuProfile = true;
+                config.roofline = true;
+            } else if (arg == "--reference-check") {
+                config.headless = true;
+                config.referenceCheck = true;
+            } else if (arg == "--trace" && i + 1 < argc) {
+                config.traceOutput = argv[++i];
+            } else if (arg == "--pipeline-cache" && i + 1 < argc) {
+                config.pipelineCachePath = argv[++i];
+            } else if (arg == "--no-pipeline-cache") {
+                config.pipelineCachePath.clear();
+            } else if (arg == "--pipeline-threads" && i + 1 < argc) {
+                config.pipelineThreads = static_cast<unsigned>(std::stoi(argv[++i]));
+            } else if (arg == "--batch") {
+                config.batch = true;
+            } else if (arg == "--first" && i + 1 < argc) {
+                config.firstFrame = std::stoi(argv[++i]);
+            } else if (arg == "--output" && i + 1 < argc) {
+                config.outputDirectory = argv[++i];
+            } else if (arg == "--output-source" && i + 1 < argc) {
+                std::string source = argv[++i];
+                if (source == "final") {
+                    config.outputSource = OutputSource::Final;
+                } else if (source == "tnr2") {
+                    config.outputSource = OutputSource::TNR2;
+                } else {
+                    std::cerr << "Unknown output source: " << source << std::endl;
+                    printUsage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+            } else if (arg == "--output-format" && i + 1 < argc) {
+                std::string format = argv[++i];
+                if (format == "raw") {
+                    config.outputFormat = OutputFormat::Raw;
+                } else if (format == "png") {
+                    config.outputFormat = OutputFormat::PNG;
+                } else if (format == "exr") {
+                    config.outputFormat = OutputFormat::EXR;
+                } else {
+                    std::cerr << "Unknown output format: " << format << std::endl;
+                    printUsage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+            } else if (arg == "--encoder-threads" && i + 1 < argc) {
+                config.encoderThreads = static_cast<unsigned>(std::stoi(argv[++i]));
+            } else if (arg == "--cpu") {
+                config.batch = true;
+                config.cpuBackend = true;
+            } else if (arg == "--cpu-threads" && i + 1 < argc) {
+                config.cpuThreads = static_cast<unsigned>(std::stoi(argv[++i]));
+            } else if (arg == "--cpu-scaling") {
+                config.cpuBackend = true;
+                config.cpuScaling = true;
+            } else if (arg == "--help" || arg == "-h") {
+                printUsage(argv[0]);
+                return EXIT_SUCCESS;
+            } else {
+                std::cerr << "Unknown argument: " << arg << std::endl;
+                printUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+
+        if ((config.batch || config.cpuBackend) && config.referenceCheck) {
+            std::cerr << "--reference-check can't be combined with --batch or --cpu" << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (!sequences.empty()) {
+            config.sequenceDirectories = sequences;
+        }
+        if (streamCount > 0) {
+            std::vector<std::string> directories;
+            for (int s = 0; s < streamCount; s++) {
+                directories.push_back(config.sequenceDirectories[s % config.sequenceDirectories.size()]);
+            }
+            config.sequenceDirectories = directories;
+        }
+
+        if (config.cpuScaling) {
+            runCpuScaling(config);
+        } else if (config.cpuBackend) {
+            runCpuBatch(config);
+        } else {
+            VulkanRenderer app(config);
+            app.run();
+        }
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
         return EXIT_FAILURE;
@@ -0,0 +1,391 @@
+// Writes synthetic input sequences of any size and length, for scaling
+// benchmarks and for exercising the temporal passes:
+//
+//   ./build/vulkanio_generate --out seq_4k --size 3840x2160 --frames 1000
+//
+// The scene is a textured background panning behind spheres that move and
+// bounce at different depths. The spheres occlude each other and the SDF
+// scene of RM.frag, so frames have disocclusions, ray hits and misses, and
+// depth discontinuities that make TNR reject its history. Every channel comes
+// from the same analytic scene, so depth, normals and motion vectors agree
+// with the color:
+//   color  : lit albedo plus per-frame noise (the denoiser's input)
+//   depth  : packed 24-bit nonlinear depth, low byte in R (depthDS.frag), or
+//            linear float32 view depth with --depth-format float32
+//   normal : view-space normal * 0.5 + 0.5
+//   albedo : base color
+//   mv     : offset to the previous frame's UV, packed R10G10 into RGB888
+//            with the quadratic encoding TNR.frag decodes
+// Rows are written bottom-up like every raw input. Frames are independent,
+// so they are generated and written on all cores at once.
+#include "SequenceInfo.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Must match depthDS.frag
+const float NEAR = 0.25f;
+const float FAR = 1000.0f;
+
+const float BACKGROUND_DEPTH = 60.0f; // Behind RM.frag's SDF sphere and plane
+
+enum class DepthFormat { Packed24, Float32 };
+
+struct GeneratorOptions {
+  std::string directory;
+  uint32_t width = 1920;
+  uint32_t height = 864;
+  int frames = 150;
+  int spheres = 8;
+  float noise = 0.08f; // Color noise amplitude
+  uint32_t seed = 1;
+  unsigned threads = 0; // 0: one per core
+  DepthFormat depthFormat = DepthFormat::Packed24;
+};
+
+struct Sphere {
+  float x, y;   // Center at frame 0, in UV
+  float vx, vy; // UV per frame
+  float radius; // In units of the image height
+  float depth;  // Linear view depth of the center
+  float depthSpeed; // Amplitude of the depth oscillation
+  float albedo[3];
+};
+
+struct Scene {
+  std::vector<Sphere> spheres;
+  float panX = 0.0015f; // Background UV per frame
+  float panY = 0.0005f;
+};
+
+struct Surface {
+  float depth; // Linear view depth
+  float normal[3];
+  float albedo[3];
+  float motion[2]; // UV offset to the previous frame
+};
+
+Scene makeScene(const GeneratorOptions &options) {
+  std::mt19937 random(options.seed);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  Scene scene;
+  for (int s = 0; s < options.spheres; s++) {
+    Sphere sphere;
+    sphere.x = unit(random);
+    sphere.y = unit(random);
+    sphere.vx = (unit(random) - 0.5f) * 0.02f;
+    sphere.vy = (unit(random) - 0.5f) * 0.02f;
+    sphere.radius = 0.05f + 0.12f * unit(random);
+    sphere.depth = 3.0f + 20.0f * unit(random);
+    sphere.depthSpeed = 2.0f * unit(random);
+    for (float &channel : sphere.albedo) {
+      channel = 0.2f + 0.8f * unit(random);
+    }
+    scene.spheres.push_back(sphere);
+  }
+  return scene;
+}
+
+// Bounces a coordinate between margin and 1 - margin.
+float bounce(float position, float margin) {
+  float span = std::max(1.0f - 2.0f * margin, 1e-3f);
+  float t = std::fmod(std::abs(position - margin), 2.0f * span);
+  return margin + (t < span ? t : 2.0f * span - t);
+}
+
+// Where a sphere is in one frame and the one before.
+struct PlacedSphere {
+  const Sphere *sphere;
+  float x, y, depth;
+  float previousX, previousY;
+};
+
+void sphereCenter(const Sphere &sphere, float aspect, int frame, float &x,
+                  float &y, float &depth) {
+  float marginX = sphere.radius / aspect;
+  x = bounce(sphere.x + sphere.vx * frame, marginX);
+  y = bounce(sphere.y + sphere.vy * frame, sphere.radius);
+  depth = sphere.depth + sphere.depthSpeed * std::sin(0.05f * frame);
+}
+
+std::vector<PlacedSphere> placeSpheres(const Scene &scene, float aspect,
+                                       int frame) {
+  std::vector<PlacedSphere> placed;
+  for (const Sphere &sphere : scene.spheres) {
+    PlacedSphere p;
+    float previousDepth;
+    p.sphere = &sphere;
+    sphereCenter(sphere, aspect, frame, p.x, p.y, p.depth);
+    sphereCenter(sphere, aspect, frame - 1, p.previousX, p.previousY,
+                 previousDepth);
+    placed.push_back(p);
+  }
+  return placed;
+}
+
+// The nearest surface at pixel (u, v) of a frame; v grows downwards.
+Surface shade(const Scene &scene, const std::vector<PlacedSphere> &spheres,
+              float u, float v, float aspect, int frame) {
+  Surface surface;
+  surface.depth = BACKGROUND_DEPTH;
+  surface.normal[0] = 0.0f;
+  surface.normal[1] = 0.0f;
+  surface.normal[2] = -1.0f;
+  int cell = (int)std::floor((u + scene.panX * frame) * 16.0f) +
+             (int)std::floor((v + scene.panY * frame) * 16.0f / aspect);
+  std::fill(surface.albedo, surface.albedo + 3, (cell & 1) ? 0.7f : 0.35f);
+  surface.motion[0] = -scene.panX;
+  surface.motion[1] = -scene.panY;
+
+  for (const PlacedSphere &placed : spheres) {
+    const Sphere &sphere = *placed.sphere;
+    float dx = (u - placed.x) * aspect / sphere.radius;
+    float dy = (v - placed.y) / sphere.radius;
+    float r2 = dx * dx + dy * dy;
+    if (r2 >= 1.0f) {
+      continue;
+    }
+    float dz = std::sqrt(1.0f - r2);
+    float depth = placed.depth - dz * sphere.radius * 10.0f;
+    if (depth >= surface.depth) {
+      continue;
+    }
+    surface.depth = depth;
+    surface.normal[0] = dx;
+    surface.normal[1] = -dy; // View space: y up
+    surface.normal[2] = -dz;
+    std::copy(sphere.albedo, sphere.albedo + 3, surface.albedo);
+    surface.motion[0] = placed.previousX - placed.x;
+    surface.motion[1] = placed.previousY - placed.y;
+  }
+  return surface;
+}
+
+uint8_t toUnorm8(float value) {
+  return static_cast<uint8_t>(
+      std::lround(std::min(std::max(value, 0.0f), 1.0f) * 255.0f));
+}
+
+// Inverse of TNR.frag's decode: m = sign(n - 0.5) * ((n - 0.5) * 2)^2.
+uint32_t encodeMotion(float motion) {
+  float offset = std::sqrt(std::min(std::abs(motion), 1.0f)) * 0.5f;
+  float normalized = 0.5f + (motion < 0.0f ? -offset : offset);
+  return static_cast<uint32_t>(std::lround(normalized * 1023.0f));
+}
+
+// Inverse of depthDS.frag's linearization.
+uint32_t packDepth(float linearDepth) {
+  float z = (FAR - NEAR * FAR / linearDepth) / (FAR - NEAR);
+  return static_cast<uint32_t>(
+      std::lround(std::min(std::max(z, 0.0f), 1.0f) * 16777215.0f));
+}
+
+uint32_t hash(uint32_t x) {
+  x ^= x >> 16;
+  x *= 0x7feb352d;
+  x ^= x >> 15;
+  x *= 0x846ca68b;
+  x ^= x >> 16;
+  return x;
+}
+
+// Renders the five channels of one frame into the buffers.
+void renderFrame(const Scene &scene, const GeneratorOptions &options,
+                 int frame, std::vector<std::vector<uint8_t>> &channels) {
+  const uint32_t width = options.width, height = options.height;
+  const float aspect = (float)width / height;
+  const float light[3] = {0.4f, 0.6f, -0.7f}; // Towards the light, ~unit
+  const std::vector<PlacedSphere> spheres = placeSpheres(scene, aspect, frame);
+  for (uint32_t y = 0; y < height; y++) {
+    size_t row = (size_t)(height - 1 - y) * width; // Bottom-up
+    for (uint32_t x = 0; x < width; x++) {
+      Surface surface = shade(scene, spheres, (x + 0.5f) / width,
+                              (y + 0.5f) / height, aspect, frame);
+      uint8_t *color = &channels[0][(row + x) * 4];
+      uint8_t *depth = &channels[1][(row + x) * 4];
+      uint8_t *normal = &channels[2][(row + x) * 4];
+      uint8_t *albedo = &channels[3][(row + x) * 4];
+      uint8_t *mv = &channels[4][(row + x) * 4];
+
+      float lambert = std::max(0.15f, surface.normal[0] * light[0] +
+                                          surface.normal[1] * light[1] +
+                                          surface.normal[2] * light[2]);
+      uint32_t noiseBits =
+          hash(options.seed ^ hash(frame * 0x9e3779b9u ^ hash(y * width + x)));
+      for (int c = 0; c < 3; c++) {
+        float noise = ((noiseBits >> (8 * c)) & 0xff) / 255.0f - 0.5f;
+        color[c] = toUnorm8(surface.albedo[c] * lambert +
+                            2.0f * options.noise * noise);
+        normal[c] = toUnorm8(surface.normal[c] * 0.5f + 0.5f);
+        albedo[c] = toUnorm8(surface.albedo[c]);
+      }
+      color[3] = normal[3] = albedo[3] = 255;
+
+      if (options.depthFormat == DepthFormat::Packed24) {
+        uint32_t packed = packDepth(surface.depth);
+        depth[0] = packed & 0xff;
+        depth[1] = (packed >> 8) & 0xff;
+        depth[2] = (packed >> 16) & 0xff;
+        depth[3] = 255;
+      } else {
+        std::memcpy(depth, &surface.depth, 4);
+      }
+
+      uint32_t packed = encodeMotion(surface.motion[0]) |
+                        (encodeMotion(surface.motion[1]) << 10);
+      mv[0] = (packed >> 16) & 0xff;
+      mv[1] = (packed >> 8) & 0xff;
+      mv[2] = packed & 0xff;
+      mv[3] = 255;
+    }
+  }
+}
+
+void generate(const GeneratorOptions &options) {
+  static const std::string *prefixes[] = {
+      &COLOR_FILE_PREFIX, &DEPTH_FILE_PREFIX, &NORMAL_FILE_PREFIX,
+      &ALBEDO_FILE_PREFIX, &MV_FILE_PREFIX};
+  std::filesystem::create_directories(options.directory);
+  std::ofstream(options.directory + "/sequence.txt")
+      << "width=" << options.width << "\nheight=" << options.height
+      << "\nframes=" << options.frames << "\n";
+
+  SequenceInfo sequence;
+  sequence.directory = options.directory;
+  sequence.width = options.width;
+  sequence.height = options.height;
+  const Scene scene = makeScene(options);
+
+  unsigned threadCount = options.threads;
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threadCount = std::min<unsigned>(threadCount, options.frames);
+
+  std::atomic<int> nextFrame{0};
+  std::atomic<bool> failed{false};
+  auto worker = [&] {
+    std::vector<std::vector<uint8_t>> channels(
+        5, std::vector<uint8_t>(sequence.frameBytes()));
+    for (int frame = nextFrame++; frame < options.frames && !failed;
+         frame = nextFrame++) {
+      renderFrame(scene, options, frame, channels);
+      for (int c = 0; c < 5; c++) {
+        std::ofstream file(sequence.framePath(*prefixes[c], frame),
+                           std::ios::binary);
+        file.write(reinterpret_cast<const char *>(channels[c].data()),
+                   channels[c].size());
+        if (!file) {
+          failed = true;
+        }
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < threadCount; t++) {
+    threads.emplace_back(worker);
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  if (failed) {
+    throw std::runtime_error("failed to write frames to " + options.directory +
+                             "!");
+  }
+}
+
+void printUsage(const char *program) {
+  std::cout
+      << "Usage: " << program << " --out <dir> [options]\n"
+      << "  --size <w>x<h>      frame size (default: 1920x864)\n"
+      << "  --frames <n>        sequence length (default: 150)\n"
+      << "  --spheres <n>       moving spheres (default: 8)\n"
+      << "  --noise <a>         color noise amplitude, 0-1 (default: 0.08)\n"
+      << "  --seed <n>          scene and noise seed (default: 1)\n"
+      << "  --depth-format <packed24|float32>  depth encoding (default: "
+         "packed24, what the player reads)\n"
+      << "  --threads <n>       writer threads (default: one per core)"
+      << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    GeneratorOptions options;
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      if (arg == "--out" && i + 1 < argc) {
+        options.directory = argv[++i];
+      } else if (arg == "--size" && i + 1 < argc) {
+        std::string size = argv[++i];
+        size_t x = size.find('x');
+        if (x == std::string::npos) {
+          throw std::runtime_error("--size needs <width>x<height>!");
+        }
+        options.width = std::stoul(size.substr(0, x));
+        options.height = std::stoul(size.substr(x + 1));
+      } else if (arg == "--frames" && i + 1 < argc) {
+        options.frames = std::stoi(argv[++i]);
+      } else if (arg == "--spheres" && i + 1 < argc) {
+        options.spheres = std::stoi(argv[++i]);
+      } else if (arg == "--noise" && i + 1 < argc) {
+        options.noise = std::stof(argv[++i]);
+      } else if (arg == "--seed" && i + 1 < argc) {
+        options.seed = std::stoul(argv[++i]);
+      } else if (arg == "--depth-format" && i + 1 < argc) {
+        std::string format = argv[++i];
+        if (format == "packed24") {
+          options.depthFormat = DepthFormat::Packed24;
+        } else if (format == "float32") {
+          options.depthFormat = DepthFormat::Float32;
+        } else {
+          throw std::runtime_error("unknown depth format: " + format + "!");
+        }
+      } else if (arg == "--threads" && i + 1 < argc) {
+        options.threads = static_cast<unsigned>(std::stoi(argv[++i]));
+      } else if (arg == "--help" || arg == "-h") {
+        printUsage(argv[0]);
+        return EXIT_SUCCESS;
+      } else {
+        std::cerr << "Unknown argument: " << arg << std::endl;
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+      }
+    }
+    if (options.directory.empty() || options.width == 0 ||
+        options.height == 0 || options.frames < 1) {
+      printUsage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    generate(options);
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    double bytes = 5.0 * options.width * options.height * 4 * options.frames;
+    std::cout << "Wrote " << options.frames << " frames of " << options.width
+              << "x" << options.height << " to " << options.directory
+              << " in " << seconds << " s (" << bytes / seconds / 1e6
+              << " MB/s)" << std::endl;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
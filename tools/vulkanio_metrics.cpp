@@ -0,0 +1,289 @@
+// Scores the image quality of one sequence of frames against another with
+// PSNR, SSIM and FLIP-lite (src/ImageMetrics.hpp):
+//
+//   ./build/vulkanio_metrics golden_out run_out --per-frame --json q.json
+//
+// Either side is a directory of
+//   - raw outputs of a batch run (--output): tnr2_NNNN.raw (RGBA16F) or
+//     final_NNNN.raw (BGRA8), or
+//   - an input sequence, whose color frames are compared.
+// Raw files carry no size: it comes from --size, else from the sequence.txt
+// of either directory, else the default 1920x864. Both sides store rows
+// bottom-up, and the scores don't depend on the row order anyway.
+#include "ImageMetrics.hpp"
+#include "PixelConvert.hpp"
+#include "SequenceInfo.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+enum class FrameSource { TNR2, Final, SequenceColor };
+
+struct MetricsOptions {
+  std::string directories[2]; // Reference, test
+  uint32_t width = 0;         // 0: from a sequence.txt
+  uint32_t height = 0;
+  int first = 0;
+  int frames = 0; // 0: every frame both sides have
+  unsigned threads = 0;
+  bool perFrame = false;
+  std::string json;
+};
+
+struct FrameSet {
+  std::string directory;
+  FrameSource source;
+};
+
+std::string outputPath(const std::string &directory, const char *prefix,
+                       int frame) {
+  std::ostringstream oss;
+  oss << directory << "/" << prefix << std::setw(4) << std::setfill('0')
+      << frame << ".raw";
+  return oss.str();
+}
+
+const char *sourceName(FrameSource source) {
+  switch (source) {
+  case FrameSource::TNR2:
+    return "tnr2";
+  case FrameSource::Final:
+    return "final";
+  case FrameSource::SequenceColor:
+    return "color input";
+  }
+  return "?";
+}
+
+FrameSet detect(const std::string &directory, int first) {
+  if (std::filesystem::exists(outputPath(directory, "tnr2_", first))) {
+    return {directory, FrameSource::TNR2};
+  }
+  if (std::filesystem::exists(outputPath(directory, "final_", first))) {
+    return {directory, FrameSource::Final};
+  }
+  SequenceInfo sequence;
+  sequence.directory = directory;
+  if (std::filesystem::exists(sequence.framePath(COLOR_FILE_PREFIX, first))) {
+    return {directory, FrameSource::SequenceColor};
+  }
+  throw std::runtime_error("no tnr2_, final_ or color input frames in " +
+                           directory + "!");
+}
+
+std::string framePath(const FrameSet &set, int frame) {
+  switch (set.source) {
+  case FrameSource::TNR2:
+    return outputPath(set.directory, "tnr2_", frame);
+  case FrameSource::Final:
+    return outputPath(set.directory, "final_", frame);
+  case FrameSource::SequenceColor:
+    break;
+  }
+  SequenceInfo sequence;
+  sequence.directory = set.directory;
+  return sequence.framePath(COLOR_FILE_PREFIX, frame);
+}
+
+// False when the frame doesn't exist.
+bool loadFrame(const FrameSet &set, int frame, uint32_t width,
+               uint32_t height, RefImage &image) {
+  std::ifstream file(framePath(set, frame), std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  size_t pixels = (size_t)width * height;
+  size_t bytes = pixels * (set.source == FrameSource::TNR2 ? 8 : 4);
+  std::vector<char> data(bytes);
+  file.read(data.data(), bytes);
+  if ((size_t)file.gcount() != bytes || file.peek() != EOF) {
+    throw std::runtime_error(framePath(set, frame) + " is not " +
+                             std::to_string(width) + "x" +
+                             std::to_string(height) + " " +
+                             sourceName(set.source) + "!");
+  }
+  if (set.source == FrameSource::TNR2) {
+    image = RefImage::fromHalf(reinterpret_cast<uint16_t *>(data.data()),
+                               width, height);
+    return true;
+  }
+  image = RefImage::fromUnorm8(reinterpret_cast<uint8_t *>(data.data()),
+                               width, height);
+  if (set.source == FrameSource::Final) {
+    for (size_t i = 0; i < pixels; i++) {
+      std::swap(image.texels[i * 4], image.texels[i * 4 + 2]); // BGRA
+    }
+  }
+  return true;
+}
+
+void findSize(MetricsOptions &options) {
+  if (options.width != 0) {
+    return;
+  }
+  SequenceInfo sequence;
+  for (const std::string &directory : options.directories) {
+    if (std::filesystem::exists(directory + "/sequence.txt")) {
+      sequence = SequenceInfo::load(directory);
+      break;
+    }
+  }
+  options.width = sequence.width;
+  options.height = sequence.height;
+}
+
+void printUsage(const char *program) {
+  std::cout
+      << "Usage: " << program << " <reference dir> <test dir> [options]\n"
+      << "  --size <w>x<h>   frame size of raw outputs (default: from "
+         "sequence.txt, else 1920x864)\n"
+      << "  --first <n>      first frame (default: 0)\n"
+      << "  --frames <n>     frames to compare (default: all both have)\n"
+      << "  --threads <n>    metric threads (default: one per core)\n"
+      << "  --per-frame      print the scores of every frame\n"
+      << "  --json <file>    write the per-frame scores and the summary"
+      << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    MetricsOptions options;
+    int positional = 0;
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      if (arg == "--size" && i + 1 < argc) {
+        std::string size = argv[++i];
+        size_t x = size.find('x');
+        if (x == std::string::npos) {
+          throw std::runtime_error("--size needs <width>x<height>!");
+        }
+        options.width = std::stoul(size.substr(0, x));
+        options.height = std::stoul(size.substr(x + 1));
+      } else if (arg == "--first" && i + 1 < argc) {
+        options.first = std::stoi(argv[++i]);
+      } else if (arg == "--frames" && i + 1 < argc) {
+        options.frames = std::stoi(argv[++i]);
+      } else if (arg == "--threads" && i + 1 < argc) {
+        options.threads = static_cast<unsigned>(std::stoi(argv[++i]));
+      } else if (arg == "--per-frame") {
+        options.perFrame = true;
+      } else if (arg == "--json" && i + 1 < argc) {
+        options.json = argv[++i];
+      } else if (arg == "--help" || arg == "-h") {
+        printUsage(argv[0]);
+        return EXIT_SUCCESS;
+      } else if (arg.rfind("--", 0) != 0 && positional < 2) {
+        options.directories[positional++] = arg;
+      } else {
+        std::cerr << "Unknown argument: " << arg << std::endl;
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+      }
+    }
+    if (positional != 2 || options.first < 0 || options.frames < 0) {
+      printUsage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    findSize(options);
+    if (options.width == 0 || options.height == 0) {
+      throw std::runtime_error("frame size must not be empty!");
+    }
+
+    FrameSet sets[2] = {detect(options.directories[0], options.first),
+                        detect(options.directories[1], options.first)};
+    std::cout << "Comparing " << sourceName(sets[1].source) << " frames of "
+              << sets[1].directory << " against " << sourceName(sets[0].source)
+              << " frames of " << sets[0].directory << " (" << options.width
+              << "x" << options.height << ")" << std::endl;
+
+    ImageMetrics metrics(options.threads);
+    std::vector<QualityScores> scores;
+    double metricSeconds = 0.0;
+    RefImage images[2];
+    int last = options.frames > 0 ? options.first + options.frames : -1;
+    for (int frame = options.first; last < 0 || frame < last; frame++) {
+      if (!loadFrame(sets[0], frame, options.width, options.height,
+                     images[0]) ||
+          !loadFrame(sets[1], frame, options.width, options.height,
+                     images[1])) {
+        if (last >= 0) {
+          throw std::runtime_error("frame " + std::to_string(frame) +
+                                   " is missing!");
+        }
+        break;
+      }
+      auto start = std::chrono::steady_clock::now();
+      scores.push_back(metrics.compare(images[0], images[1]));
+      metricSeconds += std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+      if (options.perFrame) {
+        const QualityScores &s = scores.back();
+        std::cout << "  frame " << std::setw(4) << frame << std::fixed
+                  << std::setprecision(2) << "  PSNR " << std::setw(6)
+                  << s.psnr << " dB" << std::setprecision(4) << "  SSIM "
+                  << s.ssim << "  FLIP " << s.flip << std::defaultfloat
+                  << std::endl;
+      }
+    }
+    if (scores.empty()) {
+      throw std::runtime_error("no frames to compare!");
+    }
+
+    QualityScores mean, worst = scores[0];
+    for (const QualityScores &s : scores) {
+      mean.psnr += s.psnr / scores.size();
+      mean.ssim += s.ssim / scores.size();
+      mean.flip += s.flip / scores.size();
+      worst.psnr = std::min(worst.psnr, s.psnr);
+      worst.ssim = std::min(worst.ssim, s.ssim);
+      worst.flip = std::max(worst.flip, s.flip);
+    }
+    double megapixels =
+        (double)options.width * options.height * scores.size() / 1e6;
+    std::cout << std::fixed << scores.size() << " frames: PSNR "
+              << std::setprecision(2) << mean.psnr << " dB (min "
+              << worst.psnr << "), SSIM " << std::setprecision(4) << mean.ssim
+              << " (min " << worst.ssim << "), FLIP " << mean.flip
+              << " (max " << worst.flip << ")" << std::endl;
+    std::cout << std::setprecision(1) << "Metrics: " << megapixels / metricSeconds
+              << " Mpixel/s on " << metrics.getThreadCount() << " threads"
+              << std::defaultfloat << std::endl;
+
+    if (!options.json.empty()) {
+      std::ofstream out(options.json);
+      out << std::setprecision(6) << "{\n  \"frames\": [\n";
+      for (size_t i = 0; i < scores.size(); i++) {
+        out << "    {\"frame\": " << options.first + (int)i
+            << ", \"psnr\": " << scores[i].psnr << ", \"ssim\": "
+            << scores[i].ssim << ", \"flip\": " << scores[i].flip << "}"
+            << (i + 1 < scores.size() ? "," : "") << "\n";
+      }
+      out << "  ],\n  \"mean\": {\"psnr\": " << mean.psnr
+          << ", \"ssim\": " << mean.ssim << ", \"flip\": " << mean.flip
+          << "},\n  \"worst\": {\"psnr\": " << worst.psnr
+          << ", \"ssim\": " << worst.ssim << ", \"flip\": " << worst.flip
+          << "}\n}\n";
+      if (!out) {
+        throw std::runtime_error("failed to write " + options.json + "!");
+      }
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,314 @@
+// Checks that frames pushed from memory through DenoisePipeline give the same
+// output as the same frames read from files in batch mode:
+//
+//   ./build/vulkanio_pushcheck --size 320x144 --frames 4
+//
+// A small sequence with a vertically asymmetric scene and non-zero motion
+// vectors is written to a temporary directory. Batch mode renders it from the
+// files; DenoisePipeline renders it again from memory, once copied into
+// staging and, where the device can import host memory, once read in place.
+// Pushed inputs and results are top-down, so a pipeline that uploaded them in
+// the files' bottom-up order would reproject TNR's history with the wrong
+// vertical motion and fail the comparison. Exits with 1 on a mismatch.
+#include "DenoisePipeline.hpp"
+#include "PixelConvert.hpp"
+#include "SequenceInfo.hpp"
+#include "VulkanRenderer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const std::string *const PREFIXES[DENOISE_CHANNELS] = {
+    &COLOR_FILE_PREFIX, &DEPTH_FILE_PREFIX, &NORMAL_FILE_PREFIX,
+    &ALBEDO_FILE_PREFIX, &MV_FILE_PREFIX};
+
+// Motion of the scene per frame, in UV. The y part is what a row order
+// mistake flips.
+const float MOTION_X = 0.01f;
+const float MOTION_Y = 0.03f;
+
+// The five channels of every frame, rows top to bottom.
+using Frames = std::vector<std::vector<std::vector<uint8_t>>>;
+
+struct CheckOptions {
+  uint32_t width = 320;
+  uint32_t height = 144;
+  int frames = 4;
+};
+
+// Removes the temporary sequence however the check ends.
+class TemporaryDirectory {
+public:
+  TemporaryDirectory()
+      : path(fs::temp_directory_path() /
+             ("vulkanio_pushcheck_" + std::to_string(std::random_device()()))) {
+    fs::create_directories(path);
+  }
+  ~TemporaryDirectory() {
+    std::error_code error;
+    fs::remove_all(path, error);
+  }
+  TemporaryDirectory(const TemporaryDirectory &) = delete;
+  TemporaryDirectory &operator=(const TemporaryDirectory &) = delete;
+
+  const fs::path path;
+};
+
+// Inverse of TNR.frag's decode (as in vulkanio_generate).
+uint32_t encodeMotion(float motion) {
+  float offset = std::sqrt(std::min(std::abs(motion), 1.0f)) * 0.5f;
+  float normalized = 0.5f + (motion < 0.0f ? -offset : offset);
+  return static_cast<uint32_t>(std::lround(normalized * 1023.0f));
+}
+
+// The five channels of one frame, rows top to bottom. The scene moves by
+// the motion vectors from frame to frame and has no vertical symmetry.
+std::vector<std::vector<uint8_t>> makeFrame(uint32_t width, uint32_t height,
+                                            int frame) {
+  std::vector<std::vector<uint8_t>> channels(
+      DENOISE_CHANNELS, std::vector<uint8_t>((size_t)width * height * 4));
+  uint32_t packed = encodeMotion(MOTION_X) | (encodeMotion(MOTION_Y) << 10);
+  for (uint32_t y = 0; y < height; y++) {
+    for (uint32_t x = 0; x < width; x++) {
+      size_t i = ((size_t)y * width + x) * 4;
+      // Scene coordinates of this pixel: the scene point under uv was at
+      // uv + motion in the previous frame.
+      int sx = static_cast<int>(x + frame * MOTION_X * width);
+      int sy = static_cast<int>(y + frame * MOTION_Y * height);
+      uint8_t checker = ((sx >> 3) ^ (sy >> 3)) & 1 ? 200 : 60;
+      uint8_t ramp = static_cast<uint8_t>(255 * y / std::max(1u, height - 1));
+      uint8_t *color = &channels[0][i];
+      color[0] = checker;
+      color[1] = ramp;
+      color[2] = static_cast<uint8_t>((sx * 7 + sy * 3) & 0xff);
+      color[3] = 255;
+      uint8_t *depth = &channels[1][i];
+      depth[0] = depth[1] = 0;
+      depth[2] = static_cast<uint8_t>(128 + y * 64 / height);
+      depth[3] = 255;
+      uint8_t *normal = &channels[2][i];
+      normal[0] = 128;
+      normal[1] = ramp;
+      normal[2] = 255 - ramp / 2;
+      normal[3] = 255;
+      uint8_t *albedo = &channels[3][i];
+      albedo[0] = checker;
+      albedo[1] = checker;
+      albedo[2] = ramp;
+      albedo[3] = 255;
+      uint8_t *mv = &channels[4][i];
+      mv[0] = (packed >> 16) & 0xff;
+      mv[1] = (packed >> 8) & 0xff;
+      mv[2] = packed & 0xff;
+      mv[3] = 255;
+    }
+  }
+  return channels;
+}
+
+// Writes the frames as a sequence, rows bottom-up like every raw input.
+void writeSequence(const fs::path &directory, const CheckOptions &options,
+                   const Frames &frames) {
+  std::ofstream(directory / "sequence.txt")
+      << "width=" << options.width << "\nheight=" << options.height
+      << "\nframes=" << options.frames << "\n";
+  SequenceInfo sequence;
+  sequence.directory = directory.string();
+  for (int frame = 0; frame < options.frames; frame++) {
+    for (int c = 0; c < DENOISE_CHANNELS; c++) {
+      std::vector<uint8_t> pixels = frames[frame][c];
+      flipRows(pixels.data(), (size_t)options.width * 4, options.height);
+      std::ofstream(sequence.framePath(*PREFIXES[c], frame), std::ios::binary)
+          .write(reinterpret_cast<const char *>(pixels.data()),
+                 pixels.size());
+    }
+  }
+}
+
+// TNR2 outputs of batch mode, flipped back to top-down.
+std::vector<std::vector<uint8_t>> renderFiles(const fs::path &sequence,
+                                              const fs::path &output,
+                                              const CheckOptions &options) {
+  RendererConfig config;
+  config.sequenceDirectories = {sequence.string()};
+  config.batch = true;
+  config.headless = true;
+  config.frameCount = options.frames;
+  config.outputDirectory = output.string();
+  config.outputSource = OutputSource::TNR2;
+  config.outputFormat = OutputFormat::Raw;
+  VulkanRenderer(config).run();
+
+  size_t bytes = (size_t)options.width * options.height * 8;
+  std::vector<std::vector<uint8_t>> results;
+  for (int frame = 0; frame < options.frames; frame++) {
+    std::ostringstream name;
+    name << "tnr2_" << std::setw(4) << std::setfill('0') << frame << ".raw";
+    std::vector<uint8_t> pixels(bytes);
+    std::ifstream file(output / name.str(), std::ios::binary);
+    file.read(reinterpret_cast<char *>(pixels.data()), bytes);
+    if ((size_t)file.gcount() != bytes) {
+      throw std::runtime_error("batch mode wrote no " + name.str() + "!");
+    }
+    flipRows(pixels.data(), (size_t)options.width * 8, options.height);
+    results.push_back(std::move(pixels));
+  }
+  return results;
+}
+
+// TNR2 results of DenoisePipeline for frames pushed from memory. imported:
+// the inputs lie in imported host memory; false if the device can't import.
+bool renderPushed(const CheckOptions &options, const Frames &frames,
+                  bool imported, std::vector<std::vector<uint8_t>> &results) {
+  DenoiseOptions denoise;
+  denoise.width = options.width;
+  denoise.height = options.height;
+  denoise.output = OutputSource::TNR2;
+  results.assign(options.frames, {});
+  DenoisePipeline pipeline(denoise, [&](const DenoiseResult &result) {
+    const uint8_t *pixels = static_cast<const uint8_t *>(result.pixels);
+    results[result.frame].assign(pixels, pixels + result.size);
+  });
+
+  // All inputs in one page-aligned block, so they can be imported whole.
+  size_t inputBytes = pipeline.inputBytes();
+  size_t alignment = std::max<size_t>(pipeline.hostMemoryAlignment(), 4096);
+  size_t blockBytes =
+      ((options.frames * DENOISE_CHANNELS * inputBytes + alignment - 1) /
+       alignment) *
+      alignment;
+  struct AlignedFree {
+    void operator()(uint8_t *p) const { std::free(p); }
+  };
+  std::unique_ptr<uint8_t, AlignedFree> block(
+      static_cast<uint8_t *>(std::aligned_alloc(alignment, blockBytes)));
+  if (!block) {
+    throw std::runtime_error("failed to allocate the input block!");
+  }
+  if (imported && !pipeline.importHostMemory(block.get(), blockBytes)) {
+    return false;
+  }
+
+  for (int frame = 0; frame < options.frames; frame++) {
+    const void *inputs[DENOISE_CHANNELS];
+    for (int c = 0; c < DENOISE_CHANNELS; c++) {
+      uint8_t *input =
+          block.get() + (frame * DENOISE_CHANNELS + c) * inputBytes;
+      std::memcpy(input, frames[frame][c].data(), inputBytes);
+      inputs[c] = input;
+    }
+    pipeline.pushFrame(inputs);
+  }
+  pipeline.finish();
+  if (imported) {
+    pipeline.releaseHostMemory(block.get());
+    if (pipeline.importedInputs() == 0) {
+      throw std::runtime_error("no input was read from imported memory!");
+    }
+  }
+  return true;
+}
+
+// Frames whose pushed result differs from batch mode's.
+int compare(const char *mode, const std::vector<std::vector<uint8_t>> &files,
+            const std::vector<std::vector<uint8_t>> &pushed) {
+  int mismatches = 0;
+  for (size_t frame = 0; frame < files.size(); frame++) {
+    if (pushed[frame] != files[frame]) {
+      size_t differing = 0;
+      for (size_t i = 0; i + 8 <= files[frame].size(); i += 8) {
+        differing += std::memcmp(&files[frame][i], &pushed[frame][i], 8) != 0;
+      }
+      std::cout << "  " << mode << ": frame " << frame << " differs in "
+                << differing << " pixels" << std::endl;
+      mismatches++;
+    }
+  }
+  std::cout << mode << ": " << files.size() - mismatches << "/"
+            << files.size() << " frames identical to batch mode" << std::endl;
+  return mismatches;
+}
+
+void printUsage(const char *program) {
+  std::cout << "Usage: " << program << " [options]\n"
+            << "  --size <w>x<h>   frame size (default: 320x144)\n"
+            << "  --frames <n>     frames to compare (default: 4)"
+            << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    CheckOptions options;
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      if (arg == "--size" && i + 1 < argc) {
+        std::string size = argv[++i];
+        size_t x = size.find('x');
+        if (x == std::string::npos) {
+          throw std::runtime_error("--size needs <width>x<height>!");
+        }
+        options.width = std::stoul(size.substr(0, x));
+        options.height = std::stoul(size.substr(x + 1));
+      } else if (arg == "--frames" && i + 1 < argc) {
+        options.frames = std::max(2, std::stoi(argv[++i]));
+      } else if (arg == "--help" || arg == "-h") {
+        printUsage(argv[0]);
+        return EXIT_SUCCESS;
+      } else {
+        std::cerr << "Unknown argument: " << arg << std::endl;
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+      }
+    }
+    if (options.width == 0 || options.height == 0) {
+      throw std::runtime_error("frame size must not be empty!");
+    }
+
+    Frames frames;
+    for (int frame = 0; frame < options.frames; frame++) {
+      frames.push_back(makeFrame(options.width, options.height, frame));
+    }
+    TemporaryDirectory directory;
+    writeSequence(directory.path, options, frames);
+    std::vector<std::vector<uint8_t>> files =
+        renderFiles(directory.path, directory.path / "out", options);
+
+    int mismatches = 0;
+    std::vector<std::vector<uint8_t>> pushed;
+    renderPushed(options, frames, false, pushed);
+    mismatches += compare("copied", files, pushed);
+    if (renderPushed(options, frames, true, pushed)) {
+      mismatches += compare("imported", files, pushed);
+    } else {
+      std::cout << "imported: skipped, the device can't import host memory"
+                << std::endl;
+    }
+    if (mismatches > 0) {
+      std::cout << "Push check failed" << std::endl;
+      return 1;
+    }
+    std::cout << "Push check passed" << std::endl;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}